@@ -0,0 +1,197 @@
+/* File:     mpi_balance.c
+ *
+ * Purpose:  Throughput-proportional repartitioning of block-distributed
+ *           vectors (see mpi_balance.h)
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <mpi.h>
+#include "vector_ops.h"
+#include "mpi_balance.h"
+
+#define BALANCE_MIN_TIME  1.0e-9   /* floor for the measured times */
+
+/*---------------------------------------------------------------------
+ * Function:  Balance_counts
+ * Purpose:   Compute block sizes proportional to the throughput of
+ *            each process
+ * In args:   counts:      current block sizes
+ *            local_time:  time the calling process took on its block
+ *            comm:        communicator containing the vectors
+ * Out args:  new_counts:  new block sizes, with the same total
+ * Ret val:   1 on success; 0 on every process if an allocation fails
+ *            somewhere (then new_counts is unchanged)
+ *
+ * Note:
+ *    The throughput of process q is counts[q]/time.  The ideal shares
+ *    are rounded down and the remaining elements go to the largest
+ *    remainders, so every process computes the same counts.  While
+ *    the order allows it, each process keeps at least one element so
+ *    that its throughput can still be measured.
+ */
+int Balance_counts(
+      const int  counts[]      /* in  */,
+      double     local_time    /* in  */,
+      int        new_counts[]  /* out */,
+      MPI_Comm   comm          /* in  */) {
+   int comm_sz, q, best, ok;
+   long long n = 0, assigned = 0;
+   double *times, *share, total_rate = 0.0;
+
+   MPI_Comm_size(comm, &comm_sz);
+   times = malloc(2*comm_sz*sizeof(double));
+   ok = times != NULL;
+   MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, comm);
+   if (!ok) {
+      free(times);
+      return 0;
+   }
+   share = times + comm_sz;
+   if (local_time < BALANCE_MIN_TIME) local_time = BALANCE_MIN_TIME;
+   MPI_Allgather(&local_time, 1, MPI_DOUBLE, times, 1, MPI_DOUBLE, comm);
+
+   for (q = 0; q < comm_sz; q++) {
+      n += counts[q];
+      // A process with no elements gets the mean throughput
+      share[q] = counts[q] > 0 ? counts[q]/times[q] : -1.0;
+      if (share[q] > 0.0) total_rate += share[q];
+   }
+   for (q = 0; q < comm_sz; q++)
+      if (share[q] < 0.0) share[q] = total_rate/comm_sz;
+   total_rate = 0.0;
+   for (q = 0; q < comm_sz; q++)
+      total_rate += share[q];
+
+   for (q = 0; q < comm_sz; q++) {
+      share[q] *= n/total_rate;
+      new_counts[q] = (int) floor(share[q]);
+      if (new_counts[q] < 1 && n >= comm_sz) new_counts[q] = 1;
+      share[q] -= new_counts[q];
+      assigned += new_counts[q];
+   }
+   // Hand out or take back the difference by largest remainder
+   while (assigned != n) {
+      best = -1;
+      for (q = 0; q < comm_sz; q++) {
+         if (assigned < n && (best < 0 || share[q] > share[best]))
+            best = q;
+         if (assigned > n && new_counts[q] > 1
+               && (best < 0 || share[q] < share[best]))
+            best = q;
+      }
+      if (assigned < n) {
+         new_counts[best]++;
+         share[best] -= 1.0;
+         assigned++;
+      } else {
+         new_counts[best]--;
+         share[best] += 1.0;
+         assigned--;
+      }
+   }
+
+   free(times);
+   return 1;
+}  /* Balance_counts */
+
+/*---------------------------------------------------------------------
+ * Function:  Redistribute
+ * Purpose:   Move a vector from the distribution counts to new_counts
+ * In args:   counts, new_counts:  old and new block sizes
+ *            comm:                communicator containing the vector
+ * In/out:    local_v_p:           the local block, replaced by a new
+ *                                 block of new_counts[my_rank] elements
+ * Ret val:   Number of elements the calling process received from
+ *            other processes; -1 on every process if an allocation
+ *            fails somewhere (then *local_v_p is unchanged)
+ *
+ * Note:
+ *    The old and new blocks are both contiguous and in rank order, so a
+ *    process exchanges elements only with the processes whose ranges
+ *    overlap its own, normally its neighbours.  The part of its range
+ *    that it keeps is copied locally.
+ */
+long long Redistribute(
+      double**   local_v_p     /* in/out */,
+      const int  counts[]      /* in     */,
+      const int  new_counts[]  /* in     */,
+      MPI_Comm   comm          /* in     */) {
+   int comm_sz, my_rank, q, nreqs = 0, ok;
+   long long lo, hi, new_lo, new_hi, q_lo = 0, q_new_lo = 0, a, b;
+   long long received = 0;
+   double *v = *local_v_p, *w;
+   MPI_Request* reqs;
+
+   MPI_Comm_size(comm, &comm_sz);
+   MPI_Comm_rank(comm, &my_rank);
+   lo = new_lo = 0;
+   for (q = 0; q < my_rank; q++) {
+      lo += counts[q];
+      new_lo += new_counts[q];
+   }
+   hi = lo + counts[my_rank];
+   new_hi = new_lo + new_counts[my_rank];
+
+   w = Vec_alloc(new_counts[my_rank] > 0 ? new_counts[my_rank] : 1,
+         sizeof(double));
+   reqs = malloc(2*comm_sz*sizeof(MPI_Request));
+   ok = w != NULL && reqs != NULL;
+   MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, comm);
+   if (!ok) {
+      free(w);
+      free(reqs);
+      return -1;
+   }
+
+   for (q = 0; q < comm_sz; q++) {
+      // What q used to own that the calling process owns now
+      a = q_lo > new_lo ? q_lo : new_lo;
+      b = q_lo + counts[q] < new_hi ? q_lo + counts[q] : new_hi;
+      if (a < b) {
+         if (q == my_rank)
+            memcpy(w + (a - new_lo), v + (a - lo), (b - a)*sizeof(double));
+         else {
+            MPI_Irecv(w + (a - new_lo), b - a, MPI_DOUBLE, q, 0, comm,
+                  &reqs[nreqs++]);
+            received += b - a;
+         }
+      }
+      // What q owns now that the calling process used to own
+      a = q_new_lo > lo ? q_new_lo : lo;
+      b = q_new_lo + new_counts[q] < hi ? q_new_lo + new_counts[q] : hi;
+      if (a < b && q != my_rank)
+         MPI_Isend(v + (a - lo), b - a, MPI_DOUBLE, q, 0, comm,
+               &reqs[nreqs++]);
+
+      q_lo += counts[q];
+      q_new_lo += new_counts[q];
+   }
+   MPI_Waitall(nreqs, reqs, MPI_STATUSES_IGNORE);
+
+   free(reqs);
+   free(v);
+   *local_v_p = w;
+   return received;
+}  /* Redistribute */
+
+/*---------------------------------------------------------------------
+ * Function:  Imbalance
+ * Purpose:   Load imbalance of a phase: the time of the slowest process
+ *            over the mean time
+ * In args:   local_time:  the calling process' time
+ *            comm:        communicator containing the processes
+ * Ret val:   The imbalance (1 means perfectly balanced), on every
+ *            process
+ */
+double Imbalance(
+      double    local_time  /* in */,
+      MPI_Comm  comm        /* in */) {
+   double max_time, sum_time;
+   int comm_sz;
+
+   MPI_Comm_size(comm, &comm_sz);
+   MPI_Allreduce(&local_time, &max_time, 1, MPI_DOUBLE, MPI_MAX, comm);
+   MPI_Allreduce(&local_time, &sum_time, 1, MPI_DOUBLE, MPI_SUM, comm);
+   return sum_time > 0.0 ? max_time*comm_sz/sum_time : 1.0;
+}  /* Imbalance */
@@ -0,0 +1,34 @@
+/* File:     mpi_balance.h
+ *
+ * Purpose:  Dynamic load balancing of vectors with a contiguous block
+ *           distribution.  The blocks are resized in proportion to the
+ *           throughput each process measured on its kernel, and the
+ *           vectors are moved to the new blocks exchanging only the
+ *           elements that change owner.
+ *
+ * Compile:  Link mpi_balance.c and vector_ops.c into the program.
+ *
+ * Notes:
+ * 1.  A distribution is given by counts[q], the number of elements of
+ *     process q; process q owns the elements that follow those of
+ *     processes 0, ..., q-1.  Every process holds the whole counts
+ *     array.
+ * 2.  Usage:  time the kernel on the local block, call Balance_counts
+ *     with that time to get the new counts (the same on every
+ *     process), then Redistribute each vector from the old counts to
+ *     the new ones.  This can be repeated between iterations.
+ * 3.  Both functions agree on their allocations with an MPI_Allreduce
+ *     and report a failure on every process.
+ */
+#ifndef MPI_BALANCE_H
+#define MPI_BALANCE_H
+
+#include <mpi.h>
+
+int Balance_counts(const int counts[], double local_time, int new_counts[],
+      MPI_Comm comm);
+long long Redistribute(double** local_v_p, const int counts[],
+      const int new_counts[], MPI_Comm comm);
+double Imbalance(double local_time, MPI_Comm comm);
+
+#endif /* MPI_BALANCE_H */
@@ -0,0 +1,203 @@
+/* File:     mpi_blas1.c
+ *
+ * Purpose:  Reductions of the BLAS-1 suite on block-distributed
+ *           vectors (see mpi_blas1.h).  Each one is a single pass over
+ *           the local block followed by a single MPI_Allreduce.
+ */
+#include <math.h>
+#include <mpi.h>
+#include "mpi_blas1.h"
+
+static MPI_Datatype pair_type = MPI_DATATYPE_NULL;  /* (scale, ssq) */
+static MPI_Op sumsq_op = MPI_OP_NULL;
+
+static void Nrm2_setup(void);
+static int Nrm2_cleanup(MPI_Comm comm, int keyval, void* attr,
+      void* extra);
+static void Sumsq_op(void* in, void* inout, int* len, MPI_Datatype* type);
+static int Parallel_iamaxmin(const double local_x[], int local_n,
+      int local_i, MPI_Op op, MPI_Comm comm);
+
+/*---------------------------------------------------------------------
+ * Function:  Parallel_dot
+ * Purpose:   Global dot product of two distributed vectors
+ * In args:   local_x, local_y:  local blocks of the vectors
+ *            local_n:           size of the local blocks
+ *            comm:              communicator containing the vectors
+ * Ret val:   x.y on every process
+ */
+double Parallel_dot(
+      const double  local_x[]  /* in */,
+      const double  local_y[]  /* in */,
+      int           local_n    /* in */,
+      MPI_Comm      comm       /* in */) {
+   double local_dot, dot;
+
+   local_dot = Dot_product(local_x, local_y, local_n);
+   MPI_Allreduce(&local_dot, &dot, 1, MPI_DOUBLE, MPI_SUM, comm);
+   return dot;
+}  /* Parallel_dot */
+
+/*---------------------------------------------------------------------
+ * Function:  Parallel_asum
+ * Purpose:   Global sum of absolute values of a distributed vector
+ * In args:   local_x:  local block of the vector
+ *            local_n:  size of the local block
+ *            comm:     communicator containing the vector
+ * Ret val:   sum of |x[i]| on every process
+ */
+double Parallel_asum(
+      const double  local_x[]  /* in */,
+      int           local_n    /* in */,
+      MPI_Comm      comm       /* in */) {
+   double local_sum, sum;
+
+   local_sum = Asum(local_x, local_n);
+   MPI_Allreduce(&local_sum, &sum, 1, MPI_DOUBLE, MPI_SUM, comm);
+   return sum;
+}  /* Parallel_asum */
+
+/*---------------------------------------------------------------------
+ * Function:  Parallel_nrm2
+ * Purpose:   Overflow-safe global 2-norm of a distributed vector
+ * In args:   local_x:  local block of the vector
+ *            local_n:  size of the local block
+ *            comm:     communicator containing the vector
+ * Ret val:   ||x||_2 on every process
+ *
+ * Note:
+ *    Each process contributes a (scale, ssq) pair; the pairs are
+ *    combined by a user-defined operation so that no process ever
+ *    forms the unscaled sum of squares.  The pair type and the
+ *    operation are created by the first call and reused, so later
+ *    calls cost one MPI_Allreduce like Parallel_dot.
+ */
+double Parallel_nrm2(
+      const double  local_x[]  /* in */,
+      int           local_n    /* in */,
+      MPI_Comm      comm       /* in */) {
+   double local_pair[2], pair[2];
+
+   Scaled_sumsq(local_x, local_n, &local_pair[0], &local_pair[1]);
+
+   Nrm2_setup();
+   MPI_Allreduce(local_pair, pair, 1, pair_type, sumsq_op, comm);
+
+   return pair[0]*sqrt(pair[1]);
+}  /* Parallel_nrm2 */
+
+/*---------------------------------------------------------------------
+ * Function:  Nrm2_setup
+ * Purpose:   Create the (scale, ssq) type and the Sumsq_op operation
+ *            once, and arrange for MPI_Finalize to free them
+ *
+ * Note:
+ *    MPI_Finalize deletes the attributes of MPI_COMM_SELF first, so
+ *    the delete callback of an attribute set on it runs while MPI can
+ *    still free handles.  Not thread safe: make the first call from
+ *    one thread.
+ */
+static void Nrm2_setup(void) {
+   int keyval;
+
+   if (sumsq_op != MPI_OP_NULL) return;
+   MPI_Type_contiguous(2, MPI_DOUBLE, &pair_type);
+   MPI_Type_commit(&pair_type);
+   MPI_Op_create(Sumsq_op, 1, &sumsq_op);
+   MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, Nrm2_cleanup, &keyval,
+         NULL);
+   MPI_Comm_set_attr(MPI_COMM_SELF, keyval, NULL);
+   MPI_Comm_free_keyval(&keyval);
+}  /* Nrm2_setup */
+
+/*---------------------------------------------------------------------
+ * Function:  Nrm2_cleanup
+ * Purpose:   Attribute delete callback freeing what Nrm2_setup made
+ */
+static int Nrm2_cleanup(MPI_Comm comm, int keyval, void* attr,
+      void* extra) {
+   MPI_Op_free(&sumsq_op);
+   MPI_Type_free(&pair_type);
+   return MPI_SUCCESS;
+}  /* Nrm2_cleanup */
+
+/*---------------------------------------------------------------------
+ * Function:  Parallel_iamax
+ * Purpose:   Global index of the first element with the largest
+ *            absolute value of a distributed vector
+ * In args:   local_x:  local block of the vector
+ *            local_n:  size of the local block
+ *            comm:     communicator containing the vector
+ * Ret val:   The 0-based global index on every process (-1 if the
+ *            vector is empty)
+ */
+int Parallel_iamax(
+      const double  local_x[]  /* in */,
+      int           local_n    /* in */,
+      MPI_Comm      comm       /* in */) {
+   return Parallel_iamaxmin(local_x, local_n, Iamax(local_x, local_n),
+         MPI_MAXLOC, comm);
+}  /* Parallel_iamax */
+
+/*---------------------------------------------------------------------
+ * Function:  Parallel_iamin
+ * Purpose:   Global index of the first element with the smallest
+ *            absolute value of a distributed vector
+ * In args:   local_x:  local block of the vector
+ *            local_n:  size of the local block
+ *            comm:     communicator containing the vector
+ * Ret val:   The 0-based global index on every process (-1 if the
+ *            vector is empty)
+ */
+int Parallel_iamin(
+      const double  local_x[]  /* in */,
+      int           local_n    /* in */,
+      MPI_Comm      comm       /* in */) {
+   return Parallel_iamaxmin(local_x, local_n, Iamin(local_x, local_n),
+         MPI_MINLOC, comm);
+}  /* Parallel_iamin */
+
+/*---------------------------------------------------------------------
+ * Function:  Parallel_iamaxmin
+ * Purpose:   Combine the local winners of Iamax or Iamin with one
+ *            MAXLOC/MINLOC reduction.  On ties MPI keeps the smaller
+ *            index, which is the first occurrence.
+ * In args:   local_x, local_n:  local block of the vector
+ *            local_i:           local index of the local winner
+ *            op:                MPI_MAXLOC or MPI_MINLOC
+ *            comm:              communicator containing the vector
+ */
+static int Parallel_iamaxmin(
+      const double  local_x[]  /* in */,
+      int           local_n    /* in */,
+      int           local_i    /* in */,
+      MPI_Op        op         /* in */,
+      MPI_Comm      comm       /* in */) {
+   struct { double val; int idx; } local_best, best;
+   int my_rank;
+
+   MPI_Comm_rank(comm, &my_rank);
+   if (local_i >= 0) {
+      local_best.val = fabs(local_x[local_i]);
+      local_best.idx = my_rank*local_n + local_i;
+   } else {
+      /* Empty block: a value that never wins */
+      local_best.val = (op == MPI_MAXLOC) ? -1.0 : INFINITY;
+      local_best.idx = -1;
+   }
+   MPI_Allreduce(&local_best, &best, 1, MPI_DOUBLE_INT, op, comm);
+   return best.idx;
+}  /* Parallel_iamaxmin */
+
+/*---------------------------------------------------------------------
+ * Function:  Sumsq_op
+ * Purpose:   MPI user operation combining (scale, ssq) pairs
+ */
+static void Sumsq_op(void* in, void* inout, int* len, MPI_Datatype* type) {
+   double* a = in;
+   double* b = inout;
+   int i;
+
+   for (i = 0; i < *len; i++)
+      Sumsq_merge(&b[2*i], &b[2*i+1], a[2*i], a[2*i+1]);
+}  /* Sumsq_op */
@@ -0,0 +1,38 @@
+/* File:     mpi_blas1.h
+ *
+ * Purpose:  BLAS-1 operations on block-distributed double vectors.
+ *           Elementwise operations need no communication and are the
+ *           kernels of vector_ops.h applied to the local block; each
+ *           reduction costs exactly one MPI_Allreduce and returns the
+ *           global result on every process.
+ *
+ * Compile:  Link mpi_blas1.c, mpi_vector_utils.c and vector_ops.c
+ *           into the program (and -lm).
+ *
+ * Note:
+ *    Global indices assume the block distribution used throughout:
+ *    process q owns elements q*local_n, ..., (q+1)*local_n - 1.
+ */
+#ifndef MPI_BLAS1_H
+#define MPI_BLAS1_H
+
+#include <mpi.h>
+#include "vector_ops.h"
+
+#define Parallel_axpy(local_x, local_y, local_n, alpha) \
+      Axpy(local_x, local_y, local_n, alpha)
+#define Parallel_axpby(local_x, local_y, local_n, alpha, beta) \
+      Axpby(local_x, local_y, local_n, alpha, beta)
+#define Parallel_copy(local_x, local_y, local_n) \
+      Copy_vector(local_x, local_y, local_n)
+#define Parallel_swap(local_x, local_y, local_n) \
+      Swap_vectors(local_x, local_y, local_n)
+
+double Parallel_dot(const double local_x[], const double local_y[],
+      int local_n, MPI_Comm comm);
+double Parallel_asum(const double local_x[], int local_n, MPI_Comm comm);
+double Parallel_nrm2(const double local_x[], int local_n, MPI_Comm comm);
+int Parallel_iamax(const double local_x[], int local_n, MPI_Comm comm);
+int Parallel_iamin(const double local_x[], int local_n, MPI_Comm comm);
+
+#endif /* MPI_BLAS1_H */
@@ -0,0 +1,194 @@
+/* File:     mpi_blas1_bench.c
+ *
+ * Purpose:  Check and benchmark the BLAS-1 suite of mpi_blas1.h on
+ *           block-distributed vectors: copy, swap, scal, axpy, axpby,
+ *           dot, asum, nrm2, iamax and iamin.
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_blas1_bench \
+ *              mpi_blas1_bench.c mpi_blas1.c mpi_vector_utils.c vector_ops.c -lm
+ * Run:      mpiexec -n <comm_sz> ./mpi_blas1_bench <order of the vectors> <iterations>
+ *
+ * Input:    The order of the vectors, n, and the number of times each
+ *           operation is repeated
+ * Output:   For each operation, its last result (reductions), the time
+ *           per call and the achieved memory bandwidth in GB/s summed
+ *           over all processes
+ *
+ * Notes:
+ * 1.  The order of the vectors, n, should be evenly divisible by comm_sz
+ * 2.  The bandwidth counts the bytes each operation must read and
+ *     write once (e.g., 3 doubles per element for axpy), and uses the
+ *     time of the slowest process.
+ * 3.  Before timing, nrm2 is checked on a vector whose squares
+ *     overflow, and iamax/iamin on planted extreme values.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+#include "mpi_blas1.h"
+
+enum { COPY, SWAP, SCAL, AXPY, AXPBY, DOT, ASUM, NRM2, IAMAX, IAMIN, NUM_OPS };
+
+static const char* op_names[NUM_OPS] = {"copy", "swap", "scal", "axpy",
+   "axpby", "dot", "asum", "nrm2", "iamax", "iamin"};
+/* Doubles read plus written per element */
+static const int op_doubles[NUM_OPS] = {2, 4, 2, 3, 3, 2, 1, 1, 1, 1};
+
+double Run_op(int op, double local_x[], double local_y[], int local_n,
+      MPI_Comm comm);
+void Check_special_cases(int local_n, int n, int my_rank, MPI_Comm comm);
+
+int main(int argc, char* argv[]) {
+    int n, local_n, iters, op, it;
+    int comm_sz, my_rank;
+    double *local_x, *local_y;
+    MPI_Comm comm;
+    double start, local_time, time, result = 0.0;
+
+    // Initialize MPI
+    MPI_Init(&argc, &argv);
+    comm = MPI_COMM_WORLD;
+    MPI_Comm_size(comm, &comm_sz);
+    MPI_Comm_rank(comm, &my_rank);
+
+    if (argc != 3) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Usage: %s <order of the vectors> <iterations>\n", argv[0]);
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    n = atoi(argv[1]);
+    iters = atoi(argv[2]);
+    if (n <= 0 || n % comm_sz != 0 || iters <= 0) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Order of the vectors should be a positive integer and evenly divisible by the number of processes, and iterations positive\n");
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    local_n = n / comm_sz;
+
+    Check_special_cases(local_n, n, my_rank, comm);
+
+    Allocate_vectors(&local_x, &local_y, NULL, local_n, comm);
+    Generate_vector(local_x, local_n, my_rank, 1);
+    Generate_vector(local_y, local_n, my_rank, 2);
+
+    if (my_rank == 0) {
+        printf("%-8s %16s %14s %10s\n", "op", "result", "s/call", "GB/s");
+    }
+    for (op = 0; op < NUM_OPS; op++) {
+        MPI_Barrier(comm);
+        start = MPI_Wtime();
+        for (it = 0; it < iters; it++)
+            result = Run_op(op, local_x, local_y, local_n, comm);
+        local_time = MPI_Wtime() - start;
+        MPI_Reduce(&local_time, &time, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+
+        if (my_rank == 0) {
+            printf("%-8s %16.6g %14.6e %10.2f\n", op_names[op], result,
+                  time/iters,
+                  (double)op_doubles[op]*sizeof(double)*n*iters/time/1.0e9);
+        }
+    }
+
+    free(local_x);
+    free(local_y);
+
+    MPI_Finalize();
+    return 0;
+}  /* main */
+
+/*---------------------------------------------------------------------
+ * Function:  Run_op
+ * Purpose:   Run one operation of the suite on x and y
+ * In args:   op:       the operation
+ *            local_n:  size of the local blocks
+ *            comm:     communicator containing the vectors
+ * In/out:    local_x, local_y:  local blocks of the vectors
+ * Ret val:   The result of a reduction, 0 for the other operations
+ *
+ * Note:
+ *    The factors keep the values bounded over many iterations.
+ */
+double Run_op(
+      int       op         /* in     */,
+      double    local_x[]  /* in/out */,
+      double    local_y[]  /* in/out */,
+      int       local_n    /* in     */,
+      MPI_Comm  comm       /* in     */) {
+   switch (op) {
+      case COPY:  Parallel_copy(local_x, local_y, local_n); break;
+      case SWAP:  Parallel_swap(local_x, local_y, local_n); break;
+      case SCAL:  Parallel_scalar_multiplication(local_x, local_n, 1.0); break;
+      case AXPY:  Parallel_axpy(local_x, local_y, local_n, 0.0); break;
+      case AXPBY: Parallel_axpby(local_x, local_y, local_n, 0.5, 0.5); break;
+      case DOT:   return Parallel_dot(local_x, local_y, local_n, comm);
+      case ASUM:  return Parallel_asum(local_x, local_n, comm);
+      case NRM2:  return Parallel_nrm2(local_x, local_n, comm);
+      case IAMAX: return Parallel_iamax(local_x, local_n, comm);
+      case IAMIN: return Parallel_iamin(local_x, local_n, comm);
+   }
+   return 0.0;
+}  /* Run_op */
+
+/*---------------------------------------------------------------------
+ * Function:  Check_special_cases
+ * Purpose:   Verify nrm2 on values whose squares overflow double, and
+ *            on values just under the unscaled limit in many tiles, and
+ *            iamax/iamin on extreme values planted on the last process
+ * In args:   local_n, n:  local and global order of the vectors
+ *            my_rank:     calling process' rank in comm
+ *            comm:        communicator containing the vectors
+ *
+ * Errors:    If a check fails, the program terminates
+ */
+void Check_special_cases(
+      int       local_n  /* in */,
+      int       n        /* in */,
+      int       my_rank  /* in */,
+      MPI_Comm  comm     /* in */) {
+   double *local_x;
+   double big = 1.0e300, nrm2, expected;
+   int comm_sz, i, imax, imin, ok;
+
+   MPI_Comm_size(comm, &comm_sz);
+   Allocate_vectors(&local_x, NULL, NULL, local_n, comm);
+
+   for (i = 0; i < local_n; i++)
+      local_x[i] = big;
+   nrm2 = Parallel_nrm2(local_x, local_n, comm);
+   expected = big*sqrt((double)n);
+   ok = fabs(nrm2 - expected) <= 1.0e-12*expected;
+   Check_for_error(ok, "Check_special_cases", "nrm2 overflowed", comm);
+
+   // Just inside the unscaled range, so every tile is summed unscaled
+   big = 0.9*sqrt(DBL_MAX/(2*VEC_TILE));
+   for (i = 0; i < local_n; i++)
+      local_x[i] = big;
+   nrm2 = Parallel_nrm2(local_x, local_n, comm);
+   expected = big*sqrt((double)n);
+   ok = fabs(nrm2 - expected) <= 1.0e-12*expected;
+   Check_for_error(ok, "Check_special_cases",
+         "nrm2 overflowed on unscaled tiles", comm);
+
+   for (i = 0; i < local_n; i++)
+      local_x[i] = 1.0 + (double)(my_rank*local_n + i)/n;
+   if (my_rank == comm_sz - 1) {
+      local_x[0] = 0.5;
+      local_x[local_n - 1] = -10.0;
+   }
+   imax = Parallel_iamax(local_x, local_n, comm);
+   imin = Parallel_iamin(local_x, local_n, comm);
+   ok = (imax == n - 1) && (imin == (comm_sz - 1)*local_n || local_n == 1);
+   Check_for_error(ok, "Check_special_cases", "wrong iamax/iamin index",
+         comm);
+
+   free(local_x);
+}  /* Check_special_cases */
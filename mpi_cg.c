@@ -0,0 +1,251 @@
+/* File:     mpi_cg.c
+ *
+ * Purpose:  Classic and pipelined conjugate gradient solvers (see
+ *           mpi_cg.h)
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <mpi.h>
+#include "vector_ops.h"
+#include "mpi_spmv.h"
+#include "mpi_cg.h"
+
+static double** Alloc_work(int count, int local_n, MPI_Comm comm);
+static void Free_work(double** work, int count);
+static void Timed_allreduce(double local[], double global[], int count,
+      MPI_Comm comm, double* time_p);
+
+/*---------------------------------------------------------------------
+ * Function:  Cg_solve
+ * Purpose:   Solve A*x = b with the classic conjugate gradient method
+ * In args:   b:          local block of the right-hand side
+ *            tol:        relative tolerance on ||r||/||b||
+ *            max_iters:  maximum number of iterations
+ * In/out:    A:          the matrix (its halo buffers are used)
+ *            x:          local block of the initial guess on input,
+ *                        of the solution on output
+ * Out args:  stats:      iterations, final residual and times
+ * Ret val:   1 if the tolerance was met, 0 if not or if the work
+ *            vectors can't be allocated on some process (then
+ *            stats->iters is -1 on every process)
+ *
+ * Note:
+ *    Each iteration makes one product and two blocking reductions,
+ *    p.Ap before the step and r.r after it.
+ */
+int Cg_solve(
+      Csr_matrix*   A          /* in/out */,
+      const double  b[]        /* in     */,
+      double        x[]        /* in/out */,
+      double        tol        /* in     */,
+      int           max_iters  /* in     */,
+      Cg_stats*     stats      /* out    */) {
+   int n = A->local_n, it = 0;
+   double **work, *r, *p, *q;
+   double local[2], global[2], rr, bb, alpha, beta, start;
+
+   stats->reduce_time = 0.0;
+   start = MPI_Wtime();
+   if ((work = Alloc_work(3, n, A->comm)) == NULL) {
+      stats->iters = -1;
+      return 0;
+   }
+   r = work[0];
+   p = work[1];
+   q = work[2];
+
+   Spmv(A, x, q);
+   Copy_vector(b, r, n);
+   Axpy(q, r, n, -1.0);
+   Copy_vector(r, p, n);
+   local[0] = Dot_product(r, r, n);
+   local[1] = Dot_product(b, b, n);
+   Timed_allreduce(local, global, 2, A->comm, &stats->reduce_time);
+   rr = global[0];
+   bb = global[1];
+
+   while (it < max_iters && sqrt(rr) > tol*sqrt(bb)) {
+      Spmv(A, p, q);
+      local[0] = Dot_product(p, q, n);
+      Timed_allreduce(local, global, 1, A->comm, &stats->reduce_time);
+      alpha = rr/global[0];
+      Axpy(p, x, n, alpha);
+      Axpy(q, r, n, -alpha);
+      local[0] = Dot_product(r, r, n);
+      Timed_allreduce(local, global, 1, A->comm, &stats->reduce_time);
+      beta = global[0]/rr;
+      rr = global[0];
+      Axpby(r, p, n, 1.0, beta);
+      it++;
+   }
+
+   Free_work(work, 3);
+   stats->iters = it;
+   stats->res_norm = sqrt(rr);
+   stats->time = MPI_Wtime() - start;
+   return sqrt(rr) <= tol*sqrt(bb);
+}  /* Cg_solve */
+
+/*---------------------------------------------------------------------
+ * Function:  Pipelined_cg_solve
+ * Purpose:   Solve A*x = b with the pipelined conjugate gradient method
+ * In args:   b:          local block of the right-hand side
+ *            tol:        relative tolerance on ||r||/||b||
+ *            max_iters:  maximum number of iterations
+ * In/out:    A:          the matrix (its halo buffers are used)
+ *            x:          local block of the initial guess on input,
+ *                        of the solution on output
+ * Out args:  stats:      iterations, final residual and times
+ * Ret val:   1 if the tolerance was met, 0 if not or if the work
+ *            vectors can't be allocated on some process (then
+ *            stats->iters is -1 on every process)
+ *
+ * Note:
+ *    gamma = r.r and delta = w.r (and b.b the first time) go into one
+ *    MPI_Iallreduce, which completes while q = A*w is computed.  Then
+ *       beta = gamma/gamma_old, alpha = gamma/(delta - beta*gamma/alpha_old)
+ *       z = q + beta*z,  s = w + beta*s,  p = r + beta*p
+ *       x += alpha*p,    r -= alpha*s,    w -= alpha*z
+ *    with beta = 0 and alpha = gamma/delta in the first iteration.
+ */
+int Pipelined_cg_solve(
+      Csr_matrix*   A          /* in/out */,
+      const double  b[]        /* in     */,
+      double        x[]        /* in/out */,
+      double        tol        /* in     */,
+      int           max_iters  /* in     */,
+      Cg_stats*     stats      /* out    */) {
+   int n = A->local_n, it;
+   double **work, *r, *w, *p, *s, *z, *q;
+   double local[3], global[3], gamma, delta, bb = 0.0;
+   double gamma_old = 1.0, alpha_old = 1.0, alpha, beta, start, wait;
+   MPI_Request req;
+
+   stats->reduce_time = 0.0;
+   start = MPI_Wtime();
+   if ((work = Alloc_work(6, n, A->comm)) == NULL) {
+      stats->iters = -1;
+      return 0;
+   }
+   r = work[0];
+   w = work[1];
+   p = work[2];
+   s = work[3];
+   z = work[4];
+   q = work[5];
+
+   Spmv(A, x, q);
+   Copy_vector(b, r, n);
+   Axpy(q, r, n, -1.0);
+   Spmv(A, r, w);
+
+   for (it = 0; ; it++) {
+      local[0] = Dot_product(r, r, n);
+      local[1] = Dot_product(w, r, n);
+      if (it == 0) local[2] = Dot_product(b, b, n);
+      MPI_Iallreduce(local, global, it == 0 ? 3 : 2, MPI_DOUBLE, MPI_SUM,
+            A->comm, &req);
+      Spmv(A, w, q);
+      wait = MPI_Wtime();
+      MPI_Wait(&req, MPI_STATUS_IGNORE);
+      stats->reduce_time += MPI_Wtime() - wait;
+
+      gamma = global[0];
+      delta = global[1];
+      if (it == 0) bb = global[2];
+      if (sqrt(gamma) <= tol*sqrt(bb) || it == max_iters) break;
+
+      if (it == 0) {
+         beta = 0.0;
+         alpha = gamma/delta;
+      } else {
+         beta = gamma/gamma_old;
+         alpha = gamma/(delta - beta*gamma/alpha_old);
+      }
+      Axpby(q, z, n, 1.0, beta);
+      Axpby(w, s, n, 1.0, beta);
+      Axpby(r, p, n, 1.0, beta);
+      Axpy(p, x, n, alpha);
+      Axpy(s, r, n, -alpha);
+      Axpy(z, w, n, -alpha);
+      gamma_old = gamma;
+      alpha_old = alpha;
+   }
+
+   Free_work(work, 6);
+   stats->iters = it;
+   stats->res_norm = sqrt(gamma);
+   stats->time = MPI_Wtime() - start;
+   return sqrt(gamma) <= tol*sqrt(bb);
+}  /* Pipelined_cg_solve */
+
+/*---------------------------------------------------------------------
+ * Function:  Alloc_work
+ * Purpose:   Allocate zeroed work vectors on every process of comm
+ * In args:   count:    number of vectors
+ *            local_n:  order of each
+ *            comm:     communicator of the solver
+ * Ret val:   array of count vectors, or NULL on every process if the
+ *            allocation fails on any (so no process is left waiting in
+ *            the solver's collectives)
+ */
+static double** Alloc_work(
+      int       count    /* in */,
+      int       local_n  /* in */,
+      MPI_Comm  comm     /* in */) {
+   double** work = malloc(count*sizeof(double*));
+   int k = 0, local_ok = work != NULL, ok;
+
+   for (; local_ok && k < count; k++) {
+      work[k] = Vec_alloc(local_n > 0 ? local_n : 1, sizeof(double));
+      if (work[k] == NULL)
+         local_ok = 0;
+      else
+         memset(work[k], 0, local_n*sizeof(double));
+   }
+   MPI_Allreduce(&local_ok, &ok, 1, MPI_INT, MPI_MIN, comm);
+   if (!ok) {
+      if (work != NULL)
+         Free_work(work, local_ok ? count : k - 1);
+      return NULL;
+   }
+   return work;
+}  /* Alloc_work */
+
+/*---------------------------------------------------------------------
+ * Function:  Free_work
+ * Purpose:   Release work vectors from Alloc_work
+ * In args:   count:  number of vectors
+ * In/out:    work:   the vectors, freed
+ */
+static void Free_work(
+      double**  work   /* in/out */,
+      int       count  /* in     */) {
+   int k;
+
+   for (k = 0; k < count; k++)
+      free(work[k]);
+   free(work);
+}  /* Free_work */
+
+/*---------------------------------------------------------------------
+ * Function:  Timed_allreduce
+ * Purpose:   Sum doubles over comm and add the time taken to *time_p
+ * In args:   local:   the local values
+ *            count:   how many
+ *            comm:    the communicator
+ * Out args:  global:  the sums
+ * In/out:    time_p:  accumulated seconds
+ */
+static void Timed_allreduce(
+      double    local[]   /* in     */,
+      double    global[]  /* out    */,
+      int       count     /* in     */,
+      MPI_Comm  comm      /* in     */,
+      double*   time_p    /* in/out */) {
+   double start = MPI_Wtime();
+
+   MPI_Allreduce(local, global, count, MPI_DOUBLE, MPI_SUM, comm);
+   *time_p += MPI_Wtime() - start;
+}  /* Timed_allreduce */
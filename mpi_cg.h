@@ -0,0 +1,41 @@
+/* File:     mpi_cg.h
+ *
+ * Purpose:  Conjugate gradient solvers for A*x = b with a symmetric
+ *           positive definite distributed sparse matrix (mpi_spmv.h),
+ *           assembled from the kernels of vector_ops.h.
+ *
+ * Compile:  Link mpi_cg.c, mpi_spmv.c and vector_ops.c into the program
+ *           (and -lm).
+ *
+ * Notes:
+ * 1.  Cg_solve is the classic algorithm: every iteration waits on two
+ *     MPI_Allreduce calls, one for p.Ap and one for r.r.
+ * 2.  Pipelined_cg_solve is the pipelined variant of Ghysels and
+ *     Vanroose (Parallel Computing 40, 2014).  It carries the extra
+ *     vectors w = A*r, s = A*p and z = A*s, updated by recurrence, so
+ *     the two dot products of an iteration are independent of the
+ *     matrix-vector product: they are reduced together with one
+ *     MPI_Iallreduce that runs while A*w is computed.  It does more
+ *     local work and the recurrences lose some accuracy, but it hides
+ *     the latency of the only global synchronization.
+ * 3.  Both stop when ||r|| <= tol*||b||; ||r|| is the recurrence
+ *     residual, not b - A*x.
+ */
+#ifndef MPI_CG_H
+#define MPI_CG_H
+
+#include "mpi_spmv.h"
+
+typedef struct {
+   int     iters;        /* iterations done                         */
+   double  res_norm;     /* ||r|| at the end                        */
+   double  time;         /* seconds in the solver                   */
+   double  reduce_time;  /* seconds waiting for reductions          */
+} Cg_stats;
+
+int Cg_solve(Csr_matrix* A, const double local_b[], double local_x[],
+      double tol, int max_iters, Cg_stats* stats);
+int Pipelined_cg_solve(Csr_matrix* A, const double local_b[],
+      double local_x[], double tol, int max_iters, Cg_stats* stats);
+
+#endif /* MPI_CG_H */
@@ -0,0 +1,134 @@
+/* File:     mpi_cg_bench.c
+ *
+ * Purpose:  Solve a 2D Poisson problem with the classic and the
+ *           pipelined conjugate gradient solvers of mpi_cg.h and compare
+ *           the time per iteration and the share spent in reductions.
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_cg_bench \
+ *              mpi_cg_bench.c mpi_cg.c mpi_spmv.c mpi_vector_utils.c vector_ops.c -lm
+ * Run:      mpiexec -n <comm_sz> ./mpi_cg_bench <grid size> <tolerance> <max iterations>
+ *
+ * Input:    g, the points per side of the grid (the order of the
+ *           system is g*g), the relative tolerance on the residual and
+ *           the maximum number of iterations
+ * Output:   For each solver the iterations, the time per iteration, the
+ *           percentage of it spent waiting for reductions and the true
+ *           relative residual ||b - A*x||/||b||
+ *
+ * Notes:
+ * 1.  g*g should be evenly divisible by comm_sz
+ * 2.  The matrix is the 5-point Laplacian of Csr_laplacian_2d; b = A*u
+ *     for a random u, and both solvers start from x = 0.
+ * 3.  The reduction share is the maximum over the processes.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+#include "mpi_cg.h"
+
+double True_residual(Csr_matrix* A, double local_b[], double local_x[],
+      double local_r[]);
+
+int main(int argc, char* argv[]) {
+    int g, max_iters, solver, converged;
+    int comm_sz, my_rank;
+    double *local_b, *local_x, *local_u, tol, res, share, local_share;
+    static const char* names[2] = {"classic", "pipelined"};
+    Csr_block block;
+    Csr_matrix A;
+    Cg_stats stats;
+    MPI_Comm comm;
+
+    // Initialize MPI
+    MPI_Init(&argc, &argv);
+    comm = MPI_COMM_WORLD;
+    MPI_Comm_size(comm, &comm_sz);
+    MPI_Comm_rank(comm, &my_rank);
+
+    if (argc != 4) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Usage: %s <grid size> <tolerance> <max iterations>\n", argv[0]);
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    g = atoi(argv[1]);
+    tol = atof(argv[2]);
+    max_iters = atoi(argv[3]);
+    if (g <= 0 || (g*g) % comm_sz != 0 || tol <= 0.0 || max_iters <= 0) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Grid size should be a positive integer with g*g evenly divisible by the number of processes, tolerance and iterations positive\n");
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    Check_for_error(Csr_laplacian_2d(&block, g, my_rank, comm_sz), "main",
+          "Can't allocate the matrix", comm);
+    Check_for_error(Csr_matrix_create(&block, &A, comm), "main",
+          "Can't build the distributed matrix", comm);
+    Csr_block_free(&block);
+    Allocate_vectors(&local_b, &local_x, &local_u, A.local_n, comm);
+    Generate_vector(local_u, A.local_n, my_rank, 1);
+    Spmv(&A, local_u, local_b);   // local_u is scratch from here on
+
+    if (my_rank == 0) {
+        printf("Poisson %d x %d, order %d, tolerance %g\n", g, g, A.n, tol);
+        printf("%-10s %6s %14s %9s %12s\n", "solver", "iters", "s/iteration",
+              "reduce %", "||b-Ax||/||b||");
+    }
+    for (solver = 0; solver < 2; solver++) {
+        memset(local_x, 0, A.local_n*sizeof(double));
+        MPI_Barrier(comm);
+        if (solver == 0)
+            converged = Cg_solve(&A, local_b, local_x, tol, max_iters, &stats);
+        else
+            converged = Pipelined_cg_solve(&A, local_b, local_x, tol, max_iters,
+                  &stats);
+        Check_for_error(stats.iters >= 0, "main", "Can't allocate solver vectors",
+              comm);
+        local_share = stats.time > 0.0 ? 100.0*stats.reduce_time/stats.time : 0.0;
+        MPI_Reduce(&local_share, &share, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+        res = True_residual(&A, local_b, local_x, local_u);
+        if (my_rank == 0)
+            printf("%-10s %6d %14.6e %8.1f%% %12.3e%s\n", names[solver],
+                  stats.iters, stats.time/(stats.iters > 0 ? stats.iters : 1),
+                  share, res, converged ? "" : "  (not converged)");
+    }
+
+    Csr_matrix_free(&A);
+    free(local_b);
+    free(local_x);
+    free(local_u);
+
+    MPI_Finalize();
+    return 0;
+}  /* main */
+
+/*---------------------------------------------------------------------
+ * Function:  True_residual
+ * Purpose:   Compute ||b - A*x||/||b||
+ * In args:   local_b:  local block of b
+ *            local_x:  local block of x
+ * Out args:  local_r:  scratch
+ * In/out:    A:        the matrix
+ * Ret val:   the relative residual, on every process
+ */
+double True_residual(
+      Csr_matrix*  A          /* in/out */,
+      double       local_b[]  /* in     */,
+      double       local_x[]  /* in     */,
+      double       local_r[]  /* out    */) {
+   double local[2], global[2];
+
+   Spmv(A, local_x, local_r);
+   Axpby(local_b, local_r, A->local_n, 1.0, -1.0);
+   local[0] = Dot_product(local_r, local_r, A->local_n);
+   local[1] = Dot_product(local_b, local_b, A->local_n);
+   MPI_Allreduce(local, global, 2, MPI_DOUBLE, MPI_SUM, A->comm);
+   return sqrt(global[0]/global[1]);
+}  /* True_residual */
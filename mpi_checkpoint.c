@@ -0,0 +1,326 @@
+/* File:     mpi_checkpoint.c
+ *
+ * Purpose:  Checkpoint and elastic restart of block-distributed
+ *           vectors (see mpi_checkpoint.h)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+#include "mpi_checkpoint.h"
+
+#define CKPT_MAGIC  "vector_checkpoint 1"
+
+static void Block_checksums(const double local_a[], int local_n,
+      long long first, long long block, long long nblocks,
+      unsigned long long sums[], int root, MPI_Comm comm);
+static int Write_manifest(char dir[], int nvec, char* names[], long long n,
+      long long nblocks, unsigned long long sums[]);
+static int Read_manifest(char dir[], int nvec, char* names[],
+      long long* n_p, long long* block_p, unsigned long long** sums_pp);
+
+/*---------------------------------------------------------------------
+ * Function:  Checkpoint_write
+ * Purpose:   Save distributed vectors to a checkpoint directory
+ * In args:   dir:         the directory (created if needed; an older
+ *                         checkpoint in it is replaced)
+ *            nvec:        number of vectors
+ *            names:       their names (no whitespace or '/')
+ *            local_vecs:  their local blocks
+ *            local_n:     size of the local blocks
+ *            comm:        communicator containing the vectors, ranks
+ *                         in the order of the blocks
+ * Out arg:   report:      bytes written and time
+ */
+void Checkpoint_write(
+      char                dir[]         /* in  */,
+      int                 nvec          /* in  */,
+      char*               names[]       /* in  */,
+      double*             local_vecs[]  /* in  */,
+      int                 local_n       /* in  */,
+      Checkpoint_report*  report        /* out */,
+      MPI_Comm            comm          /* in  */) {
+   char* fname = "Checkpoint_write";
+   char path[FILENAME_MAX];
+   long long first = 0, n, local = local_n, nblocks;
+   unsigned long long* sums;
+   MPI_File fh;
+   double start, local_time;
+   int my_rank, v, ok = 1;
+
+   MPI_Comm_rank(comm, &my_rank);
+   if (my_rank == 0) {
+      if (mkdir(dir, 0755) != 0 && errno != EEXIST) ok = 0;
+      /* An older checkpoint stops being valid before it's overwritten */
+      snprintf(path, sizeof(path), "%s/manifest", dir);
+      if (ok && remove(path) != 0 && errno != ENOENT) ok = 0;
+   }
+   Check_for_error(ok, fname, "Can't create checkpoint directory", comm);
+
+   MPI_Exscan(&local, &first, 1, MPI_LONG_LONG, MPI_SUM, comm);
+   if (my_rank == 0) first = 0;
+   MPI_Allreduce(&local, &n, 1, MPI_LONG_LONG, MPI_SUM, comm);
+   nblocks = (n + CKPT_BLOCK - 1)/CKPT_BLOCK;
+   sums = malloc((nvec*nblocks + 1)*sizeof(unsigned long long));
+   Check_for_error(sums != NULL, fname, "Can't allocate checksums", comm);
+
+   MPI_Barrier(comm);
+   start = MPI_Wtime();
+   for (v = 0; v < nvec; v++) {
+      snprintf(path, sizeof(path), "%s/%s.vec", dir, names[v]);
+      ok = MPI_File_open(comm, path, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+            MPI_INFO_NULL, &fh) == MPI_SUCCESS;
+      Check_for_error(ok, fname, "Can't open checkpoint file", comm);
+      ok = MPI_File_set_size(fh, n*sizeof(double)) == MPI_SUCCESS &&
+           MPI_File_write_at_all(fh, first*sizeof(double), local_vecs[v],
+                 local_n, MPI_DOUBLE, MPI_STATUS_IGNORE) == MPI_SUCCESS;
+      MPI_File_close(&fh);
+      Check_for_error(ok, fname, "Can't write checkpoint file", comm);
+
+      Block_checksums(local_vecs[v], local_n, first, CKPT_BLOCK, nblocks,
+            sums + v*nblocks, 0, comm);
+   }
+
+   /* The manifest commits the checkpoint */
+   if (my_rank == 0)
+      ok = Write_manifest(dir, nvec, names, n, nblocks, sums);
+   Check_for_error(ok, fname, "Can't write checkpoint manifest", comm);
+   local_time = MPI_Wtime() - start;
+
+   MPI_Allreduce(&local_time, &report->time, 1, MPI_DOUBLE, MPI_MAX, comm);
+   report->bytes = (double)nvec*n*sizeof(double);
+   free(sums);
+}  /* Checkpoint_write */
+
+/*---------------------------------------------------------------------
+ * Function:  Checkpoint_read
+ * Purpose:   Restore distributed vectors from a checkpoint, with a
+ *            block distribution over the processes of comm (which
+ *            may differ in number from the ones that wrote it)
+ * In args:   dir:         the checkpoint directory
+ *            nvec:        number of vectors to restore
+ *            names:       their names
+ *            comm:        communicator for the restored vectors
+ * Out args:  local_vecs:  the new local blocks (release with free)
+ *            local_n_p:   size of the local blocks
+ *            n_p:         order of the vectors
+ *            report:      bytes read and time
+ */
+void Checkpoint_read(
+      char                dir[]         /* in  */,
+      int                 nvec          /* in  */,
+      char*               names[]       /* in  */,
+      double*             local_vecs[]  /* out */,
+      int*                local_n_p     /* out */,
+      long long*          n_p           /* out */,
+      Checkpoint_report*  report        /* out */,
+      MPI_Comm            comm          /* in  */) {
+   char* fname = "Checkpoint_read";
+   char path[FILENAME_MAX];
+   long long hdr[2] = {0, 0}, n, block, nblocks, first, b;
+   unsigned long long *expected = NULL, *sums;
+   MPI_File fh;
+   MPI_Offset size;
+   double start, local_time;
+   int comm_sz, my_rank, v, ok = 1;
+
+   MPI_Comm_size(comm, &comm_sz);
+   MPI_Comm_rank(comm, &my_rank);
+
+   MPI_Barrier(comm);
+   start = MPI_Wtime();
+   if (my_rank == 0)
+      ok = Read_manifest(dir, nvec, names, &hdr[0], &hdr[1], &expected);
+   Check_for_error(ok, fname, "Missing or incomplete checkpoint manifest",
+         comm);
+   MPI_Bcast(hdr, 2, MPI_LONG_LONG, 0, comm);
+   n = hdr[0];
+   block = hdr[1];
+   nblocks = (n + block - 1)/block;
+
+   if (my_rank != 0)
+      expected = malloc((nvec*nblocks + 1)*sizeof(unsigned long long));
+   sums = malloc((nblocks + 1)*sizeof(unsigned long long));
+   Check_for_error(expected != NULL && sums != NULL, fname,
+         "Can't allocate checksums", comm);
+   MPI_Bcast(expected, nvec*nblocks, MPI_UNSIGNED_LONG_LONG, 0, comm);
+
+   first = my_rank*n/comm_sz;
+   *local_n_p = (my_rank + 1)*n/comm_sz - first;
+   *n_p = n;
+
+   for (v = 0; v < nvec; v++) {
+      local_vecs[v] = Vec_alloc(*local_n_p, sizeof(double));
+      Check_for_error(local_vecs[v] != NULL, fname,
+            "Can't allocate local vector", comm);
+
+      snprintf(path, sizeof(path), "%s/%s.vec", dir, names[v]);
+      ok = MPI_File_open(comm, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh)
+            == MPI_SUCCESS;
+      Check_for_error(ok, fname, "Can't open checkpoint file", comm);
+      ok = MPI_File_get_size(fh, &size) == MPI_SUCCESS &&
+           size == n*(MPI_Offset)sizeof(double) &&
+           MPI_File_read_at_all(fh, first*sizeof(double), local_vecs[v],
+                 *local_n_p, MPI_DOUBLE, MPI_STATUS_IGNORE) == MPI_SUCCESS;
+      MPI_File_close(&fh);
+      Check_for_error(ok, fname, "Can't read checkpoint file", comm);
+
+      Block_checksums(local_vecs[v], *local_n_p, first, block, nblocks,
+            sums, -1, comm);
+      for (b = 0; b < nblocks; b++)
+         if (sums[b] != expected[v*nblocks + b]) ok = 0;
+      if (!ok && my_rank == 0)
+         fprintf(stderr, "Checksum mismatch in %s\n", path);
+      Check_for_error(ok, fname, "Checkpoint is corrupted", comm);
+   }
+   local_time = MPI_Wtime() - start;
+
+   MPI_Allreduce(&local_time, &report->time, 1, MPI_DOUBLE, MPI_MAX, comm);
+   report->bytes = (double)nvec*n*sizeof(double);
+   free(expected);
+   free(sums);
+}  /* Checkpoint_read */
+
+/*---------------------------------------------------------------------
+ * Function:  Element_hash
+ * Purpose:   Mix the bits of an element with its global index
+ *            (splitmix64 finalizer)
+ */
+static unsigned long long Element_hash(double value, long long index) {
+   uint64_t z;
+
+   memcpy(&z, &value, sizeof(z));
+   z ^= (uint64_t)index*0x9E3779B97F4A7C15ULL;
+   z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ULL;
+   z = (z ^ (z >> 27))*0x94D049BB133111EBULL;
+   return z ^ (z >> 31);
+}  /* Element_hash */
+
+/*---------------------------------------------------------------------
+ * Function:  Block_checksums
+ * Purpose:   Checksums of the global blocks of a distributed vector
+ * In args:   local_a, local_n:  the local block
+ *            first:             global index of local_a[0]
+ *            block:             elements per checksum block
+ *            nblocks:           number of checksum blocks
+ *            root:              rank receiving the sums, or -1 for all
+ *            comm:              communicator containing the vector
+ * Out arg:   sums:              nblocks checksums (on root, or on all)
+ */
+static void Block_checksums(
+      const double        local_a[]  /* in  */,
+      int                 local_n    /* in  */,
+      long long           first      /* in  */,
+      long long           block      /* in  */,
+      long long           nblocks    /* in  */,
+      unsigned long long  sums[]     /* out */,
+      int                 root       /* in  */,
+      MPI_Comm            comm       /* in  */) {
+   unsigned long long* local_sums;
+   int i;
+
+   local_sums = calloc(nblocks + 1, sizeof(unsigned long long));
+   Check_for_error(local_sums != NULL, "Block_checksums",
+         "Can't allocate checksums", comm);
+   for (i = 0; i < local_n; i++)
+      local_sums[(first + i)/block] += Element_hash(local_a[i], first + i);
+
+   /* Unsigned sums wrap around, so the reduction order doesn't matter */
+   if (root < 0)
+      MPI_Allreduce(local_sums, sums, nblocks, MPI_UNSIGNED_LONG_LONG,
+            MPI_SUM, comm);
+   else
+      MPI_Reduce(local_sums, sums, nblocks, MPI_UNSIGNED_LONG_LONG,
+            MPI_SUM, root, comm);
+   free(local_sums);
+}  /* Block_checksums */
+
+/*---------------------------------------------------------------------
+ * Function:  Write_manifest
+ * Purpose:   Write the manifest of a checkpoint atomically
+ * Ret val:   1 on success, 0 otherwise
+ */
+static int Write_manifest(
+      char                dir[]    /* in */,
+      int                 nvec     /* in */,
+      char*               names[]  /* in */,
+      long long           n        /* in */,
+      long long           nblocks  /* in */,
+      unsigned long long  sums[]   /* in */) {
+   char tmp[FILENAME_MAX], path[FILENAME_MAX];
+   FILE* fp;
+   long long b;
+   int v, ok;
+
+   snprintf(tmp, sizeof(tmp), "%s/manifest.tmp", dir);
+   snprintf(path, sizeof(path), "%s/manifest", dir);
+   fp = fopen(tmp, "w");
+   if (fp == NULL) return 0;
+   fprintf(fp, "%s\nn %lld\nblock %d\nvectors %d\n", CKPT_MAGIC, n,
+         CKPT_BLOCK, nvec);
+   for (v = 0; v < nvec; v++) {
+      fprintf(fp, "vector %s\n", names[v]);
+      for (b = 0; b < nblocks; b++)
+         fprintf(fp, "%016llx\n", sums[v*nblocks + b]);
+   }
+   ok = (fclose(fp) == 0);
+   return ok && rename(tmp, path) == 0;
+}  /* Write_manifest */
+
+/*---------------------------------------------------------------------
+ * Function:  Read_manifest
+ * Purpose:   Read n, the block size and the checksums of the named
+ *            vectors from a checkpoint manifest
+ * Out args:  n_p, block_p:  order of the vectors and checksum block
+ *            sums_pp:       nvec*nblocks checksums, in the order of
+ *                           names (release with free)
+ * Ret val:   1 on success, 0 if the manifest is missing, malformed or
+ *            lacks one of the vectors
+ */
+static int Read_manifest(
+      char                  dir[]     /* in  */,
+      int                   nvec      /* in  */,
+      char*                 names[]   /* in  */,
+      long long*            n_p       /* out */,
+      long long*            block_p   /* out */,
+      unsigned long long**  sums_pp   /* out */) {
+   char path[FILENAME_MAX], line[128], name[CKPT_MAX_NAME + 1];
+   FILE* fp;
+   long long nblocks, b;
+   unsigned long long sum;
+   int count, v, w, found = 0;
+
+   snprintf(path, sizeof(path), "%s/manifest", dir);
+   fp = fopen(path, "r");
+   if (fp == NULL) return 0;
+   if (fgets(line, sizeof(line), fp) == NULL ||
+       strncmp(line, CKPT_MAGIC, strlen(CKPT_MAGIC)) != 0 ||
+       fscanf(fp, " n %lld block %lld vectors %d", n_p, block_p, &count)
+             != 3 || *n_p <= 0 || *block_p <= 0) {
+      fclose(fp);
+      return 0;
+   }
+   nblocks = (*n_p + *block_p - 1) / *block_p;
+   *sums_pp = malloc((nvec*nblocks + 1)*sizeof(unsigned long long));
+   if (*sums_pp == NULL) {
+      fclose(fp);
+      return 0;
+   }
+
+   for (w = 0; w < count; w++) {
+      if (fscanf(fp, " vector %64s", name) != 1) break;
+      for (v = 0; v < nvec && strcmp(names[v], name) != 0; v++) ;
+      for (b = 0; b < nblocks; b++) {
+         if (fscanf(fp, " %llx", &sum) != 1) break;
+         if (v < nvec) (*sums_pp)[v*nblocks + b] = sum;
+      }
+      if (b < nblocks) break;
+      if (v < nvec) found++;
+   }
+   fclose(fp);
+   return found == nvec;
+}  /* Read_manifest */
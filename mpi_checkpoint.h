@@ -0,0 +1,49 @@
+/* File:     mpi_checkpoint.h
+ *
+ * Purpose:  Collective checkpoint and restart of block-distributed
+ *           vectors.  A checkpoint can be restarted on a different
+ *           number of processes; each process reads the block of the
+ *           new distribution directly from the files.
+ *
+ * Compile:  Link mpi_checkpoint.c, mpi_vector_utils.c and vector_ops.c
+ *           into the program (and -lm).
+ *
+ * Notes:
+ * 1.  A checkpoint is a directory holding <name>.vec for every vector
+ *     (raw native doubles, as in mpi_stream.h) and a text manifest
+ *     with n and one checksum per CKPT_BLOCK elements of each vector.
+ *     The manifest is written last, by renaming a complete temporary
+ *     file, so a checkpoint interrupted midway has no manifest and is
+ *     rejected instead of silently restored.
+ * 2.  The checksum of a block is a sum over its elements of a hash of
+ *     the element's bits and global index.  Sums can be split at any
+ *     element, so every process checksums exactly the part of the
+ *     vector it owns, whatever the number of processes, and one
+ *     reduction assembles the block checksums.
+ * 3.  The blocks being written may have any sizes, in rank order.
+ *     Restart assigns process q the elements [q*n/comm_sz,
+ *     (q+1)*n/comm_sz), so n need not be divisible by comm_sz.
+ * 4.  Errors (missing or malformed checkpoint, I/O failure, checksum
+ *     mismatch) terminate all processes through Check_for_error.
+ */
+#ifndef MPI_CHECKPOINT_H
+#define MPI_CHECKPOINT_H
+
+#include <mpi.h>
+
+#define CKPT_BLOCK     65536
+#define CKPT_MAX_NAME  64
+
+typedef struct {
+   double  bytes;   /* vector data written or read, all processes */
+   double  time;    /* seconds taken by the slowest process       */
+} Checkpoint_report;
+
+void Checkpoint_write(char dir[], int nvec, char* names[],
+      double* local_vecs[], int local_n, Checkpoint_report* report,
+      MPI_Comm comm);
+void Checkpoint_read(char dir[], int nvec, char* names[],
+      double* local_vecs[], int* local_n_p, long long* n_p,
+      Checkpoint_report* report, MPI_Comm comm);
+
+#endif /* MPI_CHECKPOINT_H */
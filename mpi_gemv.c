@@ -0,0 +1,215 @@
+/* File:     mpi_gemv.c
+ *
+ * Purpose:  Dense matrix-vector products on row-block distributed
+ *           matrices (see mpi_gemv.h)
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include "vector_ops.h"
+#include "mpi_gemv.h"
+
+#define GEMV_TILE  2048   /* columns per tile: 16 KB of x or y          */
+#define GEMV_ROWS  4      /* rows sharing each load of x or y           */
+#define GEMV_ACC   8      /* independent partial sums per row           */
+#define GEMV_TAG   0x6e
+
+/*---------------------------------------------------------------------
+ * Function:  Gemv_local
+ * Purpose:   y += A*x for a row-major m x n matrix
+ * In args:   A:    the matrix; row i starts at A + i*lda
+ *            m, n: its dimensions
+ *            lda:  the distance between rows
+ *            x:    vector of order n
+ * In/out:    y:    vector of order m
+ *
+ * Note:
+ *    GEMV_ROWS rows are multiplied together, so each element of x
+ *    loaded from the cache feeds GEMV_ROWS products, and each row keeps
+ *    GEMV_ACC partial sums so the additions vectorize without
+ *    reassociating.  Leftover rows use Dot_product.
+ */
+void Gemv_local(
+      const double  A[]  /* in     */,
+      int           m    /* in     */,
+      int           n    /* in     */,
+      int           lda  /* in     */,
+      const double  x[]  /* in     */,
+      double        y[]  /* in/out */) {
+   const double *a, *xt;
+   double acc[GEMV_ROWS][GEMV_ACC], sum;
+   int i, j, j0, jn, r, k;
+
+   for (j0 = 0; j0 < n; j0 += GEMV_TILE) {
+      jn = n - j0 < GEMV_TILE ? n - j0 : GEMV_TILE;
+      xt = x + j0;
+      for (i = 0; i + GEMV_ROWS <= m; i += GEMV_ROWS) {
+         a = A + (size_t) i*lda + j0;
+         memset(acc, 0, sizeof(acc));
+         for (j = 0; j + GEMV_ACC <= jn; j += GEMV_ACC)
+            for (r = 0; r < GEMV_ROWS; r++)
+               for (k = 0; k < GEMV_ACC; k++)
+                  acc[r][k] += a[(size_t) r*lda + j + k]*xt[j+k];
+         for (r = 0; r < GEMV_ROWS; r++) {
+            sum = 0.0;
+            for (k = j; k < jn; k++)
+               sum += a[(size_t) r*lda + k]*xt[k];
+            for (k = 0; k < GEMV_ACC; k++)
+               sum += acc[r][k];
+            y[i+r] += sum;
+         }
+      }
+      for (; i < m; i++)
+         y[i] += Dot_product(A + (size_t) i*lda + j0, xt, jn);
+   }
+}  /* Gemv_local */
+
+/*---------------------------------------------------------------------
+ * Function:  Gemv_t_local
+ * Purpose:   y += A^T*x for a row-major m x n matrix
+ * In args:   A:    the matrix; row i starts at A + i*lda
+ *            m, n: its dimensions
+ *            lda:  the distance between rows
+ *            x:    vector of order m
+ * In/out:    y:    vector of order n
+ *
+ * Note:
+ *    y is updated with GEMV_ROWS rows at a time, so each tile of y is
+ *    loaded and stored once per GEMV_ROWS rows instead of once per row.
+ *    Leftover rows use Axpy.
+ */
+void Gemv_t_local(
+      const double  A[]  /* in     */,
+      int           m    /* in     */,
+      int           n    /* in     */,
+      int           lda  /* in     */,
+      const double  x[]  /* in     */,
+      double        y[]  /* in/out */) {
+   const double *a0, *a1, *a2, *a3;
+   double *yt;
+   int i, j, j0, jn;
+
+   for (j0 = 0; j0 < n; j0 += GEMV_TILE) {
+      jn = n - j0 < GEMV_TILE ? n - j0 : GEMV_TILE;
+      yt = y + j0;
+      for (i = 0; i + GEMV_ROWS <= m; i += GEMV_ROWS) {
+         a0 = A + (size_t) i*lda + j0;
+         a1 = a0 + lda;
+         a2 = a1 + lda;
+         a3 = a2 + lda;
+         VEC_IVDEP
+         for (j = 0; j < jn; j++)
+            yt[j] += x[i]*a0[j] + x[i+1]*a1[j] + x[i+2]*a2[j] + x[i+3]*a3[j];
+      }
+      for (; i < m; i++)
+         Axpy(A + (size_t) i*lda + j0, yt, jn, x[i]);
+   }
+}  /* Gemv_t_local */
+
+/*---------------------------------------------------------------------
+ * Function:  Gemv
+ * Purpose:   y = A*x, gathering x on every process
+ * In args:   local_A:  local rows of A, local_m x n
+ *            local_m:  rows owned
+ *            n:        columns of A
+ *            local_x:  local block of x, n/comm_sz elements
+ *            comm:     communicator containing A, x and y
+ * Out args:  local_y:  local block of y, local_m elements
+ *            x_buf:    scratch for the whole of x, n elements
+ */
+void Gemv(
+      const double  local_A[]  /* in  */,
+      int           local_m    /* in  */,
+      int           n          /* in  */,
+      const double  local_x[]  /* in  */,
+      double        local_y[]  /* out */,
+      double        x_buf[]    /* out */,
+      MPI_Comm      comm       /* in  */) {
+   int comm_sz;
+
+   MPI_Comm_size(comm, &comm_sz);
+   MPI_Allgather(local_x, n/comm_sz, MPI_DOUBLE, x_buf, n/comm_sz,
+         MPI_DOUBLE, comm);
+   memset(local_y, 0, local_m*sizeof(double));
+   Gemv_local(local_A, local_m, n, n, x_buf, local_y);
+}  /* Gemv */
+
+/*---------------------------------------------------------------------
+ * Function:  Gemv_ring
+ * Purpose:   y = A*x, passing the blocks of x around a ring
+ * In args:   local_A:  local rows of A, local_m x n
+ *            local_m:  rows owned
+ *            n:        columns of A
+ *            local_x:  local block of x, n/comm_sz elements
+ *            comm:     communicator containing A, x and y
+ * Out args:  local_y:  local block of y, local_m elements
+ *            work:     scratch for two blocks of x, 2*n/comm_sz elements
+ *
+ * Note:
+ *    In step s a process holds the block of x of process
+ *    (my_rank + s) % comm_sz; it sends it to my_rank-1 and receives the
+ *    next one from my_rank+1 while multiplying the matching columns.
+ */
+void Gemv_ring(
+      const double  local_A[]  /* in  */,
+      int           local_m    /* in  */,
+      int           n          /* in  */,
+      const double  local_x[]  /* in  */,
+      double        local_y[]  /* out */,
+      double        work[]     /* out */,
+      MPI_Comm      comm       /* in  */) {
+   int comm_sz, my_rank, local_n, s, owner, left, right;
+   const double* cur = local_x;
+   double* next;
+   MPI_Request reqs[2];
+
+   MPI_Comm_size(comm, &comm_sz);
+   MPI_Comm_rank(comm, &my_rank);
+   local_n = n/comm_sz;
+   left = (my_rank + comm_sz - 1) % comm_sz;
+   right = (my_rank + 1) % comm_sz;
+   memset(local_y, 0, local_m*sizeof(double));
+
+   for (s = 0; s < comm_sz; s++) {
+      next = work + (s % 2)*local_n;
+      if (s < comm_sz - 1) {
+         MPI_Irecv(next, local_n, MPI_DOUBLE, right, GEMV_TAG, comm, &reqs[0]);
+         MPI_Isend(cur, local_n, MPI_DOUBLE, left, GEMV_TAG, comm, &reqs[1]);
+      }
+      owner = (my_rank + s) % comm_sz;
+      Gemv_local(local_A + (size_t) owner*local_n, local_m, local_n, n, cur,
+            local_y);
+      if (s < comm_sz - 1) {
+         MPI_Waitall(2, reqs, MPI_STATUSES_IGNORE);
+         cur = next;
+      }
+   }
+}  /* Gemv_ring */
+
+/*---------------------------------------------------------------------
+ * Function:  Gemv_t
+ * Purpose:   y = A^T*x
+ * In args:   local_A:  local rows of A, local_m x n
+ *            local_m:  rows owned
+ *            n:        columns of A
+ *            local_x:  local block of x, local_m elements
+ *            comm:     communicator containing A, x and y
+ * Out args:  local_y:  local block of y, n/comm_sz elements
+ *            y_buf:    scratch for a partial y, n elements
+ */
+void Gemv_t(
+      const double  local_A[]  /* in  */,
+      int           local_m    /* in  */,
+      int           n          /* in  */,
+      const double  local_x[]  /* in  */,
+      double        local_y[]  /* out */,
+      double        y_buf[]    /* out */,
+      MPI_Comm      comm       /* in  */) {
+   int comm_sz;
+
+   MPI_Comm_size(comm, &comm_sz);
+   memset(y_buf, 0, n*sizeof(double));
+   Gemv_t_local(local_A, local_m, n, n, local_x, y_buf);
+   MPI_Reduce_scatter_block(y_buf, local_y, n/comm_sz, MPI_DOUBLE, MPI_SUM,
+         comm);
+}  /* Gemv_t */
@@ -0,0 +1,44 @@
+/* File:     mpi_gemv.h
+ *
+ * Purpose:  Distributed dense matrix-vector products y = A*x and
+ *           y = A^T*x.  A is m x n, stored by rows, and distributed by
+ *           blocks of local_m = m/comm_sz rows; vectors of order m and n
+ *           have the block distribution of mpi_vector_utils.h.
+ *
+ * Compile:  Link mpi_gemv.c and vector_ops.c into the program (and -lm).
+ *
+ * Notes:
+ * 1.  Gemv gathers the whole of x on every process with MPI_Allgather
+ *     and multiplies the local rows.  Gemv_ring instead passes the
+ *     blocks of x around a ring, multiplying the columns of one block
+ *     while the next one is in flight, so no process ever holds more
+ *     than two blocks of x.
+ * 2.  Gemv_t multiplies the local rows transposed into a partial y of
+ *     order n and sums the partial vectors with
+ *     MPI_Reduce_scatter_block, which leaves each process its block.
+ * 3.  The local kernels work on column tiles of GEMV_TILE elements, so
+ *     a tile of x (or of y for the transpose) stays in the L1 cache
+ *     while GEMV_ROWS rows stream past it.
+ * 4.  m and n should be evenly divisible by comm_sz.
+ */
+#ifndef MPI_GEMV_H
+#define MPI_GEMV_H
+
+#include <mpi.h>
+
+void Gemv_local(const double A[], int m, int n, int lda, const double x[],
+      double y[]);
+void Gemv_t_local(const double A[], int m, int n, int lda,
+      const double x[], double y[]);
+
+void Gemv(const double local_A[], int local_m, int n,
+      const double local_x[], double local_y[], double x_buf[],
+      MPI_Comm comm);
+void Gemv_ring(const double local_A[], int local_m, int n,
+      const double local_x[], double local_y[], double work[],
+      MPI_Comm comm);
+void Gemv_t(const double local_A[], int local_m, int n,
+      const double local_x[], double local_y[], double y_buf[],
+      MPI_Comm comm);
+
+#endif /* MPI_GEMV_H */
@@ -0,0 +1,222 @@
+/* File:     mpi_gemv_bench.c
+ *
+ * Purpose:  Check and time the distributed dense matrix-vector products
+ *           of mpi_gemv.h and compare their speed with the memory
+ *           bandwidth roofline.
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_gemv_bench \
+ *              mpi_gemv_bench.c mpi_gemv.c mpi_vector_utils.c vector_ops.c -lm
+ * Run:      mpiexec -n <comm_sz> ./mpi_gemv_bench <rows> <columns> <iterations>
+ *
+ * Input:    The dimensions m and n of the matrix and the number of
+ *           products timed
+ * Output:   The bandwidth of reading the matrix and the roofline it
+ *           implies, then for y = A*x (Allgather and ring) and
+ *           y = A^T*x the time per product, the GFLOP/s and the
+ *           fraction of the roofline
+ *
+ * Notes:
+ * 1.  m and n should be evenly divisible by comm_sz
+ * 2.  A product makes 2*m*n flops and reads the 8*m*n bytes of A, so at
+ *     a quarter flop per byte it is bound by memory bandwidth: the
+ *     roofline is the time to read A once, measured by Read_matrix.
+ * 3.  Before timing, A*x is checked against a plain loop over the
+ *     gathered x, the ring against Allgather, and A^T with
+ *     w.(A*x) = (A^T*w).x.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+#include "mpi_gemv.h"
+
+double Read_matrix(const double a[], size_t len);
+void Check_products(const double local_A[], int local_m, int n,
+      double local_x[], double local_w[], double x_buf[], double work[],
+      MPI_Comm comm);
+
+int main(int argc, char* argv[]) {
+    int m, n, local_m, local_n, iters, it, op;
+    int comm_sz, my_rank;
+    double *local_A, *local_x, *local_y, *local_w, *x_buf, *work;
+    double start, local_t[4], t[4], flops, roof;
+    static const char* names[3] = {"A*x allgather", "A*x ring", "A^T*x"};
+    MPI_Comm comm;
+
+    // Initialize MPI
+    MPI_Init(&argc, &argv);
+    comm = MPI_COMM_WORLD;
+    MPI_Comm_size(comm, &comm_sz);
+    MPI_Comm_rank(comm, &my_rank);
+
+    if (argc != 4) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Usage: %s <rows> <columns> <iterations>\n", argv[0]);
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    m = atoi(argv[1]);
+    n = atoi(argv[2]);
+    iters = atoi(argv[3]);
+    if (m <= 0 || n <= 0 || m % comm_sz != 0 || n % comm_sz != 0 || iters <= 0) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Rows and columns should be positive integers evenly divisible by the number of processes, and iterations positive\n");
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    local_m = m/comm_sz;
+    local_n = n/comm_sz;
+    local_A = Vec_alloc((size_t) local_m*n, sizeof(double));
+    x_buf = Vec_alloc(n, sizeof(double));
+    work = Vec_alloc(2*local_n, sizeof(double));
+    Check_for_error(local_A != NULL && x_buf != NULL && work != NULL, "main",
+          "Can't allocate the matrix", comm);
+    Allocate_vectors(&local_x, &local_y, &local_w, local_m > local_n ? local_m : local_n,
+          comm);
+    Generate_vector(local_A, local_m*n, my_rank, 1);
+    Generate_vector(local_x, local_n, my_rank, 2);
+    Generate_vector(local_w, local_m, my_rank, 3);
+
+    Check_products(local_A, local_m, n, local_x, local_w, x_buf, work, comm);
+
+    for (op = 0; op < 4; op++) {
+        MPI_Barrier(comm);
+        start = MPI_Wtime();
+        for (it = 0; it < iters; it++) {
+            switch (op) {
+                case 0:
+                    local_y[0] = Read_matrix(local_A, (size_t) local_m*n);
+                    break;
+                case 1:
+                    Gemv(local_A, local_m, n, local_x, local_y, x_buf, comm);
+                    break;
+                case 2:
+                    Gemv_ring(local_A, local_m, n, local_x, local_y, work, comm);
+                    break;
+                case 3:
+                    Gemv_t(local_A, local_m, n, local_w, local_y, x_buf, comm);
+                    break;
+            }
+        }
+        local_t[op] = (MPI_Wtime() - start)/iters;
+    }
+
+    MPI_Reduce(local_t, t, 4, MPI_DOUBLE, MPI_MAX, 0, comm);
+    if (my_rank == 0) {
+        flops = 2.0*m*n;
+        roof = flops/t[0];
+        printf("matrix %d x %d: reading it takes %e s (%.2f GB/s), roofline %.3f GFLOP/s\n",
+              m, n, t[0], 8.0*m*n/t[0]/1.0e9, roof/1.0e9);
+        printf("%-14s %14s %10s %9s\n", "product", "s/product", "GFLOP/s", "roofline");
+        for (op = 1; op < 4; op++)
+            printf("%-14s %14.6e %10.3f %8.1f%%\n", names[op-1], t[op],
+                  flops/t[op]/1.0e9, 100.0*flops/t[op]/roof);
+    }
+
+    free(local_A);
+    free(x_buf);
+    free(work);
+    free(local_x);
+    free(local_y);
+    free(local_w);
+
+    MPI_Finalize();
+    return 0;
+}  /* main */
+
+/*---------------------------------------------------------------------
+ * Function:  Read_matrix
+ * Purpose:   Read every element of an array once, as fast as possible
+ * In args:   a:    the array
+ *            len:  its number of elements
+ * Ret val:   the sum of the elements
+ *
+ * Note:
+ *    The products stream four rows at a time, and the hardware
+ *    prefetchers sustain more bandwidth on four streams than on one,
+ *    so the array is read as four concurrent quarters.
+ */
+double Read_matrix(
+      const double  a[]  /* in */,
+      size_t        len  /* in */) {
+   double acc[8] = {0}, sum = 0.0;
+   size_t q = len/4, i, j;
+
+   for (i = 0; i + 8 <= q; i += 8)
+      for (j = 0; j < 8; j++)
+         acc[j] += (a[i+j] + a[q+i+j]) + (a[2*q+i+j] + a[3*q+i+j]);
+   for (; i < q; i++)
+      sum += a[i] + a[q+i] + a[2*q+i] + a[3*q+i];
+   for (i = 4*q; i < len; i++)
+      sum += a[i];
+   for (j = 0; j < 8; j++)
+      sum += acc[j];
+   return sum;
+}  /* Read_matrix */
+
+/*---------------------------------------------------------------------
+ * Function:  Check_products
+ * Purpose:   Verify Gemv, Gemv_ring and Gemv_t
+ * In args:   local_A:  local rows of A
+ *            local_m:  rows owned
+ *            n:        columns of A
+ *            local_x:  local block of x, n/comm_sz elements
+ *            local_w:  local block of w, local_m elements
+ *            comm:     communicator containing A and the vectors
+ * Out args:  x_buf, work:  scratch for the products
+ *
+ * Errors:    If a product is off by more than a relative 1e-12, the
+ *            program terminates
+ */
+void Check_products(
+      const double  local_A[]  /* in  */,
+      int           local_m    /* in  */,
+      int           n          /* in  */,
+      double        local_x[]  /* in  */,
+      double        local_w[]  /* in  */,
+      double        x_buf[]    /* out */,
+      double        work[]     /* out */,
+      MPI_Comm      comm       /* in  */) {
+   int comm_sz, local_n, i, j, ok;
+   double *y, *y_ring, *y_ref, *v, local_dots[2], dots[2];
+
+   MPI_Comm_size(comm, &comm_sz);
+   local_n = n/comm_sz;
+   y = Vec_alloc(local_m, sizeof(double));
+   y_ring = Vec_alloc(local_m, sizeof(double));
+   y_ref = Vec_alloc(local_m, sizeof(double));
+   v = Vec_alloc(local_n, sizeof(double));
+   ok = y != NULL && y_ring != NULL && y_ref != NULL && v != NULL;
+   Check_for_error(ok, "Check_products", "Can't allocate check vectors",
+         comm);
+
+   // The elements of A and x are positive, so the sums are well scaled
+   Gemv(local_A, local_m, n, local_x, y, x_buf, comm);
+   for (i = 0; i < local_m; i++) {
+      y_ref[i] = 0.0;
+      for (j = 0; j < n; j++)
+         y_ref[i] += local_A[(size_t) i*n + j]*x_buf[j];
+      if (fabs(y[i] - y_ref[i]) > 1.0e-12*y_ref[i]) ok = 0;
+   }
+   Gemv_ring(local_A, local_m, n, local_x, y_ring, work, comm);
+   for (i = 0; i < local_m; i++)
+      if (fabs(y_ring[i] - y_ref[i]) > 1.0e-12*y_ref[i]) ok = 0;
+
+   Gemv_t(local_A, local_m, n, local_w, v, x_buf, comm);
+   local_dots[0] = Dot_product(local_w, y, local_m);
+   local_dots[1] = Dot_product(v, local_x, local_n);
+   MPI_Allreduce(local_dots, dots, 2, MPI_DOUBLE, MPI_SUM, comm);
+   if (fabs(dots[0] - dots[1]) > 1.0e-12*dots[0]) ok = 0;
+
+   free(y);
+   free(y_ring);
+   free(y_ref);
+   free(v);
+   Check_for_error(ok, "Check_products", "Distributed product is wrong",
+         comm);
+}  /* Check_products */
@@ -0,0 +1,247 @@
+/* File:     mpi_index.c
+ *
+ * Purpose:  Gather, scatter and scatter-add through global indices
+ *           into block-distributed vectors (see mpi_index.h)
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include "mpi_index.h"
+
+#define SORT_BITS  11                  /* radix sort digit            */
+#define SORT_RADIX (1 << SORT_BITS)
+
+static void Sort_pairs(int key[], int val[], int m, int key_tmp[],
+      int val_tmp[]);
+
+/*---------------------------------------------------------------------
+ * Function:  Index_plan_create
+ * Purpose:   Build the communication plan of a list of global indices
+ * In args:   idx:      the indices, 0 <= idx[i] < comm_sz*local_n
+ *            m:        their number (may differ between processes)
+ *            local_n:  block size of the distributed vectors
+ *            comm:     communicator containing the vectors
+ * Out args:  plan:     the plan
+ * Ret val:   1 on success; 0 on every process if an index is out of
+ *            range or an allocation fails somewhere
+ */
+int Index_plan_create(
+      const int    idx[]    /* in  */,
+      int          m        /* in  */,
+      int          local_n  /* in  */,
+      Index_plan*  plan     /* out */,
+      MPI_Comm     comm     /* in  */) {
+   int comm_sz, n, i, k, q, u, prev = -1, ok, *work, *key, *val;
+
+   MPI_Comm_size(comm, &comm_sz);
+   n = comm_sz*local_n;
+   memset(plan, 0, sizeof(*plan));
+   plan->m = m;
+   plan->local_n = local_n;
+   plan->comm = comm;
+   plan->slot = malloc((m > 0 ? m : 1)*sizeof(int));
+   plan->req_counts = calloc(4*comm_sz, sizeof(int));
+   work = malloc((m > 0 ? 4*m : 1)*sizeof(int));
+   ok = plan->slot != NULL && plan->req_counts != NULL && work != NULL;
+   for (i = 0; ok && i < m; i++)
+      if (idx[i] < 0 || idx[i] >= n) ok = 0;
+   MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, comm);
+   if (!ok) {
+      free(work);
+      Index_plan_free(plan);
+      return 0;
+   }
+   plan->req_displs = plan->req_counts + comm_sz;
+   plan->serve_counts = plan->req_counts + 2*comm_sz;
+   plan->serve_displs = plan->req_counts + 3*comm_sz;
+
+   // Sorting the indices buckets them by owner, in local order
+   key = work;
+   val = work + m;
+   for (i = 0; i < m; i++) {
+      key[i] = idx[i];
+      val[i] = i;
+   }
+   Sort_pairs(key, val, m, work + 2*m, work + 3*m);
+
+   // Distinct indices become requests; key[u] is the offset at the owner
+   u = -1;
+   for (k = 0; k < m; k++) {
+      if (key[k] != prev) {
+         prev = key[k];
+         q = prev/local_n;
+         plan->req_counts[q]++;
+         key[++u] = prev - q*local_n;
+      }
+      plan->slot[val[k]] = u;
+   }
+   plan->n_req = u + 1;
+
+   MPI_Alltoall(plan->req_counts, 1, MPI_INT, plan->serve_counts, 1,
+         MPI_INT, comm);
+   for (q = 0; q < comm_sz; q++) {
+      plan->req_displs[q] = q == 0 ? 0
+            : plan->req_displs[q-1] + plan->req_counts[q-1];
+      plan->serve_displs[q] = q == 0 ? 0
+            : plan->serve_displs[q-1] + plan->serve_counts[q-1];
+   }
+   plan->n_serve = plan->serve_displs[comm_sz-1]
+         + plan->serve_counts[comm_sz-1];
+   plan->serve_idx = malloc((plan->n_serve > 0 ? plan->n_serve : 1)
+         *sizeof(int));
+   plan->req_buf = malloc((plan->n_req > 0 ? plan->n_req : 1)
+         *sizeof(double));
+   plan->serve_buf = malloc((plan->n_serve > 0 ? plan->n_serve : 1)
+         *sizeof(double));
+   ok = plan->serve_idx != NULL && plan->req_buf != NULL
+         && plan->serve_buf != NULL;
+   MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, comm);
+   if (ok)
+      MPI_Alltoallv(key, plan->req_counts, plan->req_displs, MPI_INT,
+            plan->serve_idx, plan->serve_counts, plan->serve_displs,
+            MPI_INT, comm);
+   else
+      Index_plan_free(plan);
+   free(work);
+   return ok;
+}  /* Index_plan_create */
+
+/*---------------------------------------------------------------------
+ * Function:  Index_plan_free
+ * Purpose:   Release the storage of a plan
+ * In/out:    plan:  the plan
+ */
+void Index_plan_free(Index_plan* plan /* in/out */) {
+   free(plan->slot);
+   free(plan->serve_idx);
+   free(plan->req_counts);
+   free(plan->req_buf);
+   free(plan->serve_buf);
+   plan->slot = plan->serve_idx = plan->req_counts = NULL;
+   plan->req_displs = plan->serve_counts = plan->serve_displs = NULL;
+   plan->req_buf = plan->serve_buf = NULL;
+}  /* Index_plan_free */
+
+/*---------------------------------------------------------------------
+ * Function:  Index_gather
+ * Purpose:   z[i] = x[idx[i]]
+ * In args:   local_x:  local block of the distributed vector
+ * Out args:  z:        m values, in the order of idx
+ * In/out:    plan:     the plan of idx (its buffers are used)
+ */
+void Index_gather(
+      Index_plan*   plan       /* in/out */,
+      const double  local_x[]  /* in     */,
+      double        z[]        /* out    */) {
+   const int *serve_idx = plan->serve_idx, *slot = plan->slot;
+   double *serve_buf = plan->serve_buf, *req_buf = plan->req_buf;
+   int i, k;
+
+   for (k = 0; k < plan->n_serve; k++)
+      serve_buf[k] = local_x[serve_idx[k]];
+   MPI_Alltoallv(serve_buf, plan->serve_counts, plan->serve_displs,
+         MPI_DOUBLE, req_buf, plan->req_counts, plan->req_displs,
+         MPI_DOUBLE, plan->comm);
+   for (i = 0; i < plan->m; i++)
+      z[i] = req_buf[slot[i]];
+}  /* Index_gather */
+
+/*---------------------------------------------------------------------
+ * Function:  Index_scatter
+ * Purpose:   z[idx[i]] = x[i]
+ * In args:   x:        m values, in the order of idx
+ * In/out:    plan:     the plan of idx (its buffers are used)
+ *            local_z:  local block of the distributed vector; elements
+ *                      not indexed by any process are unchanged
+ */
+void Index_scatter(
+      Index_plan*   plan       /* in/out */,
+      const double  x[]        /* in     */,
+      double        local_z[]  /* in/out */) {
+   const int *serve_idx = plan->serve_idx, *slot = plan->slot;
+   double *serve_buf = plan->serve_buf, *req_buf = plan->req_buf;
+   int i, k;
+
+   for (i = 0; i < plan->m; i++)
+      req_buf[slot[i]] = x[i];
+   MPI_Alltoallv(req_buf, plan->req_counts, plan->req_displs, MPI_DOUBLE,
+         serve_buf, plan->serve_counts, plan->serve_displs, MPI_DOUBLE,
+         plan->comm);
+   for (k = 0; k < plan->n_serve; k++)
+      local_z[serve_idx[k]] = serve_buf[k];
+}  /* Index_scatter */
+
+/*---------------------------------------------------------------------
+ * Function:  Index_scatter_add
+ * Purpose:   z[idx[i]] += x[i]
+ * In args:   x:        m values, in the order of idx
+ * In/out:    plan:     the plan of idx (its buffers are used)
+ *            local_z:  local block of the distributed vector
+ */
+void Index_scatter_add(
+      Index_plan*   plan       /* in/out */,
+      const double  x[]        /* in     */,
+      double        local_z[]  /* in/out */) {
+   const int *serve_idx = plan->serve_idx, *slot = plan->slot;
+   double *serve_buf = plan->serve_buf, *req_buf = plan->req_buf;
+   int i, k;
+
+   memset(req_buf, 0, plan->n_req*sizeof(double));
+   for (i = 0; i < plan->m; i++)
+      req_buf[slot[i]] += x[i];
+   MPI_Alltoallv(req_buf, plan->req_counts, plan->req_displs, MPI_DOUBLE,
+         serve_buf, plan->serve_counts, plan->serve_displs, MPI_DOUBLE,
+         plan->comm);
+   for (k = 0; k < plan->n_serve; k++)
+      local_z[serve_idx[k]] += serve_buf[k];
+}  /* Index_scatter_add */
+
+/*---------------------------------------------------------------------
+ * Function:  Sort_pairs
+ * Purpose:   Sort nonnegative keys, moving a value with each key
+ * In args:   m:         number of pairs
+ * In/out:    key, val:  the pairs
+ * Out args:  key_tmp, val_tmp:  scratch for m pairs
+ *
+ * Note:
+ *    LSD radix sort with SORT_BITS-bit digits, stopping after the
+ *    highest nonzero digit of the largest key.  It is stable, so equal
+ *    indices keep increasing positions.
+ */
+static void Sort_pairs(
+      int  key[]      /* in/out */,
+      int  val[]      /* in/out */,
+      int  m          /* in     */,
+      int  key_tmp[]  /* out    */,
+      int  val_tmp[]  /* out    */) {
+   int count[SORT_RADIX], *k_in = key, *v_in = val, *k_out = key_tmp,
+       *v_out = val_tmp, *t, i, d, shift, sum, c, max = 0;
+
+   for (i = 0; i < m; i++)
+      max |= key[i];
+   for (shift = 0; shift < 31 && (max >> shift) != 0; shift += SORT_BITS) {
+      memset(count, 0, sizeof(count));
+      for (i = 0; i < m; i++)
+         count[(k_in[i] >> shift) & (SORT_RADIX - 1)]++;
+      for (d = sum = 0; d < SORT_RADIX; d++) {
+         c = count[d];
+         count[d] = sum;
+         sum += c;
+      }
+      for (i = 0; i < m; i++) {
+         d = count[(k_in[i] >> shift) & (SORT_RADIX - 1)]++;
+         k_out[d] = k_in[i];
+         v_out[d] = v_in[i];
+      }
+      t = k_in;
+      k_in = k_out;
+      k_out = t;
+      t = v_in;
+      v_in = v_out;
+      v_out = t;
+   }
+   if (k_in != key) {
+      memcpy(key, k_in, m*sizeof(int));
+      memcpy(val, v_in, m*sizeof(int));
+   }
+}  /* Sort_pairs */
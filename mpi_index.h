@@ -0,0 +1,54 @@
+/* File:     mpi_index.h
+ *
+ * Purpose:  Indexed access to block-distributed vectors: gather
+ *           z[i] = x[idx[i]], scatter z[idx[i]] = x[i] and scatter-add
+ *           z[idx[i]] += x[i], where each process has its own list of
+ *           global indices into the distributed vector.  A scatter
+ *           with a permutation permutes the vector.
+ *
+ * Compile:  Link mpi_index.c into the program.
+ *
+ * Notes:
+ * 1.  The distributed vector has order n = comm_sz*local_n and the
+ *     block distribution of mpi_vector_utils.h, so global index g is
+ *     owned by process g/local_n.
+ * 2.  An Index_plan is built once per index list (the "inspector") and
+ *     executed any number of times.  Building it sorts the indices,
+ *     which buckets them by owner, drops duplicates and puts each
+ *     bucket in increasing local order; one MPI_Alltoallv then tells
+ *     every owner the offsets it serves.
+ * 3.  Each execution is one MPI_Alltoallv of doubles.  Owners read or
+ *     update their elements in increasing order for each requester,
+ *     and scatters combine duplicate indices before sending, so no
+ *     element crosses the network twice.
+ * 4.  In Index_scatter, when several x[i] go to the same element, the
+ *     one from the highest rank wins, and on that rank the one with
+ *     the largest i.
+ */
+#ifndef MPI_INDEX_H
+#define MPI_INDEX_H
+
+#include <mpi.h>
+
+typedef struct {
+   int       m;            /* indices of the calling process         */
+   int       local_n;      /* block size of the distributed vector   */
+   int*      slot;         /* m: position of idx[i] among n_req      */
+   int       n_req;        /* distinct indices requested             */
+   int       n_serve;      /* requests served for all processes      */
+   int*      serve_idx;    /* n_serve local offsets, by requester    */
+   int       *req_counts, *req_displs, *serve_counts, *serve_displs;
+   double*   req_buf;      /* n_req values, by owner                 */
+   double*   serve_buf;    /* n_serve values, by requester           */
+   MPI_Comm  comm;
+} Index_plan;
+
+int Index_plan_create(const int idx[], int m, int local_n,
+      Index_plan* plan, MPI_Comm comm);
+void Index_plan_free(Index_plan* plan);
+void Index_gather(Index_plan* plan, const double local_x[], double z[]);
+void Index_scatter(Index_plan* plan, const double x[], double local_z[]);
+void Index_scatter_add(Index_plan* plan, const double x[],
+      double local_z[]);
+
+#endif /* MPI_INDEX_H */
@@ -0,0 +1,253 @@
+/* File:     mpi_index_bench.c
+ *
+ * Purpose:  Check and time the indexed gather, scatter and scatter-add
+ *           of mpi_index.h with random, near-local and permutation
+ *           index patterns.
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_index_bench \
+ *              mpi_index_bench.c mpi_index.c mpi_vector_utils.c vector_ops.c -lm
+ * Run:      mpiexec -n <comm_sz> ./mpi_index_bench <order of the vector> <iterations>
+ *
+ * Input:    The order of the vector, n, and the number of operations
+ *           timed
+ * Output:   For each pattern, the fraction of the distinct indices owned
+ *           by another process, the time to build the plan, and the
+ *           elements per second (n per operation) of gather, scatter
+ *           and scatter-add
+ *
+ * Notes:
+ * 1.  n should be evenly divisible by comm_sz
+ * 2.  Every process has local_n indices; the one at global position p
+ *           random:       a hash of p, modulo n
+ *           near-local:   p plus a hashed offset in [-NEAR, NEAR]
+ *           permutation:  (a*p + 1) mod n, with a coprime to n
+ * 3.  x[g] = g + 0.5, so every gathered value can be checked locally.
+ *     Scatter-adding ones must add iterations*n to the sum of z, and
+ *     with the permutation, gathering after scattering must give x back.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+#include "mpi_index.h"
+
+#define NEAR  256
+
+enum { RANDOM, NEAR_LOCAL, PERMUTATION, NUM_PATTERNS };
+
+static const char* pattern_names[NUM_PATTERNS] = {"random", "near-local",
+   "permutation"};
+
+uint64_t Mix(uint64_t z);
+long long Gcd(long long a, long long b);
+void Make_indices(int pattern, int idx[], int local_n, int my_rank,
+      int comm_sz);
+void Check_pattern(int pattern, Index_plan* plan, const int idx[],
+      const double local_x[], double z[], double w[], int local_n,
+      MPI_Comm comm);
+
+int main(int argc, char* argv[]) {
+    int n, local_n, iters, it, pattern, op, i;
+    int comm_sz, my_rank, *idx;
+    double *local_x, *z, *w, *ones, start, local_t[4], t[4], counts[3];
+    Index_plan plan;
+    MPI_Comm comm;
+
+    // Initialize MPI
+    MPI_Init(&argc, &argv);
+    comm = MPI_COMM_WORLD;
+    MPI_Comm_size(comm, &comm_sz);
+    MPI_Comm_rank(comm, &my_rank);
+
+    if (argc != 3) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Usage: %s <order of the vector> <iterations>\n", argv[0]);
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    n = atoi(argv[1]);
+    iters = atoi(argv[2]);
+    if (n <= 0 || n % comm_sz != 0 || iters <= 0) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Order of the vector should be a positive integer and evenly divisible by the number of processes, and iterations positive\n");
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    local_n = n/comm_sz;
+    idx = Vec_alloc(local_n, sizeof(int));
+    Check_for_error(idx != NULL, "main", "Can't allocate indices", comm);
+    Allocate_vectors(&local_x, &z, &w, local_n, comm);
+    Allocate_vectors(&ones, NULL, NULL, local_n, comm);
+    for (i = 0; i < local_n; i++) {
+        local_x[i] = (double) my_rank*local_n + i + 0.5;
+        ones[i] = 1.0;
+    }
+
+    if (my_rank == 0)
+        printf("%-12s %8s %12s %12s %12s %12s\n", "pattern", "remote",
+              "plan s", "gather", "scatter", "scatter-add");
+    for (pattern = 0; pattern < NUM_PATTERNS; pattern++) {
+        Make_indices(pattern, idx, local_n, my_rank, comm_sz);
+        MPI_Barrier(comm);
+        start = MPI_Wtime();
+        Check_for_error(Index_plan_create(idx, local_n, local_n, &plan, comm),
+              "main", "Can't build the index plan", comm);
+        local_t[0] = MPI_Wtime() - start;
+        Check_pattern(pattern, &plan, idx, local_x, z, w, local_n, comm);
+
+        for (op = 1; op < 4; op++) {
+            MPI_Barrier(comm);
+            start = MPI_Wtime();
+            for (it = 0; it < iters; it++)
+                switch (op) {
+                    case 1:
+                        Index_gather(&plan, local_x, z);
+                        break;
+                    case 2:
+                        Index_scatter(&plan, local_x, z);
+                        break;
+                    default:
+                        Index_scatter_add(&plan, ones, w);
+                        break;
+                }
+            local_t[op] = (MPI_Wtime() - start)/iters;
+        }
+
+        // Check the sum of the scatter-adds, count the remote requests
+        counts[0] = 0.0;
+        for (i = 0; i < local_n; i++)
+            counts[0] += w[i];
+        counts[1] = plan.n_req - plan.req_counts[my_rank];
+        counts[2] = plan.n_req;
+        MPI_Allreduce(MPI_IN_PLACE, counts, 3, MPI_DOUBLE, MPI_SUM, comm);
+        Check_for_error(counts[0] == (double) iters*n, "main",
+              "Scatter-add lost or duplicated elements", comm);
+        MPI_Reduce(local_t, t, 4, MPI_DOUBLE, MPI_MAX, 0, comm);
+        if (my_rank == 0)
+            printf("%-12s %7.1f%% %12.4e %12.1f %12.1f %12.1f\n",
+                  pattern_names[pattern], 100.0*counts[1]/counts[2], t[0],
+                  n/t[1]/1.0e6, n/t[2]/1.0e6, n/t[3]/1.0e6);
+        Index_plan_free(&plan);
+    }
+    if (my_rank == 0)
+        printf("(gather, scatter and scatter-add in Melem/s)\n");
+
+    free(idx);
+    free(local_x);
+    free(z);
+    free(w);
+    free(ones);
+
+    MPI_Finalize();
+    return 0;
+}  /* main */
+
+/*---------------------------------------------------------------------
+ * Function:  Mix
+ * Purpose:   Hash a 64-bit integer (the finalizer of splitmix64)
+ */
+uint64_t Mix(uint64_t z) {
+   z += 0x9e3779b97f4a7c15ULL;
+   z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ULL;
+   z = (z ^ (z >> 27))*0x94d049bb133111ebULL;
+   return z ^ (z >> 31);
+}  /* Mix */
+
+/*---------------------------------------------------------------------
+ * Function:  Gcd
+ * Purpose:   Greatest common divisor of two nonnegative integers
+ */
+long long Gcd(long long a, long long b) {
+   long long t;
+
+   while (b != 0) {
+      t = a % b;
+      a = b;
+      b = t;
+   }
+   return a;
+}  /* Gcd */
+
+/*---------------------------------------------------------------------
+ * Function:  Make_indices
+ * Purpose:   Build the local indices of a pattern
+ * In args:   pattern:  RANDOM, NEAR_LOCAL or PERMUTATION
+ *            local_n:  number of indices (and block size)
+ *            my_rank, comm_sz:  the processes
+ * Out args:  idx:      the indices
+ */
+void Make_indices(
+      int  pattern   /* in  */,
+      int  idx[]     /* out */,
+      int  local_n   /* in  */,
+      int  my_rank   /* in  */,
+      int  comm_sz   /* in  */) {
+   long long n = (long long) local_n*comm_sz, p, a, g;
+   int i;
+
+   // First a from 0x9e3779b9 mod n on that is coprime to n
+   a = 0x9e3779b9LL % n;
+   while (Gcd(a, n) != 1)
+      a = (a + 1) % n;
+   for (i = 0; i < local_n; i++) {
+      p = (long long) my_rank*local_n + i;
+      switch (pattern) {
+         case RANDOM:
+            idx[i] = (int) (Mix(p) % n);
+            break;
+         case NEAR_LOCAL:
+            g = p + (long long) (Mix(p) % (2*NEAR + 1)) - NEAR;
+            idx[i] = (int) ((g % n + n) % n);
+            break;
+         default:
+            idx[i] = (int) ((a*p + 1) % n);
+            break;
+      }
+   }
+}  /* Make_indices */
+
+/*---------------------------------------------------------------------
+ * Function:  Check_pattern
+ * Purpose:   Verify a gather, and for a permutation a scatter followed
+ *            by a gather
+ * In args:   pattern:  the pattern of idx
+ *            idx:      the indices
+ *            local_x:  local block of x, x[g] = g + 0.5
+ *            local_n:  order of the blocks
+ *            comm:     communicator containing the vectors
+ * In/out:    plan:     the plan of idx
+ * Out args:  z, w:     scratch
+ *
+ * Errors:    If a value is wrong, the program terminates
+ */
+void Check_pattern(
+      int           pattern    /* in     */,
+      Index_plan*   plan       /* in/out */,
+      const int     idx[]      /* in     */,
+      const double  local_x[]  /* in     */,
+      double        z[]        /* out    */,
+      double        w[]        /* out    */,
+      int           local_n    /* in     */,
+      MPI_Comm      comm       /* in     */) {
+   int i, ok = 1;
+
+   Index_gather(plan, local_x, z);
+   for (i = 0; i < local_n; i++)
+      if (z[i] != idx[i] + 0.5) ok = 0;
+   if (pattern == PERMUTATION) {
+      memset(z, 0, local_n*sizeof(double));
+      Index_scatter(plan, local_x, z);
+      Index_gather(plan, z, w);
+      for (i = 0; i < local_n; i++)
+         if (w[i] != local_x[i]) ok = 0;
+   }
+   Check_for_error(ok, "Check_pattern", "Indexed access gave wrong values",
+         comm);
+   memset(w, 0, local_n*sizeof(double));
+}  /* Check_pattern */
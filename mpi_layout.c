@@ -0,0 +1,496 @@
+/* File:     mpi_layout.c
+ *
+ * Purpose:  Block-cyclic and offset-table distributions and the
+ *           redistribution between them (see mpi_layout.h)
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include "mpi_layout.h"
+
+static int Segment(const Layout* layout, int i, int* owner_p, int* local_p);
+static int Own_segment(const Layout* layout, int q, int k, int* start_p,
+      int* end_p);
+static void Walk_runs(const Layout* own, const Layout* other, int my_rank,
+      int nruns[], const int first[], int start[], int len[]);
+static int Plan_side(const Layout* own, const Layout* other, int my_rank,
+      int comm_sz, int** counts_p, int** displs_p, int** first_p,
+      int** start_p, int** len_p, MPI_Datatype** types_p, double** buf_p);
+static void Free_side(int comm_sz, int* counts, int* start,
+      MPI_Datatype* types, double* buf);
+
+/*---------------------------------------------------------------------
+ * Function:  Layout_block_cyclic
+ * Purpose:   Describe a block-cyclic distribution
+ * In args:   n:        order of the vector
+ *            nb:       block size (>= 1)
+ *            comm_sz:  number of processes
+ * Out args:  layout:   the distribution
+ */
+void Layout_block_cyclic(
+      Layout*  layout   /* out */,
+      int      n        /* in  */,
+      int      nb       /* in  */,
+      int      comm_sz  /* in  */) {
+   layout->kind = LAYOUT_BLOCK_CYCLIC;
+   layout->n = n;
+   layout->comm_sz = comm_sz;
+   layout->nb = nb;
+   layout->counts = layout->displs = layout->order = NULL;
+}  /* Layout_block_cyclic */
+
+/*---------------------------------------------------------------------
+ * Function:  Layout_table
+ * Purpose:   Describe a distribution given by an offset table
+ * In args:   n:        order of the vector
+ *            counts:   elements of each process
+ *            displs:   global index of the first element of each
+ *            comm_sz:  number of processes
+ * Out args:  layout:   the distribution
+ * Ret val:   1 if the ranges tile [0, n), 0 if they don't or the
+ *            table can't be allocated (then the layout must only be
+ *            freed)
+ */
+int Layout_table(
+      Layout*    layout   /* out */,
+      int        n        /* in  */,
+      const int  counts[] /* in  */,
+      const int  displs[] /* in  */,
+      int        comm_sz  /* in  */) {
+   int q, k, j, next = 0, nonempty = 0;
+
+   layout->kind = LAYOUT_TABLE;
+   layout->n = n;
+   layout->comm_sz = comm_sz;
+   layout->nb = 0;
+   layout->counts = malloc(3*comm_sz*sizeof(int));
+   if (layout->counts == NULL) {
+      layout->displs = layout->order = NULL;
+      return 0;
+   }
+   layout->displs = layout->counts + comm_sz;
+   layout->order = layout->counts + 2*comm_sz;
+   memcpy(layout->counts, counts, comm_sz*sizeof(int));
+   memcpy(layout->displs, displs, comm_sz*sizeof(int));
+
+   // Insertion sort of the nonempty ranges by their first index
+   for (q = 0; q < comm_sz; q++) {
+      if (counts[q] < 0) return 0;
+      if (counts[q] == 0) continue;
+      for (j = nonempty++; j > 0 && displs[layout->order[j-1]] > displs[q]; j--)
+         layout->order[j] = layout->order[j-1];
+      layout->order[j] = q;
+   }
+   for (k = 0; k < nonempty; k++) {
+      q = layout->order[k];
+      if (displs[q] != next) return 0;
+      next += counts[q];
+   }
+   for (k = nonempty; k < comm_sz; k++)
+      layout->order[k] = -1;
+   return next == n;
+}  /* Layout_table */
+
+/*---------------------------------------------------------------------
+ * Function:  Layout_free
+ * Purpose:   Release the tables of a layout
+ * In/out:    layout:  the distribution
+ */
+void Layout_free(Layout* layout /* in/out */) {
+   free(layout->counts);
+   layout->counts = layout->displs = layout->order = NULL;
+}  /* Layout_free */
+
+/*---------------------------------------------------------------------
+ * Function:  Layout_local_n
+ * Purpose:   Number of elements owned by process q
+ */
+int Layout_local_n(
+      const Layout*  layout  /* in */,
+      int            q       /* in */) {
+   int nblocks, mine, p = layout->comm_sz, nb = layout->nb;
+
+   if (layout->kind == LAYOUT_TABLE) return layout->counts[q];
+   nblocks = (layout->n + nb - 1)/nb;
+   if (q >= nblocks) return 0;
+   mine = (nblocks - q + p - 1)/p;
+   // The last block may be short
+   if ((nblocks - 1) % p == q)
+      return mine*nb - (nblocks*nb - layout->n);
+   return mine*nb;
+}  /* Layout_local_n */
+
+/*---------------------------------------------------------------------
+ * Function:  Layout_global_index
+ * Purpose:   Global index of the local element local_i of process q
+ */
+int Layout_global_index(
+      const Layout*  layout   /* in */,
+      int            q        /* in */,
+      int            local_i  /* in */) {
+   int nb = layout->nb;
+
+   if (layout->kind == LAYOUT_TABLE) return layout->displs[q] + local_i;
+   return ((local_i/nb)*layout->comm_sz + q)*nb + local_i % nb;
+}  /* Layout_global_index */
+
+/*---------------------------------------------------------------------
+ * Function:  Redist_plan_create
+ * Purpose:   Work out the messages that move a vector from one layout
+ *            to another, and build the buffers and datatypes to send
+ *            them
+ * In args:   from, to:  the layouts (same n and comm_sz)
+ *            comm:      communicator containing the vector
+ * Out args:  plan:      the redistribution
+ * Ret val:   1 on success; 0 on every process if some process couldn't
+ *            allocate its half of the plan (then nothing is left to
+ *            free)
+ *
+ * Note:
+ *    The elements a process sends to q and q receives from it are
+ *    listed by both in increasing global order, so the packed buffers
+ *    and the indexed datatypes of the two sides match.
+ */
+int Redist_plan_create(
+      const Layout*  from  /* in  */,
+      const Layout*  to    /* in  */,
+      Redist_plan*   plan  /* out */,
+      MPI_Comm       comm  /* in  */) {
+   int my_rank, comm_sz, ok;
+
+   MPI_Comm_rank(comm, &my_rank);
+   MPI_Comm_size(comm, &comm_sz);
+   plan->comm_sz = comm_sz;
+   plan->recv_counts = plan->recv_start = NULL;
+   plan->recv_types = NULL;
+   plan->recv_buf = NULL;
+   ok = Plan_side(from, to, my_rank, comm_sz, &plan->send_counts,
+         &plan->send_displs, &plan->send_first, &plan->send_start,
+         &plan->send_len, &plan->send_types, &plan->send_buf);
+   ok = ok && Plan_side(to, from, my_rank, comm_sz, &plan->recv_counts,
+         &plan->recv_displs, &plan->recv_first, &plan->recv_start,
+         &plan->recv_len, &plan->recv_types, &plan->recv_buf);
+   MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, comm);
+   if (!ok) Redist_plan_free(plan);
+   return ok;
+}  /* Redist_plan_create */
+
+/*---------------------------------------------------------------------
+ * Function:  Redist_plan_free
+ * Purpose:   Release the arrays, buffers and datatypes of a plan
+ * In/out:    plan:  the redistribution
+ */
+void Redist_plan_free(Redist_plan* plan /* in/out */) {
+   Free_side(plan->comm_sz, plan->send_counts, plan->send_start,
+         plan->send_types, plan->send_buf);
+   Free_side(plan->comm_sz, plan->recv_counts, plan->recv_start,
+         plan->recv_types, plan->recv_buf);
+   plan->send_counts = plan->send_start = NULL;
+   plan->recv_counts = plan->recv_start = NULL;
+   plan->send_types = plan->recv_types = NULL;
+   plan->send_buf = plan->recv_buf = NULL;
+}  /* Redist_plan_free */
+
+/*---------------------------------------------------------------------
+ * Function:  Redist_packed
+ * Purpose:   Redistribute a vector by packing the runs for each
+ *            process, one MPI_Alltoallv, and unpacking
+ * In args:   plan:       the redistribution
+ *            local_src:  local elements in the from layout
+ *            comm:       communicator containing the vector
+ * Out args:  local_dst:  local elements in the to layout
+ */
+void Redist_packed(
+      Redist_plan*  plan         /* in  */,
+      const double  local_src[]  /* in  */,
+      double        local_dst[]  /* out */,
+      MPI_Comm      comm         /* in  */) {
+   int r, pos = 0, nruns = plan->send_first[plan->comm_sz];
+
+   for (r = 0; r < nruns; r++) {
+      memcpy(plan->send_buf + pos, local_src + plan->send_start[r],
+            plan->send_len[r]*sizeof(double));
+      pos += plan->send_len[r];
+   }
+   MPI_Alltoallv(plan->send_buf, plan->send_counts, plan->send_displs,
+         MPI_DOUBLE, plan->recv_buf, plan->recv_counts, plan->recv_displs,
+         MPI_DOUBLE, comm);
+   pos = 0;
+   nruns = plan->recv_first[plan->comm_sz];
+   for (r = 0; r < nruns; r++) {
+      memcpy(local_dst + plan->recv_start[r], plan->recv_buf + pos,
+            plan->recv_len[r]*sizeof(double));
+      pos += plan->recv_len[r];
+   }
+}  /* Redist_packed */
+
+/*---------------------------------------------------------------------
+ * Function:  Redist_typed
+ * Purpose:   Redistribute a vector with one MPI_Alltoallw whose indexed
+ *            datatypes pick the runs straight out of and into the
+ *            local vectors
+ * In args:   plan:       the redistribution
+ *            local_src:  local elements in the from layout
+ *            comm:       communicator containing the vector
+ * Out args:  local_dst:  local elements in the to layout
+ *
+ * Note:
+ *    Each process sends one element of its datatype for q to every q;
+ *    the datatypes of processes it exchanges nothing with are empty.
+ */
+void Redist_typed(
+      Redist_plan*  plan         /* in  */,
+      const double  local_src[]  /* in  */,
+      double        local_dst[]  /* out */,
+      MPI_Comm      comm         /* in  */) {
+   int* ones = plan->send_first + plan->comm_sz + 1;
+   int* zeros = ones + plan->comm_sz;
+
+   MPI_Alltoallw(local_src, ones, zeros, plan->send_types, local_dst, ones,
+         zeros, plan->recv_types, comm);
+}  /* Redist_typed */
+
+/*---------------------------------------------------------------------
+ * Function:  Redist_remote_elements
+ * Purpose:   Number of elements the calling process sends to other
+ *            processes
+ */
+long long Redist_remote_elements(
+      const Redist_plan*  plan     /* in */,
+      int                 my_rank  /* in */) {
+   long long total = 0;
+   int q;
+
+   for (q = 0; q < plan->comm_sz; q++)
+      if (q != my_rank) total += plan->send_counts[q];
+   return total;
+}  /* Redist_remote_elements */
+
+/*---------------------------------------------------------------------
+ * Function:  Segment
+ * Purpose:   Find the owner of global index i and the end of the range
+ *            of consecutive indices around i it owns
+ * In args:   layout:   the distribution
+ *            i:        global index, 0 <= i < n
+ * Out args:  owner_p:  the owning process
+ *            local_p:  local index of i on the owner
+ * Ret val:   One past the last index of the range
+ */
+static int Segment(
+      const Layout*  layout   /* in  */,
+      int            i        /* in  */,
+      int*           owner_p  /* out */,
+      int*           local_p  /* out */) {
+   int b, nb = layout->nb, p = layout->comm_sz, lo, hi, mid, q;
+
+   if (layout->kind == LAYOUT_BLOCK_CYCLIC) {
+      b = i/nb;
+      *owner_p = b % p;
+      *local_p = (b/p)*nb + i % nb;
+      return (b + 1)*nb < layout->n ? (b + 1)*nb : layout->n;
+   }
+
+   // Last nonempty range starting at or before i
+   lo = 0;
+   hi = p - 1;
+   while (hi >= 0 && layout->order[hi] < 0) hi--;
+   while (lo < hi) {
+      mid = (lo + hi + 1)/2;
+      if (layout->displs[layout->order[mid]] <= i) lo = mid;
+      else hi = mid - 1;
+   }
+   q = layout->order[lo];
+   *owner_p = q;
+   *local_p = i - layout->displs[q];
+   return layout->displs[q] + layout->counts[q];
+}  /* Segment */
+
+/*---------------------------------------------------------------------
+ * Function:  Own_segment
+ * Purpose:   Find the k-th range of consecutive global indices owned by
+ *            process q, in increasing order
+ * Out args:  start_p, end_p:  the range [start, end)
+ * Ret val:   0 if q has fewer than k+1 ranges, 1 otherwise
+ */
+static int Own_segment(
+      const Layout*  layout   /* in  */,
+      int            q        /* in  */,
+      int            k        /* in  */,
+      int*           start_p  /* out */,
+      int*           end_p    /* out */) {
+   long long start;
+
+   if (layout->kind == LAYOUT_TABLE) {
+      if (k > 0 || layout->counts[q] == 0) return 0;
+      *start_p = layout->displs[q];
+      *end_p = layout->displs[q] + layout->counts[q];
+      return 1;
+   }
+   start = ((long long) k*layout->comm_sz + q)*layout->nb;
+   if (start >= layout->n) return 0;
+   *start_p = start;
+   *end_p = start + layout->nb < layout->n ? start + layout->nb : layout->n;
+   return 1;
+}  /* Own_segment */
+
+/*---------------------------------------------------------------------
+ * Function:  Walk_runs
+ * Purpose:   Split the elements of the calling process in layout own
+ *            into runs with a single owner in layout other
+ * In args:   own, other:  the layouts
+ *            my_rank:     calling process' rank
+ *            first:       index of the first run of each peer in start
+ *                         and len, or NULL to only count the runs
+ * In/out:    nruns:       runs per peer (counted from 0 on entry)
+ * Out args:   start, len:  local index in own and length of each run
+ */
+static void Walk_runs(
+      const Layout*  own      /* in     */,
+      const Layout*  other    /* in     */,
+      int            my_rank  /* in     */,
+      int            nruns[]  /* in/out */,
+      const int      first[]  /* in     */,
+      int            start[]  /* out    */,
+      int            len[]    /* out    */) {
+   int k, g, g_end, seg_end, local, peer, peer_local, r;
+
+   local = 0;
+   for (k = 0; Own_segment(own, my_rank, k, &g, &g_end); k++) {
+      while (g < g_end) {
+         seg_end = Segment(other, g, &peer, &peer_local);
+         if (seg_end > g_end) seg_end = g_end;
+         if (first != NULL) {
+            r = first[peer] + nruns[peer];
+            start[r] = local;
+            len[r] = seg_end - g;
+         }
+         nruns[peer]++;
+         local += seg_end - g;
+         g = seg_end;
+      }
+   }
+}  /* Walk_runs */
+
+/*---------------------------------------------------------------------
+ * Function:  Plan_side
+ * Purpose:   Build the send (own = from) or receive (own = to) half of
+ *            a plan
+ * In args:   own, other:  the layouts
+ *            my_rank:     calling process' rank
+ *            comm_sz:     number of processes
+ * Out args:  counts_p, displs_p:  elements per peer and their offsets
+ *                                 in the packed buffer
+ *            first_p:             first run of each peer (comm_sz+1
+ *                                 entries), followed by comm_sz ones
+ *                                 and comm_sz zeros for MPI_Alltoallw
+ *            start_p, len_p:      the runs
+ *            types_p:             an indexed datatype per peer
+ *            buf_p:               the packed buffer
+ * Ret val:   1 on success; 0 if an allocation failed (then every
+ *            pointer returned is NULL)
+ *
+ * Note:
+ *    counts, displs and first share one allocation, as do start and
+ *    len.  The datatypes are only created once everything else is
+ *    allocated, so a failure has none to free.
+ */
+static int Plan_side(
+      const Layout*   own       /* in  */,
+      const Layout*   other     /* in  */,
+      int             my_rank   /* in  */,
+      int             comm_sz   /* in  */,
+      int**           counts_p  /* out */,
+      int**           displs_p  /* out */,
+      int**           first_p   /* out */,
+      int**           start_p   /* out */,
+      int**           len_p     /* out */,
+      MPI_Datatype**  types_p   /* out */,
+      double**        buf_p     /* out */) {
+   int *counts, *displs, *first, *nruns, *start, *len;
+   int q, r, total_runs;
+   MPI_Datatype* types;
+   double* buf;
+   long long total = 0;
+
+   *counts_p = *displs_p = *first_p = *start_p = *len_p = NULL;
+   *types_p = NULL;
+   *buf_p = NULL;
+   counts = malloc((6*comm_sz + 1)*sizeof(int));
+   if (counts == NULL) return 0;
+   displs = counts + comm_sz;
+   first = counts + 2*comm_sz;
+   nruns = counts + 5*comm_sz + 1;
+   for (q = 0; q < comm_sz; q++) {
+      nruns[q] = 0;
+      first[comm_sz + 1 + q] = 1;
+      first[2*comm_sz + 1 + q] = 0;
+   }
+
+   Walk_runs(own, other, my_rank, nruns, NULL, NULL, NULL);
+   first[0] = 0;
+   for (q = 0; q < comm_sz; q++)
+      first[q + 1] = first[q] + nruns[q];
+   total_runs = first[comm_sz];
+   start = malloc(2*(size_t)(total_runs > 0 ? total_runs : 1)*sizeof(int));
+   if (start == NULL) {
+      free(counts);
+      return 0;
+   }
+   len = start + (total_runs > 0 ? total_runs : 1);
+   for (q = 0; q < comm_sz; q++)
+      nruns[q] = 0;
+   Walk_runs(own, other, my_rank, nruns, first, start, len);
+
+   for (q = 0; q < comm_sz; q++) {
+      displs[q] = total;
+      counts[q] = 0;
+      for (r = first[q]; r < first[q + 1]; r++)
+         counts[q] += len[r];
+      total += counts[q];
+   }
+   types = malloc(comm_sz*sizeof(MPI_Datatype));
+   buf = malloc((total > 0 ? total : 1)*sizeof(double));
+   if (types == NULL || buf == NULL) {
+      free(counts);
+      free(start);
+      free(types);
+      free(buf);
+      return 0;
+   }
+   for (q = 0; q < comm_sz; q++) {
+      MPI_Type_indexed(nruns[q], len + first[q], start + first[q],
+            MPI_DOUBLE, &types[q]);
+      MPI_Type_commit(&types[q]);
+   }
+
+   *counts_p = counts;
+   *displs_p = displs;
+   *first_p = first;
+   *start_p = start;
+   *len_p = len;
+   *types_p = types;
+   *buf_p = buf;
+   return 1;
+}  /* Plan_side */
+
+/*---------------------------------------------------------------------
+ * Function:  Free_side
+ * Purpose:   Release the arrays, buffer and datatypes of one half of a
+ *            plan, any of which may be NULL
+ */
+static void Free_side(
+      int            comm_sz  /* in */,
+      int*           counts   /* in */,
+      int*           start    /* in */,
+      MPI_Datatype*  types    /* in */,
+      double*        buf      /* in */) {
+   int q;
+
+   if (types != NULL)
+      for (q = 0; q < comm_sz; q++)
+         MPI_Type_free(&types[q]);
+   free(counts);
+   free(start);
+   free(types);
+   free(buf);
+}  /* Free_side */
@@ -0,0 +1,76 @@
+/* File:     mpi_layout.h
+ *
+ * Purpose:  Distributions of a vector of order n over the processes of
+ *           a communicator, and redistribution of a vector between any
+ *           two of them.
+ *
+ *           LAYOUT_BLOCK_CYCLIC:  blocks of nb elements dealt to the
+ *              processes in turn: global index i is in block b = i/nb,
+ *              owned by process b % comm_sz.  nb = ceil(n/comm_sz)
+ *              gives the usual block distribution.
+ *           LAYOUT_TABLE:  an explicit offset table, as in
+ *              MPI_Scatterv: process q owns the counts[q] elements
+ *              starting at displs[q].  The ranges must tile [0, n) but
+ *              may come in any order.
+ *
+ *           A process stores its elements in increasing global order.
+ *
+ * Compile:  Link mpi_layout.c into the program.
+ *
+ * Notes:
+ * 1.  Layouts are plain descriptions known to every process; creating
+ *     one involves no communication.
+ * 2.  A Redist_plan lists, for each pair of processes, the runs of
+ *     consecutive local elements that move between them.  Building it
+ *     costs each process time proportional to the number of runs
+ *     it takes part in, not to n.  The plan can be executed
+ *     repeatedly with MPI_Alltoallv on packed buffers
+ *     (Redist_packed) or with MPI_Alltoallw on indexed datatypes that
+ *     address the vectors in place (Redist_typed).
+ * 3.  Redist_plan_create agrees on its result over the communicator:
+ *     if one process can't allocate its half of the plan, every
+ *     process gets 0 and an empty plan.
+ */
+#ifndef MPI_LAYOUT_H
+#define MPI_LAYOUT_H
+
+#include <mpi.h>
+
+enum { LAYOUT_BLOCK_CYCLIC, LAYOUT_TABLE };
+
+typedef struct {
+   int   kind;
+   int   n;
+   int   comm_sz;
+   int   nb;        /* LAYOUT_BLOCK_CYCLIC: block size                */
+   int*  counts;    /* LAYOUT_TABLE: elements of each process         */
+   int*  displs;    /* LAYOUT_TABLE: first global index of each       */
+   int*  order;     /* LAYOUT_TABLE: processes by increasing displs   */
+} Layout;
+
+typedef struct {
+   int            comm_sz;
+   int            *send_counts, *send_displs, *recv_counts, *recv_displs;
+   int            *send_first, *recv_first;   /* first run of each peer */
+   int            *send_start, *send_len, *recv_start, *recv_len;
+   MPI_Datatype   *send_types, *recv_types;
+   double         *send_buf, *recv_buf;
+} Redist_plan;
+
+void Layout_block_cyclic(Layout* layout, int n, int nb, int comm_sz);
+int Layout_table(Layout* layout, int n, const int counts[],
+      const int displs[], int comm_sz);
+void Layout_free(Layout* layout);
+int Layout_local_n(const Layout* layout, int q);
+int Layout_global_index(const Layout* layout, int q, int local_i);
+
+int Redist_plan_create(const Layout* from, const Layout* to,
+      Redist_plan* plan, MPI_Comm comm);
+void Redist_plan_free(Redist_plan* plan);
+void Redist_packed(Redist_plan* plan, const double local_src[],
+      double local_dst[], MPI_Comm comm);
+void Redist_typed(Redist_plan* plan, const double local_src[],
+      double local_dst[], MPI_Comm comm);
+long long Redist_remote_elements(const Redist_plan* plan, int my_rank);
+
+#endif /* MPI_LAYOUT_H */
@@ -0,0 +1,270 @@
+/* File:     mpi_multivec.c
+ *
+ * Purpose:  Tall-skinny multivectors: block inner product, block update
+ *           and TSQR (see mpi_multivec.h)
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <mpi.h>
+#include "vector_ops.h"
+#include "mpi_multivec.h"
+
+static void Householder_qr(double A[], int m, int k, double R[],
+      double work[]);
+
+/*---------------------------------------------------------------------
+ * Function:  Multivec_alloc
+ * Purpose:   Allocate the local rows of a multivector
+ * In args:   local_n:  rows owned
+ *            k:        number of vectors
+ * Out args:  X:        the multivector (elements not initialized)
+ * Ret val:   1 on success, 0 if the allocation fails
+ */
+int Multivec_alloc(
+      Multivector*  X        /* out */,
+      int           local_n  /* in  */,
+      int           k        /* in  */) {
+   X->local_n = local_n;
+   X->k = k;
+   X->val = Vec_alloc((size_t) local_n*k > 0 ? (size_t) local_n*k : 1,
+         sizeof(double));
+   return X->val != NULL;
+}  /* Multivec_alloc */
+
+/*---------------------------------------------------------------------
+ * Function:  Multivec_free
+ * Purpose:   Release the storage of a multivector
+ * In/out:    X:  the multivector
+ */
+void Multivec_free(Multivector* X /* in/out */) {
+   free(X->val);
+   X->val = NULL;
+}  /* Multivec_free */
+
+/*---------------------------------------------------------------------
+ * Function:  Multivec_inner
+ * Purpose:   Block inner product G = X^T*Y
+ * In args:   X, Y:  multivectors with the same distribution
+ *            comm:  communicator containing them
+ * Out args:  G:     X->k x Y->k matrix, G[a*Y->k + b] = x_a.y_b, on
+ *                   every process
+ *
+ * Note:
+ *    Each row of X and Y is read once and its outer product added to
+ *    the local G, which stays in the L1 cache for moderate k; then a
+ *    single MPI_Allreduce sums the kx*ky entries.  The local G is
+ *    accumulated in G itself and reduced in place, so nothing is
+ *    allocated.
+ */
+void Multivec_inner(
+      const Multivector*  X     /* in  */,
+      const Multivector*  Y     /* in  */,
+      double              G[]   /* out */,
+      MPI_Comm            comm  /* in  */) {
+   int kx = X->k, ky = Y->k, i, a, b;
+   const double *xr, *yr;
+   double *g, xa;
+
+   memset(G, 0, kx*ky*sizeof(double));
+   for (i = 0; i < X->local_n; i++) {
+      xr = X->val + (size_t) i*kx;
+      yr = Y->val + (size_t) i*ky;
+      for (a = 0; a < kx; a++) {
+         xa = xr[a];
+         g = G + a*ky;
+         VEC_IVDEP
+         for (b = 0; b < ky; b++)
+            g[b] += xa*yr[b];
+      }
+   }
+   MPI_Allreduce(MPI_IN_PLACE, G, kx*ky, MPI_DOUBLE, MPI_SUM, comm);
+}  /* Multivec_inner */
+
+/*---------------------------------------------------------------------
+ * Function:  Multivec_update
+ * Purpose:   Block update X += Y*B
+ * In args:   Y:  multivector with the distribution of X
+ *            B:  Y->k x X->k matrix
+ * In/out:    X:  the multivector updated
+ *
+ * Note:
+ *    Purely local: one pass over the rows of X and Y.
+ */
+void Multivec_update(
+      Multivector*        X    /* in/out */,
+      const Multivector*  Y    /* in     */,
+      const double        B[]  /* in     */) {
+   int kx = X->k, ky = Y->k, i, a, b;
+   const double *yr, *br;
+   double *xr, yb;
+
+   for (i = 0; i < X->local_n; i++) {
+      xr = X->val + (size_t) i*kx;
+      yr = Y->val + (size_t) i*ky;
+      for (b = 0; b < ky; b++) {
+         yb = yr[b];
+         br = B + b*kx;
+         VEC_IVDEP
+         for (a = 0; a < kx; a++)
+            xr[a] += yb*br[a];
+      }
+   }
+}  /* Multivec_update */
+
+/*---------------------------------------------------------------------
+ * Function:  Tsqr
+ * Purpose:   Tall-skinny QR factorization X = Q*R
+ * In args:   comm:  communicator containing X
+ * In/out:    X:     the multivector on input, Q on output
+ * Out args:  R:     k x k upper triangular factor, on every process
+ * Ret val:   1 on success, 0 if some process has fewer than k rows or
+ *            can't allocate its work space (X is then unchanged)
+ *
+ * Note:
+ *    Each process factors its rows, X_q = Q_q*R_q, with Householder
+ *    reflections.  The comm_sz factors R_q are gathered on every process
+ *    with MPI_Allgather and the stacked (comm_sz*k) x k matrix is
+ *    factored again, redundantly, giving R and Q2.  The block of Q2
+ *    that multiplies R_q turns Q_q into the rows of Q.  Only k*k values
+ *    per process are communicated.
+ */
+int Tsqr(
+      Multivector*  X     /* in/out */,
+      double        R[]   /* out    */,
+      MPI_Comm      comm  /* in     */) {
+   int comm_sz, my_rank, k = X->k, local_ok, ok;
+   double *stacked, *local_R, *work;
+   Multivector Q;
+
+   MPI_Comm_size(comm, &comm_sz);
+   MPI_Comm_rank(comm, &my_rank);
+   stacked = malloc((size_t) comm_sz*k*k*sizeof(double));
+   local_R = malloc((size_t) k*k*sizeof(double));
+   work = malloc(((size_t) (X->local_n > comm_sz*k ? X->local_n : comm_sz*k)
+         *k + 2*k)*sizeof(double));
+   local_ok = Multivec_alloc(&Q, X->local_n, k);
+   local_ok = local_ok && X->local_n >= k && stacked != NULL
+         && local_R != NULL && work != NULL;
+   MPI_Allreduce(&local_ok, &ok, 1, MPI_INT, MPI_MIN, comm);
+   if (!ok) {
+      Multivec_free(&Q);
+      free(stacked);
+      free(local_R);
+      free(work);
+      return 0;
+   }
+
+   memcpy(Q.val, X->val, (size_t) X->local_n*k*sizeof(double));
+   Householder_qr(Q.val, X->local_n, k, local_R, work);
+   MPI_Allgather(local_R, k*k, MPI_DOUBLE, stacked, k*k, MPI_DOUBLE, comm);
+   Householder_qr(stacked, comm_sz*k, k, R, work);
+
+   // X = Q_q * (block my_rank of Q2)
+   memset(X->val, 0, (size_t) X->local_n*k*sizeof(double));
+   Multivec_update(X, &Q, stacked + (size_t) my_rank*k*k);
+
+   Multivec_free(&Q);
+   free(stacked);
+   free(local_R);
+   free(work);
+   return 1;
+}  /* Tsqr */
+
+/*---------------------------------------------------------------------
+ * Function:  Householder_qr
+ * Purpose:   QR factorization of a row-major m x k matrix, m >= k, with
+ *            the explicit Q
+ * In args:   m, k:  dimensions of A
+ * In/out:    A:     the matrix on input, Q (m x k) on output
+ * Out args:  R:     k x k upper triangular factor
+ *            work:  scratch for m*k + 2*k doubles
+ *
+ * Note:
+ *    Each reflection H = I - tau*v*v^T (v[j] = 1) is applied to the
+ *    remaining columns in two passes over the rows: one forms v^T*A for
+ *    all the columns at once, one subtracts tau*v*(v^T*A).  Both read
+ *    rows contiguously, which suits the row-interleaved layout.  The
+ *    diagonal of R is made nonnegative.
+ */
+static void Householder_qr(
+      double  A[]     /* in/out */,
+      int     m       /* in     */,
+      int     k       /* in     */,
+      double  R[]     /* out    */,
+      double  work[]  /* out    */) {
+   double *V = work, *tau = work + (size_t) m*k, *s = tau + k;
+   double norm, alpha, beta, t;
+   int i, j, c;
+
+   for (j = 0; j < k; j++) {
+      norm = 0.0;
+      for (i = j; i < m; i++)
+         norm += A[(size_t) i*k + j]*A[(size_t) i*k + j];
+      norm = sqrt(norm);
+      alpha = A[(size_t) j*k + j];
+      if (norm == 0.0) {
+         tau[j] = 0.0;
+         for (i = j + 1; i < m; i++)
+            A[(size_t) i*k + j] = 0.0;
+         continue;
+      }
+      beta = alpha > 0.0 ? -norm : norm;
+      tau[j] = (beta - alpha)/beta;
+      for (i = j + 1; i < m; i++)
+         A[(size_t) i*k + j] /= alpha - beta;
+      A[(size_t) j*k + j] = beta;
+
+      // s = v^T*A for the columns right of j, then A -= tau*v*s
+      for (c = j + 1; c < k; c++)
+         s[c] = A[(size_t) j*k + c];
+      for (i = j + 1; i < m; i++)
+         for (c = j + 1; c < k; c++)
+            s[c] += A[(size_t) i*k + j]*A[(size_t) i*k + c];
+      for (c = j + 1; c < k; c++) {
+         s[c] *= tau[j];
+         A[(size_t) j*k + c] -= s[c];
+      }
+      for (i = j + 1; i < m; i++) {
+         t = A[(size_t) i*k + j];
+         for (c = j + 1; c < k; c++)
+            A[(size_t) i*k + c] -= t*s[c];
+      }
+   }
+
+   // R is the upper triangle; keep the reflectors in V
+   for (i = 0; i < k; i++)
+      for (c = 0; c < k; c++)
+         R[i*k + c] = c >= i ? A[(size_t) i*k + c] : 0.0;
+   memcpy(V, A, (size_t) m*k*sizeof(double));
+
+   // Q = H_0 H_1 ... H_{k-1} [I; 0], applying the reflectors backwards
+   memset(A, 0, (size_t) m*k*sizeof(double));
+   for (j = 0; j < k; j++)
+      A[(size_t) j*k + j] = 1.0;
+   for (j = k - 1; j >= 0; j--) {
+      for (c = j; c < k; c++)
+         s[c] = A[(size_t) j*k + c];
+      for (i = j + 1; i < m; i++)
+         for (c = j; c < k; c++)
+            s[c] += V[(size_t) i*k + j]*A[(size_t) i*k + c];
+      for (c = j; c < k; c++) {
+         s[c] *= tau[j];
+         A[(size_t) j*k + c] -= s[c];
+      }
+      for (i = j + 1; i < m; i++) {
+         t = V[(size_t) i*k + j];
+         for (c = j; c < k; c++)
+            A[(size_t) i*k + c] -= t*s[c];
+      }
+   }
+
+   // Nonnegative diagonal: flip row j of R and column j of Q together
+   for (j = 0; j < k; j++)
+      if (R[j*k + j] < 0.0) {
+         for (c = j; c < k; c++)
+            R[j*k + c] = -R[j*k + c];
+         for (i = 0; i < m; i++)
+            A[(size_t) i*k + j] = -A[(size_t) i*k + j];
+      }
+}  /* Householder_qr */
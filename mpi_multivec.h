@@ -0,0 +1,42 @@
+/* File:     mpi_multivec.h
+ *
+ * Purpose:  Distributed tall-skinny multivectors: k vectors of order n
+ *           with the block distribution of mpi_vector_utils.h, stored
+ *           together.  Each process holds its local_n rows, and row i
+ *           holds element i of the k vectors contiguously:
+ *              val[i*k + j] = element i of vector j
+ *
+ * Compile:  Link mpi_multivec.c and vector_ops.c into the program (and
+ *           -lm).
+ *
+ * Notes:
+ * 1.  Because the k elements of a row are adjacent, one pass over the
+ *     rows does the work of k (or k*k) vector kernels, and the k*k
+ *     results of a block inner product go into a single MPI_Allreduce.
+ * 2.  Operations:
+ *        Multivec_inner   G = X^T*Y, a kx x ky matrix on every process
+ *        Multivec_update  X += Y*B for a ky x kx matrix B
+ *        Tsqr             X = Q*R with orthonormal Q (in X) and
+ *                         upper triangular k x k R on every process
+ *     Small matrices (G, B, R) are row-major.
+ */
+#ifndef MPI_MULTIVEC_H
+#define MPI_MULTIVEC_H
+
+#include <mpi.h>
+
+typedef struct {
+   int      local_n;   /* rows owned                   */
+   int      k;         /* number of vectors            */
+   double*  val;       /* local_n*k elements, by rows  */
+} Multivector;
+
+int Multivec_alloc(Multivector* X, int local_n, int k);
+void Multivec_free(Multivector* X);
+void Multivec_inner(const Multivector* X, const Multivector* Y, double G[],
+      MPI_Comm comm);
+void Multivec_update(Multivector* X, const Multivector* Y,
+      const double B[]);
+int Tsqr(Multivector* X, double R[], MPI_Comm comm);
+
+#endif /* MPI_MULTIVEC_H */
@@ -0,0 +1,264 @@
+/* File:     mpi_multivec_bench.c
+ *
+ * Purpose:  Compare the block operations of mpi_multivec.h with the same
+ *           work done on k separate vectors, and check TSQR.
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_multivec_bench \
+ *              mpi_multivec_bench.c mpi_multivec.c mpi_vector_utils.c vector_ops.c -lm
+ * Run:      mpiexec -n <comm_sz> ./mpi_multivec_bench <order of the vectors> <k> <iterations>
+ *
+ * Input:    The order of the vectors, n, the number of vectors, k, and
+ *           the number of repetitions
+ * Output:   Time per call of X^T*Y and X += Y*B with the multivector and
+ *           with separate vectors, the time of TSQR and the errors
+ *           ||Q^T*Q - I|| and ||Q*R - X||/||X|| (max norms)
+ *
+ * Notes:
+ * 1.  n should be evenly divisible by comm_sz, with n/comm_sz >= k
+ * 2.  With separate vectors, X^T*Y takes k*k calls of
+ *     Parallel_dot_product, each followed by its MPI_Allreduce, as the
+ *     dot product of mpi_vector_operations.c is; X += Y*B takes k*k
+ *     calls of Axpy.
+ * 3.  Before timing, both inner products must agree to a relative
+ *     1e-12.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+#include "mpi_multivec.h"
+
+void Split(const Multivector* X, double* cols[]);
+void Separate_inner(double* xs[], double* ys[], int local_n, int k,
+      double G[], MPI_Comm comm);
+void Separate_update(double* xs[], double* ys[], int local_n, int k,
+      const double B[]);
+void Check_tsqr(const Multivector* X0, const Multivector* Q,
+      const double R[], double errors[], MPI_Comm comm);
+
+int main(int argc, char* argv[]) {
+    int n, local_n, k, iters, it, j, ok;
+    int comm_sz, my_rank;
+    double **xs, **ys, *G, *G_sep, *B, *R;
+    double start, local_t[5], t[5], errors[2];
+    Multivector X, Y, Q;
+    MPI_Comm comm;
+
+    // Initialize MPI
+    MPI_Init(&argc, &argv);
+    comm = MPI_COMM_WORLD;
+    MPI_Comm_size(comm, &comm_sz);
+    MPI_Comm_rank(comm, &my_rank);
+
+    if (argc != 4) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Usage: %s <order of the vectors> <k> <iterations>\n", argv[0]);
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    n = atoi(argv[1]);
+    k = atoi(argv[2]);
+    iters = atoi(argv[3]);
+    if (n <= 0 || n % comm_sz != 0 || k <= 0 || n/comm_sz < k || iters <= 0) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Order of the vectors should be a positive integer, evenly divisible by the number of processes, with at least k rows per process; k and iterations positive\n");
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    local_n = n/comm_sz;
+    ok = Multivec_alloc(&X, local_n, k) && Multivec_alloc(&Y, local_n, k)
+          && Multivec_alloc(&Q, local_n, k);
+    xs = malloc(2*k*sizeof(double*));
+    ys = xs + k;
+    G = malloc(4*k*k*sizeof(double));
+    G_sep = G + k*k;
+    B = G + 2*k*k;
+    R = G + 3*k*k;
+    ok = ok && xs != NULL && G != NULL;
+    for (j = 0; ok && j < k; j++) {
+        xs[j] = Vec_alloc(local_n, sizeof(double));
+        ys[j] = Vec_alloc(local_n, sizeof(double));
+        ok = xs[j] != NULL && ys[j] != NULL;
+    }
+    Check_for_error(ok, "main", "Can't allocate the vectors", comm);
+
+    Generate_vector(X.val, local_n*k, my_rank, 1);
+    Generate_vector(Y.val, local_n*k, my_rank, 2);
+    Generate_vector(B, k*k, 0, 3);
+    MPI_Bcast(B, k*k, MPI_DOUBLE, 0, comm);
+    Split(&X, xs);
+    Split(&Y, ys);
+
+    Multivec_inner(&X, &Y, G, comm);
+    Separate_inner(xs, ys, local_n, k, G_sep, comm);
+    for (j = 0; j < k*k; j++)
+        if (fabs(G[j] - G_sep[j]) > 1.0e-12*fabs(G_sep[j])) ok = 0;
+    Check_for_error(ok, "main", "Block inner product is wrong", comm);
+
+    MPI_Barrier(comm);
+    start = MPI_Wtime();
+    for (it = 0; it < iters; it++)
+        Multivec_inner(&X, &Y, G, comm);
+    local_t[0] = (MPI_Wtime() - start)/iters;
+    MPI_Barrier(comm);
+    start = MPI_Wtime();
+    for (it = 0; it < iters; it++)
+        Separate_inner(xs, ys, local_n, k, G_sep, comm);
+    local_t[1] = (MPI_Wtime() - start)/iters;
+
+    memcpy(Q.val, X.val, (size_t) local_n*k*sizeof(double));
+    MPI_Barrier(comm);
+    start = MPI_Wtime();
+    for (it = 0; it < iters; it++)
+        Multivec_update(&Q, &Y, B);
+    local_t[2] = (MPI_Wtime() - start)/iters;
+    MPI_Barrier(comm);
+    start = MPI_Wtime();
+    for (it = 0; it < iters; it++)
+        Separate_update(xs, ys, local_n, k, B);
+    local_t[3] = (MPI_Wtime() - start)/iters;
+
+    memcpy(Q.val, X.val, (size_t) local_n*k*sizeof(double));
+    MPI_Barrier(comm);
+    start = MPI_Wtime();
+    Check_for_error(Tsqr(&Q, R, comm), "main", "TSQR failed", comm);
+    local_t[4] = MPI_Wtime() - start;
+    Check_tsqr(&X, &Q, R, errors, comm);
+
+    MPI_Reduce(local_t, t, 5, MPI_DOUBLE, MPI_MAX, 0, comm);
+    if (my_rank == 0) {
+        printf("n = %d, k = %d\n", n, k);
+        printf("%-10s %14s %14s %9s\n", "op", "multivector", "separate", "speedup");
+        printf("%-10s %14.6e %14.6e %9.2f\n", "X^T*Y", t[0], t[1], t[1]/t[0]);
+        printf("%-10s %14.6e %14.6e %9.2f\n", "X += Y*B", t[2], t[3], t[3]/t[2]);
+        printf("TSQR %e s, ||Q^T*Q - I|| = %.2e, ||Q*R - X||/||X|| = %.2e\n",
+              t[4], errors[0], errors[1]);
+    }
+
+    for (j = 0; j < k; j++) {
+        free(xs[j]);
+        free(ys[j]);
+    }
+    free(xs);
+    free(G);
+    Multivec_free(&X);
+    Multivec_free(&Y);
+    Multivec_free(&Q);
+
+    MPI_Finalize();
+    return 0;
+}  /* main */
+
+/*---------------------------------------------------------------------
+ * Function:  Split
+ * Purpose:   Copy the vectors of a multivector into separate arrays
+ * In args:   X:     the multivector
+ * Out args:  cols:  X->k arrays of X->local_n elements
+ */
+void Split(
+      const Multivector*  X       /* in  */,
+      double*             cols[]  /* out */) {
+   int i, j;
+
+   for (i = 0; i < X->local_n; i++)
+      for (j = 0; j < X->k; j++)
+         cols[j][i] = X->val[(size_t) i*X->k + j];
+}  /* Split */
+
+/*---------------------------------------------------------------------
+ * Function:  Separate_inner
+ * Purpose:   G = X^T*Y with one dot product and one MPI_Allreduce per
+ *            entry
+ * In args:   xs, ys:   the k local blocks of each set of vectors
+ *            local_n:  order of the blocks
+ *            k:        number of vectors
+ *            comm:     communicator containing the vectors
+ * Out args:  G:        k x k result
+ */
+void Separate_inner(
+      double*    xs[]     /* in  */,
+      double*    ys[]     /* in  */,
+      int        local_n  /* in  */,
+      int        k        /* in  */,
+      double     G[]      /* out */,
+      MPI_Comm   comm     /* in  */) {
+   int a, b;
+   double local_dot;
+
+   for (a = 0; a < k; a++)
+      for (b = 0; b < k; b++) {
+         local_dot = Parallel_dot_product(xs[a], ys[b], local_n);
+         MPI_Allreduce(&local_dot, &G[a*k + b], 1, MPI_DOUBLE, MPI_SUM, comm);
+      }
+}  /* Separate_inner */
+
+/*---------------------------------------------------------------------
+ * Function:  Separate_update
+ * Purpose:   X += Y*B with one Axpy per entry of B
+ * In args:   ys:       the k local blocks of Y
+ *            local_n:  order of the blocks
+ *            k:        number of vectors
+ *            B:        k x k matrix
+ * In/out:    xs:       the k local blocks of X
+ */
+void Separate_update(
+      double*       xs[]     /* in/out */,
+      double*       ys[]     /* in     */,
+      int           local_n  /* in     */,
+      int           k        /* in     */,
+      const double  B[]      /* in     */) {
+   int a, b;
+
+   for (a = 0; a < k; a++)
+      for (b = 0; b < k; b++)
+         Axpy(ys[b], xs[a], local_n, B[b*k + a]);
+}  /* Separate_update */
+
+/*---------------------------------------------------------------------
+ * Function:  Check_tsqr
+ * Purpose:   Measure the orthogonality of Q and the residual of Q*R
+ * In args:   X0:      the factored multivector
+ *            Q, R:    its factors
+ *            comm:    communicator containing the multivectors
+ * Out args:  errors:  max |Q^T*Q - I| and max |Q*R - X0| / max |X0|
+ */
+void Check_tsqr(
+      const Multivector*  X0        /* in  */,
+      const Multivector*  Q         /* in  */,
+      const double        R[]       /* in  */,
+      double              errors[]  /* out */,
+      MPI_Comm            comm      /* in  */) {
+   int k = Q->k, i, j, c;
+   double *G, e, qr, local_max[2] = {0.0, 0.0}, max[2];
+
+   // Orthogonality
+   G = malloc(k*k*sizeof(double));
+   Multivec_inner(Q, Q, G, comm);
+   errors[0] = 0.0;
+   for (i = 0; i < k; i++)
+      for (j = 0; j < k; j++) {
+         e = fabs(G[i*k + j] - (i == j));
+         if (e > errors[0]) errors[0] = e;
+      }
+   free(G);
+
+   // Residual, relative to the largest element of X0
+   for (i = 0; i < Q->local_n; i++)
+      for (j = 0; j < k; j++) {
+         qr = 0.0;
+         for (c = 0; c <= j; c++)
+            qr += Q->val[(size_t) i*k + c]*R[c*k + j];
+         e = fabs(qr - X0->val[(size_t) i*k + j]);
+         if (e > local_max[0]) local_max[0] = e;
+         e = fabs(X0->val[(size_t) i*k + j]);
+         if (e > local_max[1]) local_max[1] = e;
+      }
+   MPI_Allreduce(local_max, max, 2, MPI_DOUBLE, MPI_MAX, comm);
+   errors[1] = max[0]/max[1];
+}  /* Check_tsqr */
@@ -0,0 +1,216 @@
+/* File:     mpi_persist.c
+ *
+ * Purpose:  Persistent communication patterns with a fallback for MPI
+ *           libraries older than MPI 4 (see mpi_persist.h)
+ *
+ * Note:
+ *    The point-to-point gather uses the tag PERSIST_TAG, so two of them
+ *    on the same communicator must not be in flight at the same time.
+ */
+#include <stdlib.h>
+#include <mpi.h>
+#include "mpi_persist.h"
+
+#define PERSIST_TAG  0x5e
+
+/* How Persist_start starts the pattern */
+enum { PERSIST_REQUESTS, PERSIST_IREDUCE, PERSIST_IALLREDUCE,
+   PERSIST_IGATHER };
+
+static void Persist_record(int kind, const void* sendbuf, void* recvbuf,
+      int count, MPI_Datatype type, MPI_Op op, int root, MPI_Comm comm,
+      Persistent_op* p);
+
+/*---------------------------------------------------------------------
+ * Function:  Persist_reduce_init
+ * Purpose:   Set up MPI_Reduce(sendbuf, recvbuf, count, type, op, root,
+ *            comm) for repeated use
+ * In args:   sendbuf, count, type, op, root, comm:  as in MPI_Reduce
+ * Out args:  recvbuf:  written by each completed iteration on root
+ *            p:        the pattern
+ */
+void Persist_reduce_init(
+      const void*     sendbuf  /* in  */,
+      void*           recvbuf  /* out */,
+      int             count    /* in  */,
+      MPI_Datatype    type     /* in  */,
+      MPI_Op          op       /* in  */,
+      int             root     /* in  */,
+      MPI_Comm        comm     /* in  */,
+      Persistent_op*  p        /* out */) {
+   Persist_record(PERSIST_IREDUCE, sendbuf, recvbuf, count, type, op, root,
+         comm, p);
+#if PERSIST_COLLECTIVES
+   p->kind = PERSIST_REQUESTS;
+   MPI_Reduce_init(sendbuf, recvbuf, count, type, op, root, comm,
+         MPI_INFO_NULL, p->reqs);
+#endif
+}  /* Persist_reduce_init */
+
+/*---------------------------------------------------------------------
+ * Function:  Persist_allreduce_init
+ * Purpose:   Set up MPI_Allreduce(sendbuf, recvbuf, count, type, op,
+ *            comm) for repeated use
+ * In args:   sendbuf, count, type, op, comm:  as in MPI_Allreduce
+ * Out args:  recvbuf:  written by each completed iteration
+ *            p:        the pattern
+ */
+void Persist_allreduce_init(
+      const void*     sendbuf  /* in  */,
+      void*           recvbuf  /* out */,
+      int             count    /* in  */,
+      MPI_Datatype    type     /* in  */,
+      MPI_Op          op       /* in  */,
+      MPI_Comm        comm     /* in  */,
+      Persistent_op*  p        /* out */) {
+   Persist_record(PERSIST_IALLREDUCE, sendbuf, recvbuf, count, type, op, 0,
+         comm, p);
+#if PERSIST_COLLECTIVES
+   p->kind = PERSIST_REQUESTS;
+   MPI_Allreduce_init(sendbuf, recvbuf, count, type, op, comm,
+         MPI_INFO_NULL, p->reqs);
+#endif
+}  /* Persist_allreduce_init */
+
+/*---------------------------------------------------------------------
+ * Function:  Persist_gather_init
+ * Purpose:   Set up MPI_Gather(sendbuf, count, type, recvbuf, count,
+ *            type, root, comm) for repeated use
+ * In args:   sendbuf, count, type, root, comm:  as in MPI_Gather
+ * Out args:  recvbuf:  written by each completed iteration on root
+ *            p:        the pattern
+ */
+void Persist_gather_init(
+      const void*     sendbuf  /* in  */,
+      void*           recvbuf  /* out */,
+      int             count    /* in  */,
+      MPI_Datatype    type     /* in  */,
+      int             root     /* in  */,
+      MPI_Comm        comm     /* in  */,
+      Persistent_op*  p        /* out */) {
+   Persist_record(PERSIST_IGATHER, sendbuf, recvbuf, count, type, MPI_OP_NULL,
+         root, comm, p);
+#if PERSIST_COLLECTIVES
+   p->kind = PERSIST_REQUESTS;
+   MPI_Gather_init(sendbuf, count, type, recvbuf, count, type, root, comm,
+         MPI_INFO_NULL, p->reqs);
+#endif
+}  /* Persist_gather_init */
+
+/*---------------------------------------------------------------------
+ * Function:  Persist_gather_p2p_init
+ * Purpose:   Set up the same gather as Persist_gather_init with
+ *            persistent point-to-point requests
+ * In args:   sendbuf, count, type, root, comm:  as in MPI_Gather
+ * Out args:  recvbuf:  written by each completed iteration on root
+ *            p:        the pattern
+ *
+ * Note:
+ *    Every process has a send request to root, and root one receive
+ *    request per process (its own block included), all started
+ *    together by Persist_start.
+ */
+void Persist_gather_p2p_init(
+      const void*     sendbuf  /* in  */,
+      void*           recvbuf  /* out */,
+      int             count    /* in  */,
+      MPI_Datatype    type     /* in  */,
+      int             root     /* in  */,
+      MPI_Comm        comm     /* in  */,
+      Persistent_op*  p        /* out */) {
+   int comm_sz, my_rank, q;
+   MPI_Aint lb, extent;
+
+   MPI_Comm_size(comm, &comm_sz);
+   MPI_Comm_rank(comm, &my_rank);
+   MPI_Type_get_extent(type, &lb, &extent);
+   Persist_record(PERSIST_REQUESTS, sendbuf, recvbuf, count, type,
+         MPI_OP_NULL, root, comm, p);
+
+   p->nreqs = (my_rank == root) ? comm_sz + 1 : 1;
+   p->reqs = realloc(p->reqs, p->nreqs*sizeof(MPI_Request));
+   MPI_Send_init(sendbuf, count, type, root, PERSIST_TAG, comm, &p->reqs[0]);
+   if (my_rank == root)
+      for (q = 0; q < comm_sz; q++)
+         MPI_Recv_init((char*) recvbuf + (MPI_Aint) q*count*extent, count,
+               type, q, PERSIST_TAG, comm, &p->reqs[q + 1]);
+}  /* Persist_gather_p2p_init */
+
+/*---------------------------------------------------------------------
+ * Function:  Persist_start
+ * Purpose:   Start one iteration of the pattern
+ * In/out:    p:  the pattern
+ */
+void Persist_start(Persistent_op* p /* in/out */) {
+   switch (p->kind) {
+      case PERSIST_REQUESTS:
+         MPI_Startall(p->nreqs, p->reqs);
+         break;
+      case PERSIST_IREDUCE:
+         MPI_Ireduce(p->sendbuf, p->recvbuf, p->count, p->type, p->op,
+               p->root, p->comm, p->reqs);
+         break;
+      case PERSIST_IALLREDUCE:
+         MPI_Iallreduce(p->sendbuf, p->recvbuf, p->count, p->type, p->op,
+               p->comm, p->reqs);
+         break;
+      case PERSIST_IGATHER:
+         MPI_Igather(p->sendbuf, p->count, p->type, p->recvbuf, p->count,
+               p->type, p->root, p->comm, p->reqs);
+         break;
+   }
+}  /* Persist_start */
+
+/*---------------------------------------------------------------------
+ * Function:  Persist_wait
+ * Purpose:   Complete the iteration started by Persist_start
+ * In/out:    p:  the pattern
+ */
+void Persist_wait(Persistent_op* p /* in/out */) {
+   MPI_Waitall(p->nreqs, p->reqs, MPI_STATUSES_IGNORE);
+}  /* Persist_wait */
+
+/*---------------------------------------------------------------------
+ * Function:  Persist_free
+ * Purpose:   Release the requests of an inactive pattern
+ * In/out:    p:  the pattern
+ */
+void Persist_free(Persistent_op* p /* in/out */) {
+   int i;
+
+   if (p->kind == PERSIST_REQUESTS)
+      for (i = 0; i < p->nreqs; i++)
+         MPI_Request_free(&p->reqs[i]);
+   free(p->reqs);
+   p->reqs = NULL;
+}  /* Persist_free */
+
+/*---------------------------------------------------------------------
+ * Function:  Persist_record
+ * Purpose:   Store the arguments of a pattern; without persistent
+ *            requests it is started as the nonblocking collective kind
+ * In args:   kind, sendbuf, recvbuf, count, type, op, root, comm
+ * Out args:  p:  the pattern
+ */
+static void Persist_record(
+      int             kind     /* in  */,
+      const void*     sendbuf  /* in  */,
+      void*           recvbuf  /* in  */,
+      int             count    /* in  */,
+      MPI_Datatype    type     /* in  */,
+      MPI_Op          op       /* in  */,
+      int             root     /* in  */,
+      MPI_Comm        comm     /* in  */,
+      Persistent_op*  p        /* out */) {
+   p->kind = kind;
+   p->nreqs = 1;
+   p->reqs = malloc(sizeof(MPI_Request));
+   p->reqs[0] = MPI_REQUEST_NULL;
+   p->sendbuf = sendbuf;
+   p->recvbuf = recvbuf;
+   p->count = count;
+   p->type = type;
+   p->op = op;
+   p->root = root;
+   p->comm = comm;
+}  /* Persist_record */
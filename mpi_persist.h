@@ -0,0 +1,61 @@
+/* File:     mpi_persist.h
+ *
+ * Purpose:  Communication patterns that are set up once and started
+ *           every iteration: MPI-4 persistent collectives
+ *           (MPI_Reduce_init, MPI_Allreduce_init, MPI_Gather_init) and
+ *           a gather built from persistent point-to-point requests
+ *           (MPI_Send_init/MPI_Recv_init).
+ *
+ * Compile:  Link mpi_persist.c into the program.
+ *
+ * Notes:
+ * 1.  Usage:  Persist_*_init once, then Persist_start and Persist_wait
+ *     every iteration, and Persist_free at the end.  The buffers passed
+ *     to the init function are the ones used by every iteration, so
+ *     they must stay allocated until Persist_free.
+ * 2.  If the MPI library predates MPI 4 (PERSIST_COLLECTIVES is 0),
+ *     the collective inits only record their arguments and
+ *     Persist_start issues the equivalent nonblocking collective.
+ *     The point-to-point gather is persistent with any MPI.
+ * 3.  All processes of comm must call the init, start, wait and free
+ *     functions of a pattern in the same order.
+ */
+#ifndef MPI_PERSIST_H
+#define MPI_PERSIST_H
+
+#include <mpi.h>
+
+#if MPI_VERSION >= 4
+#define PERSIST_COLLECTIVES 1
+#else
+#define PERSIST_COLLECTIVES 0
+#endif
+
+typedef struct {
+   int           kind;
+   int           nreqs;
+   MPI_Request*  reqs;
+   /* Arguments of the nonblocking collective issued by the fallback */
+   const void*   sendbuf;
+   void*         recvbuf;
+   int           count;
+   MPI_Datatype  type;
+   MPI_Op        op;
+   int           root;
+   MPI_Comm      comm;
+} Persistent_op;
+
+void Persist_reduce_init(const void* sendbuf, void* recvbuf, int count,
+      MPI_Datatype type, MPI_Op op, int root, MPI_Comm comm,
+      Persistent_op* p);
+void Persist_allreduce_init(const void* sendbuf, void* recvbuf, int count,
+      MPI_Datatype type, MPI_Op op, MPI_Comm comm, Persistent_op* p);
+void Persist_gather_init(const void* sendbuf, void* recvbuf, int count,
+      MPI_Datatype type, int root, MPI_Comm comm, Persistent_op* p);
+void Persist_gather_p2p_init(const void* sendbuf, void* recvbuf, int count,
+      MPI_Datatype type, int root, MPI_Comm comm, Persistent_op* p);
+void Persist_start(Persistent_op* p);
+void Persist_wait(Persistent_op* p);
+void Persist_free(Persistent_op* p);
+
+#endif /* MPI_PERSIST_H */
@@ -0,0 +1,152 @@
+/* File:     mpi_pipeline.c
+ *
+ * Purpose:  Pipelined scatter/compute/gather of block-distributed
+ *           vectors (see mpi_pipeline.h)
+ */
+#include <stdlib.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+#include "mpi_pipeline.h"
+
+static int Chunk_layout(int k, int local_n, int chunk_n, int comm_sz,
+      int counts[], int displs[]);
+
+/*-------------------------------------------------------------------
+ * Function:  Pipelined_vector_sum
+ * Purpose:   Scatter x and y from the root, compute z = x+y on the
+ *            local blocks and gather z to the root, chunk by chunk
+ * In args:   x, y:      the vectors (significant only on root)
+ *            local_n:   size of the local blocks
+ *            chunk_n:   elements of each block moved per step
+ *            root:      rank holding the full vectors
+ *            comm:      communicator containing the calling processes
+ * Out args:  z:         the sum (significant only on root)
+ *            local_x, local_y, local_z:  the local blocks
+ *
+ * Errors:    If a process can't allocate its chunk layouts, all the
+ *            processes terminate
+ *
+ * Note:
+ *    At most two chunks of x and y are being scattered and two chunks
+ *    of z gathered at any time; chunks land directly in the local
+ *    blocks, so no extra buffers are needed.
+ */
+void Pipelined_vector_sum(
+      double    x[]        /* in  */,
+      double    y[]        /* in  */,
+      double    z[]        /* out */,
+      double    local_x[]  /* out */,
+      double    local_y[]  /* out */,
+      double    local_z[]  /* out */,
+      int       local_n    /* in  */,
+      int       chunk_n    /* in  */,
+      int       root       /* in  */,
+      MPI_Comm  comm       /* in  */) {
+   int comm_sz, k, s, len, next_len, nchunks;
+   int *buf, *scatter_counts[2], *scatter_displs[2];
+   int *gather_counts[2], *gather_displs[2];
+   MPI_Request scatter_req[2][2], gather_req[2] = {MPI_REQUEST_NULL,
+      MPI_REQUEST_NULL};
+
+   MPI_Comm_size(comm, &comm_sz);
+   /* Arrays of pending operations must stay intact, so one set per slot */
+   buf = malloc(8*comm_sz*sizeof(int));
+   Check_for_error(buf != NULL, "Pipelined_vector_sum",
+         "Can't allocate chunk layouts", comm);
+   for (s = 0; s < 2; s++) {
+      scatter_counts[s] = buf + (4*s)*comm_sz;
+      scatter_displs[s] = buf + (4*s + 1)*comm_sz;
+      gather_counts[s] = buf + (4*s + 2)*comm_sz;
+      gather_displs[s] = buf + (4*s + 3)*comm_sz;
+   }
+   nchunks = (local_n + chunk_n - 1)/chunk_n;
+
+   if (nchunks > 0) {
+      len = Chunk_layout(0, local_n, chunk_n, comm_sz, scatter_counts[0],
+            scatter_displs[0]);
+      MPI_Iscatterv(x, scatter_counts[0], scatter_displs[0], MPI_DOUBLE,
+            local_x, len, MPI_DOUBLE, root, comm, &scatter_req[0][0]);
+      MPI_Iscatterv(y, scatter_counts[0], scatter_displs[0], MPI_DOUBLE,
+            local_y, len, MPI_DOUBLE, root, comm, &scatter_req[0][1]);
+   }
+
+   for (k = 0; k < nchunks; k++) {
+      s = k % 2;
+      len = (local_n - k*chunk_n < chunk_n) ? local_n - k*chunk_n : chunk_n;
+      MPI_Waitall(2, scatter_req[s], MPI_STATUSES_IGNORE);
+
+      /* Chunk k+1 travels while chunk k is added */
+      if (k + 1 < nchunks) {
+         next_len = Chunk_layout(k + 1, local_n, chunk_n, comm_sz,
+               scatter_counts[1-s], scatter_displs[1-s]);
+         MPI_Iscatterv(x, scatter_counts[1-s], scatter_displs[1-s], MPI_DOUBLE,
+               local_x + (k+1)*chunk_n, next_len, MPI_DOUBLE, root, comm,
+               &scatter_req[1-s][0]);
+         MPI_Iscatterv(y, scatter_counts[1-s], scatter_displs[1-s], MPI_DOUBLE,
+               local_y + (k+1)*chunk_n, next_len, MPI_DOUBLE, root, comm,
+               &scatter_req[1-s][1]);
+      }
+
+      Vector_sum(local_x + k*chunk_n, local_y + k*chunk_n,
+            local_z + k*chunk_n, len);
+
+      /* Slot s was last used by the gather of chunk k-2 */
+      MPI_Wait(&gather_req[s], MPI_STATUS_IGNORE);
+      Chunk_layout(k, local_n, chunk_n, comm_sz, gather_counts[s],
+            gather_displs[s]);
+      MPI_Igatherv(local_z + k*chunk_n, len, MPI_DOUBLE, z, gather_counts[s],
+            gather_displs[s], MPI_DOUBLE, root, comm, &gather_req[s]);
+   }
+   MPI_Waitall(2, gather_req, MPI_STATUSES_IGNORE);
+
+   free(buf);
+}  /* Pipelined_vector_sum */
+
+/*-------------------------------------------------------------------
+ * Function:  Blocking_vector_sum
+ * Purpose:   The same computation as Pipelined_vector_sum with one
+ *            MPI_Scatter per input and one MPI_Gather, as in
+ *            Read_vector and Print_vector
+ */
+void Blocking_vector_sum(
+      double    x[]        /* in  */,
+      double    y[]        /* in  */,
+      double    z[]        /* out */,
+      double    local_x[]  /* out */,
+      double    local_y[]  /* out */,
+      double    local_z[]  /* out */,
+      int       local_n    /* in  */,
+      int       root       /* in  */,
+      MPI_Comm  comm       /* in  */) {
+   MPI_Scatter(x, local_n, MPI_DOUBLE, local_x, local_n, MPI_DOUBLE, root,
+         comm);
+   MPI_Scatter(y, local_n, MPI_DOUBLE, local_y, local_n, MPI_DOUBLE, root,
+         comm);
+   Vector_sum(local_x, local_y, local_z, local_n);
+   MPI_Gather(local_z, local_n, MPI_DOUBLE, z, local_n, MPI_DOUBLE, root,
+         comm);
+}  /* Blocking_vector_sum */
+
+/*-------------------------------------------------------------------
+ * Function:  Chunk_layout
+ * Purpose:   Counts and displacements (in the full vector) of chunk k
+ *            of every block
+ * Out args:  counts, displs:  arrays of comm_sz entries
+ * Ret val:   Number of elements in chunk k of each block
+ */
+static int Chunk_layout(
+      int  k          /* in  */,
+      int  local_n    /* in  */,
+      int  chunk_n    /* in  */,
+      int  comm_sz    /* in  */,
+      int  counts[]   /* out */,
+      int  displs[]   /* out */) {
+   int q, len;
+
+   len = (local_n - k*chunk_n < chunk_n) ? local_n - k*chunk_n : chunk_n;
+   for (q = 0; q < comm_sz; q++) {
+      counts[q] = len;
+      displs[q] = q*local_n + k*chunk_n;
+   }
+   return len;
+}  /* Chunk_layout */
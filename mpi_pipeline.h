@@ -0,0 +1,29 @@
+/* File:     mpi_pipeline.h
+ *
+ * Purpose:  Pipelined distribution and collection of block-distributed
+ *           vectors.  Instead of one MPI_Scatter before and one
+ *           MPI_Gather after the computation, every block is moved in
+ *           chunks with nonblocking collectives, so a process computes
+ *           on chunk k while chunk k+1 is in flight and chunk k-1 is
+ *           on its way back to the root.
+ *
+ * Compile:  Link mpi_pipeline.c, mpi_vector_utils.c and vector_ops.c
+ *           into the program (and -lm).
+ *
+ * Note:
+ *    As in Read_vector and Print_vector, the order of the vectors is
+ *    local_n*comm_sz and the full vectors exist only on the root.
+ */
+#ifndef MPI_PIPELINE_H
+#define MPI_PIPELINE_H
+
+#include <mpi.h>
+
+void Pipelined_vector_sum(double x[], double y[], double z[],
+      double local_x[], double local_y[], double local_z[], int local_n,
+      int chunk_n, int root, MPI_Comm comm);
+void Blocking_vector_sum(double x[], double y[], double z[],
+      double local_x[], double local_y[], double local_z[], int local_n,
+      int root, MPI_Comm comm);
+
+#endif /* MPI_PIPELINE_H */
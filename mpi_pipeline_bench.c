@@ -0,0 +1,150 @@
+/* File:     mpi_pipeline_bench.c
+ *
+ * Purpose:  Compare the blocking scatter/add/gather of the vector
+ *           addition with the pipelined version of mpi_pipeline.h for
+ *           several chunk sizes.
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_pipeline_bench \
+ *              mpi_pipeline_bench.c mpi_pipeline.c mpi_vector_utils.c vector_ops.c -lm
+ * Run:      mpiexec -n <comm_sz> ./mpi_pipeline_bench <order of the vectors> <iterations> <chunk size>...
+ *
+ * Input:    The order of the vectors, n, the number of repetitions and
+ *           one or more chunk sizes (elements of each local block)
+ * Output:   Time per call of the blocking version and, for each chunk
+ *           size, of the pipelined one with its speedup
+ *
+ * Notes:
+ * 1.  n should be evenly divisible by comm_sz
+ * 2.  Every result is checked against x+y on the root.
+ * 3.  The overlap only materializes if the MPI library progresses
+ *     nonblocking collectives while the processes compute.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+#include "mpi_pipeline.h"
+
+void Check_sum(double x[], double y[], double z[], int n, int my_rank,
+      MPI_Comm comm);
+
+int main(int argc, char* argv[]) {
+    int n, local_n, iters, chunk_n, c, it;
+    int comm_sz, my_rank;
+    double *x = NULL, *y = NULL, *z = NULL;
+    double *local_x, *local_y, *local_z;
+    MPI_Comm comm;
+    double start, local_time, time, blocking_time;
+
+    // Initialize MPI
+    MPI_Init(&argc, &argv);
+    comm = MPI_COMM_WORLD;
+    MPI_Comm_size(comm, &comm_sz);
+    MPI_Comm_rank(comm, &my_rank);
+
+    if (argc < 4) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Usage: %s <order of the vectors> <iterations> <chunk size>...\n", argv[0]);
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    n = atoi(argv[1]);
+    iters = atoi(argv[2]);
+    if (n <= 0 || n % comm_sz != 0 || iters <= 0) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Order of the vectors should be a positive integer and evenly divisible by the number of processes, and iterations positive\n");
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    local_n = n / comm_sz;
+
+    Allocate_vectors(&local_x, &local_y, &local_z, local_n, comm);
+    if (my_rank == 0) {
+        x = Vec_alloc(n, sizeof(double));
+        y = Vec_alloc(n, sizeof(double));
+        z = Vec_alloc(n, sizeof(double));
+    }
+    Check_for_error(my_rank != 0 || (x != NULL && y != NULL && z != NULL),
+          "main", "Can't allocate vectors", comm);
+    if (my_rank == 0) {
+        Generate_vector(x, n, 0, 1);
+        Generate_vector(y, n, 0, 2);
+    }
+
+    MPI_Barrier(comm);
+    start = MPI_Wtime();
+    for (it = 0; it < iters; it++)
+        Blocking_vector_sum(x, y, z, local_x, local_y, local_z, local_n, 0,
+              comm);
+    local_time = MPI_Wtime() - start;
+    MPI_Reduce(&local_time, &blocking_time, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+    Check_sum(x, y, z, n, my_rank, comm);
+
+    if (my_rank == 0) {
+        printf("%-10s %14s %10s\n", "chunk", "s/call", "speedup");
+        printf("%-10s %14.6e %10.2f\n", "blocking", blocking_time/iters, 1.0);
+    }
+
+    for (c = 3; c < argc; c++) {
+        chunk_n = atoi(argv[c]);
+        Check_for_error(chunk_n > 0, "main", "Chunk sizes should be positive",
+              comm);
+        if (my_rank == 0) {
+            for (it = 0; it < n; it++)
+                z[it] = 0.0;
+        }
+
+        MPI_Barrier(comm);
+        start = MPI_Wtime();
+        for (it = 0; it < iters; it++)
+            Pipelined_vector_sum(x, y, z, local_x, local_y, local_z, local_n,
+                  chunk_n, 0, comm);
+        local_time = MPI_Wtime() - start;
+        MPI_Reduce(&local_time, &time, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+        Check_sum(x, y, z, n, my_rank, comm);
+
+        if (my_rank == 0) {
+            printf("%-10d %14.6e %10.2f\n", chunk_n, time/iters,
+                  blocking_time/time);
+        }
+    }
+
+    free(local_x);
+    free(local_y);
+    free(local_z);
+    free(x);
+    free(y);
+    free(z);
+
+    MPI_Finalize();
+    return 0;
+}  /* main */
+
+/*---------------------------------------------------------------------
+ * Function:  Check_sum
+ * Purpose:   Verify z = x+y on the root
+ * In args:   x, y, z:  full vectors (significant only on process 0)
+ *            n:        order of the vectors
+ *            my_rank:  calling process' rank in comm
+ *            comm:     communicator containing the calling processes
+ *
+ * Errors:    If z is wrong, the program terminates
+ */
+void Check_sum(
+      double    x[]      /* in */,
+      double    y[]      /* in */,
+      double    z[]      /* in */,
+      int       n        /* in */,
+      int       my_rank  /* in */,
+      MPI_Comm  comm     /* in */) {
+   int i, ok = 1;
+
+   if (my_rank == 0)
+      for (i = 0; i < n; i++)
+         if (z[i] != x[i] + y[i]) ok = 0;
+   Check_for_error(ok, "Check_sum", "Gathered sum is not x+y", comm);
+}  /* Check_sum */
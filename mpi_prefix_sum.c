@@ -0,0 +1,132 @@
+/* File:     mpi_prefix_sum.c
+ *
+ * Purpose:  Check and time the distributed prefix sum of mpi_scan.h
+ *           with both methods (scan then offset, sum then scan),
+ *           inclusive and exclusive.
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_prefix_sum \
+ *              mpi_prefix_sum.c mpi_scan.c mpi_vector_utils.c vector_ops.c -lm
+ * Run:      mpiexec -n <comm_sz> ./mpi_prefix_sum <order of the vectors> <iterations>
+ *
+ * Input:    The order of the vector, n, and the number of repetitions
+ * Output:   The inclusive prefix sum, and for each method and kind of
+ *           scan the time per call and the bandwidth in GB/s (one read
+ *           and one write per element, summed over all processes)
+ *
+ * Notes:
+ * 1.  The order of the vectors, n, should be evenly divisible by comm_sz
+ * 2.  x[i] = i % 7, so every prefix sum is an exact integer with a
+ *     closed form and the results are checked exactly.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+#include "mpi_scan.h"
+
+int Check_prefix_sum(double local_z[], int local_n, int my_rank,
+      int inclusive);
+
+int main(int argc, char* argv[]) {
+    int n, local_n, iters, i, it, method, inclusive;
+    int comm_sz, my_rank;
+    double *local_x, *local_z;
+    MPI_Comm comm;
+    double start, local_time, time;
+    const char* method_names[] = {"auto", "scan+offset", "sum+scan"};
+
+    // Initialize MPI
+    MPI_Init(&argc, &argv);
+    comm = MPI_COMM_WORLD;
+    MPI_Comm_size(comm, &comm_sz);
+    MPI_Comm_rank(comm, &my_rank);
+
+    if (argc != 3) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Usage: %s <order of the vectors> <iterations>\n", argv[0]);
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    n = atoi(argv[1]);
+    iters = atoi(argv[2]);
+    if (n <= 0 || n % comm_sz != 0 || iters <= 0) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Order of the vectors should be a positive integer and evenly divisible by the number of processes, and iterations positive\n");
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    local_n = n / comm_sz;
+
+    Allocate_vectors(&local_x, &local_z, NULL, local_n, comm);
+    for (i = 0; i < local_n; i++)
+        local_x[i] = (my_rank*local_n + i) % 7;
+
+    Parallel_prefix_sum(local_x, local_z, local_n, 1, SCAN_AUTO, comm);
+    Print_vector(local_x, local_n, n, "=> The vector is", my_rank, comm);
+    Print_vector(local_z, local_n, n, "=> The inclusive prefix sum is", my_rank, comm);
+
+    if (my_rank == 0) {
+        printf("%-12s %-10s %14s %10s\n", "method", "scan", "s/call", "GB/s");
+    }
+    for (method = SCAN_THEN_OFFSET; method <= SUM_THEN_SCAN; method++)
+        for (inclusive = 1; inclusive >= 0; inclusive--) {
+            MPI_Barrier(comm);
+            start = MPI_Wtime();
+            for (it = 0; it < iters; it++)
+                Parallel_prefix_sum(local_x, local_z, local_n, inclusive,
+                      method, comm);
+            local_time = MPI_Wtime() - start;
+            MPI_Reduce(&local_time, &time, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+
+            Check_for_error(Check_prefix_sum(local_z, local_n, my_rank,
+                  inclusive), "main", "wrong prefix sum", comm);
+            if (my_rank == 0) {
+                printf("%-12s %-10s %14.6e %10.2f\n", method_names[method],
+                      inclusive ? "inclusive" : "exclusive", time/iters,
+                      2.0*sizeof(double)*n*iters/time/1.0e9);
+            }
+        }
+    if (my_rank == 0) {
+        printf("SCAN_AUTO picks %s for local_n = %d\n",
+              (2.0*local_n*sizeof(double) <= SCAN_CACHE_BYTES) ?
+              method_names[SCAN_THEN_OFFSET] : method_names[SUM_THEN_SCAN],
+              local_n);
+    }
+
+    free(local_x);
+    free(local_z);
+
+    MPI_Finalize();
+    return 0;
+}  /* main */
+
+/*---------------------------------------------------------------------
+ * Function:  Check_prefix_sum
+ * Purpose:   Compare the prefix sums of x[i] = i % 7 with their
+ *            closed form
+ * In args:   local_z:    local block of the prefix sums
+ *            local_n:    size of the local block
+ *            my_rank:    calling process' rank
+ *            inclusive:  1 if local_z holds an inclusive scan
+ * Ret val:   1 if every element is exact, 0 otherwise
+ */
+int Check_prefix_sum(
+      double  local_z[]  /* in */,
+      int     local_n    /* in */,
+      int     my_rank    /* in */,
+      int     inclusive  /* in */) {
+   long long count, r;
+   int i;
+
+   for (i = 0; i < local_n; i++) {
+      /* Number of terms in the prefix */
+      count = (long long)my_rank*local_n + i + inclusive;
+      r = count % 7;
+      if (local_z[i] != (double)(21*(count/7) + r*(r - 1)/2)) return 0;
+   }
+   return 1;
+}  /* Check_prefix_sum */
@@ -0,0 +1,127 @@
+/* File:     mpi_rma.c
+ *
+ * Purpose:  One-sided access to block-distributed vectors (see
+ *           mpi_rma.h)
+ */
+#include <mpi.h>
+#include "mpi_rma.h"
+
+/*---------------------------------------------------------------------
+ * Function:  Rma_create
+ * Purpose:   Allocate the local block of a distributed vector in a
+ *            window and open the passive-target epoch
+ * In args:   local_n:  size of the local block
+ *            comm:     communicator containing the vector
+ * Out args:  v:        the vector
+ *
+ * Note:
+ *    Collective over comm.  The memory comes from MPI_Win_allocate,
+ *    which lets the library place it where remote access is fastest.
+ */
+void Rma_create(
+      Rma_vector*  v        /* out */,
+      int          local_n  /* in  */,
+      MPI_Comm     comm     /* in  */) {
+   int comm_sz;
+
+   MPI_Comm_size(comm, &comm_sz);
+   v->local_n = local_n;
+   v->n = (long long) local_n*comm_sz;
+   v->comm = comm;
+   MPI_Win_allocate((MPI_Aint) local_n*sizeof(double), sizeof(double),
+         MPI_INFO_NULL, comm, &v->local, &v->win);
+   MPI_Win_lock_all(MPI_MODE_NOCHECK, v->win);
+}  /* Rma_create */
+
+/*---------------------------------------------------------------------
+ * Function:  Rma_free
+ * Purpose:   Close the epoch and release the window and its memory
+ * In/out:    v:  the vector
+ *
+ * Note:
+ *    Collective over v->comm.
+ */
+void Rma_free(Rma_vector* v /* in/out */) {
+   MPI_Win_unlock_all(v->win);
+   MPI_Win_free(&v->win);
+   v->local = NULL;
+}  /* Rma_free */
+
+/*---------------------------------------------------------------------
+ * Function:  Rma_get
+ * Purpose:   Copy the global elements [first, first+count) into buf
+ * In args:   v:      the vector
+ *            first:  global index of the first element
+ *            count:  number of elements
+ * Out args:  buf:    the elements
+ *
+ * Note:
+ *    The range may span any number of blocks; one MPI_Get is issued
+ *    per owner and all are completed together.
+ */
+void Rma_get(
+      Rma_vector*  v      /* in  */,
+      long long    first  /* in  */,
+      int          count  /* in  */,
+      double       buf[]  /* out */) {
+   long long i = first, end = first + count;
+   int q, offset, len;
+
+   while (i < end) {
+      q = i / v->local_n;
+      offset = i - (long long) q*v->local_n;
+      len = (end - i < v->local_n - offset) ? end - i : v->local_n - offset;
+      MPI_Get(buf + (i - first), len, MPI_DOUBLE, q, offset, len,
+            MPI_DOUBLE, v->win);
+      i += len;
+   }
+   MPI_Win_flush_local_all(v->win);
+}  /* Rma_get */
+
+/*---------------------------------------------------------------------
+ * Function:  Rma_put
+ * Purpose:   Store buf into the global elements [first, first+count)
+ * In args:   first:  global index of the first element
+ *            count:  number of elements
+ *            buf:    the elements
+ * In/out:    v:      the vector
+ *
+ * Note:
+ *    MPI_Win_flush_all completes the puts at their targets, so the data
+ *    are visible to the owners after their next Rma_sync.
+ */
+void Rma_put(
+      Rma_vector*   v      /* in/out */,
+      long long     first  /* in     */,
+      int           count  /* in     */,
+      const double  buf[]  /* in     */) {
+   long long i = first, end = first + count;
+   int q, offset, len;
+
+   while (i < end) {
+      q = i / v->local_n;
+      offset = i - (long long) q*v->local_n;
+      len = (end - i < v->local_n - offset) ? end - i : v->local_n - offset;
+      MPI_Put(buf + (i - first), len, MPI_DOUBLE, q, offset, len,
+            MPI_DOUBLE, v->win);
+      i += len;
+   }
+   MPI_Win_flush_all(v->win);
+}  /* Rma_put */
+
+/*---------------------------------------------------------------------
+ * Function:  Rma_sync
+ * Purpose:   Make every completed access to v, local or remote,
+ *            visible to all processes
+ * In/out:    v:  the vector
+ *
+ * Note:
+ *    Collective over v->comm.  MPI_Win_sync on both sides of the
+ *    barrier reconciles the public and private copies of the window
+ *    when the memory model is separate.
+ */
+void Rma_sync(Rma_vector* v /* in/out */) {
+   MPI_Win_sync(v->win);
+   MPI_Barrier(v->comm);
+   MPI_Win_sync(v->win);
+}  /* Rma_sync */
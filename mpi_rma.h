@@ -0,0 +1,41 @@
+/* File:     mpi_rma.h
+ *
+ * Purpose:  Block-distributed vectors exposed in MPI RMA windows, so
+ *           any process can read (MPI_Get) or write (MPI_Put) any
+ *           subrange of the vector without the owners or a root taking
+ *           part in the transfer.
+ *
+ * Compile:  Link mpi_rma.c into the program.
+ *
+ * Notes:
+ * 1.  As in mpi_vector_utils.h, every process owns local_n elements and
+ *     process q owns the global indices [q*local_n, (q+1)*local_n).
+ *     The owner works on its block through the local member.
+ * 2.  Rma_create opens a passive-target epoch on every process
+ *     (MPI_Win_lock_all) that lasts until Rma_free, so Rma_get and
+ *     Rma_put need no synchronization with the targets.  They return
+ *     when the transfer is complete at the target.
+ * 3.  Rma_sync is the collective that orders remote accesses with the
+ *     owners' local loads and stores: writes made before it, local or
+ *     remote, are visible to every process after it.
+ */
+#ifndef MPI_RMA_H
+#define MPI_RMA_H
+
+#include <mpi.h>
+
+typedef struct {
+   double*    local;     /* this process' block     */
+   int        local_n;
+   long long  n;         /* local_n*comm_sz         */
+   MPI_Win    win;
+   MPI_Comm   comm;
+} Rma_vector;
+
+void Rma_create(Rma_vector* v, int local_n, MPI_Comm comm);
+void Rma_free(Rma_vector* v);
+void Rma_get(Rma_vector* v, long long first, int count, double buf[]);
+void Rma_put(Rma_vector* v, long long first, int count, const double buf[]);
+void Rma_sync(Rma_vector* v);
+
+#endif /* MPI_RMA_H */
@@ -0,0 +1,47 @@
+/* File:     mpi_scan.c
+ *
+ * Purpose:  Prefix sums of block-distributed vectors (see mpi_scan.h)
+ */
+#include <mpi.h>
+#include "vector_ops.h"
+#include "mpi_scan.h"
+
+/*---------------------------------------------------------------------
+ * Function:  Parallel_prefix_sum
+ * Purpose:   Global inclusive or exclusive prefix sum of a distributed
+ *            vector
+ * In args:   local_x:    local block of the vector
+ *            local_n:    size of the local block
+ *            inclusive:  1 for an inclusive scan, 0 for exclusive
+ *            method:     SCAN_AUTO, SCAN_THEN_OFFSET or SUM_THEN_SCAN
+ *            comm:       communicator containing the vector, ranks
+ *                        in the order of the blocks
+ * Out arg:   local_z:    local block of the prefix sums (may be local_x)
+ */
+void Parallel_prefix_sum(
+      const double  local_x[]  /* in  */,
+      double        local_z[]  /* out */,
+      int           local_n    /* in  */,
+      int           inclusive  /* in  */,
+      int           method     /* in  */,
+      MPI_Comm      comm       /* in  */) {
+   double total, offset = 0.0;
+   int my_rank;
+
+   MPI_Comm_rank(comm, &my_rank);
+   if (method == SCAN_AUTO)
+      method = (2.0*local_n*sizeof(double) <= SCAN_CACHE_BYTES) ?
+            SCAN_THEN_OFFSET : SUM_THEN_SCAN;
+
+   if (method == SCAN_THEN_OFFSET) {
+      total = Prefix_sum(local_x, local_z, local_n, 0.0, inclusive);
+      MPI_Exscan(&total, &offset, 1, MPI_DOUBLE, MPI_SUM, comm);
+      /* offset is undefined on process 0 */
+      if (my_rank != 0) Add_scalar(local_z, local_n, offset);
+   } else {
+      total = Vector_total(local_x, local_n);
+      MPI_Exscan(&total, &offset, 1, MPI_DOUBLE, MPI_SUM, comm);
+      if (my_rank == 0) offset = 0.0;
+      Prefix_sum(local_x, local_z, local_n, offset, inclusive);
+   }
+}  /* Parallel_prefix_sum */
@@ -0,0 +1,35 @@
+/* File:     mpi_scan.h
+ *
+ * Purpose:  Prefix sums (scans) of block-distributed double vectors.
+ *
+ * Compile:  Link mpi_scan.c and vector_ops.c into the program.
+ *
+ * Notes:
+ * 1.  Every method does one local pass to find the block total, one
+ *     MPI_Exscan of the totals and one local pass that applies the
+ *     offset of the preceding blocks.  They differ in the order:
+ *       SCAN_THEN_OFFSET:  scan the block, Exscan, add the offset.
+ *                          Both passes write, so it pays off only
+ *                          when the second pass hits cache.
+ *       SUM_THEN_SCAN:     sum the block (read only), Exscan, scan
+ *                          with the offset as carry.  One read-write
+ *                          pass, best for blocks larger than cache.
+ *       SCAN_AUTO:         pick by the size of the local blocks.
+ * 2.  Blocks up to SCAN_CACHE_BYTES (x and z together) are treated as
+ *     cache resident.
+ */
+#ifndef MPI_SCAN_H
+#define MPI_SCAN_H
+
+#include <mpi.h>
+
+#define SCAN_AUTO          0
+#define SCAN_THEN_OFFSET   1
+#define SUM_THEN_SCAN      2
+
+#define SCAN_CACHE_BYTES   (1 << 20)
+
+void Parallel_prefix_sum(const double local_x[], double local_z[],
+      int local_n, int inclusive, int method, MPI_Comm comm);
+
+#endif /* MPI_SCAN_H */
@@ -0,0 +1,345 @@
+/* File:     mpi_select.c
+ *
+ * Purpose:  Distributed exact selection, quantiles and top-k (see
+ *           mpi_select.h)
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <mpi.h>
+#include "mpi_select.h"
+
+#define SELECT_SAMPLE  63   /* candidates per process whose median is
+                               the local pivot estimate               */
+
+static double Select_in_place(double w[], int n, long long k,
+      double pairs[], MPI_Comm comm);
+static double Weighted_median(double pairs[], int comm_sz);
+static void Nth_element(double a[], int n, int k);
+static void Partition3(double a[], int n, double pivot, int* lt_p,
+      int* eq_p);
+static int Compare_pairs(const void* a, const void* b);
+static int Compare_descending(const void* a, const void* b);
+
+/*---------------------------------------------------------------------
+ * Function:  Parallel_select
+ * Purpose:   Find the element of rank k of a distributed vector
+ * In args:   local_a:  local block
+ *            local_n:  its order (may differ between processes)
+ *            k:        0-based rank in ascending order, 0 <= k < n
+ *            comm:     communicator containing the vector
+ * Ret val:   the element, on every process; NaN on every process if k
+ *            is out of range (or the vector is empty) or an allocation
+ *            fails somewhere
+ */
+double Parallel_select(
+      const double  local_a[]  /* in */,
+      int           local_n    /* in */,
+      long long     k          /* in */,
+      MPI_Comm      comm       /* in */) {
+   long long local_counts[2], counts[2];
+   double *w, x;
+   int comm_sz;
+
+   MPI_Comm_size(comm, &comm_sz);
+   w = malloc((local_n + 2*comm_sz)*sizeof(double));
+   local_counts[0] = local_n;
+   local_counts[1] = w == NULL;
+   MPI_Allreduce(local_counts, counts, 2, MPI_LONG_LONG, MPI_SUM, comm);
+   if (counts[1] > 0 || k < 0 || k >= counts[0]) {
+      free(w);
+      return NAN;
+   }
+   memcpy(w, local_a, local_n*sizeof(double));
+   x = Select_in_place(w, local_n, k, w + local_n, comm);
+   free(w);
+   return x;
+}  /* Parallel_select */
+
+/*---------------------------------------------------------------------
+ * Function:  Parallel_quantile
+ * Purpose:   Exact quantile of a distributed vector
+ * In args:   local_a:  local block
+ *            local_n:  its order
+ *            q:        the probability, 0 <= q <= 1
+ *            comm:     communicator containing the vector
+ * Ret val:   x_j + (h - j)*(x_{j+1} - x_j), with h = q*(n-1), j = floor(h)
+ *            and x_j the element of rank j, on every process; NaN if
+ *            q is outside [0, 1], the vector is empty or an allocation
+ *            fails
+ *
+ * Note:
+ *    After x_j is selected, x_{j+1} is either x_j again (if more than
+ *    j+1 elements are <= x_j) or the smallest element above it, so it
+ *    costs two reductions, not a second selection.
+ */
+double Parallel_quantile(
+      const double  local_a[]  /* in */,
+      int           local_n    /* in */,
+      double        q          /* in */,
+      MPI_Comm      comm       /* in */) {
+   long long local_count = local_n, n, j;
+   double h, x, next, local_next = INFINITY;
+   int i;
+
+   MPI_Allreduce(&local_count, &n, 1, MPI_LONG_LONG, MPI_SUM, comm);
+   if (n == 0 || !(q >= 0.0 && q <= 1.0)) return NAN;
+   h = q*(n - 1);
+   j = (long long) floor(h);
+   x = Parallel_select(local_a, local_n, j, comm);
+   if (h == j || isnan(x)) return x;
+
+   local_count = 0;
+   for (i = 0; i < local_n; i++) {
+      if (local_a[i] <= x) local_count++;
+      else if (local_a[i] < local_next) local_next = local_a[i];
+   }
+   MPI_Allreduce(&local_count, &n, 1, MPI_LONG_LONG, MPI_SUM, comm);
+   if (n > j + 1) return x;
+   MPI_Allreduce(&local_next, &next, 1, MPI_DOUBLE, MPI_MIN, comm);
+   return x + (h - j)*(next - x);
+}  /* Parallel_quantile */
+
+/*---------------------------------------------------------------------
+ * Function:  Parallel_top_k
+ * Purpose:   Collect the k largest elements of a distributed vector
+ * In args:   local_a:  local block
+ *            local_n:  its order
+ *            k:        how many elements
+ *            root:     rank that receives them
+ *            comm:     communicator containing the vector
+ * Out args:  top:      on root, the elements in descending order (room
+ *                      for k)
+ * Ret val:   the number of elements collected, min(k, n), or -1 on
+ *            every process if an allocation fails somewhere
+ *
+ * Note:
+ *    Ties at the threshold are broken by rank, so exactly min(k, n)
+ *    elements reach the root.
+ */
+int Parallel_top_k(
+      const double  local_a[]  /* in  */,
+      int           local_n    /* in  */,
+      int           k          /* in  */,
+      double        top[]      /* out */,
+      int           root       /* in  */,
+      MPI_Comm      comm       /* in  */) {
+   int comm_sz, my_rank, m, i, g = 0, e = 0, take, count, q;
+   long long local_counts[2], counts[2], before = 0, need;
+   double *w, *cand, *pairs, thr;
+   int *recv_counts = NULL, *displs = NULL;
+
+   MPI_Comm_size(comm, &comm_sz);
+   MPI_Comm_rank(comm, &my_rank);
+   local_counts[0] = local_n;
+   MPI_Allreduce(local_counts, counts, 1, MPI_LONG_LONG, MPI_SUM, comm);
+   if (k > counts[0]) k = counts[0];
+   if (k <= 0) return 0;
+
+   w = malloc((local_n + 2*comm_sz)*sizeof(double));
+   if (my_rank == root) recv_counts = malloc(2*comm_sz*sizeof(int));
+   m = local_n < k ? local_n : k;
+   local_counts[0] = m;
+   local_counts[1] = w == NULL || (my_rank == root && recv_counts == NULL);
+   MPI_Allreduce(local_counts, counts, 2, MPI_LONG_LONG, MPI_SUM, comm);
+   if (counts[1] > 0) {
+      free(recv_counts);
+      free(w);
+      return -1;
+   }
+   pairs = w + local_n;
+
+   // Only the k largest of each block can win
+   memcpy(w, local_a, local_n*sizeof(double));
+   if (m < local_n) Nth_element(w, local_n, local_n - m);
+   cand = w + local_n - m;
+   thr = Select_in_place(cand, m, counts[0] - k, pairs, comm);
+
+   // Everything above the threshold, and as many ties as are missing
+   for (i = 0; i < m; i++) {
+      g += cand[i] > thr;
+      e += cand[i] == thr;
+   }
+   local_counts[0] = g;
+   local_counts[1] = e;
+   MPI_Allreduce(local_counts, counts, 1, MPI_LONG_LONG, MPI_SUM, comm);
+   MPI_Exscan(&local_counts[1], &before, 1, MPI_LONG_LONG, MPI_SUM, comm);
+   if (my_rank == 0) before = 0;
+   need = k - counts[0] - before;
+   take = need <= 0 ? 0 : need < e ? need : e;
+   for (i = count = 0; i < m; i++)
+      if (cand[i] > thr || (cand[i] == thr && take-- > 0))
+         w[count++] = cand[i];
+
+   if (my_rank == root) displs = recv_counts + comm_sz;
+   MPI_Gather(&count, 1, MPI_INT, recv_counts, 1, MPI_INT, root, comm);
+   if (my_rank == root)
+      for (q = 0; q < comm_sz; q++)
+         displs[q] = q == 0 ? 0 : displs[q-1] + recv_counts[q-1];
+   MPI_Gatherv(w, count, MPI_DOUBLE, top, recv_counts, displs, MPI_DOUBLE,
+         root, comm);
+   if (my_rank == root)
+      qsort(top, k, sizeof(double), Compare_descending);
+
+   free(recv_counts);
+   free(w);
+   return k;
+}  /* Parallel_top_k */
+
+/*---------------------------------------------------------------------
+ * Function:  Select_in_place
+ * Purpose:   Find the element of rank k of the distributed candidates
+ * In args:   n:      number of local candidates
+ *            k:      0-based rank in ascending order, 0 <= k < the
+ *                    total number of candidates (else it never ends)
+ *            comm:   communicator containing the candidates
+ * In/out:    w:      the local candidates, reordered
+ * Out args:  pairs:  scratch for 2*comm_sz doubles
+ * Ret val:   the element, on every process
+ */
+static double Select_in_place(
+      double     w[]      /* in/out */,
+      int        n        /* in     */,
+      long long  k        /* in     */,
+      double     pairs[]  /* out    */,
+      MPI_Comm   comm     /* in     */) {
+   int comm_sz, lo = 0, hi = n, lt, eq, s, j;
+   long long local_counts[2], counts[2];
+   double local_pair[2], sample[SELECT_SAMPLE], pivot;
+
+   MPI_Comm_size(comm, &comm_sz);
+   for (;;) {
+      s = hi - lo < SELECT_SAMPLE ? hi - lo : SELECT_SAMPLE;
+      for (j = 0; j < s; j++)
+         sample[j] = w[lo + (int) ((2LL*j + 1)*(hi - lo)/(2*s))];
+      if (s > 0) Nth_element(sample, s, s/2);
+      local_pair[0] = s > 0 ? sample[s/2] : 0.0;
+      local_pair[1] = hi - lo;
+      MPI_Allgather(local_pair, 2, MPI_DOUBLE, pairs, 2, MPI_DOUBLE, comm);
+      pivot = Weighted_median(pairs, comm_sz);
+
+      Partition3(w + lo, hi - lo, pivot, &lt, &eq);
+      local_counts[0] = lt;
+      local_counts[1] = eq;
+      MPI_Allreduce(local_counts, counts, 2, MPI_LONG_LONG, MPI_SUM, comm);
+      if (k < counts[0]) {
+         hi = lo + lt;
+      } else if (k < counts[0] + counts[1]) {
+         break;
+      } else {
+         k -= counts[0] + counts[1];
+         lo += lt + eq;
+      }
+   }
+   return pivot;
+}  /* Select_in_place */
+
+/*---------------------------------------------------------------------
+ * Function:  Weighted_median
+ * Purpose:   Median of the local medians, weighted by candidate counts
+ * In args:   comm_sz:  number of pairs
+ * In/out:    pairs:    (median, count) per process; sorted here
+ * Ret val:   the smallest median with at least half the total count at
+ *            or below it
+ */
+static double Weighted_median(
+      double  pairs[]  /* in/out */,
+      int     comm_sz  /* in     */) {
+   double total = 0.0, cum = 0.0;
+   int q;
+
+   qsort(pairs, comm_sz, 2*sizeof(double), Compare_pairs);
+   for (q = 0; q < comm_sz; q++)
+      total += pairs[2*q+1];
+   for (q = 0; q < comm_sz; q++) {
+      cum += pairs[2*q+1];
+      if (pairs[2*q+1] > 0.0 && 2.0*cum >= total) break;
+   }
+   return pairs[2*(q < comm_sz ? q : comm_sz - 1)];
+}  /* Weighted_median */
+
+/*---------------------------------------------------------------------
+ * Function:  Nth_element
+ * Purpose:   Reorder a so that a[k] is the element of rank k, smaller
+ *            ones before it and larger ones after it
+ * In args:   n:  number of elements
+ *            k:  0 <= k < n
+ * In/out:    a:  the elements
+ *
+ * Note:
+ *    Quickselect with a median-of-three pivot and three-way partitions,
+ *    so runs of equal elements end the search at once.
+ */
+static void Nth_element(
+      double  a[]  /* in/out */,
+      int     n    /* in     */,
+      int     k    /* in     */) {
+   int lo = 0, hi = n, lt, eq;
+   double x, y, z, pivot;
+
+   while (hi - lo > 1) {
+      x = a[lo];
+      y = a[lo + (hi - lo)/2];
+      z = a[hi-1];
+      pivot = x < y ? (y < z ? y : x < z ? z : x) : (x < z ? x : y < z ? z : y);
+      Partition3(a + lo, hi - lo, pivot, &lt, &eq);
+      if (k < lo + lt) hi = lo + lt;
+      else if (k < lo + lt + eq) return;
+      else lo += lt + eq;
+   }
+}  /* Nth_element */
+
+/*---------------------------------------------------------------------
+ * Function:  Partition3
+ * Purpose:   Split a into the elements < pivot, == pivot and > pivot
+ * In args:   n:      number of elements
+ *            pivot:  the value
+ * In/out:    a:      the elements, reordered
+ * Out args:  lt_p:   number < pivot (they come first)
+ *            eq_p:   number == pivot (they come next)
+ */
+static void Partition3(
+      double  a[]    /* in/out */,
+      int     n      /* in     */,
+      double  pivot  /* in     */,
+      int*    lt_p   /* out    */,
+      int*    eq_p   /* out    */) {
+   int lt = 0, i = 0, gt = n;
+   double t;
+
+   while (i < gt) {
+      if (a[i] < pivot) {
+         t = a[lt];
+         a[lt++] = a[i];
+         a[i++] = t;
+      } else if (a[i] > pivot) {
+         t = a[--gt];
+         a[gt] = a[i];
+         a[i] = t;
+      } else {
+         i++;
+      }
+   }
+   *lt_p = lt;
+   *eq_p = gt - lt;
+}  /* Partition3 */
+
+/*---------------------------------------------------------------------
+ * Function:  Compare_pairs
+ * Purpose:   Order (median, count) pairs by median for qsort
+ */
+static int Compare_pairs(const void* a, const void* b) {
+   double x = *(const double*) a, y = *(const double*) b;
+
+   return (x > y) - (x < y);
+}  /* Compare_pairs */
+
+/*---------------------------------------------------------------------
+ * Function:  Compare_descending
+ * Purpose:   Order doubles from largest to smallest for qsort
+ */
+static int Compare_descending(const void* a, const void* b) {
+   double x = *(const double*) a, y = *(const double*) b;
+
+   return (x < y) - (x > y);
+}  /* Compare_descending */
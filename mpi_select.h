@@ -0,0 +1,43 @@
+/* File:     mpi_select.h
+ *
+ * Purpose:  Exact selection on block-distributed vectors: order
+ *           statistics, quantiles and the k largest elements, without
+ *           gathering the vector anywhere.
+ *
+ * Compile:  Link mpi_select.c into the program.
+ *
+ * Notes:
+ * 1.  Parallel_select finds the element of rank k (0-based, ascending)
+ *     by narrowing a window of candidates: every round, the pivot is
+ *     the median of the local medians weighted by the candidates left
+ *     on each process (MPI_Allgather of 2 doubles per process), each
+ *     process partitions its candidates around it, and one
+ *     MPI_Allreduce of two counts tells which side holds rank k.  The
+ *     local medians are estimated from a sample of the candidates, so
+ *     a round costs one pass over them; it usually discards about half,
+ *     giving O(log n) rounds of small messages.
+ * 2.  Parallel_quantile interpolates linearly between the order
+ *     statistics around q*(n-1), as most statistics packages do by
+ *     default.
+ * 3.  Parallel_top_k first keeps the k largest elements of each block
+ *     (local partial selection), selects the threshold among those
+ *     candidates, and then gathers only the k winners on the root.
+ * 4.  The inputs are not modified.  NaNs are not supported.
+ * 5.  A rank k outside [0, n), a quantile outside [0, 1] or a failed
+ *     allocation on any process makes Parallel_select and
+ *     Parallel_quantile return NaN, and Parallel_top_k -1, on every
+ *     process.
+ */
+#ifndef MPI_SELECT_H
+#define MPI_SELECT_H
+
+#include <mpi.h>
+
+double Parallel_select(const double local_a[], int local_n, long long k,
+      MPI_Comm comm);
+double Parallel_quantile(const double local_a[], int local_n, double q,
+      MPI_Comm comm);
+int Parallel_top_k(const double local_a[], int local_n, int k,
+      double top[], int root, MPI_Comm comm);
+
+#endif /* MPI_SELECT_H */
@@ -0,0 +1,138 @@
+/* File:     mpi_select_bench.c
+ *
+ * Purpose:  Compute quantiles and the k largest elements of a
+ *           distributed vector with mpi_select.h, and compare with
+ *           gathering the vector on process 0 and sorting it.
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_select_bench \
+ *              mpi_select_bench.c mpi_select.c mpi_vector_utils.c vector_ops.c -lm
+ * Run:      mpiexec -n <comm_sz> ./mpi_select_bench <order of the vector> <k> <quantile>...
+ *
+ * Input:    The order of the vector, n, the number of largest elements
+ *           wanted, k, and one or more probabilities in [0, 1]
+ * Output:   The quantiles and the smallest of the k largest elements,
+ *           then the time and the doubles received by process 0 for the
+ *           distributed selection and for gather-and-sort
+ *
+ * Notes:
+ * 1.  n should be evenly divisible by comm_sz
+ * 2.  The elements are random with many repeated values (multiples of
+ *     1/1024), so ties at the thresholds are exercised.
+ * 3.  Both methods must give identical results.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+#include "mpi_select.h"
+
+int Compare_doubles(const void* a, const void* b);
+
+int main(int argc, char* argv[]) {
+    int n, local_n, k, nq, j, i, got, ok = 1;
+    int comm_sz, my_rank;
+    double *local_a, *a = NULL, *top, *quant, *ref_quant, h, start;
+    double local_t[2], t[2];
+    MPI_Comm comm;
+
+    // Initialize MPI
+    MPI_Init(&argc, &argv);
+    comm = MPI_COMM_WORLD;
+    MPI_Comm_size(comm, &comm_sz);
+    MPI_Comm_rank(comm, &my_rank);
+
+    if (argc < 4) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Usage: %s <order of the vector> <k> <quantile>...\n", argv[0]);
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    n = atoi(argv[1]);
+    k = atoi(argv[2]);
+    if (n <= 0 || n % comm_sz != 0 || k <= 0 || k > n) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Order of the vector should be a positive integer and evenly divisible by the number of processes, and 0 < k <= n\n");
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+    nq = argc - 3;
+
+    local_n = n/comm_sz;
+    local_a = Vec_alloc(local_n, sizeof(double));
+    top = Vec_alloc(k, sizeof(double));
+    quant = Vec_alloc(2*nq, sizeof(double));
+    if (my_rank == 0) a = Vec_alloc(n, sizeof(double));
+    Check_for_error(local_a != NULL && top != NULL && quant != NULL
+          && (my_rank != 0 || a != NULL), "main", "Can't allocate vectors", comm);
+    ref_quant = quant + nq;
+    Generate_vector(local_a, local_n, my_rank, 1);
+    for (i = 0; i < local_n; i++)
+        local_a[i] = floor(1024.0*local_a[i])/1024.0;
+    for (j = 0; j < nq; j++) {
+        quant[j] = atof(argv[3+j]);
+        Check_for_error(quant[j] >= 0.0 && quant[j] <= 1.0, "main",
+              "Quantiles should be in [0, 1]", comm);
+    }
+
+    // Distributed selection
+    MPI_Barrier(comm);
+    start = MPI_Wtime();
+    for (j = 0; j < nq; j++)
+        quant[j] = Parallel_quantile(local_a, local_n, quant[j], comm);
+    got = Parallel_top_k(local_a, local_n, k, top, 0, comm);
+    local_t[0] = MPI_Wtime() - start;
+
+    // Gather everything and sort
+    MPI_Barrier(comm);
+    start = MPI_Wtime();
+    MPI_Gather(local_a, local_n, MPI_DOUBLE, a, local_n, MPI_DOUBLE, 0, comm);
+    if (my_rank == 0) {
+        qsort(a, n, sizeof(double), Compare_doubles);
+        for (j = 0; j < nq; j++) {
+            h = atof(argv[3+j])*(n - 1);
+            i = (int) floor(h);
+            ref_quant[j] = h == i ? a[i] : a[i] + (h - i)*(a[i+1] - a[i]);
+        }
+    }
+    local_t[1] = MPI_Wtime() - start;
+
+    MPI_Reduce(local_t, t, 2, MPI_DOUBLE, MPI_MAX, 0, comm);
+    if (my_rank == 0) {
+        ok = got == k;
+        for (j = 0; j < nq; j++)
+            if (quant[j] != ref_quant[j]) ok = 0;
+        for (i = 0; i < k; i++)
+            if (top[i] != a[n-1-i]) ok = 0;
+    }
+    Check_for_error(ok, "main", "Selection differs from the sorted vector", comm);
+    if (my_rank == 0) {
+        for (j = 0; j < nq; j++)
+            printf("quantile %g = %.10f\n", atof(argv[3+j]), quant[j]);
+        printf("largest %d: %.10f ... %.10f\n", k, top[0], top[k-1]);
+        printf("%-16s %14s %16s\n", "method", "seconds", "doubles to root");
+        printf("%-16s %14.6e %16d\n", "select", t[0], k);
+        printf("%-16s %14.6e %16d\n", "gather + sort", t[1], n);
+    }
+
+    free(local_a);
+    free(top);
+    free(quant);
+    free(a);
+
+    MPI_Finalize();
+    return 0;
+}  /* main */
+
+/*---------------------------------------------------------------------
+ * Function:  Compare_doubles
+ * Purpose:   Order doubles for qsort
+ */
+int Compare_doubles(const void* a, const void* b) {
+   double x = *(const double*) a, y = *(const double*) b;
+
+   return (x > y) - (x < y);
+}  /* Compare_doubles */
@@ -0,0 +1,45 @@
+/* File:     mpi_service.h
+ *
+ * Purpose:  Protocol between the resident vector service
+ *           (mpi_vector_service.c) and its clients (vector_client.c).
+ *           A client connects to the service's Unix socket and sends
+ *           fixed-size requests; each is answered by one reply before
+ *           the client sends the next.
+ *
+ * Notes:
+ * 1.  The service holds a pool of three block-distributed vectors,
+ *     x, y and z, of order n.  SVC_GEN resizes the pool and fills x and
+ *     y with Generate_vector; the other operations work on the pool.
+ * 2.  Both ends run on the same node, so the structs are sent as raw
+ *     bytes.
+ */
+#ifndef MPI_SERVICE_H
+#define MPI_SERVICE_H
+
+#define SVC_SOCKET       "/tmp/mpi_vector_service.sock"
+#define SVC_MAX_CLIENTS  64
+
+/* Operations; the result of the reply is given after each */
+enum {
+   SVC_PING,      /* 0: no work, measures the request path       */
+   SVC_GEN,       /* n: x, y = random vectors of order n         */
+   SVC_ADD,       /* sum of the elements of z = x+y              */
+   SVC_DOT,       /* x.y                                         */
+   SVC_SCALE,     /* 0: x = scalar*x                             */
+   SVC_SHUTDOWN   /* 0: the service stops after replying         */
+};
+
+typedef struct {
+   int        op;
+   int        seed;     /* SVC_GEN: seed of x, seed+1 is that of y   */
+   long long  n;        /* SVC_GEN: order, divisible by comm_sz      */
+   double     scalar;   /* SVC_SCALE                                 */
+} Svc_request;
+
+typedef struct {
+   int     status;        /* 0, or -1 if the request was rejected    */
+   double  result;
+   double  service_time;  /* seconds from request to reply, rank 0  */
+} Svc_reply;
+
+#endif /* MPI_SERVICE_H */
@@ -0,0 +1,335 @@
+/* File:     mpi_sort.c
+ *
+ * Purpose:  Local radix sort and distributed sample sort (see
+ *           mpi_sort.h)
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <mpi.h>
+#include "mpi_sort.h"
+
+#define SORT_BITS        11    /* bits per digit                      */
+#define SORT_PASSES      6     /* digits in a 64-bit key              */
+#define SORT_RADIX       (1 << SORT_BITS)
+#define SORT_OVERSAMPLE  32    /* samples taken from each block       */
+
+static uint64_t To_bits(double d);
+static double From_bits(uint64_t u);
+static int Compare_doubles(const void* a, const void* b);
+static int Upper_bound(const double a[], int lo, int n, double key);
+static void Merge_runs(double** a_p, long long** v_p, double** ta_p,
+      long long** tv_p, int bounds[], int runs, int m);
+
+/*---------------------------------------------------------------------
+ * Function:  Local_sort
+ * Purpose:   Sort n doubles in ascending order, moving the values with
+ *            their keys
+ * In args:   n:  number of keys
+ * In/out:    a:  the keys
+ *            v:  the values, or NULL
+ * Ret val:   1 on success, 0 if the work space can't be allocated (a and
+ *            v are then unchanged)
+ *
+ * Note:
+ *    The keys are mapped to unsigned integers that compare like the
+ *    doubles (flip all the bits of negatives, the sign bit of
+ *    positives) and sorted by digits of SORT_BITS bits, least
+ *    significant first; 2^11 counters per pass still fit in the L1 cache.
+ */
+int Local_sort(
+      double     a[]  /* in/out */,
+      long long  v[]  /* in/out */,
+      int        n    /* in     */) {
+   int count[SORT_PASSES][SORT_RADIX], pos[SORT_RADIX], i, d, b, sum;
+   uint64_t *key, *k_src, *k_dst, *k_swap, bits;
+   long long *tval = NULL, *v_src, *v_dst, *v_swap;
+
+   if (n < 2) return 1;
+   key = malloc(2*(size_t) n*sizeof(uint64_t));
+   if (v != NULL) tval = malloc((size_t) n*sizeof(long long));
+   if (key == NULL || (v != NULL && tval == NULL)) {
+      free(key);
+      free(tval);
+      return 0;
+   }
+
+   memset(count, 0, sizeof(count));
+   for (i = 0; i < n; i++) {
+      bits = key[i] = To_bits(a[i]);
+      for (d = 0; d < SORT_PASSES; d++)
+         count[d][(bits >> SORT_BITS*d) & (SORT_RADIX-1)]++;
+   }
+
+   k_src = key;
+   k_dst = key + n;
+   v_src = v;
+   v_dst = tval;
+   for (d = 0; d < SORT_PASSES; d++) {
+      // A digit shared by all keys leaves the order as it is
+      if (count[d][(k_src[0] >> SORT_BITS*d) & (SORT_RADIX-1)] == n) continue;
+      for (b = sum = 0; b < SORT_RADIX; b++) {
+         pos[b] = sum;
+         sum += count[d][b];
+      }
+      for (i = 0; i < n; i++) {
+         b = pos[(k_src[i] >> SORT_BITS*d) & (SORT_RADIX-1)]++;
+         k_dst[b] = k_src[i];
+         if (v != NULL) v_dst[b] = v_src[i];
+      }
+      k_swap = k_src;
+      k_src = k_dst;
+      k_dst = k_swap;
+      v_swap = v_src;
+      v_src = v_dst;
+      v_dst = v_swap;
+   }
+
+   for (i = 0; i < n; i++)
+      a[i] = From_bits(k_src[i]);
+   if (v != NULL && v_src != v)
+      memcpy(v, v_src, (size_t) n*sizeof(long long));
+   free(key);
+   free(tval);
+   return 1;
+}  /* Local_sort */
+
+/*---------------------------------------------------------------------
+ * Function:  Sample_sort
+ * Purpose:   Sort a block-distributed vector, keeping the distribution
+ * In args:   local_n:  order of the local blocks (the same everywhere)
+ *            comm:     communicator containing the vector
+ * In/out:    local_a:  local block of the keys
+ *            local_v:  local block of the values, or NULL on every
+ *                      process
+ * Ret val:   1 on success, 0 if some process can't allocate its work
+ *            space (the blocks may then be sorted only locally)
+ *
+ * Note:
+ *    Every block contributes SORT_OVERSAMPLE evenly spaced keys; the
+ *    splitters are every SORT_OVERSAMPLE-th key of the sorted sample,
+ *    so each process receives about local_n keys unless there are many
+ *    duplicates (keys equal to a splitter all go to the lower process).
+ */
+int Sample_sort(
+      double     local_a[]  /* in/out */,
+      long long  local_v[]  /* in/out */,
+      int        local_n    /* in     */,
+      MPI_Comm   comm       /* in     */) {
+   int comm_sz, my_rank, s = SORT_OVERSAMPLE, j, q, m, local_ok, ok;
+   int *counts, *send_counts, *send_displs, *recv_counts, *recv_displs;
+   double *samples, *ra, *ta, *ra_base;
+   long long *rv = NULL, *tv = NULL, *rv_base, first = 0, lo, hi, mm;
+
+   MPI_Comm_size(comm, &comm_sz);
+   MPI_Comm_rank(comm, &my_rank);
+   counts = malloc((4*comm_sz + 1)*sizeof(int));
+   samples = malloc((size_t) s*comm_sz*sizeof(double));
+   local_ok = counts != NULL && samples != NULL
+         && Local_sort(local_a, local_v, local_n);
+   MPI_Allreduce(&local_ok, &ok, 1, MPI_INT, MPI_MIN, comm);
+   if (!ok) {
+      free(counts);
+      free(samples);
+      return 0;
+   }
+   send_counts = counts;
+   send_displs = counts + comm_sz;
+   recv_counts = counts + 2*comm_sz;
+   recv_displs = counts + 3*comm_sz;
+
+   // Splitters from a regular sample of every sorted block
+   for (j = 0; j < s; j++)
+      samples[(size_t) my_rank*s + j] = local_n > 0
+            ? local_a[(int) ((2LL*j + 1)*local_n/(2*s))] : 0.0;
+   MPI_Allgather(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, samples, s, MPI_DOUBLE,
+         comm);
+   qsort(samples, (size_t) s*comm_sz, sizeof(double), Compare_doubles);
+
+   send_displs[0] = 0;
+   for (q = 0; q < comm_sz - 1; q++) {
+      send_displs[q+1] = Upper_bound(local_a, send_displs[q], local_n,
+            samples[(size_t) (q+1)*s]);
+      send_counts[q] = send_displs[q+1] - send_displs[q];
+   }
+   send_counts[comm_sz-1] = local_n - send_displs[comm_sz-1];
+   MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT, comm);
+   for (q = m = 0; q < comm_sz; q++) {
+      recv_displs[q] = m;
+      m += recv_counts[q];
+   }
+
+   ra = malloc(2*(size_t) (m > 0 ? m : 1)*sizeof(double));
+   if (local_v != NULL) rv = malloc(2*(size_t) (m > 0 ? m : 1)*sizeof(long long));
+   local_ok = ra != NULL && (local_v == NULL || rv != NULL);
+   MPI_Allreduce(&local_ok, &ok, 1, MPI_INT, MPI_MIN, comm);
+   if (!ok) {
+      free(ra);
+      free(rv);
+      free(counts);
+      free(samples);
+      return 0;
+   }
+   ra_base = ra;
+   rv_base = rv;
+   ta = ra + m;
+   if (rv != NULL) tv = rv + m;
+
+   MPI_Alltoallv(local_a, send_counts, send_displs, MPI_DOUBLE, ra,
+         recv_counts, recv_displs, MPI_DOUBLE, comm);
+   if (local_v != NULL)
+      MPI_Alltoallv(local_v, send_counts, send_displs, MPI_LONG_LONG, rv,
+            recv_counts, recv_displs, MPI_LONG_LONG, comm);
+   recv_displs[comm_sz] = m;
+   Merge_runs(&ra, &rv, &ta, &tv, recv_displs, comm_sz, m);
+
+   // Back to blocks of local_n: our m keys start at global position first
+   mm = m;
+   MPI_Exscan(&mm, &first, 1, MPI_LONG_LONG, MPI_SUM, comm);
+   if (my_rank == 0) first = 0;
+   for (q = 0; q < comm_sz; q++) {
+      lo = (long long) q*local_n > first ? (long long) q*local_n : first;
+      hi = (long long) (q+1)*local_n < first + m ? (long long) (q+1)*local_n
+            : first + m;
+      send_counts[q] = hi > lo ? hi - lo : 0;
+      send_displs[q] = hi > lo ? lo - first : 0;
+   }
+   MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT, comm);
+   for (q = j = 0; q < comm_sz; q++) {
+      recv_displs[q] = j;
+      j += recv_counts[q];
+   }
+   MPI_Alltoallv(ra, send_counts, send_displs, MPI_DOUBLE, local_a,
+         recv_counts, recv_displs, MPI_DOUBLE, comm);
+   if (local_v != NULL)
+      MPI_Alltoallv(rv, send_counts, send_displs, MPI_LONG_LONG, local_v,
+            recv_counts, recv_displs, MPI_LONG_LONG, comm);
+
+   free(ra_base);
+   free(rv_base);
+   free(counts);
+   free(samples);
+   return 1;
+}  /* Sample_sort */
+
+/*---------------------------------------------------------------------
+ * Function:  Merge_runs
+ * Purpose:   Merge sorted runs, pairwise, until one is left, in the
+ *            order of To_bits
+ * In args:   runs:    number of runs
+ *            m:       total number of keys
+ * In/out:    a_p, v_p:    the keys and values (*v_p may be NULL); on
+ *                         return, the merged ones
+ *            ta_p, tv_p:  scratch of the same size, swapped with
+ *                         *a_p and *v_p as the passes alternate
+ *            bounds:      runs+1 starts of the runs (bounds[runs] = m);
+ *                         overwritten
+ */
+static void Merge_runs(
+      double**     a_p       /* in/out */,
+      long long**  v_p       /* in/out */,
+      double**     ta_p      /* in/out */,
+      long long**  tv_p      /* in/out */,
+      int          bounds[]  /* in/out */,
+      int          runs      /* in     */,
+      int          m         /* in     */) {
+   double *a = *a_p, *ta = *ta_p, *swap;
+   long long *v = *v_p, *tv = *tv_p, *vswap;
+   int r, i, j, k, lo, mid, hi;
+
+   while (runs > 1) {
+      for (r = 0; r < runs; r += 2) {
+         lo = bounds[r];
+         mid = bounds[r+1];
+         hi = r + 2 <= runs ? bounds[r+2] : mid;
+         for (i = k = lo, j = mid; i < mid && j < hi; k++)
+            if (To_bits(a[j]) < To_bits(a[i])) {
+               ta[k] = a[j];
+               if (v != NULL) tv[k] = v[j];
+               j++;
+            } else {
+               ta[k] = a[i];
+               if (v != NULL) tv[k] = v[i];
+               i++;
+            }
+         memcpy(ta + k, a + i, (mid - i)*sizeof(double));
+         memcpy(ta + k + mid - i, a + j, (hi - j)*sizeof(double));
+         if (v != NULL) {
+            memcpy(tv + k, v + i, (mid - i)*sizeof(long long));
+            memcpy(tv + k + mid - i, v + j, (hi - j)*sizeof(long long));
+         }
+         bounds[r/2] = lo;
+      }
+      runs = (runs + 1)/2;
+      bounds[runs] = m;
+      swap = a;
+      a = ta;
+      ta = swap;
+      vswap = v;
+      v = tv;
+      tv = vswap;
+   }
+   *a_p = a;
+   *ta_p = ta;
+   *v_p = v;
+   *tv_p = tv;
+}  /* Merge_runs */
+
+/*---------------------------------------------------------------------
+ * Function:  Upper_bound
+ * Purpose:   Find the first position p >= lo with a[p] > key in the
+ *            order of To_bits
+ * In args:   a:    sorted keys
+ *            lo:   where to start
+ *            n:    number of keys
+ *            key:  the splitter
+ * Ret val:   p, or n if no key after lo is greater
+ */
+static int Upper_bound(
+      const double  a[]  /* in */,
+      int           lo   /* in */,
+      int           n    /* in */,
+      double        key  /* in */) {
+   uint64_t k = To_bits(key);
+   int hi = n, mid;
+
+   while (lo < hi) {
+      mid = lo + (hi - lo)/2;
+      if (To_bits(a[mid]) <= k) lo = mid + 1;
+      else hi = mid;
+   }
+   return lo;
+}  /* Upper_bound */
+
+/*---------------------------------------------------------------------
+ * Function:  To_bits
+ * Purpose:   Map a double to an unsigned integer with the same order
+ */
+static uint64_t To_bits(double d) {
+   uint64_t u;
+
+   memcpy(&u, &d, sizeof(u));
+   return (u >> 63) ? ~u : u | 0x8000000000000000ULL;
+}  /* To_bits */
+
+/*---------------------------------------------------------------------
+ * Function:  From_bits
+ * Purpose:   Invert To_bits
+ */
+static double From_bits(uint64_t u) {
+   double d;
+
+   u = (u >> 63) ? u & 0x7fffffffffffffffULL : ~u;
+   memcpy(&d, &u, sizeof(d));
+   return d;
+}  /* From_bits */
+
+/*---------------------------------------------------------------------
+ * Function:  Compare_doubles
+ * Purpose:   Order doubles for qsort, as Local_sort does
+ */
+static int Compare_doubles(const void* a, const void* b) {
+   uint64_t x = To_bits(*(const double*) a), y = To_bits(*(const double*) b);
+
+   return (x > y) - (x < y);
+}  /* Compare_doubles */
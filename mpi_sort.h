@@ -0,0 +1,36 @@
+/* File:     mpi_sort.h
+ *
+ * Purpose:  Distributed sort of block-distributed vectors of doubles,
+ *           optionally carrying a long long value with each key.
+ *
+ * Compile:  Link mpi_sort.c into the program.
+ *
+ * Notes:
+ * 1.  Local_sort is an LSD radix sort on the bit patterns of the
+ *     doubles (6 passes of 11 bits, skipping passes where all keys share
+ *     the digit).  The histograms of all the passes are built in one
+ *     read of the keys.
+ * 2.  Sample_sort sorts the blocks locally, picks comm_sz-1 splitters
+ *     from a regular sample of every block (MPI_Allgather), sends each
+ *     element to the process of its splitter interval with
+ *     MPI_Alltoallv and merges the comm_sz sorted runs received.  A
+ *     second MPI_Alltoallv then restores the block distribution, so on
+ *     return process q holds elements q*local_n, ..., (q+1)*local_n - 1
+ *     of the sorted vector.
+ * 3.  Values (e.g., the original global indices, which make any payload
+ *     follow its key) move with their keys; pass NULL for keys only.
+ *     The sort is not stable.
+ * 4.  Both sorts order the bit patterns (see To_bits in mpi_sort.c):
+ *     NaNs with the sign bit clear sort after +inf, those with it set
+ *     before -inf, and -0.0 before +0.0.
+ */
+#ifndef MPI_SORT_H
+#define MPI_SORT_H
+
+#include <mpi.h>
+
+int Local_sort(double a[], long long v[], int n);
+int Sample_sort(double local_a[], long long local_v[], int local_n,
+      MPI_Comm comm);
+
+#endif /* MPI_SORT_H */
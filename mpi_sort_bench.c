@@ -0,0 +1,245 @@
+/* File:     mpi_sort_bench.c
+ *
+ * Purpose:  Check and time the local radix sort and the distributed
+ *           sample sort of mpi_sort.h, with keys only and with
+ *           key/value pairs.
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_sort_bench \
+ *              mpi_sort_bench.c mpi_sort.c mpi_vector_utils.c vector_ops.c -lm
+ * Run:      mpiexec -n <comm_sz> ./mpi_sort_bench <order of the vector> <iterations>
+ *
+ * Input:    The order of the vector, n, and the number of sorts timed
+ * Output:   Time per sort and keys sorted per second per process for
+ *           qsort and Local_sort on the local blocks, and for
+ *           Sample_sort with keys only and with values
+ *
+ * Notes:
+ * 1.  n should be evenly divisible by comm_sz
+ * 2.  Key i is a hash of i mapped to [-1, 1), so the input is the same
+ *     for any number of processes, and the value carried with it is i.
+ * 3.  After every sort, each block must be sorted and not overlap the
+ *     next one.  With values, every key must match the hash of its
+ *     value; with keys only, the sum of the bit patterns of the keys
+ *     must be unchanged.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+#include "mpi_sort.h"
+
+enum { QSORT, LOCAL, SAMPLE, SAMPLE_KV, NUM_SORTS };
+
+static const char* sort_names[NUM_SORTS] = {"qsort (local)",
+   "radix (local)", "sample sort", "sample sort k/v"};
+
+double Key_of(long long i);
+void Fill(double local_a[], long long local_v[], int local_n, int my_rank);
+unsigned long long Checksum(double local_a[], int local_n, MPI_Comm comm);
+void Check_sorted(double local_a[], long long local_v[], int local_n,
+      int global, unsigned long long checksum, int my_rank, int comm_sz,
+      MPI_Comm comm);
+int Compare_doubles(const void* a, const void* b);
+
+int main(int argc, char* argv[]) {
+    int n, local_n, iters, it, sort, ok;
+    int comm_sz, my_rank;
+    double *local_a, start, elapsed, local_t[NUM_SORTS], t[NUM_SORTS];
+    long long *local_v;
+    unsigned long long checksum;
+    MPI_Comm comm;
+
+    // Initialize MPI
+    MPI_Init(&argc, &argv);
+    comm = MPI_COMM_WORLD;
+    MPI_Comm_size(comm, &comm_sz);
+    MPI_Comm_rank(comm, &my_rank);
+
+    if (argc != 3) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Usage: %s <order of the vector> <iterations>\n", argv[0]);
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    n = atoi(argv[1]);
+    iters = atoi(argv[2]);
+    if (n <= 0 || n % comm_sz != 0 || iters <= 0) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Order of the vector should be a positive integer and evenly divisible by the number of processes, and iterations positive\n");
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    local_n = n/comm_sz;
+    local_a = Vec_alloc(local_n, sizeof(double));
+    local_v = Vec_alloc(local_n, sizeof(long long));
+    Check_for_error(local_a != NULL && local_v != NULL, "main",
+          "Can't allocate local vectors", comm);
+    Fill(local_a, local_v, local_n, my_rank);
+    checksum = Checksum(local_a, local_n, comm);
+
+    for (sort = 0; sort < NUM_SORTS; sort++) {
+        local_t[sort] = 0.0;
+        for (it = 0; it < iters; it++) {
+            Fill(local_a, local_v, local_n, my_rank);
+            MPI_Barrier(comm);
+            start = MPI_Wtime();
+            switch (sort) {
+                case QSORT:
+                    qsort(local_a, local_n, sizeof(double), Compare_doubles);
+                    ok = 1;
+                    break;
+                case LOCAL:
+                    ok = Local_sort(local_a, NULL, local_n);
+                    break;
+                case SAMPLE:
+                    ok = Sample_sort(local_a, NULL, local_n, comm);
+                    break;
+                default:
+                    ok = Sample_sort(local_a, local_v, local_n, comm);
+                    break;
+            }
+            elapsed = MPI_Wtime() - start;
+            local_t[sort] += elapsed;
+            Check_for_error(ok, "main", "Can't allocate sort work space", comm);
+            Check_sorted(local_a, sort == SAMPLE_KV ? local_v : NULL, local_n,
+                  sort >= SAMPLE, checksum, my_rank, comm_sz, comm);
+        }
+        local_t[sort] /= iters;
+    }
+
+    MPI_Reduce(local_t, t, NUM_SORTS, MPI_DOUBLE, MPI_MAX, 0, comm);
+    if (my_rank == 0) {
+        printf("n = %d, %d processes, %d keys per process\n", n, comm_sz, local_n);
+        printf("%-16s %14s %16s\n", "sort", "s/sort", "keys/s/process");
+        for (sort = 0; sort < NUM_SORTS; sort++)
+            printf("%-16s %14.6e %16.4e\n", sort_names[sort], t[sort],
+                  local_n/t[sort]);
+    }
+
+    free(local_a);
+    free(local_v);
+
+    MPI_Finalize();
+    return 0;
+}  /* main */
+
+/*---------------------------------------------------------------------
+ * Function:  Key_of
+ * Purpose:   Hash a global index to a key in [-1, 1)
+ * In args:   i:  the index
+ * Ret val:   the key
+ *
+ * Note:
+ *    The hash is the finalizer of splitmix64.
+ */
+double Key_of(long long i /* in */) {
+   uint64_t z = (uint64_t) i + 0x9e3779b97f4a7c15ULL;
+
+   z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ULL;
+   z = (z ^ (z >> 27))*0x94d049bb133111ebULL;
+   z ^= z >> 31;
+   return (z >> 11)*0x1.0p-52 - 1.0;
+}  /* Key_of */
+
+/*---------------------------------------------------------------------
+ * Function:  Fill
+ * Purpose:   Set the local keys and values
+ * In args:   local_n:  order of the blocks
+ *            my_rank:  calling process' rank
+ * Out args:  local_a:  keys
+ *            local_v:  values (global indices)
+ */
+void Fill(
+      double     local_a[]  /* out */,
+      long long  local_v[]  /* out */,
+      int        local_n    /* in  */,
+      int        my_rank    /* in  */) {
+   long long i, first = (long long) my_rank*local_n;
+
+   for (i = 0; i < local_n; i++) {
+      local_v[i] = first + i;
+      local_a[i] = Key_of(first + i);
+   }
+}  /* Fill */
+
+/*---------------------------------------------------------------------
+ * Function:  Checksum
+ * Purpose:   Sum the bit patterns of all the keys, modulo 2^64
+ * In args:   local_a:  local keys
+ *            local_n:  their number
+ *            comm:     communicator containing the vector
+ * Ret val:   the sum, on every process
+ */
+unsigned long long Checksum(
+      double    local_a[]  /* in */,
+      int       local_n    /* in */,
+      MPI_Comm  comm       /* in */) {
+   unsigned long long local_sum = 0, sum, bits;
+   int i;
+
+   for (i = 0; i < local_n; i++) {
+      memcpy(&bits, &local_a[i], sizeof(bits));
+      local_sum += bits;
+   }
+   MPI_Allreduce(&local_sum, &sum, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, comm);
+   return sum;
+}  /* Checksum */
+
+/*---------------------------------------------------------------------
+ * Function:  Check_sorted
+ * Purpose:   Verify the result of a sort
+ * In args:   local_a:   local keys
+ *            local_v:   local values, or NULL
+ *            local_n:   order of the blocks
+ *            global:    whether the whole vector should be sorted, not
+ *                       only each block
+ *            checksum:  Checksum of the input
+ *            my_rank, comm_sz, comm:  the processes
+ *
+ * Errors:    If the keys are out of order or were changed, the program
+ *            terminates
+ */
+void Check_sorted(
+      double              local_a[]  /* in */,
+      long long           local_v[]  /* in */,
+      int                 local_n    /* in */,
+      int                 global     /* in */,
+      unsigned long long  checksum   /* in */,
+      int                 my_rank    /* in */,
+      int                 comm_sz    /* in */,
+      MPI_Comm            comm       /* in */) {
+   int i, ok = 1;
+   double prev_last = -2.0;
+
+   for (i = 1; i < local_n; i++)
+      if (local_a[i] < local_a[i-1]) ok = 0;
+   if (local_v != NULL)
+      for (i = 0; i < local_n; i++)
+         if (local_a[i] != Key_of(local_v[i])) ok = 0;
+   if (global) {
+      MPI_Sendrecv(&local_a[local_n-1], 1, MPI_DOUBLE,
+            my_rank < comm_sz - 1 ? my_rank + 1 : MPI_PROC_NULL, 0,
+            &prev_last, 1, MPI_DOUBLE,
+            my_rank > 0 ? my_rank - 1 : MPI_PROC_NULL, 0, comm,
+            MPI_STATUS_IGNORE);
+      if (my_rank > 0 && prev_last > local_a[0]) ok = 0;
+   }
+   ok = Checksum(local_a, local_n, comm) == checksum && ok;
+   Check_for_error(ok, "Check_sorted", "The vector isn't sorted", comm);
+}  /* Check_sorted */
+
+/*---------------------------------------------------------------------
+ * Function:  Compare_doubles
+ * Purpose:   Order doubles for qsort
+ */
+int Compare_doubles(const void* a, const void* b) {
+   double x = *(const double*) a, y = *(const double*) b;
+
+   return (x > y) - (x < y);
+}  /* Compare_doubles */
@@ -0,0 +1,375 @@
+/* File:     mpi_sparse.c
+ *
+ * Purpose:  Sparse vector storage and kernels (see mpi_sparse.h)
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <mpi.h>
+#include "vector_ops.h"
+#include "mpi_sparse.h"
+
+#define SPARSE_ACC     8    /* independent partial sums in the dots    */
+#define SPARSE_GALLOP  32   /* size ratio above which Sparse_dot
+                               searches instead of merging            */
+
+static int Sparse_reserve(Sparse_vector* x, int capacity);
+static int Gallop(const int idx[], int lo, int n, int key);
+
+/*---------------------------------------------------------------------
+ * Function:  Sparse_alloc
+ * Purpose:   Create an empty sparse block
+ * In args:   local_n:   order of the dense block
+ *            capacity:  number of pairs to make room for
+ * Out args:  x:         the sparse block
+ * Ret val:   1 on success, 0 if the allocation fails
+ */
+int Sparse_alloc(
+      Sparse_vector*  x         /* out */,
+      int             local_n   /* in  */,
+      int             capacity  /* in  */) {
+   x->local_n = local_n;
+   x->nnz = 0;
+   x->capacity = 0;
+   x->idx = NULL;
+   x->val = NULL;
+   return Sparse_reserve(x, capacity);
+}  /* Sparse_alloc */
+
+/*---------------------------------------------------------------------
+ * Function:  Sparse_free
+ * Purpose:   Release the storage of a sparse block
+ * In/out:    x:  the sparse block, left empty
+ */
+void Sparse_free(Sparse_vector* x /* in/out */) {
+   free(x->idx);
+   free(x->val);
+   x->idx = NULL;
+   x->val = NULL;
+   x->nnz = x->capacity = 0;
+}  /* Sparse_free */
+
+/*---------------------------------------------------------------------
+ * Function:  Sparse_from_dense
+ * Purpose:   Store the nonzeros of a dense block
+ * In args:   local_a:  the dense block
+ *            local_n:  its order
+ * Out args:  x:        the sparse block (allocated here)
+ * Ret val:   1 on success, 0 if the allocation fails
+ */
+int Sparse_from_dense(
+      Sparse_vector*  x          /* out */,
+      const double    local_a[]  /* in  */,
+      int             local_n    /* in  */) {
+   int i, nnz = 0;
+
+   for (i = 0; i < local_n; i++)
+      nnz += local_a[i] != 0.0;
+   if (!Sparse_alloc(x, local_n, nnz)) return 0;
+   for (i = 0; i < local_n; i++)
+      if (local_a[i] != 0.0) {
+         x->idx[x->nnz] = i;
+         x->val[x->nnz++] = local_a[i];
+      }
+   return 1;
+}  /* Sparse_from_dense */
+
+/*---------------------------------------------------------------------
+ * Function:  Sparse_to_dense
+ * Purpose:   Expand a sparse block into a dense one
+ * In args:   x:        the sparse block
+ * Out args:  local_a:  the dense block, x->local_n elements
+ */
+void Sparse_to_dense(
+      const Sparse_vector*  x          /* in  */,
+      double                local_a[]  /* out */) {
+   int k;
+
+   memset(local_a, 0, x->local_n*sizeof(double));
+   VEC_IVDEP
+   for (k = 0; k < x->nnz; k++)
+      local_a[x->idx[k]] = x->val[k];
+}  /* Sparse_to_dense */
+
+/*---------------------------------------------------------------------
+ * Function:  Sparse_generate
+ * Purpose:   Generate a random sparse block: each element is nonzero
+ *            with probability density, with a value in (0, 1]
+ * In args:   local_n:  order of the dense block
+ *            density:  fraction of nonzeros, 0 < density <= 1
+ *            my_rank:  rank of the calling process
+ *            i_seed:   distinguishes vectors generated by one process
+ * Out args:  x:        the sparse block (allocated here)
+ * Ret val:   1 on success, 0 if the allocation fails
+ *
+ * Note:
+ *    The gaps between nonzeros are drawn from the geometric
+ *    distribution, so the cost is proportional to the nonzeros, not to
+ *    local_n.
+ */
+int Sparse_generate(
+      Sparse_vector*  x        /* out */,
+      int             local_n  /* in  */,
+      double          density  /* in  */,
+      int             my_rank  /* in  */,
+      int             i_seed   /* in  */) {
+   unsigned int seed = (unsigned int)time(NULL) + my_rank + i_seed;
+   double log_q = log1p(-density), u;
+   long long i = -1;
+   int expect = (int) (1.5*density*local_n) + 16;
+
+   if (!Sparse_alloc(x, local_n, expect < local_n ? expect : local_n))
+      return 0;
+   for (;;) {
+      u = (rand_r(&seed) + 1.0)/(RAND_MAX + 1.0);
+      i += density >= 1.0 ? 1 : 1 + (long long) floor(log(u)/log_q);
+      if (i >= local_n) break;
+      if (x->nnz == x->capacity && !Sparse_reserve(x, 2*x->capacity))
+         return 0;
+      x->idx[x->nnz] = i;
+      x->val[x->nnz++] = (rand_r(&seed) + 1.0)/(RAND_MAX + 1.0);
+   }
+   return 1;
+}  /* Sparse_generate */
+
+/*---------------------------------------------------------------------
+ * Function:  Sparse_dense_dot
+ * Purpose:   Dot product of a sparse and a dense block
+ * In args:   x:  the sparse block
+ *            y:  the dense block, x->local_n elements
+ * Ret val:   sum of x.val[k]*y[x.idx[k]]
+ *
+ * Note:
+ *    The loop over SPARSE_ACC partial sums vectorizes into gather
+ *    instructions where the ISA has them (AVX2, AVX-512).
+ */
+double Sparse_dense_dot(
+      const Sparse_vector*  x    /* in */,
+      const double          y[]  /* in */) {
+   double acc[SPARSE_ACC] = {0}, dot = 0.0;
+   const int* idx = x->idx;
+   const double* val = x->val;
+   int k, j;
+
+   for (k = 0; k + SPARSE_ACC <= x->nnz; k += SPARSE_ACC)
+      for (j = 0; j < SPARSE_ACC; j++)
+         acc[j] += val[k+j]*y[idx[k+j]];
+   for (; k < x->nnz; k++)
+      acc[0] += val[k]*y[idx[k]];
+   for (j = 0; j < SPARSE_ACC; j++)
+      dot += acc[j];
+   return dot;
+}  /* Sparse_dense_dot */
+
+/*---------------------------------------------------------------------
+ * Function:  Sparse_axpy
+ * Purpose:   y = alpha*x + y for a sparse x and a dense y
+ * In args:   x:      the sparse block
+ *            alpha:  the factor
+ * In/out:    y:      the dense block, x->local_n elements
+ *
+ * Note:
+ *    The indices of x are distinct, so the updates are independent:
+ *    the loop gathers y, adds and scatters it back.
+ */
+void Sparse_axpy(
+      const Sparse_vector*  x      /* in     */,
+      double                y[]    /* in/out */,
+      double                alpha  /* in     */) {
+   const int* idx = x->idx;
+   const double* val = x->val;
+   int k;
+
+   VEC_IVDEP
+   for (k = 0; k < x->nnz; k++)
+      y[idx[k]] += alpha*val[k];
+}  /* Sparse_axpy */
+
+/*---------------------------------------------------------------------
+ * Function:  Sparse_add
+ * Purpose:   z = x+y for sparse blocks, by merging their index lists
+ * In args:   x, y:  the sparse blocks (same local_n)
+ * Out args:  z:     the sum; an allocated block (e.g., from
+ *                   Sparse_alloc), grown if needed; not x or y
+ * Ret val:   1 on success, 0 if the allocation fails
+ */
+int Sparse_add(
+      const Sparse_vector*  x  /* in  */,
+      const Sparse_vector*  y  /* in  */,
+      Sparse_vector*        z  /* out */) {
+   int i = 0, j = 0, k = 0;
+
+   if (z->capacity < x->nnz + y->nnz && !Sparse_reserve(z, x->nnz + y->nnz))
+      return 0;
+   z->local_n = x->local_n;
+   while (i < x->nnz && j < y->nnz) {
+      if (x->idx[i] < y->idx[j]) {
+         z->idx[k] = x->idx[i];
+         z->val[k++] = x->val[i++];
+      } else if (x->idx[i] > y->idx[j]) {
+         z->idx[k] = y->idx[j];
+         z->val[k++] = y->val[j++];
+      } else {
+         z->idx[k] = x->idx[i];
+         z->val[k++] = x->val[i++] + y->val[j++];
+      }
+   }
+   memcpy(z->idx + k, x->idx + i, (x->nnz - i)*sizeof(int));
+   memcpy(z->val + k, x->val + i, (x->nnz - i)*sizeof(double));
+   k += x->nnz - i;
+   memcpy(z->idx + k, y->idx + j, (y->nnz - j)*sizeof(int));
+   memcpy(z->val + k, y->val + j, (y->nnz - j)*sizeof(double));
+   z->nnz = k + y->nnz - j;
+   return 1;
+}  /* Sparse_add */
+
+/*---------------------------------------------------------------------
+ * Function:  Sparse_dot
+ * Purpose:   Dot product of two sparse blocks
+ * In args:   x, y:  the sparse blocks (same local_n)
+ * Ret val:   sum over the common indices of the products of the values
+ *
+ * Note:
+ *    Blocks of similar size are merged with a branch-free loop that
+ *    advances whichever index is smaller (both when they are equal).
+ *    When one block has SPARSE_GALLOP times more pairs than the other,
+ *    each index of the short one is found in the long one by
+ *    galloping search instead.
+ */
+double Sparse_dot(
+      const Sparse_vector*  x  /* in */,
+      const Sparse_vector*  y  /* in */) {
+   const Sparse_vector *s = x, *l = y, *t;
+   double dot = 0.0;
+   int i = 0, j = 0, a, b;
+
+   if (s->nnz > l->nnz) {
+      t = s;
+      s = l;
+      l = t;
+   }
+
+   if ((long long) s->nnz*SPARSE_GALLOP < l->nnz) {
+      for (i = 0; i < s->nnz && j < l->nnz; i++) {
+         j = Gallop(l->idx, j, l->nnz, s->idx[i]);
+         if (j < l->nnz && l->idx[j] == s->idx[i])
+            dot += s->val[i]*l->val[j];
+      }
+      return dot;
+   }
+
+   while (i < s->nnz && j < l->nnz) {
+      a = s->idx[i];
+      b = l->idx[j];
+      dot += a == b ? s->val[i]*l->val[j] : 0.0;
+      i += a <= b;
+      j += b <= a;
+   }
+   return dot;
+}  /* Sparse_dot */
+
+/*---------------------------------------------------------------------
+ * Function:  Parallel_sparse_dense_dot
+ * Purpose:   Dot product of a distributed sparse and dense vector
+ * In args:   local_x:  local sparse block
+ *            local_y:  local dense block
+ *            comm:     communicator containing the vectors
+ * Ret val:   x.y on every process
+ */
+double Parallel_sparse_dense_dot(
+      const Sparse_vector*  local_x    /* in */,
+      const double          local_y[]  /* in */,
+      MPI_Comm              comm       /* in */) {
+   double local_dot, dot;
+
+   local_dot = Sparse_dense_dot(local_x, local_y);
+   MPI_Allreduce(&local_dot, &dot, 1, MPI_DOUBLE, MPI_SUM, comm);
+   return dot;
+}  /* Parallel_sparse_dense_dot */
+
+/*---------------------------------------------------------------------
+ * Function:  Parallel_sparse_dot
+ * Purpose:   Dot product of two distributed sparse vectors
+ * In args:   local_x, local_y:  local sparse blocks
+ *            comm:              communicator containing the vectors
+ * Ret val:   x.y on every process
+ */
+double Parallel_sparse_dot(
+      const Sparse_vector*  local_x  /* in */,
+      const Sparse_vector*  local_y  /* in */,
+      MPI_Comm              comm     /* in */) {
+   double local_dot, dot;
+
+   local_dot = Sparse_dot(local_x, local_y);
+   MPI_Allreduce(&local_dot, &dot, 1, MPI_DOUBLE, MPI_SUM, comm);
+   return dot;
+}  /* Parallel_sparse_dot */
+
+/*---------------------------------------------------------------------
+ * Function:  Sparse_reserve
+ * Purpose:   Make room for capacity pairs, keeping the stored ones
+ * In/out:    x:  the sparse block
+ * Ret val:   1 on success, 0 if the allocation fails (x is unchanged)
+ */
+static int Sparse_reserve(
+      Sparse_vector*  x         /* in/out */,
+      int             capacity  /* in     */) {
+   int* idx;
+   double* val;
+
+   if (capacity < 1) capacity = 1;
+   if (capacity <= x->capacity) return 1;
+   idx = Vec_alloc(capacity, sizeof(int));
+   val = Vec_alloc(capacity, sizeof(double));
+   if (idx == NULL || val == NULL) {
+      free(idx);
+      free(val);
+      return 0;
+   }
+   if (x->nnz > 0) {
+      memcpy(idx, x->idx, x->nnz*sizeof(int));
+      memcpy(val, x->val, x->nnz*sizeof(double));
+   }
+   free(x->idx);
+   free(x->val);
+   x->idx = idx;
+   x->val = val;
+   x->capacity = capacity;
+   return 1;
+}  /* Sparse_reserve */
+
+/*---------------------------------------------------------------------
+ * Function:  Gallop
+ * Purpose:   Find the first position p >= lo with idx[p] >= key
+ * In args:   idx:  sorted indices
+ *            lo:   where to start
+ *            n:    number of indices
+ *            key:  the index sought
+ * Ret val:   p, or n if every idx[p] < key
+ *
+ * Note:
+ *    The step doubles until it passes key, then a binary search
+ *    finishes, so the cost is logarithmic in the distance moved.
+ */
+static int Gallop(
+      const int  idx[]  /* in */,
+      int        lo     /* in */,
+      int        n      /* in */,
+      int        key    /* in */) {
+   int step = 1, hi = lo, mid;
+
+   while (hi < n && idx[hi] < key) {
+      lo = hi + 1;
+      hi += step;
+      step *= 2;
+   }
+   if (hi > n) hi = n;
+   while (lo < hi) {
+      mid = lo + (hi - lo)/2;
+      if (idx[mid] < key) lo = mid + 1;
+      else hi = mid;
+   }
+   return lo;
+}  /* Gallop */
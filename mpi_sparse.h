@@ -0,0 +1,61 @@
+/* File:     mpi_sparse.h
+ *
+ * Purpose:  Distributed sparse vectors.  A sparse vector has the same
+ *           block distribution as the dense vectors of
+ *           mpi_vector_utils.h, but each process stores only the
+ *           nonzeros of its block, as index/value pairs sorted by
+ *           index.
+ *
+ * Compile:  Link mpi_sparse.c and vector_ops.c into the program (and
+ *           -lm).
+ *
+ * Notes:
+ * 1.  Indices are local to the block: 0 <= idx[k] < local_n.  Global
+ *     index = my_rank*local_n + idx[k].
+ * 2.  Kernels:
+ *        Sparse_dense_dot   x.y for sparse x, dense y (gathers y)
+ *        Sparse_axpy        y += alpha*x for sparse x, dense y
+ *        Sparse_add         z = x+y for sparse x, y (merge)
+ *        Sparse_dot         x.y for sparse x, y (merge)
+ *     The Parallel_ names of the reductions combine the local results
+ *     with MPI_Allreduce; the other operations are purely local.
+ * 3.  Sums that cancel are kept as explicit zeros; Sparse_from_dense
+ *     drops them again.
+ */
+#ifndef MPI_SPARSE_H
+#define MPI_SPARSE_H
+
+#include <mpi.h>
+
+typedef struct {
+   int      local_n;    /* order of the dense block          */
+   int      nnz;        /* stored pairs                      */
+   int      capacity;   /* room in idx and val               */
+   int*     idx;
+   double*  val;
+} Sparse_vector;
+
+int Sparse_alloc(Sparse_vector* x, int local_n, int capacity);
+void Sparse_free(Sparse_vector* x);
+int Sparse_from_dense(Sparse_vector* x, const double local_a[],
+      int local_n);
+void Sparse_to_dense(const Sparse_vector* x, double local_a[]);
+int Sparse_generate(Sparse_vector* x, int local_n, double density,
+      int my_rank, int i_seed);
+
+double Sparse_dense_dot(const Sparse_vector* x, const double y[]);
+void Sparse_axpy(const Sparse_vector* x, double y[], double alpha);
+int Sparse_add(const Sparse_vector* x, const Sparse_vector* y,
+      Sparse_vector* z);
+double Sparse_dot(const Sparse_vector* x, const Sparse_vector* y);
+
+double Parallel_sparse_dense_dot(const Sparse_vector* local_x,
+      const double local_y[], MPI_Comm comm);
+double Parallel_sparse_dot(const Sparse_vector* local_x,
+      const Sparse_vector* local_y, MPI_Comm comm);
+#define Parallel_sparse_axpy(local_x, local_y, alpha) \
+      Sparse_axpy(local_x, local_y, alpha)
+#define Parallel_sparse_add(local_x, local_y, local_z) \
+      Sparse_add(local_x, local_y, local_z)
+
+#endif /* MPI_SPARSE_H */
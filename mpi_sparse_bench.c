@@ -0,0 +1,230 @@
+/* File:     mpi_sparse_bench.c
+ *
+ * Purpose:  Check the sparse kernels of mpi_sparse.h against their
+ *           dense counterparts and compare their speed over a range of
+ *           densities.
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_sparse_bench \
+ *              mpi_sparse_bench.c mpi_sparse.c mpi_vector_utils.c vector_ops.c -lm
+ * Run:      mpiexec -n <comm_sz> ./mpi_sparse_bench <order of the vectors> <iterations> <density>...
+ *
+ * Input:    The order of the vectors, n, the number of times each
+ *           operation is repeated, and one or more densities (fraction
+ *           of nonzeros, in (0, 1])
+ * Output:   For each density, the time per call of each operation on
+ *           dense vectors and on sparse ones, and the speedup; then the
+ *           time of the conversions between the two
+ *
+ * Notes:
+ * 1.  n should be evenly divisible by comm_sz
+ * 2.  The operations are x.y for sparse x and dense y, y += alpha*x,
+ *     z = x+w and x.w, where x and w are independent random sparse
+ *     vectors of the given density.  The dense versions run the
+ *     kernels of vector_ops.h on the expanded vectors.
+ * 3.  Before timing, the sparse sum must equal the dense one exactly,
+ *     and the dot products must agree to a relative 1e-12.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+#include "mpi_sparse.h"
+
+enum { SD_DOT, AXPY, ADD, SS_DOT, NUM_OPS };
+
+static const char* op_names[NUM_OPS] = {"sparse.dense", "axpy", "add",
+   "sparse.sparse"};
+
+void Check_kernels(Sparse_vector* x, Sparse_vector* w, double local_y[],
+      double local_xd[], double local_wd[], double local_zd[], int local_n,
+      MPI_Comm comm);
+
+int main(int argc, char* argv[]) {
+    int n, local_n, iters, d, op, it, dense, i;
+    int comm_sz, my_rank;
+    double *local_y, *local_xd, *local_wd, *local_zd;
+    double density, start, local_dot, dot, local_t[2*NUM_OPS + 2], t[2*NUM_OPS + 2];
+    long long local_nnz, nnz;
+    Sparse_vector x, w, z, x2;
+    MPI_Comm comm;
+
+    // Initialize MPI
+    MPI_Init(&argc, &argv);
+    comm = MPI_COMM_WORLD;
+    MPI_Comm_size(comm, &comm_sz);
+    MPI_Comm_rank(comm, &my_rank);
+
+    if (argc < 4) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Usage: %s <order of the vectors> <iterations> <density>...\n", argv[0]);
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    n = atoi(argv[1]);
+    iters = atoi(argv[2]);
+    if (n <= 0 || n % comm_sz != 0 || iters <= 0) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Order of the vectors should be a positive integer and evenly divisible by the number of processes, and iterations positive\n");
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    local_n = n / comm_sz;
+    Allocate_vectors(&local_y, &local_xd, &local_wd, local_n, comm);
+    Allocate_vectors(&local_zd, NULL, NULL, local_n, comm);
+    Check_for_error(Sparse_alloc(&z, local_n, 0), "main",
+          "Can't allocate sparse vector", comm);
+
+    for (d = 3; d < argc; d++) {
+        density = atof(argv[d]);
+        Check_for_error(density > 0.0 && density <= 1.0, "main",
+              "Densities should be in (0, 1]", comm);
+        Check_for_error(Sparse_generate(&x, local_n, density, my_rank, 1)
+              && Sparse_generate(&w, local_n, density, my_rank, 2),
+              "main", "Can't allocate sparse vectors", comm);
+        Generate_vector(local_y, local_n, my_rank, 3);
+        Sparse_to_dense(&x, local_xd);
+        Sparse_to_dense(&w, local_wd);
+
+        Check_kernels(&x, &w, local_y, local_xd, local_wd, local_zd, local_n,
+              comm);
+
+        for (op = 0; op < NUM_OPS; op++) {
+            for (dense = 1; dense >= 0; dense--) {
+                MPI_Barrier(comm);
+                start = MPI_Wtime();
+                for (it = 0; it < iters; it++) {
+                    switch (op) {
+                        case SD_DOT:
+                            if (dense) {
+                                local_dot = Parallel_dot_product(local_xd, local_y, local_n);
+                                MPI_Allreduce(&local_dot, &dot, 1, MPI_DOUBLE, MPI_SUM, comm);
+                            } else {
+                                Parallel_sparse_dense_dot(&x, local_y, comm);
+                            }
+                            break;
+                        case AXPY:
+                            if (dense) Axpy(local_xd, local_y, local_n, 0.0);
+                            else Parallel_sparse_axpy(&x, local_y, 0.0);
+                            break;
+                        case ADD:
+                            if (dense) Parallel_vector_sum(local_xd, local_wd, local_zd, local_n);
+                            else Parallel_sparse_add(&x, &w, &z);
+                            break;
+                        case SS_DOT:
+                            if (dense) {
+                                local_dot = Parallel_dot_product(local_xd, local_wd, local_n);
+                                MPI_Allreduce(&local_dot, &dot, 1, MPI_DOUBLE, MPI_SUM, comm);
+                            } else {
+                                Parallel_sparse_dot(&x, &w, comm);
+                            }
+                            break;
+                    }
+                }
+                local_t[2*op + !dense] = (MPI_Wtime() - start)/iters;
+            }
+        }
+
+        // Conversions
+        MPI_Barrier(comm);
+        start = MPI_Wtime();
+        for (it = 0; it < iters; it++)
+            Sparse_to_dense(&x, local_zd);
+        local_t[2*NUM_OPS] = (MPI_Wtime() - start)/iters;
+        MPI_Barrier(comm);
+        start = MPI_Wtime();
+        for (it = 0; it < iters; it++) {
+            Sparse_from_dense(&x2, local_xd, local_n);
+            if (it < iters - 1) Sparse_free(&x2);
+        }
+        local_t[2*NUM_OPS + 1] = (MPI_Wtime() - start)/iters;
+        for (i = 0; i < x.nnz; i++)
+            if (x2.idx[i] != x.idx[i] || x2.val[i] != x.val[i]) break;
+        Check_for_error(x2.nnz == x.nnz && i == x.nnz, "main",
+              "Dense to sparse conversion is wrong", comm);
+        Sparse_free(&x2);
+
+        local_nnz = x.nnz;
+        MPI_Reduce(&local_nnz, &nnz, 1, MPI_LONG_LONG, MPI_SUM, 0, comm);
+        MPI_Reduce(local_t, t, 2*NUM_OPS + 2, MPI_DOUBLE, MPI_MAX, 0, comm);
+        if (my_rank == 0) {
+            printf("density %g: %lld nonzeros of %d\n", density, nnz, n);
+            printf("   %-14s %14s %14s %9s\n", "op", "dense s/call", "sparse s/call", "speedup");
+            for (op = 0; op < NUM_OPS; op++)
+                printf("   %-14s %14.6e %14.6e %9.2f\n", op_names[op],
+                      t[2*op], t[2*op + 1], t[2*op]/t[2*op + 1]);
+            printf("   to dense %e s/call, from dense %e s/call\n",
+                  t[2*NUM_OPS], t[2*NUM_OPS + 1]);
+        }
+
+        Sparse_free(&x);
+        Sparse_free(&w);
+    }
+
+    Sparse_free(&z);
+    free(local_y);
+    free(local_xd);
+    free(local_wd);
+    free(local_zd);
+
+    MPI_Finalize();
+    return 0;
+}  /* main */
+
+/*---------------------------------------------------------------------
+ * Function:  Check_kernels
+ * Purpose:   Compare each sparse kernel with the dense computation
+ * In args:   x, w:                 local sparse blocks
+ *            local_y:              a dense block
+ *            local_xd, local_wd:   x and w expanded
+ *            local_n:              order of the blocks
+ *            comm:                 communicator containing the vectors
+ * Out args:  local_zd:             scratch
+ *
+ * Errors:    If a kernel disagrees, the program terminates
+ */
+void Check_kernels(
+      Sparse_vector*  x           /* in  */,
+      Sparse_vector*  w           /* in  */,
+      double          local_y[]   /* in  */,
+      double          local_xd[]  /* in  */,
+      double          local_wd[]  /* in  */,
+      double          local_zd[]  /* out */,
+      int             local_n     /* in  */,
+      MPI_Comm        comm        /* in  */) {
+   Sparse_vector z;
+   double sparse, dense, *scratch;
+   int i, ok = 1;
+
+   sparse = Sparse_dense_dot(x, local_y);
+   dense = Dot_product(local_xd, local_y, local_n);
+   ok = ok && fabs(sparse - dense) <= 1.0e-12*fabs(dense);
+   sparse = Sparse_dot(x, w);
+   dense = Dot_product(local_xd, local_wd, local_n);
+   ok = ok && fabs(sparse - dense) <= 1.0e-12*fabs(dense);
+
+   ok = ok && Sparse_alloc(&z, local_n, 0) && Sparse_add(x, w, &z);
+   scratch = Vec_alloc(local_n, sizeof(double));
+   ok = ok && scratch != NULL;
+   if (ok) {
+      Sparse_to_dense(&z, scratch);
+      Vector_sum(local_xd, local_wd, local_zd, local_n);
+      for (i = 0; i < local_n; i++)
+         if (scratch[i] != local_zd[i]) ok = 0;
+      // axpy must add 2x at the nonzeros of x
+      for (i = 0; i < local_n; i++)
+         local_zd[i] = local_y[i];
+      Sparse_axpy(x, local_zd, 2.0);
+      for (i = 0; i < x->nnz; i++)
+         if (local_zd[x->idx[i]] != local_y[x->idx[i]] + 2.0*x->val[i])
+            ok = 0;
+   }
+   free(scratch);
+   Sparse_free(&z);
+   Check_for_error(ok, "Check_kernels", "Sparse and dense results differ",
+         comm);
+}  /* Check_kernels */
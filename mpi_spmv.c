@@ -0,0 +1,440 @@
+/* File:     mpi_spmv.c
+ *
+ * Purpose:  Distributed CSR matrices and the sparse matrix-vector
+ *           product with halo exchange (see mpi_spmv.h)
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <mpi.h>
+#include "vector_ops.h"
+#include "mpi_spmv.h"
+
+#define SPMV_TAG  0x5b
+
+static int Compare_ints(const void* a, const void* b);
+static void Halo_start(Csr_matrix* A, const double local_x[]);
+static void Multiply_diag(const Csr_matrix* A, const double local_x[],
+      double local_y[]);
+static void Multiply_offd(const Csr_matrix* A, double local_y[]);
+
+/*---------------------------------------------------------------------
+ * Function:  Csr_block_alloc
+ * Purpose:   Allocate the local rows of a matrix in CSR form
+ * In args:   n:        order of the matrix
+ *            local_n:  rows owned by the calling process
+ *            nnz:      room for this many nonzeros
+ * Out args:  block:    the rows, with no nonzeros yet (ptr[0] = 0)
+ * Ret val:   1 on success, 0 if the allocation fails
+ */
+int Csr_block_alloc(
+      Csr_block*  block    /* out */,
+      int         n        /* in  */,
+      int         local_n  /* in  */,
+      int         nnz      /* in  */) {
+   block->n = n;
+   block->local_n = local_n;
+   block->ptr = Vec_alloc(local_n + 1, sizeof(int));
+   block->col = Vec_alloc(nnz > 0 ? nnz : 1, sizeof(int));
+   block->val = Vec_alloc(nnz > 0 ? nnz : 1, sizeof(double));
+   if (block->ptr == NULL || block->col == NULL || block->val == NULL) {
+      Csr_block_free(block);
+      return 0;
+   }
+   block->ptr[0] = 0;
+   return 1;
+}  /* Csr_block_alloc */
+
+/*---------------------------------------------------------------------
+ * Function:  Csr_block_free
+ * Purpose:   Release the storage of the local rows
+ * In/out:    block:  the rows
+ */
+void Csr_block_free(Csr_block* block /* in/out */) {
+   free(block->ptr);
+   free(block->col);
+   free(block->val);
+   block->ptr = block->col = NULL;
+   block->val = NULL;
+}  /* Csr_block_free */
+
+/*---------------------------------------------------------------------
+ * Function:  Csr_laplacian_2d
+ * Purpose:   Generate the local rows of the 5-point Laplacian on a g x g
+ *            grid (Dirichlet boundary), numbered row by row
+ * In args:   g:        points per side; the order is n = g*g
+ *            my_rank:  rank of the calling process
+ *            comm_sz:  number of processes (should divide g*g)
+ * Out args:  block:    the local rows
+ * Ret val:   1 on success, 0 if the allocation fails
+ *
+ * Note:
+ *    Row i couples with i-1, i+1 (same grid row) and i-g, i+g, so each
+ *    process needs g elements from each neighboring process.
+ */
+int Csr_laplacian_2d(
+      Csr_block*  block    /* out */,
+      int         g        /* in  */,
+      int         my_rank  /* in  */,
+      int         comm_sz  /* in  */) {
+   int n = g*g, local_n = n/comm_sz, first = my_rank*local_n;
+   int i, r, c, k = 0;
+
+   if (!Csr_block_alloc(block, n, local_n, 5*local_n)) return 0;
+   for (i = 0; i < local_n; i++) {
+      r = (first + i)/g;
+      c = (first + i)%g;
+      if (r > 0) {
+         block->col[k] = first + i - g;
+         block->val[k++] = -1.0;
+      }
+      if (c > 0) {
+         block->col[k] = first + i - 1;
+         block->val[k++] = -1.0;
+      }
+      block->col[k] = first + i;
+      block->val[k++] = 4.0;
+      if (c < g - 1) {
+         block->col[k] = first + i + 1;
+         block->val[k++] = -1.0;
+      }
+      if (r < g - 1) {
+         block->col[k] = first + i + g;
+         block->val[k++] = -1.0;
+      }
+      block->ptr[i+1] = k;
+   }
+   return 1;
+}  /* Csr_laplacian_2d */
+
+/*---------------------------------------------------------------------
+ * Function:  Csr_random
+ * Purpose:   Generate the local rows of a random sparse matrix
+ * In args:   n:        order of the matrix
+ *            per_row:  nonzeros drawn per row (diagonal included)
+ *            my_rank:  rank of the calling process
+ *            comm_sz:  number of processes (should divide n)
+ * Out args:  block:    the local rows
+ * Ret val:   1 on success, 0 if the allocation fails
+ *
+ * Note:
+ *    The off-diagonal columns are uniform over 0..n-1 (columns drawn
+ *    twice are stored once) with values in [-1, 0), and the diagonal is
+ *    per_row, so the matrix is diagonally dominant.  Almost every
+ *    process is a neighbor of every other one, which is the hard case
+ *    for the halo exchange.
+ */
+int Csr_random(
+      Csr_block*  block    /* out */,
+      int         n        /* in  */,
+      int         per_row  /* in  */,
+      int         my_rank  /* in  */,
+      int         comm_sz  /* in  */) {
+   int local_n = n/comm_sz, first = my_rank*local_n;
+   unsigned int seed = (unsigned int)time(NULL) + my_rank;
+   int i, j, k = 0, start;
+
+   if (per_row < 1) per_row = 1;
+   if (!Csr_block_alloc(block, n, local_n, per_row*local_n)) return 0;
+   for (i = 0; i < local_n; i++) {
+      start = k;
+      block->col[k++] = first + i;
+      for (j = 1; j < per_row; j++)
+         block->col[k++] = (int) ((double) rand_r(&seed)/((double) RAND_MAX + 1.0)*n);
+      qsort(block->col + start, k - start, sizeof(int), Compare_ints);
+      // Drop repeated columns, then give the values
+      for (j = k = start + 1; j < start + per_row; j++)
+         if (block->col[j] != block->col[k-1]) block->col[k++] = block->col[j];
+      for (j = start; j < k; j++)
+         block->val[j] = block->col[j] == first + i ? per_row
+               : -(rand_r(&seed) + 1.0)/(RAND_MAX + 1.0);
+      block->ptr[i+1] = k;
+   }
+   return 1;
+}  /* Csr_random */
+
+/*---------------------------------------------------------------------
+ * Function:  Csr_matrix_create
+ * Purpose:   Build the distributed matrix and its halo exchange pattern
+ *            from the local rows
+ * In args:   block:  the local rows (global columns); not kept
+ *            comm:   communicator containing the matrix; every process
+ *                    owns block->n/comm_sz rows
+ * Out args:  A:      the matrix
+ * Ret val:   1 on success; 0 on every process if an allocation fails
+ *            somewhere (then A's storage is already freed)
+ *
+ * Note:
+ *    The ghosts are the distinct remote columns, sorted, so those of
+ *    one owner are contiguous and arrive in one message.  Their global
+ *    indices are sent to the owners with MPI_Alltoallv, once; after
+ *    that only neighbors communicate.
+ */
+int Csr_matrix_create(
+      const Csr_block*  block  /* in  */,
+      Csr_matrix*       A      /* out */,
+      MPI_Comm          comm   /* in  */) {
+   int comm_sz, my_rank, first, local_n = block->local_n;
+   int i, k, q, nd = 0, no = 0, ok, *ghost_col, *found;
+   int *counts, *displs, *send_counts, *send_displs;
+
+   MPI_Comm_size(comm, &comm_sz);
+   MPI_Comm_rank(comm, &my_rank);
+   first = my_rank*local_n;
+   memset(A, 0, sizeof(*A));
+   A->n = block->n;
+   A->local_n = local_n;
+   A->comm = comm;
+
+   for (k = 0; k < block->ptr[local_n]; k++)
+      if (block->col[k] >= first && block->col[k] < first + local_n) nd++;
+   no = block->ptr[local_n] - nd;
+   A->diag_ptr = malloc((local_n + 1)*sizeof(int));
+   A->diag_col = malloc((nd > 0 ? nd : 1)*sizeof(int));
+   A->diag_val = malloc((nd > 0 ? nd : 1)*sizeof(double));
+   A->offd_row = malloc((local_n > 0 ? local_n : 1)*sizeof(int));
+   A->offd_ptr = malloc((local_n + 1)*sizeof(int));
+   A->offd_col = malloc((no > 0 ? no : 1)*sizeof(int));
+   A->offd_val = malloc((no > 0 ? no : 1)*sizeof(double));
+   ghost_col = malloc((no > 0 ? no : 1)*sizeof(int));
+   counts = calloc(4*comm_sz, sizeof(int));
+   ok = A->diag_ptr != NULL && A->diag_col != NULL && A->diag_val != NULL
+         && A->offd_row != NULL && A->offd_ptr != NULL
+         && A->offd_col != NULL && A->offd_val != NULL
+         && ghost_col != NULL && counts != NULL;
+   MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, comm);
+   if (!ok) {
+      free(counts);
+      free(ghost_col);
+      Csr_matrix_free(A);
+      return 0;
+   }
+
+   // Split the rows; offd_col holds global columns for now
+   nd = no = 0;
+   A->diag_ptr[0] = A->offd_ptr[0] = 0;
+   A->offd_rows = 0;
+   for (i = 0; i < local_n; i++) {
+      for (k = block->ptr[i]; k < block->ptr[i+1]; k++)
+         if (block->col[k] >= first && block->col[k] < first + local_n) {
+            A->diag_col[nd] = block->col[k] - first;
+            A->diag_val[nd++] = block->val[k];
+         } else {
+            ghost_col[no] = A->offd_col[no] = block->col[k];
+            A->offd_val[no++] = block->val[k];
+         }
+      A->diag_ptr[i+1] = nd;
+      if (no > A->offd_ptr[A->offd_rows]) {
+         A->offd_row[A->offd_rows++] = i;
+         A->offd_ptr[A->offd_rows] = no;
+      }
+   }
+
+   // Distinct remote columns, then the position of each offd entry
+   qsort(ghost_col, no, sizeof(int), Compare_ints);
+   A->n_ghost = 0;
+   for (k = 0; k < no; k++)
+      if (k == 0 || ghost_col[k] != ghost_col[k-1])
+         ghost_col[A->n_ghost++] = ghost_col[k];
+   for (k = 0; k < no; k++) {
+      found = bsearch(&A->offd_col[k], ghost_col, A->n_ghost, sizeof(int),
+            Compare_ints);
+      A->offd_col[k] = found - ghost_col;
+   }
+
+   // Tell every owner which of its elements we need
+   displs = counts + comm_sz;
+   send_counts = counts + 2*comm_sz;
+   send_displs = counts + 3*comm_sz;
+   for (k = 0; k < A->n_ghost; k++)
+      counts[ghost_col[k]/local_n]++;
+   for (q = 1; q < comm_sz; q++)
+      displs[q] = displs[q-1] + counts[q-1];
+   MPI_Alltoall(counts, 1, MPI_INT, send_counts, 1, MPI_INT, comm);
+   for (q = 1; q < comm_sz; q++)
+      send_displs[q] = send_displs[q-1] + send_counts[q-1];
+   k = send_displs[comm_sz-1] + send_counts[comm_sz-1];
+   for (q = 0; q < comm_sz; q++) {
+      A->n_recv += counts[q] > 0;
+      A->n_send += send_counts[q] > 0;
+   }
+   A->send_idx = malloc((k > 0 ? k : 1)*sizeof(int));
+   A->recv_rank = malloc((2*A->n_recv + 2*A->n_send + 2)*sizeof(int));
+   A->ghost = malloc((A->n_ghost > 0 ? A->n_ghost : 1)*sizeof(double));
+   A->send_buf = malloc((k > 0 ? k : 1)*sizeof(double));
+   A->reqs = malloc((A->n_recv + A->n_send + 1)*sizeof(MPI_Request));
+   ok = A->send_idx != NULL && A->recv_rank != NULL && A->ghost != NULL
+         && A->send_buf != NULL && A->reqs != NULL;
+   MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, comm);
+   if (!ok) {
+      free(counts);
+      free(ghost_col);
+      Csr_matrix_free(A);
+      return 0;
+   }
+
+   MPI_Alltoallv(ghost_col, counts, displs, MPI_INT, A->send_idx,
+         send_counts, send_displs, MPI_INT, comm);
+   for (i = 0; i < k; i++)
+      A->send_idx[i] -= first;
+
+   A->recv_ptr = A->recv_rank + A->n_recv;
+   A->send_rank = A->recv_ptr + A->n_recv + 1;
+   A->send_ptr = A->send_rank + A->n_send;
+   A->n_recv = A->n_send = 0;
+   A->recv_ptr[0] = A->send_ptr[0] = 0;
+   for (q = 0; q < comm_sz; q++) {
+      if (counts[q] > 0) {
+         A->recv_rank[A->n_recv++] = q;
+         A->recv_ptr[A->n_recv] = displs[q] + counts[q];
+      }
+      if (send_counts[q] > 0) {
+         A->send_rank[A->n_send++] = q;
+         A->send_ptr[A->n_send] = send_displs[q] + send_counts[q];
+      }
+   }
+
+   free(counts);
+   free(ghost_col);
+   return 1;
+}  /* Csr_matrix_create */
+
+/*---------------------------------------------------------------------
+ * Function:  Csr_matrix_free
+ * Purpose:   Release the storage of a distributed matrix
+ * In/out:    A:  the matrix
+ */
+void Csr_matrix_free(Csr_matrix* A /* in/out */) {
+   free(A->diag_ptr);
+   free(A->diag_col);
+   free(A->diag_val);
+   free(A->offd_row);
+   free(A->offd_ptr);
+   free(A->offd_col);
+   free(A->offd_val);
+   free(A->send_idx);
+   free(A->recv_rank);
+   free(A->ghost);
+   free(A->send_buf);
+   free(A->reqs);
+}  /* Csr_matrix_free */
+
+/*---------------------------------------------------------------------
+ * Function:  Spmv
+ * Purpose:   y = A*x, overlapping the halo exchange with the product of
+ *            the diagonal part
+ * In args:   local_x:  local block of x
+ * Out args:  local_y:  local block of y (not local_x)
+ * In/out:    A:        the matrix (its buffers are used)
+ *
+ * Note:
+ *    The overlap only materializes if the MPI library progresses the
+ *    messages while the process computes; messages small enough for
+ *    the eager protocol always do.
+ */
+void Spmv(
+      Csr_matrix*   A          /* in/out */,
+      const double  local_x[]  /* in     */,
+      double        local_y[]  /* out    */) {
+   Halo_start(A, local_x);
+   Multiply_diag(A, local_x, local_y);
+   MPI_Waitall(A->n_recv + A->n_send, A->reqs, MPI_STATUSES_IGNORE);
+   Multiply_offd(A, local_y);
+}  /* Spmv */
+
+/*---------------------------------------------------------------------
+ * Function:  Spmv_blocking
+ * Purpose:   y = A*x, completing the halo exchange before computing
+ * In args:   local_x:  local block of x
+ * Out args:  local_y:  local block of y (not local_x)
+ * In/out:    A:        the matrix (its buffers are used)
+ */
+void Spmv_blocking(
+      Csr_matrix*   A          /* in/out */,
+      const double  local_x[]  /* in     */,
+      double        local_y[]  /* out    */) {
+   Halo_start(A, local_x);
+   MPI_Waitall(A->n_recv + A->n_send, A->reqs, MPI_STATUSES_IGNORE);
+   Multiply_diag(A, local_x, local_y);
+   Multiply_offd(A, local_y);
+}  /* Spmv_blocking */
+
+/*---------------------------------------------------------------------
+ * Function:  Halo_start
+ * Purpose:   Post the receives of the ghosts and send our elements to
+ *            the neighbors that need them
+ * In args:   local_x:  local block of x
+ * In/out:    A:        the matrix; A->reqs holds the pending requests
+ */
+static void Halo_start(
+      Csr_matrix*   A          /* in/out */,
+      const double  local_x[]  /* in     */) {
+   int r, k;
+
+   for (r = 0; r < A->n_recv; r++)
+      MPI_Irecv(A->ghost + A->recv_ptr[r], A->recv_ptr[r+1] - A->recv_ptr[r],
+            MPI_DOUBLE, A->recv_rank[r], SPMV_TAG, A->comm, &A->reqs[r]);
+   for (k = 0; k < A->send_ptr[A->n_send]; k++)
+      A->send_buf[k] = local_x[A->send_idx[k]];
+   for (r = 0; r < A->n_send; r++)
+      MPI_Isend(A->send_buf + A->send_ptr[r], A->send_ptr[r+1] - A->send_ptr[r],
+            MPI_DOUBLE, A->send_rank[r], SPMV_TAG, A->comm,
+            &A->reqs[A->n_recv + r]);
+}  /* Halo_start */
+
+/*---------------------------------------------------------------------
+ * Function:  Multiply_diag
+ * Purpose:   y = (diagonal part of A)*x
+ * In args:   A:        the matrix
+ *            local_x:  local block of x
+ * Out args:  local_y:  local block of y
+ */
+static void Multiply_diag(
+      const Csr_matrix*  A          /* in  */,
+      const double       local_x[]  /* in  */,
+      double             local_y[]  /* out */) {
+   const int *ptr = A->diag_ptr, *col = A->diag_col;
+   const double* val = A->diag_val;
+   double sum;
+   int i, k;
+
+   for (i = 0; i < A->local_n; i++) {
+      sum = 0.0;
+      for (k = ptr[i]; k < ptr[i+1]; k++)
+         sum += val[k]*local_x[col[k]];
+      local_y[i] = sum;
+   }
+}  /* Multiply_diag */
+
+/*---------------------------------------------------------------------
+ * Function:  Multiply_offd
+ * Purpose:   y += (off-diagonal part of A)*ghosts
+ * In args:   A:        the matrix, with the ghosts received
+ * In/out:    local_y:  local block of y
+ */
+static void Multiply_offd(
+      const Csr_matrix*  A          /* in     */,
+      double             local_y[]  /* in/out */) {
+   const int *ptr = A->offd_ptr, *col = A->offd_col;
+   const double *val = A->offd_val, *ghost = A->ghost;
+   double sum;
+   int r, k;
+
+   for (r = 0; r < A->offd_rows; r++) {
+      sum = 0.0;
+      for (k = ptr[r]; k < ptr[r+1]; k++)
+         sum += val[k]*ghost[col[k]];
+      local_y[A->offd_row[r]] += sum;
+   }
+}  /* Multiply_offd */
+
+/*---------------------------------------------------------------------
+ * Function:  Compare_ints
+ * Purpose:   Order ints for qsort and bsearch
+ */
+static int Compare_ints(const void* a, const void* b) {
+   int x = *(const int*) a, y = *(const int*) b;
+
+   return (x > y) - (x < y);
+}  /* Compare_ints */
@@ -0,0 +1,73 @@
+/* File:     mpi_spmv.h
+ *
+ * Purpose:  Distributed sparse matrix-vector product y = A*x.  The rows
+ *           of A, like the elements of x and y, have the block
+ *           distribution of mpi_vector_utils.h: process q owns rows and
+ *           elements q*local_n, ..., (q+1)*local_n - 1.
+ *
+ * Compile:  Link mpi_spmv.c and vector_ops.c into the program (and -lm).
+ *
+ * Notes:
+ * 1.  A matrix is built in two steps.  A Csr_block holds the local rows
+ *     in CSR form with global column indices (as a generator or a file
+ *     reader produces them); Csr_matrix_create turns it into a
+ *     Csr_matrix, which splits the rows into a diagonal part, whose
+ *     columns are local elements of x, and an off-diagonal part, whose
+ *     columns are "ghost" elements owned by other processes.
+ * 2.  Csr_matrix_create finds the ghosts and tells their owners which
+ *     of their elements to send, so the halo exchange of each product
+ *     is a set of point-to-point messages between neighbors only.
+ * 3.  Spmv posts the exchange, multiplies the diagonal part while the
+ *     messages travel and adds the off-diagonal part when they have
+ *     arrived; Spmv_blocking completes the exchange first.
+ */
+#ifndef MPI_SPMV_H
+#define MPI_SPMV_H
+
+#include <mpi.h>
+
+typedef struct {
+   int      n;          /* order of the matrix                        */
+   int      local_n;    /* rows owned                                 */
+   int*     ptr;        /* local_n+1 row starts                       */
+   int*     col;        /* global column indices                      */
+   double*  val;
+} Csr_block;
+
+typedef struct {
+   int      n, local_n;
+   int*     diag_ptr;      /* local_n+1 row starts                    */
+   int*     diag_col;      /* local indices into x                    */
+   double*  diag_val;
+   int      offd_rows;     /* rows with ghost columns                 */
+   int*     offd_row;      /* their local row numbers                 */
+   int*     offd_ptr;      /* offd_rows+1 row starts                  */
+   int*     offd_col;      /* indices into ghost                      */
+   double*  offd_val;
+   int      n_ghost;
+   int      n_recv, n_send;         /* neighbors                      */
+   int*     recv_rank;
+   int*     recv_ptr;      /* n_recv+1 starts in ghost                */
+   int*     send_rank;
+   int*     send_ptr;      /* n_send+1 starts in send_idx             */
+   int*     send_idx;      /* local elements of x to send             */
+   double*  ghost;
+   double*  send_buf;
+   MPI_Request* reqs;
+   MPI_Comm comm;
+} Csr_matrix;
+
+int Csr_block_alloc(Csr_block* block, int n, int local_n, int nnz);
+void Csr_block_free(Csr_block* block);
+int Csr_laplacian_2d(Csr_block* block, int g, int my_rank, int comm_sz);
+int Csr_random(Csr_block* block, int n, int per_row, int my_rank,
+      int comm_sz);
+
+int Csr_matrix_create(const Csr_block* block, Csr_matrix* A,
+      MPI_Comm comm);
+void Csr_matrix_free(Csr_matrix* A);
+void Spmv(Csr_matrix* A, const double local_x[], double local_y[]);
+void Spmv_blocking(Csr_matrix* A, const double local_x[],
+      double local_y[]);
+
+#endif /* MPI_SPMV_H */
@@ -0,0 +1,197 @@
+/* File:     mpi_spmv_bench.c
+ *
+ * Purpose:  Check the distributed sparse matrix-vector product of
+ *           mpi_spmv.h and compare the overlapped halo exchange with the
+ *           blocking one.
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_spmv_bench \
+ *              mpi_spmv_bench.c mpi_spmv.c mpi_vector_utils.c vector_ops.c -lm
+ * Run:      mpiexec -n <comm_sz> ./mpi_spmv_bench <matrix> <iterations>
+ *
+ * Input:    The matrix, one of
+ *              laplace:<g>              5-point Laplacian on a g x g grid
+ *              random:<n>:<per row>     random matrix of order n with
+ *                                       about per row nonzeros per row
+ *           and the number of products timed
+ * Output:   The size of the matrix and of the halo, then for each
+ *           version the time per product and the GFLOP/s (2 flops per
+ *           nonzero)
+ *
+ * Notes:
+ * 1.  The order of the matrix should be evenly divisible by comm_sz
+ * 2.  Before timing, y = A*x is checked against a product computed with
+ *     all of x gathered on every process.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+#include "mpi_spmv.h"
+
+int Parse_matrix(char spec[], int my_rank, int comm_sz, Csr_block* block);
+void Check_product(const Csr_block* block, double local_x[],
+      double local_y[], MPI_Comm comm);
+
+int main(int argc, char* argv[]) {
+    int iters, it, ok;
+    int comm_sz, my_rank;
+    double *local_x, *local_y;
+    double start, local_t[2], t[2];
+    long long local_size[3], size[3];
+    int local_neighbors, neighbors;
+    Csr_block block;
+    Csr_matrix A;
+    MPI_Comm comm;
+
+    // Initialize MPI
+    MPI_Init(&argc, &argv);
+    comm = MPI_COMM_WORLD;
+    MPI_Comm_size(comm, &comm_sz);
+    MPI_Comm_rank(comm, &my_rank);
+
+    if (argc != 3) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Usage: %s <matrix> <iterations>\n", argv[0]);
+            fprintf(stderr, "       matrices: laplace:<g>, random:<n>:<per row>\n");
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    iters = atoi(argv[2]);
+    if (iters <= 0) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Iterations should be a positive integer\n");
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+    ok = Parse_matrix(argv[1], my_rank, comm_sz, &block);
+    Check_for_error(ok, "main",
+          "Unknown matrix, order not divisible by the number of processes, or can't allocate it",
+          comm);
+
+    Check_for_error(Csr_matrix_create(&block, &A, comm), "main",
+          "Can't build the distributed matrix", comm);
+    Allocate_vectors(&local_x, &local_y, NULL, A.local_n, comm);
+    Generate_vector(local_x, A.local_n, my_rank, 1);
+    Check_product(&block, local_x, local_y, comm);
+
+    MPI_Barrier(comm);
+    start = MPI_Wtime();
+    for (it = 0; it < iters; it++)
+        Spmv_blocking(&A, local_x, local_y);
+    local_t[0] = (MPI_Wtime() - start)/iters;
+
+    MPI_Barrier(comm);
+    start = MPI_Wtime();
+    for (it = 0; it < iters; it++)
+        Spmv(&A, local_x, local_y);
+    local_t[1] = (MPI_Wtime() - start)/iters;
+
+    local_size[0] = block.ptr[block.local_n];
+    local_size[1] = A.n_ghost;
+    local_size[2] = A.offd_rows;
+    local_neighbors = A.n_recv;
+    MPI_Reduce(local_size, size, 3, MPI_LONG_LONG, MPI_SUM, 0, comm);
+    MPI_Reduce(&local_neighbors, &neighbors, 1, MPI_INT, MPI_MAX, 0, comm);
+    MPI_Reduce(local_t, t, 2, MPI_DOUBLE, MPI_MAX, 0, comm);
+    if (my_rank == 0) {
+        printf("%s: order %d, %lld nonzeros\n", argv[1], A.n, size[0]);
+        printf("halo: %lld ghosts, %lld rows need them, at most %d neighbors per process\n",
+              size[1], size[2], neighbors);
+        printf("%-10s %14s %10s\n", "version", "s/product", "GFLOP/s");
+        printf("%-10s %14.6e %10.3f\n", "blocking", t[0], 2.0*size[0]/t[0]/1.0e9);
+        printf("%-10s %14.6e %10.3f\n", "overlap", t[1], 2.0*size[0]/t[1]/1.0e9);
+        printf("speedup %.2f\n", t[0]/t[1]);
+    }
+
+    Csr_matrix_free(&A);
+    Csr_block_free(&block);
+    free(local_x);
+    free(local_y);
+
+    MPI_Finalize();
+    return 0;
+}  /* main */
+
+/*---------------------------------------------------------------------
+ * Function:  Parse_matrix
+ * Purpose:   Generate the local rows of the matrix named on the command
+ *            line
+ * In args:   spec:     laplace:<g> or random:<n>:<per row>
+ *            my_rank:  rank of the calling process
+ *            comm_sz:  number of processes
+ * Out args:  block:    the local rows
+ * Ret val:   1 on success, 0 if spec is invalid or the allocation fails
+ */
+int Parse_matrix(
+      char        spec[]   /* in  */,
+      int         my_rank  /* in  */,
+      int         comm_sz  /* in  */,
+      Csr_block*  block    /* out */) {
+   int g, n, per_row;
+
+   if (sscanf(spec, "laplace:%d", &g) == 1) {
+      if (g <= 0 || (g*g) % comm_sz != 0) return 0;
+      return Csr_laplacian_2d(block, g, my_rank, comm_sz);
+   }
+   if (sscanf(spec, "random:%d:%d", &n, &per_row) == 2) {
+      if (n <= 0 || n % comm_sz != 0 || per_row <= 0) return 0;
+      return Csr_random(block, n, per_row, my_rank, comm_sz);
+   }
+   return 0;
+}  /* Parse_matrix */
+
+/*---------------------------------------------------------------------
+ * Function:  Check_product
+ * Purpose:   Compare y = A*x from Spmv and Spmv_blocking with the
+ *            product of the local rows and the whole of x
+ * In args:   block:    the local rows (global columns)
+ *            local_x:  local block of x
+ *            comm:     communicator containing the vectors
+ * Out args:  local_y:  scratch
+ *
+ * Errors:    If an element differs by more than a relative 1e-12, the
+ *            program terminates
+ */
+void Check_product(
+      const Csr_block*  block      /* in  */,
+      double            local_x[]  /* in  */,
+      double            local_y[]  /* out */,
+      MPI_Comm          comm       /* in  */) {
+   double *x, *y_ref, scale;
+   int i, k, ok, version;
+   Csr_matrix A;
+
+   x = Vec_alloc(block->n, sizeof(double));
+   y_ref = Vec_alloc(block->local_n, sizeof(double));
+   ok = x != NULL && y_ref != NULL;
+   Check_for_error(ok, "Check_product", "Can't allocate check vectors", comm);
+   MPI_Allgather(local_x, block->local_n, MPI_DOUBLE, x, block->local_n,
+         MPI_DOUBLE, comm);
+   for (i = 0; i < block->local_n; i++) {
+      y_ref[i] = 0.0;
+      for (k = block->ptr[i]; k < block->ptr[i+1]; k++)
+         y_ref[i] += block->val[k]*x[block->col[k]];
+   }
+
+   Check_for_error(Csr_matrix_create(block, &A, comm), "Check_product",
+         "Can't build the distributed matrix", comm);
+   for (version = 0; version < 2; version++) {
+      if (version == 0) Spmv(&A, local_x, local_y);
+      else Spmv_blocking(&A, local_x, local_y);
+      for (i = 0; i < block->local_n; i++) {
+         scale = 0.0;
+         for (k = block->ptr[i]; k < block->ptr[i+1]; k++)
+            scale += fabs(block->val[k]*x[block->col[k]]);
+         if (fabs(local_y[i] - y_ref[i]) > 1.0e-12*scale) ok = 0;
+      }
+   }
+   Csr_matrix_free(&A);
+   free(x);
+   free(y_ref);
+   Check_for_error(ok, "Check_product", "Distributed product is wrong", comm);
+}  /* Check_product */
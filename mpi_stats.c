@@ -0,0 +1,305 @@
+/* File:     mpi_stats.c
+ *
+ * Purpose:  Fused single-pass statistics of block-distributed vectors
+ *           (see mpi_stats.h)
+ */
+#include <stdlib.h>
+#include <stddef.h>
+#include <math.h>
+#include <mpi.h>
+#include "vector_ops.h"
+#include "mpi_stats.h"
+
+#define STATS_ACC 8   /* independent partial results per tile */
+
+static MPI_Datatype stats_type = MPI_DATATYPE_NULL;
+static long long type_nbins = -1;   /* bins stats_type was built for */
+static MPI_Op stats_op = MPI_OP_NULL;
+
+static size_t Stats_size(long long nbins);
+static void Stats_setup(long long nbins);
+static int Stats_cleanup(MPI_Comm comm, int keyval, void* attr,
+      void* extra);
+static void Stats_op(void* in, void* inout, int* len, MPI_Datatype* type);
+
+/*---------------------------------------------------------------------
+ * Function:  Stats_alloc
+ * Purpose:   Allocate an empty profile with nbins histogram bins
+ * In args:   nbins:   number of bins (>= 1)
+ *            lo, hi:  histogram range [lo, hi)
+ * Ret val:   The profile, or NULL if the allocation fails
+ */
+Vec_stats* Stats_alloc(
+      int     nbins  /* in */,
+      double  lo     /* in */,
+      double  hi     /* in */) {
+   Vec_stats* s = malloc(Stats_size(nbins));
+
+   if (s == NULL) return NULL;
+   s->nbins = nbins;
+   s->lo = lo;
+   s->hi = hi;
+   Stats_reset(s);
+   return s;
+}  /* Stats_alloc */
+
+/*---------------------------------------------------------------------
+ * Function:  Stats_reset
+ * Purpose:   Empty a profile, keeping its histogram layout
+ * In/out:    s:  the profile
+ */
+void Stats_reset(Vec_stats* s /* in/out */) {
+   long long b;
+
+   s->min = INFINITY;
+   s->max = -INFINITY;
+   s->mean = s->m2 = 0.0;
+   s->argmin = s->argmax = -1;
+   s->count = s->below = s->above = 0;
+   for (b = 0; b < s->nbins; b++)
+      s->hist[b] = 0;
+}  /* Stats_reset */
+
+/*---------------------------------------------------------------------
+ * Function:  Stats_accumulate
+ * Purpose:   Add the elements of x to a profile
+ * In args:   x:            the elements
+ *            n:            number of elements
+ *            first_index:  global index of x[0]
+ * In/out:    s:            the profile
+ *
+ * Note:
+ *    The elements are read from memory once.  Each tile of VEC_TILE
+ *    elements is reduced (sum, min, max) with vectorizable loops, then
+ *    re-read from cache for its m2 and histogram, and merged into s.
+ */
+void Stats_accumulate(
+      Vec_stats*    s            /* in/out */,
+      const double  x[]          /* in     */,
+      int           n            /* in     */,
+      long long     first_index  /* in     */) {
+   double acc[STATS_ACC], mn[STATS_ACC], mx[STATS_ACC];
+   double scale = s->nbins/(s->hi - s->lo);
+   Vec_stats tile;
+   double v, d;
+   long long b;
+   int start, len, i, j;
+
+   tile.nbins = 0;
+   for (start = 0; start < n; start += VEC_TILE) {
+      const double* t = x + start;
+      len = (n - start < VEC_TILE) ? n - start : VEC_TILE;
+
+      for (j = 0; j < STATS_ACC; j++) {
+         acc[j] = 0.0;
+         mn[j] = INFINITY;
+         mx[j] = -INFINITY;
+      }
+      for (i = 0; i + STATS_ACC <= len; i += STATS_ACC)
+         for (j = 0; j < STATS_ACC; j++) {
+            v = t[i+j];
+            acc[j] += v;
+            mn[j] = (v < mn[j]) ? v : mn[j];
+            mx[j] = (v > mx[j]) ? v : mx[j];
+         }
+      for (; i < len; i++) {
+         v = t[i];
+         acc[0] += v;
+         mn[0] = (v < mn[0]) ? v : mn[0];
+         mx[0] = (v > mx[0]) ? v : mx[0];
+      }
+      tile.mean = 0.0;
+      tile.min = mn[0];
+      tile.max = mx[0];
+      for (j = 0; j < STATS_ACC; j++) {
+         tile.mean += acc[j];
+         tile.min = (mn[j] < tile.min) ? mn[j] : tile.min;
+         tile.max = (mx[j] > tile.max) ? mx[j] : tile.max;
+      }
+      tile.count = len;
+      tile.mean /= len;
+
+      /* Second look at the tile, from cache */
+      tile.m2 = 0.0;
+      for (i = 0; i < len; i++) {
+         d = t[i] - tile.mean;
+         tile.m2 += d*d;
+      }
+      for (i = 0; i < len; i++) {
+         v = t[i];
+         if (!(v >= s->lo)) {
+            s->below++;
+         } else if (v >= s->hi) {
+            s->above++;
+         } else {
+            b = (long long)((v - s->lo)*scale);
+            s->hist[b < s->nbins ? b : s->nbins - 1]++;
+         }
+      }
+
+      /* Positions of the extremes, only if they beat s.  An all-NaN
+         tile has no match and keeps argmin and argmax at -1. */
+      tile.argmin = tile.argmax = -1;
+      if (s->argmin < 0 || tile.min < s->min) {
+         for (i = 0; i < len && t[i] != tile.min; i++) ;
+         if (i < len) tile.argmin = first_index + start + i;
+      }
+      if (s->argmax < 0 || tile.max > s->max) {
+         for (i = 0; i < len && t[i] != tile.max; i++) ;
+         if (i < len) tile.argmax = first_index + start + i;
+      }
+      if (tile.argmin < 0) tile.min = INFINITY;
+      if (tile.argmax < 0) tile.max = -INFINITY;
+      Stats_merge(s, &tile);
+   }
+}  /* Stats_accumulate */
+
+/*---------------------------------------------------------------------
+ * Function:  Stats_merge
+ * Purpose:   Combine the profile t into s.  Ties between extremes go to
+ *            the smaller global index.  t's histogram is added only if
+ *            t has one (t->nbins > 0).
+ * In/out:    s:  the profile to update
+ * In arg:    t:  the other profile
+ */
+void Stats_merge(
+      Vec_stats*        s  /* in/out */,
+      const Vec_stats*  t  /* in     */) {
+   long long n, b;
+   double d;
+
+   if (t->argmin >= 0 && (s->argmin < 0 || t->min < s->min ||
+         (t->min == s->min && t->argmin < s->argmin))) {
+      s->min = t->min;
+      s->argmin = t->argmin;
+   }
+   if (t->argmax >= 0 && (s->argmax < 0 || t->max > s->max ||
+         (t->max == s->max && t->argmax < s->argmax))) {
+      s->max = t->max;
+      s->argmax = t->argmax;
+   }
+
+   n = s->count + t->count;
+   if (t->count > 0) {
+      d = t->mean - s->mean;
+      s->mean += d*t->count/n;
+      s->m2 += t->m2 + d*d*((double)s->count*t->count/n);
+      s->count = n;
+   }
+
+   if (t->nbins > 0) {
+      s->below += t->below;
+      s->above += t->above;
+      for (b = 0; b < s->nbins; b++)
+         s->hist[b] += t->hist[b];
+   }
+}  /* Stats_merge */
+
+/*---------------------------------------------------------------------
+ * Function:  Parallel_stats
+ * Purpose:   Profile of a distributed vector
+ * In args:   local_x:  local block of the vector
+ *            local_n:  size of the local block (the same on every
+ *                      process)
+ *            comm:     communicator containing the vector
+ * In/out:    s:        on input, an empty profile whose nbins, lo and
+ *                      hi are the same on every process.  On output,
+ *                      the profile of the whole vector on every
+ *                      process.
+ *
+ * Note:
+ *    The whole profile travels as one element of a derived datatype
+ *    (header plus bins) combined by a user-defined operation, so the
+ *    reduction is a single MPI_Allreduce.  Both are created on first
+ *    use and kept; the datatype is rebuilt only when nbins changes.
+ */
+void Parallel_stats(
+      Vec_stats*    s          /* in/out */,
+      const double  local_x[]  /* in     */,
+      int           local_n    /* in     */,
+      MPI_Comm      comm       /* in     */) {
+   int my_rank;
+
+   MPI_Comm_rank(comm, &my_rank);
+   Stats_accumulate(s, local_x, local_n, (long long)my_rank*local_n);
+
+   Stats_setup(s->nbins);
+   MPI_Allreduce(MPI_IN_PLACE, s, 1, stats_type, stats_op, comm);
+}  /* Parallel_stats */
+
+/*---------------------------------------------------------------------
+ * Function:  Stats_setup
+ * Purpose:   Create the Stats_op operation once and the profile
+ *            datatype for nbins bins, unless the current one already
+ *            has them, and arrange for MPI_Finalize to free both
+ *
+ * Note:
+ *    Freed through an attribute of MPI_COMM_SELF, as in mpi_blas1.c.
+ *    Not thread safe.
+ */
+static void Stats_setup(long long nbins) {
+   int keyval;
+   int blocklens[2];
+   MPI_Aint displs[2];
+   MPI_Datatype types[2] = {MPI_DOUBLE, MPI_LONG_LONG};
+   MPI_Datatype tmp_type;
+
+   if (stats_op == MPI_OP_NULL) {
+      MPI_Op_create(Stats_op, 1, &stats_op);
+      MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, Stats_cleanup, &keyval,
+            NULL);
+      MPI_Comm_set_attr(MPI_COMM_SELF, keyval, NULL);
+      MPI_Comm_free_keyval(&keyval);
+   }
+   if (nbins == type_nbins) return;
+
+   if (stats_type != MPI_DATATYPE_NULL) MPI_Type_free(&stats_type);
+   blocklens[0] = offsetof(Vec_stats, argmin)/sizeof(double);
+   blocklens[1] = (Stats_size(nbins) - offsetof(Vec_stats, argmin))/
+         sizeof(long long);
+   displs[0] = 0;
+   displs[1] = offsetof(Vec_stats, argmin);
+   MPI_Type_create_struct(2, blocklens, displs, types, &tmp_type);
+   MPI_Type_create_resized(tmp_type, 0, Stats_size(nbins), &stats_type);
+   MPI_Type_commit(&stats_type);
+   MPI_Type_free(&tmp_type);
+   type_nbins = nbins;
+}  /* Stats_setup */
+
+/*---------------------------------------------------------------------
+ * Function:  Stats_cleanup
+ * Purpose:   Attribute delete callback freeing what Stats_setup made
+ */
+static int Stats_cleanup(MPI_Comm comm, int keyval, void* attr,
+      void* extra) {
+   MPI_Op_free(&stats_op);
+   if (stats_type != MPI_DATATYPE_NULL) MPI_Type_free(&stats_type);
+   type_nbins = -1;
+   return MPI_SUCCESS;
+}  /* Stats_cleanup */
+
+/*---------------------------------------------------------------------
+ * Function:  Stats_size
+ * Purpose:   Size in bytes of a profile with nbins bins
+ */
+static size_t Stats_size(long long nbins) {
+   return sizeof(Vec_stats) + nbins*sizeof(long long);
+}  /* Stats_size */
+
+/*---------------------------------------------------------------------
+ * Function:  Stats_op
+ * Purpose:   MPI user operation merging profiles
+ */
+static void Stats_op(void* in, void* inout, int* len, MPI_Datatype* type) {
+   char* a = in;
+   char* b = inout;
+   size_t size;
+   int i;
+
+   for (i = 0; i < *len; i++) {
+      size = Stats_size(((Vec_stats*)b)->nbins);
+      Stats_merge((Vec_stats*)b, (Vec_stats*)a);
+      a += size;
+      b += size;
+   }
+}  /* Stats_op */
@@ -0,0 +1,48 @@
+/* File:     mpi_stats.h
+ *
+ * Purpose:  Data profile of a block-distributed double vector: min,
+ *           max, their first global indices, mean, variance and a
+ *           fixed-bin histogram, computed in one pass over the local
+ *           block and combined with one MPI_Allreduce.
+ *
+ * Compile:  Link mpi_stats.c into the program (and -lm).
+ *
+ * Notes:
+ * 1.  The mean and variance use Welford's method with the parallel
+ *     merge of Chan et al.: each cache-resident tile gets its own
+ *     mean and sum of squared deviations (m2), which are then merged
+ *     into the running values, and the per-process results are merged
+ *     the same way by the reduction.
+ * 2.  The histogram has nbins equal bins over [lo, hi).  Values
+ *     outside the range are counted in below and above instead.
+ * 3.  NaNs are counted in count and below, and make mean and m2 NaN.
+ *     min and max skip them; argmin and argmax stay -1 only if every
+ *     element is NaN.
+ * 4.  A Vec_stats is variable-sized (the bins follow the header); get
+ *     one from Stats_alloc and release it with free.
+ */
+#ifndef MPI_STATS_H
+#define MPI_STATS_H
+
+#include <mpi.h>
+
+typedef struct {
+   double     min, max;
+   double     mean, m2;
+   double     lo, hi;          /* histogram range                   */
+   long long  argmin, argmax;  /* global index, -1 if all NaN      */
+   long long  count;
+   long long  below, above;    /* values outside [lo, hi)           */
+   long long  nbins;
+   long long  hist[];
+} Vec_stats;
+
+Vec_stats* Stats_alloc(int nbins, double lo, double hi);
+void Stats_reset(Vec_stats* s);
+void Stats_accumulate(Vec_stats* s, const double x[], int n,
+      long long first_index);
+void Stats_merge(Vec_stats* s, const Vec_stats* t);
+void Parallel_stats(Vec_stats* s, const double local_x[], int local_n,
+      MPI_Comm comm);
+
+#endif /* MPI_STATS_H */
@@ -0,0 +1,171 @@
+/* File:     mpi_stencil.c
+ *
+ * Purpose:  1D stencils and convolutions with halo exchange (see
+ *           mpi_stencil.h)
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include "vector_ops.h"
+#include "mpi_stencil.h"
+
+#define CONV_TILE  512    /* outputs per tile: 4 KB of y                */
+#define CONV_TAG   0x3c
+
+static void Halo_start(const double local_x[], int local_n, int left,
+      int right, double lbuf[], double rbuf[], MPI_Request reqs[],
+      MPI_Comm comm);
+
+/*---------------------------------------------------------------------
+ * Function:  Conv1d_local
+ * Purpose:   y[i] = w[0]*x[i] + w[1]*x[i+1] + ... + w[width-1]*x[i+width-1]
+ * In args:   x:      input of order n + width - 1
+ *            n:      number of outputs
+ *            w:      the taps
+ *            width:  their number
+ * Out args:  y:      output of order n (not overlapping x)
+ *
+ * Note:
+ *    Each tile of y is loaded and stored once per four taps, and the
+ *    window of x feeding it is read at four unaligned offsets.
+ *    Leftover taps use Axpy.
+ */
+void Conv1d_local(
+      const double  x[]    /* in  */,
+      int           n      /* in  */,
+      const double  w[]    /* in  */,
+      int           width  /* in  */,
+      double        y[]    /* out */) {
+   const double *xt;
+   double *yt, w0, w1, w2, w3;
+   int i, j, t, nt;
+
+   for (t = 0; t < n; t += CONV_TILE) {
+      nt = n - t < CONV_TILE ? n - t : CONV_TILE;
+      xt = x + t;
+      yt = y + t;
+      memset(yt, 0, nt*sizeof(double));
+      for (j = 0; j + 4 <= width; j += 4) {
+         w0 = w[j];
+         w1 = w[j+1];
+         w2 = w[j+2];
+         w3 = w[j+3];
+         VEC_IVDEP
+         for (i = 0; i < nt; i++)
+            yt[i] += w0*xt[i+j] + w1*xt[i+j+1] + w2*xt[i+j+2]
+                  + w3*xt[i+j+3];
+      }
+      for (; j < width; j++)
+         Axpy(xt + j, yt, nt, w[j]);
+   }
+}  /* Conv1d_local */
+
+/*---------------------------------------------------------------------
+ * Function:  Conv1d
+ * Purpose:   Apply a kernel to a distributed vector, overlapping the
+ *            halo exchange with the interior outputs
+ * In args:   local_x:  local block of x
+ *            local_n:  its order, at least width - 1
+ *            w:        the taps
+ *            width:    their number
+ *            center:   index of the tap applied to x[i], 0 <= center < width
+ *            comm:     communicator containing the vectors
+ * Out args:  local_y:  local block of y (not local_x)
+ *            work:     room for 3*(width-1) doubles
+ */
+void Conv1d(
+      const double  local_x[]  /* in  */,
+      int           local_n    /* in  */,
+      const double  w[]        /* in  */,
+      int           width      /* in  */,
+      int           center     /* in  */,
+      double        local_y[]  /* out */,
+      double        work[]     /* out */,
+      MPI_Comm      comm       /* in  */) {
+   int left = center, right = width - 1 - center;
+   double *lbuf = work, *rbuf = work + 2*left + right;
+   MPI_Request reqs[4];
+
+   Halo_start(local_x, local_n, left, right, lbuf, rbuf, reqs, comm);
+   Conv1d_local(local_x, local_n - left - right, w, width, local_y + left);
+   MPI_Waitall(4, reqs, MPI_STATUSES_IGNORE);
+   Conv1d_local(lbuf, left, w, width, local_y);
+   Conv1d_local(rbuf, right, w, width, local_y + local_n - right);
+}  /* Conv1d */
+
+/*---------------------------------------------------------------------
+ * Function:  Conv1d_blocking
+ * Purpose:   Apply a kernel to a distributed vector, completing the halo
+ *            exchange before computing
+ * In args:   local_x, local_n, w, width, center, comm:  as in Conv1d
+ * Out args:  local_y, work:  as in Conv1d
+ */
+void Conv1d_blocking(
+      const double  local_x[]  /* in  */,
+      int           local_n    /* in  */,
+      const double  w[]        /* in  */,
+      int           width      /* in  */,
+      int           center     /* in  */,
+      double        local_y[]  /* out */,
+      double        work[]     /* out */,
+      MPI_Comm      comm       /* in  */) {
+   int left = center, right = width - 1 - center;
+   double *lbuf = work, *rbuf = work + 2*left + right;
+   MPI_Request reqs[4];
+
+   Halo_start(local_x, local_n, left, right, lbuf, rbuf, reqs, comm);
+   MPI_Waitall(4, reqs, MPI_STATUSES_IGNORE);
+   Conv1d_local(lbuf, left, w, width, local_y);
+   Conv1d_local(local_x, local_n - left - right, w, width, local_y + left);
+   Conv1d_local(rbuf, right, w, width, local_y + local_n - right);
+}  /* Conv1d_blocking */
+
+/*---------------------------------------------------------------------
+ * Function:  Halo_start
+ * Purpose:   Post the exchange of the halos with rank-1 and rank+1 and
+ *            build the inputs of the edge outputs
+ * In args:   local_x:  local block of x
+ *            local_n:  its order
+ *            left:     elements needed from rank-1 (the center)
+ *            right:    elements needed from rank+1
+ *            comm:     communicator containing the vectors
+ * Out args:  lbuf:     the left halo followed by the first left+right
+ *                      local elements (complete once reqs are)
+ *            rbuf:     the last left+right local elements followed by
+ *                      the right halo (complete once reqs are)
+ *            reqs:     the 4 pending requests
+ *
+ * Note:
+ *    The first and last processes have no neighbor on one side: that
+ *    halo is zero and its messages go to MPI_PROC_NULL.
+ */
+static void Halo_start(
+      const double  local_x[]  /* in  */,
+      int           local_n    /* in  */,
+      int           left       /* in  */,
+      int           right      /* in  */,
+      double        lbuf[]     /* out */,
+      double        rbuf[]     /* out */,
+      MPI_Request   reqs[]     /* out */,
+      MPI_Comm      comm       /* in  */) {
+   int comm_sz, my_rank, prev, next;
+
+   MPI_Comm_size(comm, &comm_sz);
+   MPI_Comm_rank(comm, &my_rank);
+   prev = my_rank > 0 ? my_rank - 1 : MPI_PROC_NULL;
+   next = my_rank < comm_sz - 1 ? my_rank + 1 : MPI_PROC_NULL;
+
+   MPI_Irecv(lbuf, left, MPI_DOUBLE, prev, CONV_TAG, comm, &reqs[0]);
+   MPI_Irecv(rbuf + left + right, right, MPI_DOUBLE, next, CONV_TAG, comm,
+         &reqs[1]);
+   MPI_Isend(local_x, right, MPI_DOUBLE, prev, CONV_TAG, comm, &reqs[2]);
+   MPI_Isend(local_x + local_n - left, left, MPI_DOUBLE, next, CONV_TAG,
+         comm, &reqs[3]);
+
+   if (prev == MPI_PROC_NULL) memset(lbuf, 0, left*sizeof(double));
+   if (next == MPI_PROC_NULL)
+      memset(rbuf + left + right, 0, right*sizeof(double));
+   memcpy(lbuf + left, local_x, (left + right)*sizeof(double));
+   memcpy(rbuf, local_x + local_n - left - right,
+         (left + right)*sizeof(double));
+}  /* Halo_start */
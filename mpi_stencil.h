@@ -0,0 +1,43 @@
+/* File:     mpi_stencil.h
+ *
+ * Purpose:  Distributed 1D stencils and convolutions (FIR filters) of
+ *           block-distributed vectors.  With a kernel w of width
+ *           taps and center c,
+ *
+ *              y[i] = w[0]*x[i-c] + w[1]*x[i-c+1] + ... + w[width-1]*x[i-c+width-1]
+ *
+ *           where the elements of x outside the vector are zero.
+ *
+ * Compile:  Link mpi_stencil.c and vector_ops.c into the program (and -lm).
+ *
+ * Notes:
+ * 1.  A centered stencil of radius r has width = 2*r + 1 and c = r.  A
+ *     causal filter y[i] = h[0]*x[i] + h[1]*x[i-1] + ... takes the taps
+ *     of h in reverse order and c = width - 1.
+ * 2.  Each process needs c elements of its left neighbor and width-1-c
+ *     of its right neighbor (the halos).  Conv1d sends and receives them
+ *     with nonblocking messages to rank-1 and rank+1, computes the
+ *     interior outputs, which only use local elements, while they
+ *     travel, and then the width-1 outputs at the edges of the block;
+ *     Conv1d_blocking completes the exchange first.
+ * 3.  Conv1d_local works on tiles of CONV_TILE outputs, which stay in
+ *     the L1 cache while the input window slides past them four taps
+ *     at a time, so the inner loops are unit-stride and vectorize.
+ * 4.  Every block must have at least width-1 elements.
+ */
+#ifndef MPI_STENCIL_H
+#define MPI_STENCIL_H
+
+#include <mpi.h>
+
+void Conv1d_local(const double x[], int n, const double w[], int width,
+      double y[]);
+
+void Conv1d(const double local_x[], int local_n, const double w[],
+      int width, int center, double local_y[], double work[],
+      MPI_Comm comm);
+void Conv1d_blocking(const double local_x[], int local_n, const double w[],
+      int width, int center, double local_y[], double work[],
+      MPI_Comm comm);
+
+#endif /* MPI_STENCIL_H */
@@ -0,0 +1,219 @@
+/* File:     mpi_stencil_bench.c
+ *
+ * Purpose:  Check and time the 1D convolution of mpi_stencil.h: the
+ *           local kernel against a direct loop, and the distributed
+ *           convolution with and without overlapping the halo exchange.
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_stencil_bench \
+ *              mpi_stencil_bench.c mpi_stencil.c mpi_vector_utils.c vector_ops.c -lm
+ * Run:      mpiexec -n <comm_sz> ./mpi_stencil_bench <order of the vector> <kernel width> <iterations>
+ *
+ * Input:    The order of the vector, n, the number of taps and the
+ *           number of applications timed
+ * Output:   For each method, the time per application, the outputs per
+ *           second and the GFLOP/s
+ *
+ * Notes:
+ * 1.  n should be evenly divisible by comm_sz, with at least width
+ *     elements per process
+ * 2.  The kernel is centered (center = width/2) with random taps.  The
+ *     local rows compute the local_n - width + 1 outputs of each block
+ *     that need no halo; every output costs 2*width flops.
+ * 3.  Before timing, Conv1d is checked against a direct loop over the
+ *     gathered x on process 0, and Conv1d_blocking against Conv1d.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+#include "mpi_stencil.h"
+
+enum { DIRECT, LOCAL, BLOCKING, OVERLAP, NUM_METHODS };
+
+static const char* method_names[NUM_METHODS] = {"direct (local)",
+   "Conv1d_local", "Conv1d_blocking", "Conv1d"};
+
+void Direct(const double x[], int n, const double w[], int width,
+      double y[]);
+void Check_conv(const double local_x[], int local_n, const double w[],
+      int width, double local_y[], double work[], MPI_Comm comm);
+
+int main(int argc, char* argv[]) {
+    int n, local_n, width, iters, it, method, n_int;
+    int comm_sz, my_rank;
+    double *local_x, *local_y, *w, *work, start, local_t[NUM_METHODS],
+           t[NUM_METHODS], points;
+    MPI_Comm comm;
+
+    // Initialize MPI
+    MPI_Init(&argc, &argv);
+    comm = MPI_COMM_WORLD;
+    MPI_Comm_size(comm, &comm_sz);
+    MPI_Comm_rank(comm, &my_rank);
+
+    if (argc != 4) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Usage: %s <order of the vector> <kernel width> <iterations>\n", argv[0]);
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    n = atoi(argv[1]);
+    width = atoi(argv[2]);
+    iters = atoi(argv[3]);
+    if (n <= 0 || n % comm_sz != 0 || width <= 0 || n/comm_sz < width || iters <= 0) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Order of the vector should be a positive integer and evenly divisible by the number of processes, with at least <kernel width> > 0 elements per process, and iterations positive\n");
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    local_n = n/comm_sz;
+    n_int = local_n - width + 1;
+    w = Vec_alloc(width, sizeof(double));
+    work = Vec_alloc(3*width, sizeof(double));
+    Check_for_error(w != NULL && work != NULL, "main", "Can't allocate the kernel",
+          comm);
+    Allocate_vectors(&local_x, &local_y, NULL, local_n, comm);
+    Generate_vector(local_x, local_n, my_rank, 1);
+    if (my_rank == 0) Generate_vector(w, width, my_rank, 2);
+    MPI_Bcast(w, width, MPI_DOUBLE, 0, comm);
+
+    Check_conv(local_x, local_n, w, width, local_y, work, comm);
+
+    for (method = 0; method < NUM_METHODS; method++) {
+        MPI_Barrier(comm);
+        start = MPI_Wtime();
+        for (it = 0; it < iters; it++) {
+            switch (method) {
+                case DIRECT:
+                    Direct(local_x, n_int, w, width, local_y);
+                    break;
+                case LOCAL:
+                    Conv1d_local(local_x, n_int, w, width, local_y);
+                    break;
+                case BLOCKING:
+                    Conv1d_blocking(local_x, local_n, w, width, width/2,
+                          local_y, work, comm);
+                    break;
+                default:
+                    Conv1d(local_x, local_n, w, width, width/2, local_y,
+                          work, comm);
+                    break;
+            }
+        }
+        local_t[method] = (MPI_Wtime() - start)/iters;
+    }
+
+    MPI_Reduce(local_t, t, NUM_METHODS, MPI_DOUBLE, MPI_MAX, 0, comm);
+    if (my_rank == 0) {
+        printf("n = %d, %d taps, %d processes\n", n, width, comm_sz);
+        printf("%-16s %14s %12s %10s\n", "method", "s/apply", "Gpoints/s", "GFLOP/s");
+        for (method = 0; method < NUM_METHODS; method++) {
+            points = method <= LOCAL ? (double) comm_sz*n_int : n;
+            printf("%-16s %14.6e %12.4f %10.3f\n", method_names[method],
+                  t[method], points/t[method]/1.0e9,
+                  2.0*width*points/t[method]/1.0e9);
+        }
+    }
+
+    free(w);
+    free(work);
+    free(local_x);
+    free(local_y);
+
+    MPI_Finalize();
+    return 0;
+}  /* main */
+
+/*---------------------------------------------------------------------
+ * Function:  Direct
+ * Purpose:   The convolution of Conv1d_local, one output at a time
+ * In args:   x:      input of order n + width - 1
+ *            n:      number of outputs
+ *            w:      the taps
+ *            width:  their number
+ * Out args:  y:      output of order n
+ */
+void Direct(
+      const double  x[]    /* in  */,
+      int           n      /* in  */,
+      const double  w[]    /* in  */,
+      int           width  /* in  */,
+      double        y[]    /* out */) {
+   double sum;
+   int i, j;
+
+   for (i = 0; i < n; i++) {
+      sum = 0.0;
+      for (j = 0; j < width; j++)
+         sum += w[j]*x[i+j];
+      y[i] = sum;
+   }
+}  /* Direct */
+
+/*---------------------------------------------------------------------
+ * Function:  Check_conv
+ * Purpose:   Verify Conv1d against a direct loop over the gathered
+ *            vector, and Conv1d_blocking against Conv1d
+ * In args:   local_x:  local block of x
+ *            local_n:  its order
+ *            w:        the taps
+ *            width:    their number
+ *            comm:     communicator containing the vectors
+ * Out args:  local_y:  scratch
+ *            work:     scratch for Conv1d
+ *
+ * Errors:    If an output differs from the direct loop by more than
+ *            1e-12 relative to sum |w[j]*x[i-c+j]|, or the two
+ *            distributed versions differ at all, the program terminates
+ */
+void Check_conv(
+      const double  local_x[]  /* in  */,
+      int           local_n    /* in  */,
+      const double  w[]        /* in  */,
+      int           width      /* in  */,
+      double        local_y[]  /* out */,
+      double        work[]     /* out */,
+      MPI_Comm      comm       /* in  */) {
+   int comm_sz, my_rank, n, c = width/2, i, j, ok = 1;
+   double *x = NULL, *y = NULL, *y2, sum, mag;
+
+   MPI_Comm_size(comm, &comm_sz);
+   MPI_Comm_rank(comm, &my_rank);
+   n = local_n*comm_sz;
+   y2 = Vec_alloc(local_n, sizeof(double));
+   if (my_rank == 0) {
+      x = Vec_alloc(n, sizeof(double));
+      y = Vec_alloc(n, sizeof(double));
+   }
+   Check_for_error(y2 != NULL && (my_rank != 0 || (x != NULL && y != NULL)),
+         "Check_conv", "Can't allocate vectors", comm);
+
+   Conv1d(local_x, local_n, w, width, c, local_y, work, comm);
+   Conv1d_blocking(local_x, local_n, w, width, c, y2, work, comm);
+   for (i = 0; i < local_n; i++)
+      if (y2[i] != local_y[i]) ok = 0;
+
+   MPI_Gather(local_x, local_n, MPI_DOUBLE, x, local_n, MPI_DOUBLE, 0, comm);
+   MPI_Gather(local_y, local_n, MPI_DOUBLE, y, local_n, MPI_DOUBLE, 0, comm);
+   if (my_rank == 0)
+      for (i = 0; i < n; i++) {
+         sum = mag = 0.0;
+         for (j = 0; j < width; j++)
+            if (i - c + j >= 0 && i - c + j < n) {
+               sum += w[j]*x[i-c+j];
+               mag += fabs(w[j]*x[i-c+j]);
+            }
+         if (fabs(y[i] - sum) > 1.0e-12*mag) ok = 0;
+      }
+   Check_for_error(ok, "Check_conv", "Convolution differs from the direct loop",
+         comm);
+
+   free(x);
+   free(y);
+   free(y2);
+}  /* Check_conv */
@@ -0,0 +1,248 @@
+/* File:     mpi_stream.c
+ *
+ * Purpose:  Out-of-core streaming of file-backed vectors with
+ *           double-buffered nonblocking MPI-IO (see mpi_stream.h)
+ */
+#include <stdlib.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+#include "mpi_stream.h"
+
+#define STREAM_GEN  0
+#define STREAM_SUM  1
+#define STREAM_DOT  2
+
+static double Stream_pass(int op, char* in_paths[], int n_in,
+      char out_path[], MPI_Offset n, int chunk_n, int i_seed,
+      Stream_report* report, MPI_Comm comm);
+static int Chunk_seed(int i_seed, MPI_Offset offset);
+
+/*---------------------------------------------------------------------
+ * Function:  Stream_generate
+ * Purpose:   Write a file holding a random vector of order n
+ * In args:   path:     the file to create (or overwrite)
+ *            n:        order of the vector
+ *            chunk_n:  elements per buffer
+ *            i_seed:   distinguishes the vectors generated (e.g. a
+ *                      hash of the path)
+ *            comm:     communicator containing the calling processes
+ * Out arg:   report:   size, bytes written and time
+ */
+void Stream_generate(
+      char            path[]   /* in  */,
+      MPI_Offset      n        /* in  */,
+      int             chunk_n  /* in  */,
+      int             i_seed   /* in  */,
+      Stream_report*  report   /* out */,
+      MPI_Comm        comm     /* in  */) {
+   Stream_pass(STREAM_GEN, NULL, 0, path, n, chunk_n, i_seed, report,
+         comm);
+}  /* Stream_generate */
+
+/*---------------------------------------------------------------------
+ * Function:  Stream_vector_sum
+ * Purpose:   z = x + y for vectors stored in files
+ * In args:   x_path, y_path:  files holding x and y (same order)
+ *            z_path:          file to create (or overwrite) with z
+ *            chunk_n:         elements per buffer
+ *            comm:            communicator containing the processes
+ * Out arg:   report:          order, bytes moved and time
+ */
+void Stream_vector_sum(
+      char            x_path[]  /* in  */,
+      char            y_path[]  /* in  */,
+      char            z_path[]  /* in  */,
+      int             chunk_n   /* in  */,
+      Stream_report*  report    /* out */,
+      MPI_Comm        comm      /* in  */) {
+   char* in_paths[2] = {x_path, y_path};
+
+   Stream_pass(STREAM_SUM, in_paths, 2, z_path, 0, chunk_n, 0, report,
+         comm);
+}  /* Stream_vector_sum */
+
+/*---------------------------------------------------------------------
+ * Function:  Stream_dot_product
+ * Purpose:   Dot product of two vectors stored in files
+ * In args:   x_path, y_path:  files holding x and y (same order)
+ *            chunk_n:         elements per buffer
+ *            comm:            communicator containing the processes
+ * Out arg:   report:          order, bytes read and time
+ * Ret val:   x.y on every process
+ */
+double Stream_dot_product(
+      char            x_path[]  /* in  */,
+      char            y_path[]  /* in  */,
+      int             chunk_n   /* in  */,
+      Stream_report*  report    /* out */,
+      MPI_Comm        comm      /* in  */) {
+   char* in_paths[2] = {x_path, y_path};
+
+   return Stream_pass(STREAM_DOT, in_paths, 2, NULL, 0, chunk_n, 0,
+         report, comm);
+}  /* Stream_dot_product */
+
+/*---------------------------------------------------------------------
+ * Function:  Stream_pass
+ * Purpose:   Stream the local blocks of n_in input files (and/or one
+ *            output file) through double buffers, applying op to
+ *            each chunk
+ * In args:   op:        STREAM_GEN, STREAM_SUM or STREAM_DOT
+ *            in_paths:  the input files
+ *            n_in:      number of input files (0 or 2)
+ *            out_path:  the output file, or NULL
+ *            n:         order of the vectors if there are no inputs
+ *            chunk_n:   elements per buffer
+ *            i_seed:    seed for STREAM_GEN, combined with the global
+ *                       offset of each chunk
+ *            comm:      communicator containing the processes
+ * Out arg:   report:    order, bytes moved and time
+ * Ret val:   The global dot product for STREAM_DOT, else 0
+ */
+static double Stream_pass(
+      int             op          /* in  */,
+      char*           in_paths[]  /* in  */,
+      int             n_in        /* in  */,
+      char            out_path[]  /* in  */,
+      MPI_Offset      n           /* in  */,
+      int             chunk_n     /* in  */,
+      int             i_seed      /* in  */,
+      Stream_report*  report      /* out */,
+      MPI_Comm        comm        /* in  */) {
+   char* fname = "Stream_pass";
+   MPI_File in[2], out;
+   double* in_buf[2][2] = {{NULL, NULL}, {NULL, NULL}};
+   double* out_buf[2] = {NULL, NULL};
+   MPI_Request in_req[2][2];
+   MPI_Request out_req[2] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+   MPI_Offset size, first, local_n, k, nchunks;
+   double local_dot = 0.0, dot = 0.0, start, local_time;
+   int comm_sz, my_rank, i, slot, len, next_len, ok = 1;
+
+   MPI_Comm_size(comm, &comm_sz);
+   MPI_Comm_rank(comm, &my_rank);
+
+   for (i = 0; i < n_in; i++) {
+      ok = MPI_File_open(comm, in_paths[i], MPI_MODE_RDONLY, MPI_INFO_NULL,
+            &in[i]) == MPI_SUCCESS;
+      Check_for_error(ok, fname, "Can't open input file", comm);
+      MPI_File_get_size(in[i], &size);
+      if (i == 0) n = size/sizeof(double);
+      Check_for_error(size == n*(MPI_Offset)sizeof(double), fname,
+            "Input files must hold the same number of doubles", comm);
+   }
+   if (out_path != NULL) {
+      ok = MPI_File_open(comm, out_path, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+            MPI_INFO_NULL, &out) == MPI_SUCCESS;
+      Check_for_error(ok, fname, "Can't open output file", comm);
+      ok = MPI_File_set_size(out, n*sizeof(double)) == MPI_SUCCESS;
+      Check_for_error(ok, fname, "Can't size output file", comm);
+   }
+
+   first = my_rank*n/comm_sz;
+   local_n = (my_rank + 1)*n/comm_sz - first;
+   nchunks = (local_n + chunk_n - 1)/chunk_n;
+
+   for (slot = 0; slot < 2; slot++) {
+      for (i = 0; i < n_in; i++) {
+         in_buf[i][slot] = Vec_alloc(chunk_n, sizeof(double));
+         if (in_buf[i][slot] == NULL) ok = 0;
+      }
+      if (out_path != NULL) {
+         out_buf[slot] = Vec_alloc(chunk_n, sizeof(double));
+         if (out_buf[slot] == NULL) ok = 0;
+      }
+   }
+   Check_for_error(ok, fname, "Can't allocate stream buffers", comm);
+
+   MPI_Barrier(comm);
+   start = MPI_Wtime();
+
+   /* Reads of chunk 0 */
+   len = (local_n < chunk_n) ? local_n : chunk_n;
+   for (i = 0; i < n_in && nchunks > 0; i++)
+      MPI_File_iread_at(in[i], first*sizeof(double), in_buf[i][0], len,
+            MPI_DOUBLE, &in_req[i][0]);
+
+   for (k = 0; k < nchunks; k++) {
+      slot = k % 2;
+      len = (local_n - k*chunk_n < chunk_n) ? local_n - k*chunk_n : chunk_n;
+
+      /* Wait for chunk k, then start reading chunk k+1 */
+      for (i = 0; i < n_in; i++)
+         MPI_Wait(&in_req[i][slot], MPI_STATUS_IGNORE);
+      if (k + 1 < nchunks) {
+         next_len = (local_n - (k+1)*chunk_n < chunk_n) ?
+               local_n - (k+1)*chunk_n : chunk_n;
+         for (i = 0; i < n_in; i++)
+            MPI_File_iread_at(in[i], (first + (k+1)*chunk_n)*sizeof(double),
+                  in_buf[i][1-slot], next_len, MPI_DOUBLE, &in_req[i][1-slot]);
+      }
+
+      /* The write of chunk k-2 must be done before reusing its buffer */
+      if (out_path != NULL)
+         MPI_Wait(&out_req[slot], MPI_STATUS_IGNORE);
+
+      switch (op) {
+         case STREAM_GEN:
+            Generate_vector(out_buf[slot], len, 0,
+                  Chunk_seed(i_seed, first + k*chunk_n));
+            break;
+         case STREAM_SUM:
+            Vector_sum(in_buf[0][slot], in_buf[1][slot], out_buf[slot], len);
+            break;
+         case STREAM_DOT:
+            local_dot += Dot_product(in_buf[0][slot], in_buf[1][slot], len);
+            break;
+      }
+
+      if (out_path != NULL)
+         MPI_File_iwrite_at(out, (first + k*chunk_n)*sizeof(double),
+               out_buf[slot], len, MPI_DOUBLE, &out_req[slot]);
+   }
+   MPI_Waitall(2, out_req, MPI_STATUSES_IGNORE);
+
+   for (i = 0; i < n_in; i++)
+      MPI_File_close(&in[i]);
+   if (out_path != NULL)
+      MPI_File_close(&out);
+   if (op == STREAM_DOT)
+      MPI_Allreduce(&local_dot, &dot, 1, MPI_DOUBLE, MPI_SUM, comm);
+   local_time = MPI_Wtime() - start;
+
+   MPI_Allreduce(&local_time, &report->time, 1, MPI_DOUBLE, MPI_MAX, comm);
+   report->n = n;
+   report->bytes = (double)(n_in + (out_path != NULL))*n*sizeof(double);
+
+   for (slot = 0; slot < 2; slot++) {
+      for (i = 0; i < n_in; i++)
+         free(in_buf[i][slot]);
+      free(out_buf[slot]);
+   }
+   return dot;
+}  /* Stream_pass */
+
+/*---------------------------------------------------------------------
+ * Function:  Chunk_seed
+ * Purpose:   Seed for the chunk of a generated vector starting at a
+ *            global offset
+ * In args:   i_seed:  seed of the vector
+ *            offset:  index of the chunk's first element
+ * Ret val:   A hash of both
+ *
+ * Note:
+ *    Generate_vector adds its seed to time(NULL) and the rank, so
+ *    seeds made of small sums (rank + chunk number, say) repeat between
+ *    processes and vectors.  Hashing the offset gives every chunk of
+ *    every vector its own seed.
+ */
+static int Chunk_seed(
+      int         i_seed  /* in */,
+      MPI_Offset  offset  /* in */) {
+   unsigned long long z = ((unsigned long long) (unsigned) i_seed << 40)
+         ^ (unsigned long long) offset;
+
+   z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ULL;
+   z = (z ^ (z >> 27))*0x94d049bb133111ebULL;
+   return (int) (unsigned) (z ^ (z >> 31));
+}  /* Chunk_seed */
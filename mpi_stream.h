@@ -0,0 +1,41 @@
+/* File:     mpi_stream.h
+ *
+ * Purpose:  Out-of-core operations on vectors stored in files, for
+ *           vectors larger than the memory of the processes.  Each
+ *           process streams its block of the files through buffers
+ *           of chunk_n elements, so memory use per process is
+ *           constant.
+ *
+ * Compile:  Link mpi_stream.c, mpi_vector_utils.c and vector_ops.c
+ *           into the program (and -lm).
+ *
+ * Notes:
+ * 1.  Files are raw arrays of doubles in native byte order; n is the
+ *     file size divided by sizeof(double).  n need not be divisible
+ *     by comm_sz: process q owns [q*n/comm_sz, (q+1)*n/comm_sz).
+ * 2.  Input is double-buffered with nonblocking MPI-IO: the reads of
+ *     chunk k+1 are in flight while chunk k is processed.  Output
+ *     chunks are written with nonblocking writes from two alternating
+ *     buffers, so writing chunk k overlaps processing chunk k+1.
+ * 3.  Errors opening or sizing files terminate all processes through
+ *     Check_for_error.
+ */
+#ifndef MPI_STREAM_H
+#define MPI_STREAM_H
+
+#include <mpi.h>
+
+typedef struct {
+   MPI_Offset  n;       /* order of the vectors                      */
+   double      bytes;   /* bytes read and written by all processes   */
+   double      time;    /* seconds taken by the slowest process      */
+} Stream_report;
+
+void Stream_generate(char path[], MPI_Offset n, int chunk_n, int i_seed,
+      Stream_report* report, MPI_Comm comm);
+void Stream_vector_sum(char x_path[], char y_path[], char z_path[],
+      int chunk_n, Stream_report* report, MPI_Comm comm);
+double Stream_dot_product(char x_path[], char y_path[], int chunk_n,
+      Stream_report* report, MPI_Comm comm);
+
+#endif /* MPI_STREAM_H */
@@ -0,0 +1,179 @@
+/* File:     mpi_vector_balance.c
+ *
+ * Purpose:  Iterate the vector addition and dot product on processes of
+ *           unequal speed, rebalancing the block boundaries by measured
+ *           throughput (mpi_balance.h) between phases of iterations.
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_vector_balance \
+ *              mpi_vector_balance.c mpi_balance.c mpi_vector_utils.c vector_ops.c -lm
+ * Run:      mpiexec -n <comm_sz> ./mpi_vector_balance <order of the vectors> <phases> <iterations per phase> [<slow rank> <slowdown>]
+ *
+ * Input:    The order of the vectors, n, the number of phases and of
+ *           iterations per phase, and optionally a process that is
+ *           made <slowdown> times slower
+ * Output:   For each phase, the load imbalance (slowest process' kernel
+ *           time over the mean), the time per iteration, and the
+ *           elements moved by the rebalancing that follows it
+ *
+ * Notes:
+ * 1.  n should be evenly divisible by comm_sz; the first phase uses
+ *     equal blocks.
+ * 2.  An iteration is z = x+y on the local block followed by x.z
+ *     reduced to all processes.  Only the local computation is timed
+ *     for the balancing.
+ * 3.  The slow process repeats its vector addition <slowdown> times,
+ *     standing in for a throttled or shared core.  Without it the
+ *     balancing reacts to whatever noise the node has.
+ * 4.  After every rebalancing, each process checks that its new blocks
+ *     hold the right elements (x[i] = i, y[i] = 1).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+#include "mpi_balance.h"
+
+void Check_blocks(double local_x[], double local_y[], const int counts[],
+      int my_rank, MPI_Comm comm);
+
+int main(int argc, char* argv[]) {
+    int n, phases, iters, slow_rank = -1, slowdown = 1;
+    int comm_sz, my_rank, phase, it, r, q, i, min_n, max_n;
+    int *counts, *new_counts;
+    double *local_x, *local_y, *local_z;
+    double local_dot, dot, start, iter_start, local_time, local_iter_time;
+    double iter_time;
+    double imbalance;
+    long long moved, moved_y, total_moved;
+    MPI_Comm comm;
+
+    // Initialize MPI
+    MPI_Init(&argc, &argv);
+    comm = MPI_COMM_WORLD;
+    MPI_Comm_size(comm, &comm_sz);
+    MPI_Comm_rank(comm, &my_rank);
+
+    if (argc != 4 && argc != 6) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Usage: %s <order of the vectors> <phases> <iterations per phase> [<slow rank> <slowdown>]\n", argv[0]);
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    n = atoi(argv[1]);
+    phases = atoi(argv[2]);
+    iters = atoi(argv[3]);
+    if (argc == 6) {
+        slow_rank = atoi(argv[4]);
+        slowdown = atoi(argv[5]);
+    }
+    if (n <= 0 || n % comm_sz != 0 || phases <= 0 || iters <= 0 || slowdown <= 0) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Order of the vectors should be a positive integer and evenly divisible by the number of processes, and phases, iterations and slowdown positive\n");
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    counts = malloc(2*comm_sz*sizeof(int));
+    new_counts = counts + comm_sz;
+    for (q = 0; q < comm_sz; q++)
+        counts[q] = n / comm_sz;
+
+    Allocate_vectors(&local_x, &local_y, &local_z, counts[my_rank], comm);
+    for (i = 0; i < counts[my_rank]; i++) {
+        local_x[i] = (double) my_rank*counts[my_rank] + i;
+        local_y[i] = 1.0;
+    }
+
+    if (my_rank == 0) {
+        printf("%-6s %10s %14s %12s %12s %12s\n", "phase", "imbalance",
+              "s/iteration", "min block", "max block", "moved");
+    }
+    for (phase = 0; phase < phases; phase++) {
+        local_time = 0.0;
+        MPI_Barrier(comm);
+        iter_start = MPI_Wtime();
+        for (it = 0; it < iters; it++) {
+            start = MPI_Wtime();
+            for (r = 0; r < (my_rank == slow_rank ? slowdown : 1); r++)
+                Parallel_vector_sum(local_x, local_y, local_z, counts[my_rank]);
+            local_dot = Parallel_dot_product(local_x, local_z, counts[my_rank]);
+            local_time += MPI_Wtime() - start;
+            MPI_Allreduce(&local_dot, &dot, 1, MPI_DOUBLE, MPI_SUM, comm);
+        }
+        local_iter_time = (MPI_Wtime() - iter_start)/iters;
+        MPI_Reduce(&local_iter_time, &iter_time, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+        imbalance = Imbalance(local_time, comm);
+
+        min_n = max_n = counts[0];
+        for (q = 1; q < comm_sz; q++) {
+            if (counts[q] < min_n) min_n = counts[q];
+            if (counts[q] > max_n) max_n = counts[q];
+        }
+
+        // Rebalance for the next phase
+        total_moved = 0;
+        if (phase < phases - 1) {
+            Check_for_error(Balance_counts(counts, local_time, new_counts, comm),
+                  "main", "Can't balance the counts", comm);
+            moved = Redistribute(&local_x, counts, new_counts, comm);
+            moved_y = Redistribute(&local_y, counts, new_counts, comm);
+            Check_for_error(moved >= 0 && moved_y >= 0, "main",
+                  "Can't redistribute the vectors", comm);
+            moved += moved_y;
+            free(local_z);
+            local_z = Vec_alloc(new_counts[my_rank] > 0 ? new_counts[my_rank] : 1,
+                  sizeof(double));
+            Check_for_error(local_z != NULL, "main", "Can't allocate local vector", comm);
+            for (q = 0; q < comm_sz; q++)
+                counts[q] = new_counts[q];
+            MPI_Reduce(&moved, &total_moved, 1, MPI_LONG_LONG, MPI_SUM, 0, comm);
+            Check_blocks(local_x, local_y, counts, my_rank, comm);
+        }
+
+        if (my_rank == 0) {
+            printf("%-6d %10.3f %14.6e %12d %12d %12lld\n", phase, imbalance,
+                  iter_time, min_n, max_n, total_moved);
+        }
+    }
+    if (my_rank == 0) {
+        printf("Last x.(x+y) = %f\n", dot);
+    }
+
+    free(counts);
+    free(local_x);
+    free(local_y);
+    free(local_z);
+
+    MPI_Finalize();
+    return 0;
+}  /* main */
+
+/*---------------------------------------------------------------------
+ * Function:  Check_blocks
+ * Purpose:   Verify that the local blocks hold their elements of x and
+ *            y after a redistribution
+ * In args:   local_x, local_y:  the local blocks
+ *            counts:            block sizes
+ *            my_rank:           calling process' rank in comm
+ *            comm:              communicator containing the vectors
+ *
+ * Errors:    If an element is wrong, the program terminates
+ */
+void Check_blocks(
+      double     local_x[]  /* in */,
+      double     local_y[]  /* in */,
+      const int  counts[]   /* in */,
+      int        my_rank    /* in */,
+      MPI_Comm   comm       /* in */) {
+   long long first = 0;
+   int q, i, ok = 1;
+
+   for (q = 0; q < my_rank; q++)
+      first += counts[q];
+   for (i = 0; i < counts[my_rank]; i++)
+      if (local_x[i] != (double) (first + i) || local_y[i] != 1.0) ok = 0;
+   Check_for_error(ok, "Check_blocks", "Redistributed block is wrong", comm);
+}  /* Check_blocks */
@@ -0,0 +1,112 @@
+/* File:     mpi_vector_checkpoint.c
+ *
+ * Purpose:  Checkpoint the vectors of the vector addition (x, y and
+ *           z = x+y) and restart them, possibly on a different number
+ *           of processes.
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_vector_checkpoint \
+ *              mpi_vector_checkpoint.c mpi_checkpoint.c mpi_vector_utils.c vector_ops.c -lm
+ * Run:      mpiexec -n <comm_sz> ./mpi_vector_checkpoint save <dir> <order of the vectors>
+ *           mpiexec -n <comm_sz> ./mpi_vector_checkpoint restore <dir>
+ *
+ * Input:    The checkpoint directory and, for save, the order n
+ * Output:   The vectors, the checkpoint write bandwidth (save) or the
+ *           restart time (restore).  restore also checks that z is
+ *           still x+y.
+ *
+ * Notes:
+ * 1.  For save, n should be evenly divisible by comm_sz; restore
+ *     accepts any comm_sz.
+ * 2.  See mpi_checkpoint.h for the checkpoint layout.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+#include "mpi_checkpoint.h"
+
+void Usage(char prog_name[], int my_rank);
+
+int main(int argc, char* argv[]) {
+    int n, local_n, i, ok;
+    long long n_restored;
+    int comm_sz, my_rank;
+    double *local_vecs[3], *local_sum;
+    char* names[3] = {"x", "y", "z"};
+    MPI_Comm comm;
+    Checkpoint_report report;
+
+    // Initialize MPI
+    MPI_Init(&argc, &argv);
+    comm = MPI_COMM_WORLD;
+    MPI_Comm_size(comm, &comm_sz);
+    MPI_Comm_rank(comm, &my_rank);
+
+    if (argc == 4 && strcmp(argv[1], "save") == 0) {
+        n = atoi(argv[3]);
+        if (n <= 0 || n % comm_sz != 0) {
+            if (my_rank == 0) {
+                fprintf(stderr, "Order of the vectors should be a positive integer and evenly divisible by the number of processes\n");
+            }
+            MPI_Finalize();
+            exit(-1);
+        }
+        local_n = n / comm_sz;
+
+        Allocate_vectors(&local_vecs[0], &local_vecs[1], &local_vecs[2],
+              local_n, comm);
+        Generate_vector(local_vecs[0], local_n, my_rank, 1);
+        Generate_vector(local_vecs[1], local_n, my_rank, 2);
+        Parallel_vector_sum(local_vecs[0], local_vecs[1], local_vecs[2], local_n);
+
+        Checkpoint_write(argv[2], 3, names, local_vecs, local_n, &report, comm);
+
+        Print_vector(local_vecs[2], local_n, n, "=> The saved sum is", my_rank, comm);
+        if (my_rank == 0) {
+            printf("Checkpoint of %d elements x 3 vectors on %d processes took %f seconds (%.2f GB/s)\n",
+                  n, comm_sz, report.time, report.bytes/report.time/1.0e9);
+        }
+    } else if (argc == 3 && strcmp(argv[1], "restore") == 0) {
+        Checkpoint_read(argv[2], 3, names, local_vecs, &local_n, &n_restored,
+              &report, comm);
+
+        local_sum = Vec_alloc(local_n, sizeof(double));
+        Check_for_error(local_sum != NULL, "main", "Can't allocate local vector", comm);
+        Parallel_vector_sum(local_vecs[0], local_vecs[1], local_sum, local_n);
+        ok = 1;
+        for (i = 0; i < local_n; i++)
+            if (local_sum[i] != local_vecs[2][i]) ok = 0;
+        Check_for_error(ok, "main", "Restored z is not x+y", comm);
+        free(local_sum);
+
+        if (local_n*comm_sz == n_restored)
+            Print_vector(local_vecs[2], local_n, n_restored, "=> The restored sum is", my_rank, comm);
+        if (my_rank == 0) {
+            printf("Restart of %lld elements x 3 vectors on %d processes took %f seconds (%.2f GB/s)\n",
+                  n_restored, comm_sz, report.time, report.bytes/report.time/1.0e9);
+            printf("Restored z = x+y on every process\n");
+        }
+    } else {
+        Usage(argv[0], my_rank);
+    }
+
+    for (i = 0; i < 3; i++)
+        free(local_vecs[i]);
+
+    MPI_Finalize();
+    return 0;
+}  /* main */
+
+/*---------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   Print the command lines and terminate
+ */
+void Usage(char prog_name[], int my_rank) {
+    if (my_rank == 0) {
+        fprintf(stderr, "Usage: %s save <dir> <order of the vectors>\n", prog_name);
+        fprintf(stderr, "       %s restore <dir>\n", prog_name);
+    }
+    MPI_Finalize();
+    exit(-1);
+}  /* Usage */
@@ -0,0 +1,135 @@
+/* File:     mpi_vector_expr.c
+ *
+ * Purpose:  Evaluate z = a*x + b*y + c and ||z|| on block-distributed
+ *           vectors twice: once with the hand-written kernels
+ *           (one full pass per operation plus temporaries) and once
+ *           as a fused lazy expression (one pass, norm included).
+ *           The results are compared and both are timed.
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_vector_expr \
+ *              mpi_vector_expr.c vector_expr.c mpi_vector_utils.c vector_ops.c -lm
+ * Run:      mpiexec -n <comm_sz> ./mpi_vector_expr <order of the vectors> <a> <b> <c>
+ *
+ * Input:    The order of the vectors, n, and the scalars a, b and c
+ * Output:   z, ||z|| from both paths, the largest difference between
+ *           them and the time taken by each path
+ *
+ * Notes:
+ * 1.  The order of the vectors, n, should be evenly divisible by comm_sz
+ * 2.  The hand-written path is the reference for the fused one
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+#include "vector_expr.h"
+
+int main(int argc, char* argv[]) {
+    int n, local_n, i;
+    int comm_sz, my_rank;
+    double *local_x, *local_y, *local_z, *local_t, *local_ref;
+    double a, b, c;
+    MPI_Comm comm;
+    double start, ref_time, fused_time;
+    double local_sq, ref_norm, fused_norm, local_diff, max_diff;
+    Vexpr e;
+
+    // Initialize MPI
+    MPI_Init(&argc, &argv);
+    comm = MPI_COMM_WORLD;
+    MPI_Comm_size(comm, &comm_sz);
+    MPI_Comm_rank(comm, &my_rank);
+
+    // Check if the user provided the vector size and scalars as arguments
+    if (argc != 5) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Usage: %s <order of the vectors> <a> <b> <c>\n", argv[0]);
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    n = atoi(argv[1]);
+    a = atof(argv[2]);
+    b = atof(argv[3]);
+    c = atof(argv[4]);
+    if (n <= 0 || n % comm_sz != 0) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Order of the vectors should be a positive integer and evenly divisible by the number of processes\n");
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    local_n = n / comm_sz;
+
+    // Allocate memory for vectors (t is the temporary of the reference path)
+    Allocate_vectors(&local_x, &local_y, &local_z, local_n, comm);
+    Allocate_vectors(&local_t, &local_ref, NULL, local_n, comm);
+
+    // Generate random vectors
+    Generate_vector(local_x, local_n, my_rank, 1);
+    Generate_vector(local_y, local_n, my_rank, 2);
+
+    // Reference: one pass per operation
+    MPI_Barrier(comm);
+    start = MPI_Wtime();
+    memcpy(local_ref, local_x, local_n*sizeof(double));
+    Parallel_scalar_multiplication(local_ref, local_n, a);
+    memcpy(local_t, local_y, local_n*sizeof(double));
+    Parallel_scalar_multiplication(local_t, local_n, b);
+    Parallel_vector_sum(local_ref, local_t, local_ref, local_n);
+    for (i = 0; i < local_n; i++)
+        local_ref[i] += c;
+    local_sq = Parallel_dot_product(local_ref, local_ref, local_n);
+    MPI_Allreduce(&local_sq, &ref_norm, 1, MPI_DOUBLE, MPI_SUM, comm);
+    ref_norm = sqrt(ref_norm);
+    ref_time = MPI_Wtime() - start;
+
+    // Fused: the whole expression and the norm in one pass
+    Vexpr_init(&e);
+    Vexpr_push_const(&e, a);
+    Vexpr_push_vector(&e, local_x);
+    Vexpr_apply(&e, VEXPR_MUL);
+    Vexpr_push_const(&e, b);
+    Vexpr_push_vector(&e, local_y);
+    Vexpr_apply(&e, VEXPR_MUL);
+    Vexpr_apply(&e, VEXPR_ADD);
+    Vexpr_push_const(&e, c);
+    Vexpr_apply(&e, VEXPR_ADD);
+    Check_for_error(Vexpr_is_valid(&e), "main", "Invalid expression", comm);
+
+    MPI_Barrier(comm);
+    start = MPI_Wtime();
+    local_sq = Vexpr_eval(&e, local_z, local_n, VEXPR_RED_SUMSQ, NULL);
+    MPI_Allreduce(&local_sq, &fused_norm, 1, MPI_DOUBLE, MPI_SUM, comm);
+    fused_norm = sqrt(fused_norm);
+    fused_time = MPI_Wtime() - start;
+
+    local_diff = 0.0;
+    for (i = 0; i < local_n; i++)
+        if (fabs(local_z[i] - local_ref[i]) > local_diff)
+            local_diff = fabs(local_z[i] - local_ref[i]);
+    MPI_Reduce(&local_diff, &max_diff, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+
+    Print_vector(local_z, local_n, n, "=> z = a*x + b*y + c is", my_rank, comm);
+
+    if (my_rank == 0) {
+        printf("Reference ||z|| = %f, fused ||z|| = %f, max |z_fused - z_ref| = %e\n",
+              ref_norm, fused_norm, max_diff);
+        printf("Reference kernels took %f seconds\n", ref_time);
+        printf("Fused expression took %f seconds\n", fused_time);
+    }
+
+    // Free allocated memory
+    free(local_x);
+    free(local_y);
+    free(local_z);
+    free(local_t);
+    free(local_ref);
+
+    MPI_Finalize();
+    return 0;
+}  /* main */
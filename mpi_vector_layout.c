@@ -0,0 +1,205 @@
+/* File:     mpi_vector_layout.c
+ *
+ * Purpose:  Redistribute a vector between two distributions
+ *           (mpi_layout.h) and compare MPI_Alltoallv on packed buffers
+ *           with MPI_Alltoallw on indexed datatypes.
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_vector_layout \
+ *              mpi_vector_layout.c mpi_layout.c mpi_vector_utils.c vector_ops.c -lm
+ * Run:      mpiexec -n <comm_sz> ./mpi_vector_layout <order of the vectors> <iterations> <from> <to>
+ *
+ * Input:    The order of the vector, n, the number of repetitions, and
+ *           the two distributions, each one of
+ *              block        contiguous blocks, as in Read_vector
+ *              cyclic:<nb>  block-cyclic with blocks of nb elements
+ *              table        offset table with uneven ranges in reverse
+ *                           rank order: process q owns about
+ *                           2(q+1)n/(comm_sz(comm_sz+1)) elements and
+ *                           process comm_sz-1 owns the first range
+ * Output:   Time to build the plan, and for each method the time per
+ *           redistribution and the bandwidth of the data that changes
+ *           process (all processes together)
+ *
+ * Note:
+ *    Element i of the vector holds i, so each process checks its
+ *    elements after every method.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+#include "mpi_layout.h"
+
+int Parse_layout(char spec[], int n, int comm_sz, Layout* layout);
+void Check_layout(double local_v[], const Layout* layout, int my_rank,
+      MPI_Comm comm);
+
+int main(int argc, char* argv[]) {
+    int n, iters, it, i, m, ok;
+    int comm_sz, my_rank;
+    double *local_src, *local_dst;
+    MPI_Comm comm;
+    Layout from, to;
+    Redist_plan plan;
+    long long local_moved, moved;
+    double start, local_t[3], t[3];
+
+    // Initialize MPI
+    MPI_Init(&argc, &argv);
+    comm = MPI_COMM_WORLD;
+    MPI_Comm_size(comm, &comm_sz);
+    MPI_Comm_rank(comm, &my_rank);
+
+    if (argc != 5) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Usage: %s <order of the vectors> <iterations> <from> <to>\n", argv[0]);
+            fprintf(stderr, "       layouts: block, cyclic:<nb>, table\n");
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    n = atoi(argv[1]);
+    iters = atoi(argv[2]);
+    if (n <= 0 || iters <= 0) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Order of the vectors and iterations should be positive integers\n");
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+    ok = Parse_layout(argv[3], n, comm_sz, &from);
+    ok = Parse_layout(argv[4], n, comm_sz, &to) && ok;
+    Check_for_error(ok, "main", "Unknown or invalid layout", comm);
+
+    m = Layout_local_n(&from, my_rank);
+    local_src = Vec_alloc(m > 0 ? m : 1, sizeof(double));
+    m = Layout_local_n(&to, my_rank);
+    local_dst = Vec_alloc(m > 0 ? m : 1, sizeof(double));
+    Check_for_error(local_src != NULL && local_dst != NULL, "main",
+          "Can't allocate local vectors", comm);
+    for (i = 0; i < Layout_local_n(&from, my_rank); i++)
+        local_src[i] = Layout_global_index(&from, my_rank, i);
+
+    MPI_Barrier(comm);
+    start = MPI_Wtime();
+    ok = Redist_plan_create(&from, &to, &plan, comm);
+    local_t[0] = MPI_Wtime() - start;
+    Check_for_error(ok, "main", "Can't allocate the redistribution plan",
+          comm);
+
+    for (i = 0; i < m; i++)
+        local_dst[i] = -1.0;
+    MPI_Barrier(comm);
+    start = MPI_Wtime();
+    for (it = 0; it < iters; it++)
+        Redist_packed(&plan, local_src, local_dst, comm);
+    local_t[1] = MPI_Wtime() - start;
+    Check_layout(local_dst, &to, my_rank, comm);
+
+    for (i = 0; i < m; i++)
+        local_dst[i] = -1.0;
+    MPI_Barrier(comm);
+    start = MPI_Wtime();
+    for (it = 0; it < iters; it++)
+        Redist_typed(&plan, local_src, local_dst, comm);
+    local_t[2] = MPI_Wtime() - start;
+    Check_layout(local_dst, &to, my_rank, comm);
+
+    local_moved = Redist_remote_elements(&plan, my_rank);
+    MPI_Reduce(&local_moved, &moved, 1, MPI_LONG_LONG, MPI_SUM, 0, comm);
+    MPI_Reduce(local_t, t, 3, MPI_DOUBLE, MPI_MAX, 0, comm);
+    if (my_rank == 0) {
+        printf("%s -> %s: %lld of %d elements change process, plan built in %e seconds\n",
+              argv[3], argv[4], moved, n, t[0]);
+        printf("%-10s %14s %10s\n", "method", "s/redist", "GB/s");
+        printf("%-10s %14.6e %10.2f\n", "alltoallv", t[1]/iters,
+              moved*sizeof(double)*iters/t[1]/1.0e9);
+        printf("%-10s %14.6e %10.2f\n", "alltoallw", t[2]/iters,
+              moved*sizeof(double)*iters/t[2]/1.0e9);
+    }
+
+    Redist_plan_free(&plan);
+    Layout_free(&from);
+    Layout_free(&to);
+    free(local_src);
+    free(local_dst);
+
+    MPI_Finalize();
+    return 0;
+}  /* main */
+
+/*---------------------------------------------------------------------
+ * Function:  Parse_layout
+ * Purpose:   Build the layout named on the command line
+ * In args:   spec:     block, cyclic:<nb> or table
+ *            n:        order of the vector
+ *            comm_sz:  number of processes
+ * Out args:  layout:   the distribution
+ * Ret val:   1 if spec is valid, 0 otherwise
+ */
+int Parse_layout(
+      char     spec[]   /* in  */,
+      int      n        /* in  */,
+      int      comm_sz  /* in  */,
+      Layout*  layout   /* out */) {
+   int *counts, *displs, q, next, ok;
+   long long weight = (long long) comm_sz*(comm_sz + 1)/2, given = 0;
+
+   if (strcmp(spec, "block") == 0) {
+      Layout_block_cyclic(layout, n, (n + comm_sz - 1)/comm_sz, comm_sz);
+      return 1;
+   }
+   if (strncmp(spec, "cyclic:", 7) == 0) {
+      Layout_block_cyclic(layout, n, atoi(spec + 7), comm_sz);
+      return atoi(spec + 7) > 0;
+   }
+   if (strcmp(spec, "table") != 0) {
+      Layout_block_cyclic(layout, n, 1, comm_sz);
+      return 0;
+   }
+
+   counts = malloc(2*comm_sz*sizeof(int));
+   if (counts == NULL) {
+      Layout_block_cyclic(layout, n, 1, comm_sz);
+      return 0;
+   }
+   displs = counts + comm_sz;
+   for (q = 0; q < comm_sz; q++) {
+      // The last process takes what the rounding left over
+      counts[q] = q < comm_sz - 1 ? (long long) n*(q + 1)/weight : n - given;
+      given += counts[q];
+   }
+   next = 0;
+   for (q = comm_sz - 1; q >= 0; q--) {
+      displs[q] = next;
+      next += counts[q];
+   }
+   ok = Layout_table(layout, n, counts, displs, comm_sz);
+   free(counts);
+   return ok;
+}  /* Parse_layout */
+
+/*---------------------------------------------------------------------
+ * Function:  Check_layout
+ * Purpose:   Verify that every local element holds its global index
+ * In args:   local_v:  the local elements
+ *            layout:   their distribution
+ *            my_rank:  calling process' rank in comm
+ *            comm:     communicator containing the vector
+ *
+ * Errors:    If an element is wrong, the program terminates
+ */
+void Check_layout(
+      double         local_v[]  /* in */,
+      const Layout*  layout     /* in */,
+      int            my_rank    /* in */,
+      MPI_Comm       comm       /* in */) {
+   int i, ok = 1;
+
+   for (i = 0; i < Layout_local_n(layout, my_rank); i++)
+      if (local_v[i] != Layout_global_index(layout, my_rank, i)) ok = 0;
+   Check_for_error(ok, "Check_layout", "Redistributed vector is wrong",
+         comm);
+}  /* Check_layout */
@@ -0,0 +1,264 @@
+/* File:     mpi_vector_math.c
+ *
+ * Purpose:  Apply exp, log, sqrt, tanh, sigmoid and pow to the local
+ *           blocks of distributed vectors with every accuracy tier of
+ *           vector_math.h and with libm, and compare throughput and
+ *           accuracy.
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_vector_math \
+ *              mpi_vector_math.c vector_math.c mpi_vector_utils.c vector_ops.c -lm
+ *           (add -fopenmp to run OMP_NUM_THREADS threads per process)
+ * Run:      mpiexec -n <comm_sz> ./mpi_vector_math <order of the vectors> <iterations>
+ *
+ * Input:    The order of the vectors, n, and the number of
+ *           applications timed
+ * Output:   For each function and version, the elements computed per
+ *           second by all the processes, the speedup over libm and the
+ *           largest error in ulps
+ *
+ * Notes:
+ * 1.  n should be evenly divisible by comm_sz
+ * 2.  The arguments cover most of each function's domain: exp on
+ *     [-740, 709] (down to subnormal results), log and sqrt on
+ *     [1e-300, 1e300] log-uniformly and on [0.5, 1.5], tanh and sigmoid
+ *     on [-20, 20] and [-40, 40] concentrated near 0, and pow with
+ *     x in [0, 10] and y in [-100, 100].
+ * 3.  Errors are measured against the long double functions of libm,
+ *     in units of the spacing of the doubles around the exact result.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+#include "vector_math.h"
+
+enum { EXP, LOG, SQRT, TANH, SIGMOID, POW, NUM_FUNCS };
+
+#define LIBM  VMATH_NUM_TIERS   /* version after the tiers */
+
+static const char* func_names[NUM_FUNCS] = {"exp", "log", "sqrt", "tanh",
+   "sigmoid", "pow"};
+static const char* version_names[VMATH_NUM_TIERS + 1] = {"fast", "medium",
+   "accurate", "libm"};
+
+void Fill_arguments(int func, const double u[], const double v[],
+      double a[], double b[], int n);
+void Apply(int func, int version, const double a[], const double b[],
+      double out[], int n);
+long double Reference(int func, double a, double b);
+double Max_ulp(int func, const double a[], const double b[],
+      const double out[], int n);
+
+int main(int argc, char* argv[]) {
+    int n, local_n, iters, it, func, version;
+    int comm_sz, my_rank;
+    double *local_u, *local_v, *local_a, *local_b, *local_out;
+    double start, local_res[2*(VMATH_NUM_TIERS + 1)],
+           res[2*(VMATH_NUM_TIERS + 1)], *t = res, *ulp = res + VMATH_NUM_TIERS + 1;
+    MPI_Comm comm;
+
+    // Initialize MPI
+    MPI_Init(&argc, &argv);
+    comm = MPI_COMM_WORLD;
+    MPI_Comm_size(comm, &comm_sz);
+    MPI_Comm_rank(comm, &my_rank);
+
+    if (argc != 3) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Usage: %s <order of the vectors> <iterations>\n", argv[0]);
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    n = atoi(argv[1]);
+    iters = atoi(argv[2]);
+    if (n <= 0 || n % comm_sz != 0 || iters <= 0) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Order of the vectors should be a positive integer and evenly divisible by the number of processes, and iterations positive\n");
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    local_n = n/comm_sz;
+    Allocate_vectors(&local_u, &local_v, &local_a, local_n, comm);
+    Allocate_vectors(&local_b, &local_out, NULL, local_n, comm);
+    Generate_vector(local_u, local_n, my_rank, 1);
+    Generate_vector(local_v, local_n, my_rank, 2);
+
+    if (my_rank == 0)
+        printf("%-8s %-9s %12s %8s %12s\n", "function", "version",
+              "Melem/s", "vs libm", "max ulps");
+    for (func = 0; func < NUM_FUNCS; func++) {
+        Fill_arguments(func, local_u, local_v, local_a, local_b, local_n);
+        for (version = 0; version <= LIBM; version++) {
+            MPI_Barrier(comm);
+            start = MPI_Wtime();
+            for (it = 0; it < iters; it++)
+                Apply(func, version, local_a, local_b, local_out, local_n);
+            local_res[version] = (MPI_Wtime() - start)/iters;
+            local_res[VMATH_NUM_TIERS + 1 + version] =
+                  Max_ulp(func, local_a, local_b, local_out, local_n);
+        }
+        MPI_Reduce(local_res, res, 2*(VMATH_NUM_TIERS + 1), MPI_DOUBLE,
+              MPI_MAX, 0, comm);
+        if (my_rank == 0)
+            for (version = 0; version <= LIBM; version++)
+                printf("%-8s %-9s %12.1f %7.2fx %12.4g\n", func_names[func],
+                      version_names[version], n/t[version]/1.0e6,
+                      t[LIBM]/t[version], ulp[version]);
+    }
+
+    free(local_u);
+    free(local_v);
+    free(local_a);
+    free(local_b);
+    free(local_out);
+
+    MPI_Finalize();
+    return 0;
+}  /* main */
+
+/*---------------------------------------------------------------------
+ * Function:  Fill_arguments
+ * Purpose:   Map uniform random numbers in [0, 1] to the arguments of a
+ *            function
+ * In args:   func:  the function
+ *            u, v:  the random numbers
+ *            n:     their number
+ * Out args:  a:     first arguments
+ *            b:     second arguments (pow only)
+ */
+void Fill_arguments(
+      int           func  /* in  */,
+      const double  u[]   /* in  */,
+      const double  v[]   /* in  */,
+      double        a[]   /* out */,
+      double        b[]   /* out */,
+      int           n     /* in  */) {
+   double w;
+   int i;
+
+   for (i = 0; i < n; i++) {
+      w = 2.0*u[i] - 1.0;
+      b[i] = 0.0;
+      switch (func) {
+         case EXP:
+            a[i] = -740.0 + 1449.0*u[i];
+            break;
+         case LOG:
+         case SQRT:
+            a[i] = i % 2 ? 0.5 + u[i] : exp(-690.0 + 1380.0*u[i]);
+            break;
+         case TANH:
+            a[i] = 20.0*w*w*w;
+            break;
+         case SIGMOID:
+            a[i] = 40.0*w*w*w;
+            break;
+         default:
+            a[i] = 10.0*u[i];
+            b[i] = 100.0*(2.0*v[i] - 1.0);
+            break;
+      }
+   }
+}  /* Fill_arguments */
+
+/*---------------------------------------------------------------------
+ * Function:  Apply
+ * Purpose:   out = func(a[, b]) with one version
+ * In args:   func:     the function
+ *            version:  a Vmath_tier, or LIBM for one libm call per
+ *                      element
+ *            a, b:     the arguments
+ *            n:        their number
+ * Out args:  out:      the results
+ */
+void Apply(
+      int           func     /* in  */,
+      int           version  /* in  */,
+      const double  a[]      /* in  */,
+      const double  b[]      /* in  */,
+      double        out[]    /* out */,
+      int           n        /* in  */) {
+   int i;
+
+   if (version == LIBM) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+      for (i = 0; i < n; i++)
+         switch (func) {
+            case EXP:     out[i] = exp(a[i]); break;
+            case LOG:     out[i] = log(a[i]); break;
+            case SQRT:    out[i] = sqrt(a[i]); break;
+            case TANH:    out[i] = tanh(a[i]); break;
+            case SIGMOID: out[i] = 1.0/(1.0 + exp(-a[i])); break;
+            default:      out[i] = pow(a[i], b[i]); break;
+         }
+      return;
+   }
+
+   switch (func) {
+      case EXP:     Vmath_exp(a, out, n, version); break;
+      case LOG:     Vmath_log(a, out, n, version); break;
+      case SQRT:    Vmath_sqrt(a, out, n, version); break;
+      case TANH:    Vmath_tanh(a, out, n, version); break;
+      case SIGMOID: Vmath_sigmoid(a, out, n, version); break;
+      default:      Vmath_pow(a, b, out, n, version); break;
+   }
+}  /* Apply */
+
+/*---------------------------------------------------------------------
+ * Function:  Reference
+ * Purpose:   func(a[, b]) in long double
+ */
+long double Reference(int func, double a, double b) {
+   switch (func) {
+      case EXP:     return expl(a);
+      case LOG:     return logl(a);
+      case SQRT:    return sqrtl(a);
+      case TANH:    return tanhl(a);
+      case SIGMOID: return 1.0L/(1.0L + expl(-(long double) a));
+      default:      return powl(a, b);
+   }
+}  /* Reference */
+
+/*---------------------------------------------------------------------
+ * Function:  Max_ulp
+ * Purpose:   Largest error of the results in ulps of the exact ones
+ * In args:   func:  the function
+ *            a, b:  the arguments
+ *            out:   the results
+ *            n:     their number
+ * Ret val:   the error; inf if a result is inf or NaN and shouldn't be
+ *
+ * Note:
+ *    Below the normal range the ulp is that of the subnormals, 2^-1074.
+ */
+double Max_ulp(
+      int           func   /* in */,
+      const double  a[]    /* in */,
+      const double  b[]    /* in */,
+      const double  out[]  /* in */,
+      int           n      /* in */) {
+   long double ref, err, max = 0.0L;
+   double refd;
+   int i, e;
+
+   for (i = 0; i < n; i++) {
+      ref = Reference(func, a[i], b[i]);
+      refd = (double) ref;
+      if (!isfinite(out[i]) || !isfinite(refd)) {
+         err = out[i] == refd || (isnan(out[i]) && isnan(refd)) ? 0.0L
+               : INFINITY;
+      } else {
+         e = ref != 0.0L ? ilogbl(ref) : -1022;
+         err = fabsl(out[i] - ref)/ldexpl(1.0L, (e < -1022 ? -1022 : e) - 52);
+      }
+      if (err > max) max = err;
+   }
+   return (double) max;
+}  /* Max_ulp */
@@ -4,35 +4,42 @@
  *           1) Compute the dot product of two vectors.
  *           2) Multiply each vector by a scalar (the same scalar for both).
  *
- * Compile:  mpicc -g -Wall -o mpi_vector_operations mpi_vector_operations.c
- * Run:      mpiexec -n <comm_sz> ./mpi_vector_operations <order of the vectors> <scalar>
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_vector_operations \
+ *              mpi_vector_operations.c mpi_persist.c mpi_vector_utils.c vector_ops.c -lm
+ * Run:      mpiexec -n <comm_sz> ./mpi_vector_operations <order of the vectors> <scalar> [<iterations>]
  *
- * Input:    The order of the vectors, n, and the scalar s
- * Output:   The dot product of the two vectors and the vectors after scalar multiplication
+ * Input:    The order of the vectors, n, the scalar s and, optionally,
+ *           a number of iterations
+ * Output:   The dot product of the two vectors and the vectors after scalar multiplication.
+ *           With iterations, also the time per iteration of the
+ *           repeated communication with blocking and persistent calls.
  *
  * Notes:
  * 1.  The order of the vectors, n, should be evenly divisible by comm_sz
  * 2.  This program uses MPI_Scatter and MPI_Gather for distributing and collecting vectors
  * 3.  It also uses MPI_Reduce to compute the global dot product
+ * 4.  The helpers and kernels live in mpi_vector_utils.c and vector_ops.c
+ * 5.  An iteration is the communication of a solver step on the scaled
+ *     vectors: the dot product reduced to process 0 (MPI_Reduce) and
+ *     to every process (MPI_Allreduce), and x gathered to process 0
+ *     (MPI_Gather).  It is timed with blocking calls, with persistent
+ *     collectives (or, before MPI 4, nonblocking ones), and with the
+ *     gather made of persistent point-to-point requests; see
+ *     mpi_persist.h.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
 #include <mpi.h>
-#include <time.h>
-
-void Check_for_error(int local_ok, char fname[], char message[],
-      MPI_Comm comm);
-void Allocate_vectors(double** local_x_pp, double** local_y_pp,
-      int local_n, MPI_Comm comm);
-void Print_vector(double local_b[], int local_n, int n, char title[],
-      int my_rank, MPI_Comm comm);
-void Generate_vector(double local_a[], int local_n, int my_rank, int i_seed);
-double Parallel_dot_product(double local_x[], double local_y[], int local_n);
-void Parallel_scalar_multiplication(double local_a[], int local_n, double scalar);
+#include "mpi_vector_utils.h"
+#include "mpi_persist.h"
+
+void Time_iterations(double local_x[], double local_y[], int local_n,
+      int n, int iters, int my_rank, MPI_Comm comm);
 
 int main(int argc, char* argv[]) {
-    int n, local_n;
+    int n, local_n, iters = 0;
     int comm_sz, my_rank;
     double *local_x, *local_y;
     double s;
@@ -47,9 +54,9 @@ int main(int argc, char* argv[]) {
     MPI_Comm_rank(comm, &my_rank);
 
     // Check if the user provided the vector size and scalar as arguments
-    if (argc != 3) {
+    if (argc != 3 && argc != 4) {
         if (my_rank == 0) {
-            fprintf(stderr, "Usage: %s <order of the vectors> <scalar>\n", argv[0]);
+            fprintf(stderr, "Usage: %s <order of the vectors> <scalar> [<iterations>]\n", argv[0]);
         }
         MPI_Finalize();
         exit(-1);
@@ -58,9 +65,10 @@ int main(int argc, char* argv[]) {
     // Receive n and scalar s as execution parameters
     n = atoi(argv[1]);
     s = atof(argv[2]);
-    if (n <= 0 || n % comm_sz != 0) {
+    if (argc == 4) iters = atoi(argv[3]);
+    if (n <= 0 || n % comm_sz != 0 || iters < 0) {
         if (my_rank == 0) {
-            fprintf(stderr, "Order of the vectors should be a positive integer and evenly divisible by the number of processes\n");
+            fprintf(stderr, "Order of the vectors should be a positive integer and evenly divisible by the number of processes, and iterations nonnegative\n");
         }
         MPI_Finalize();
         exit(-1);
@@ -69,7 +77,7 @@ int main(int argc, char* argv[]) {
     local_n = n / comm_sz;
 
     // Allocate memory for vectors
-    Allocate_vectors(&local_x, &local_y, local_n, comm);
+    Allocate_vectors(&local_x, &local_y, NULL, local_n, comm);
 
     // Generate random vectors
     Generate_vector(local_x, local_n, my_rank, 1);
@@ -99,6 +107,9 @@ int main(int argc, char* argv[]) {
         printf("Dot product computation took %f seconds\n", end - start);
     }
 
+    if (iters > 0)
+        Time_iterations(local_x, local_y, local_n, n, iters, my_rank, comm);
+
     // Free allocated memory
     free(local_x);
     free(local_y);
@@ -107,125 +118,122 @@ int main(int argc, char* argv[]) {
     return 0;
 }  /* main */
 
-/*-------------------------------------------------------------------
- * Function:  Check_for_error
- * Purpose:   Check whether any process has found an error.  If so,
- *            print message and terminate all processes.  Otherwise,
- *            continue execution.
- */
-void Check_for_error(
-      int       local_ok   /* in */,
-      char      fname[]    /* in */,
-      char      message[]  /* in */,
-      MPI_Comm  comm       /* in */) {
-   int ok;
-
-   MPI_Allreduce(&local_ok, &ok, 1, MPI_INT, MPI_MIN, comm);
-   if (ok == 0) {
-      int my_rank;
-      MPI_Comm_rank(comm, &my_rank);
-      if (my_rank == 0) {
-         fprintf(stderr, "Proc %d > In %s, %s\n", my_rank, fname,
-               message);
-         fflush(stderr);
-      }
-      MPI_Finalize();
-      exit(-1);
-   }
-}  /* Check_for_error */
-
-/*-------------------------------------------------------------------
- * Function:  Allocate_vectors
- * Purpose:   Allocate storage for x and y
- */
-void Allocate_vectors(
-      double**   local_x_pp  /* out */,
-      double**   local_y_pp  /* out */,
-      int        local_n     /* in  */,
-      MPI_Comm   comm        /* in  */) {
-   int local_ok = 1;
-   char* fname = "Allocate_vectors";
-
-   *local_x_pp = malloc(local_n*sizeof(double));
-   *local_y_pp = malloc(local_n*sizeof(double));
-
-   if (*local_x_pp == NULL || *local_y_pp == NULL) local_ok = 0;
-   Check_for_error(local_ok, fname, "Can't allocate local vector(s)",
-         comm);
-}  /* Allocate_vectors */
-
-/*-------------------------------------------------------------------
- * Function:  Print_vector
- * Purpose:   Print a vector that has a block distribution to stdout
+/*---------------------------------------------------------------------
+ * Function:  Time_iterations
+ * Purpose:   Time the communication of an iteration (see Note 5) with
+ *            blocking calls and with persistent patterns, and print
+ *            the time per iteration of each and the latency saved
+ * In args:   local_x, local_y:  local blocks of the vectors
+ *            local_n, n:        local and global order of the vectors
+ *            iters:             number of iterations of each version
+ *            my_rank:           calling process' rank in comm
+ *            comm:              communicator containing the vectors
+ *
+ * Errors:    If the gathered vectors differ, or the dot products by more
+ *            than rounding, the program terminates
  */
-void Print_vector(
-      double    local_b[]  /* in */,
+void Time_iterations(
+      double    local_x[]  /* in */,
+      double    local_y[]  /* in */,
       int       local_n    /* in */,
       int       n          /* in */,
-      char      title[]    /* in */,
+      int       iters      /* in */,
       int       my_rank    /* in */,
       MPI_Comm  comm       /* in */) {
+   double *x = NULL, *x_check = NULL;
+   double local_dot, dot, all_dot, check[2];
+   double start, local_time[3], time[3];
+   Persistent_op reduce, allreduce, gather, gather_p2p;
+   int it, i, ok = 1;
+
+   if (my_rank == 0) {
+      x = Vec_alloc(n, sizeof(double));
+      x_check = Vec_alloc(n, sizeof(double));
+   }
+   Check_for_error(my_rank != 0 || (x != NULL && x_check != NULL),
+         "Time_iterations", "Can't allocate vectors", comm);
+
+   MPI_Barrier(comm);
+   start = MPI_Wtime();
+   for (it = 0; it < iters; it++) {
+      local_dot = Parallel_dot_product(local_x, local_y, local_n);
+      MPI_Reduce(&local_dot, &dot, 1, MPI_DOUBLE, MPI_SUM, 0, comm);
+      MPI_Allreduce(&local_dot, &all_dot, 1, MPI_DOUBLE, MPI_SUM, comm);
+      MPI_Gather(local_x, local_n, MPI_DOUBLE, x_check, local_n, MPI_DOUBLE,
+            0, comm);
+   }
+   local_time[0] = MPI_Wtime() - start;
+   check[0] = dot;
+   check[1] = all_dot;
+
+   Persist_reduce_init(&local_dot, &dot, 1, MPI_DOUBLE, MPI_SUM, 0, comm,
+         &reduce);
+   Persist_allreduce_init(&local_dot, &all_dot, 1, MPI_DOUBLE, MPI_SUM, comm,
+         &allreduce);
+   Persist_gather_init(local_x, x, local_n, MPI_DOUBLE, 0, comm, &gather);
+   Persist_gather_p2p_init(local_x, x, local_n, MPI_DOUBLE, 0, comm,
+         &gather_p2p);
+
+   MPI_Barrier(comm);
+   start = MPI_Wtime();
+   for (it = 0; it < iters; it++) {
+      local_dot = Parallel_dot_product(local_x, local_y, local_n);
+      Persist_start(&reduce);
+      Persist_start(&allreduce);
+      Persist_start(&gather);
+      Persist_wait(&reduce);
+      Persist_wait(&allreduce);
+      Persist_wait(&gather);
+   }
+   local_time[1] = MPI_Wtime() - start;
+   // The collectives may add the terms in different orders
+   if (fabs(all_dot - check[1]) > 1e-12*fabs(check[1])
+         || (my_rank == 0 && fabs(dot - check[0]) > 1e-12*fabs(check[0])))
+      ok = 0;
+   if (my_rank == 0)
+      for (i = 0; i < n; i++)
+         if (x[i] != x_check[i]) ok = 0;
+
+   if (my_rank == 0)
+      for (i = 0; i < n; i++)
+         x[i] = 0.0;
+   MPI_Barrier(comm);
+   start = MPI_Wtime();
+   for (it = 0; it < iters; it++) {
+      local_dot = Parallel_dot_product(local_x, local_y, local_n);
+      Persist_start(&reduce);
+      Persist_start(&allreduce);
+      Persist_start(&gather_p2p);
+      Persist_wait(&reduce);
+      Persist_wait(&allreduce);
+      Persist_wait(&gather_p2p);
+   }
+   local_time[2] = MPI_Wtime() - start;
+   if (my_rank == 0)
+      for (i = 0; i < n; i++)
+         if (x[i] != x_check[i]) ok = 0;
+   Check_for_error(ok, "Time_iterations",
+         "Persistent and blocking results differ", comm);
+
+   Persist_free(&reduce);
+   Persist_free(&allreduce);
+   Persist_free(&gather);
+   Persist_free(&gather_p2p);
+
+   MPI_Reduce(local_time, time, 3, MPI_DOUBLE, MPI_MAX, 0, comm);
+   if (my_rank == 0) {
+      printf("Per iteration over %d iterations (reduce + allreduce + gather):\n",
+            iters);
+      printf("   blocking                      %e seconds\n", time[0]/iters);
+      printf("   %-29s %e seconds, saved %e\n",
+            PERSIST_COLLECTIVES ? "persistent collectives"
+                                : "nonblocking (no MPI 4)",
+            time[1]/iters, (time[0] - time[1])/iters);
+      printf("   %-29s %e seconds, saved %e\n",
+            "persistent p2p gather", time[2]/iters,
+            (time[0] - time[2])/iters);
+   }
 
-    double* b = NULL;
-    int i;
-    if (my_rank == 0) {
-        b = malloc(n * sizeof(double));
-        if (b == NULL) {
-            fprintf(stderr, "Can't allocate temporary vector for printing\n");
-            MPI_Finalize();
-            exit(-1);
-        }
-    }
-
-    MPI_Gather(local_b, local_n, MPI_DOUBLE, b, local_n, MPI_DOUBLE, 0, comm);
-
-    if (my_rank == 0) {
-        printf("%s\n", title);
-        printf("\t");
-        int elements_to_print = (n < 20) ? n : 10;
-        for (i = 0; i < elements_to_print; i++)
-            printf("%f ", b[i]);
-        printf("\t");
-        if (n >= 20) {
-            printf("\n\t...\n");
-            printf("\t");
-            for (i = n - 10; i < n; i++)
-                printf("%f ", b[i]);
-        }
-        printf("\n");
-        free(b);
-    }
-} /* Print_vector */
-
-/*---------------------------------------------------------------------
- * Function:  Generate_vector
- * Purpose:   Generate a vector with random numbers
- */
-void Generate_vector(double local_a[], int local_n, int my_rank, int i_seed) {
-    unsigned int seed = (unsigned int)time(NULL) + my_rank + i_seed;
-    for (int i = 0; i < local_n; i++) {
-        local_a[i] = (double)rand_r(&seed) / RAND_MAX;  // Generate a random number between 0 and 1
-    }
-}
-
-/*---------------------------------------------------------------------
- * Function:  Parallel_dot_product
- * Purpose:   Compute the dot product of two vectors in parallel
- */
-double Parallel_dot_product(double local_x[], double local_y[], int local_n) {
-    double local_dot = 0.0;
-    for (int i = 0; i < local_n; i++) {
-        local_dot += local_x[i] * local_y[i];
-    }
-    return local_dot;
-}
-
-/*---------------------------------------------------------------------
- * Function:  Parallel_scalar_multiplication
- * Purpose:   Multiply each element of a vector by a scalar in parallel
- */
-void Parallel_scalar_multiplication(double local_a[], int local_n, double scalar) {
-    for (int i = 0; i < local_n; i++) {
-        local_a[i] *= scalar;
-    }
-}
+   free(x);
+   free(x_check);
+}  /* Time_iterations */
@@ -0,0 +1,196 @@
+/* File:     mpi_vector_rma.c
+ *
+ * Purpose:  Compare the collective path of the vector addition
+ *           (MPI_Scatter of x and y from process 0, MPI_Gather of z)
+ *           with one-sided access through the windows of mpi_rma.h,
+ *           and measure reads of arbitrary subranges by every process.
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_vector_rma \
+ *              mpi_vector_rma.c mpi_rma.c mpi_vector_utils.c vector_ops.c -lm
+ * Run:      mpiexec -n <comm_sz> ./mpi_vector_rma <order of the vectors> <iterations> <subrange length>
+ *
+ * Input:    The order of the vectors, n, the number of repetitions and
+ *           the length of the subranges read in the last test
+ * Output:   Time per call to distribute x and y and to collect z with
+ *           each path, and the rate of subrange reads
+ *
+ * Notes:
+ * 1.  n should be evenly divisible by comm_sz
+ * 2.  In the RMA path process 0 puts x and y straight into the owners'
+ *     windows and gets z back from them; the owners only synchronize.
+ * 3.  In the subrange test every process gets slices of x, y and z at
+ *     pseudo-random offsets (most of them spanning blocks of other
+ *     processes) and checks z = x+y on them.  No process serves the
+ *     requests.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+#include "mpi_rma.h"
+
+void Check_sum(double x[], double y[], double z[], int n, int my_rank,
+      MPI_Comm comm);
+
+int main(int argc, char* argv[]) {
+    int n, local_n, iters, len, it, i, ok;
+    int comm_sz, my_rank;
+    double *x = NULL, *y = NULL, *z = NULL;
+    double *local_x, *local_y, *local_z, *sx, *sy, *sz;
+    long long first;
+    MPI_Comm comm;
+    Rma_vector rx, ry, rz;
+    double start, t[5], local_t[5];
+
+    // Initialize MPI
+    MPI_Init(&argc, &argv);
+    comm = MPI_COMM_WORLD;
+    MPI_Comm_size(comm, &comm_sz);
+    MPI_Comm_rank(comm, &my_rank);
+
+    if (argc != 4) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Usage: %s <order of the vectors> <iterations> <subrange length>\n", argv[0]);
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    n = atoi(argv[1]);
+    iters = atoi(argv[2]);
+    len = atoi(argv[3]);
+    if (n <= 0 || n % comm_sz != 0 || iters <= 0 || len <= 0 || len > n) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Order of the vectors should be a positive integer and evenly divisible by the number of processes, iterations positive and the subrange length in [1, n]\n");
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    local_n = n / comm_sz;
+
+    Allocate_vectors(&local_x, &local_y, &local_z, local_n, comm);
+    Allocate_vectors(&sx, &sy, &sz, len, comm);
+    if (my_rank == 0) {
+        x = Vec_alloc(n, sizeof(double));
+        y = Vec_alloc(n, sizeof(double));
+        z = Vec_alloc(n, sizeof(double));
+    }
+    Check_for_error(my_rank != 0 || (x != NULL && y != NULL && z != NULL),
+          "main", "Can't allocate vectors", comm);
+    if (my_rank == 0) {
+        Generate_vector(x, n, 0, 1);
+        Generate_vector(y, n, 0, 2);
+    }
+    Rma_create(&rx, local_n, comm);
+    Rma_create(&ry, local_n, comm);
+    Rma_create(&rz, local_n, comm);
+    for (i = 0; i < 5; i++)
+        local_t[i] = 0.0;
+
+    // Collective path
+    for (it = 0; it < iters; it++) {
+        MPI_Barrier(comm);
+        start = MPI_Wtime();
+        MPI_Scatter(x, local_n, MPI_DOUBLE, local_x, local_n, MPI_DOUBLE, 0, comm);
+        MPI_Scatter(y, local_n, MPI_DOUBLE, local_y, local_n, MPI_DOUBLE, 0, comm);
+        local_t[0] += MPI_Wtime() - start;
+        Parallel_vector_sum(local_x, local_y, local_z, local_n);
+        MPI_Barrier(comm);
+        start = MPI_Wtime();
+        MPI_Gather(local_z, local_n, MPI_DOUBLE, z, local_n, MPI_DOUBLE, 0, comm);
+        local_t[1] += MPI_Wtime() - start;
+    }
+    Check_sum(x, y, z, n, my_rank, comm);
+
+    // One-sided path
+    if (my_rank == 0)
+        for (i = 0; i < n; i++)
+            z[i] = 0.0;
+    for (it = 0; it < iters; it++) {
+        MPI_Barrier(comm);
+        start = MPI_Wtime();
+        if (my_rank == 0) {
+            Rma_put(&rx, 0, n, x);
+            Rma_put(&ry, 0, n, y);
+        }
+        Rma_sync(&rx);
+        Rma_sync(&ry);
+        local_t[2] += MPI_Wtime() - start;
+        Parallel_vector_sum(rx.local, ry.local, rz.local, local_n);
+        Rma_sync(&rz);
+        start = MPI_Wtime();
+        if (my_rank == 0)
+            Rma_get(&rz, 0, n, z);
+        local_t[3] += MPI_Wtime() - start;
+    }
+    Check_sum(x, y, z, n, my_rank, comm);
+
+    // Subranges read by every process, no root
+    MPI_Barrier(comm);
+    start = MPI_Wtime();
+    ok = 1;
+    for (it = 0; it < iters; it++) {
+        first = ((unsigned long long) (my_rank + 1)*2654435761ULL
+              + (unsigned long long) it*40503ULL) % (n - len + 1);
+        Rma_get(&rx, first, len, sx);
+        Rma_get(&ry, first, len, sy);
+        Rma_get(&rz, first, len, sz);
+        for (i = 0; i < len; i++)
+            if (sz[i] != sx[i] + sy[i]) ok = 0;
+    }
+    local_t[4] = MPI_Wtime() - start;
+    Check_for_error(ok, "main", "Subrange of z is not x+y", comm);
+
+    MPI_Reduce(local_t, t, 5, MPI_DOUBLE, MPI_MAX, 0, comm);
+    if (my_rank == 0) {
+        printf("%-12s %14s %14s\n", "path", "distribute s", "collect s");
+        printf("%-12s %14.6e %14.6e\n", "collective", t[0]/iters, t[1]/iters);
+        printf("%-12s %14.6e %14.6e\n", "one-sided", t[2]/iters, t[3]/iters);
+        printf("Subranges of %d elements: %.0f reads/s per process, %.2f GB/s in total\n",
+              len, 3.0*iters/t[4],
+              3.0*len*sizeof(double)*iters*comm_sz/t[4]/1.0e9);
+        printf("Collected z = x+y on both paths and on every subrange\n");
+    }
+
+    Rma_free(&rx);
+    Rma_free(&ry);
+    Rma_free(&rz);
+    free(local_x);
+    free(local_y);
+    free(local_z);
+    free(sx);
+    free(sy);
+    free(sz);
+    free(x);
+    free(y);
+    free(z);
+
+    MPI_Finalize();
+    return 0;
+}  /* main */
+
+/*---------------------------------------------------------------------
+ * Function:  Check_sum
+ * Purpose:   Verify z = x+y on process 0
+ * In args:   x, y, z:  full vectors (significant only on process 0)
+ *            n:        order of the vectors
+ *            my_rank:  calling process' rank in comm
+ *            comm:     communicator containing the calling processes
+ *
+ * Errors:    If z is wrong, the program terminates
+ */
+void Check_sum(
+      double    x[]      /* in */,
+      double    y[]      /* in */,
+      double    z[]      /* in */,
+      int       n        /* in */,
+      int       my_rank  /* in */,
+      MPI_Comm  comm     /* in */) {
+   int i, ok = 1;
+
+   if (my_rank == 0)
+      for (i = 0; i < n; i++)
+         if (z[i] != x[i] + y[i]) ok = 0;
+   Check_for_error(ok, "Check_sum", "Collected sum is not x+y", comm);
+}  /* Check_sum */
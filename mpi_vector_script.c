@@ -0,0 +1,373 @@
+/* File:     mpi_vector_script.c
+ *
+ * Purpose:  Run a script of operations on named distributed vectors in
+ *           one MPI job.  The vectors stay in memory between steps,
+ *           so a pipeline needs no relaunch, regeneration or reload.
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_vector_script \
+ *              mpi_vector_script.c mpi_vector_utils.c vector_ops.c -lm
+ * Run:      mpiexec -n <comm_sz> ./mpi_vector_script <script file> <order of the vectors>
+ *
+ * Input:    The script and the order of the vectors, n.  One statement
+ *           per line; blank lines and text after '#' are ignored:
+ *
+ *              gen   <v> <seed>      v = random vector (Generate_vector)
+ *              load  <v> <file>      v = the first n doubles of file
+ *              add   <z> <x> <y>     z = x+y
+ *              scale <v> <scalar>    v = scalar*v
+ *              dot   <x> <y>         print x.y
+ *              store <v> <file>      write v to file
+ *
+ *           gen, load and add create their destination if needed.
+ * Output:   For each step, its result (dot) and the time taken by the
+ *           slowest process; the total time at the end
+ *
+ * Notes:
+ * 1.  n should be evenly divisible by comm_sz
+ * 2.  Files hold raw doubles in native byte order, as in mpi_stream.h,
+ *     and are read and written with collective MPI-IO.
+ * 3.  Process 0 reads the script and broadcasts it; every process then
+ *     parses and runs it, so an error in a statement is found by all
+ *     of them and terminates the job with its line number.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+
+#define SCRIPT_MAX_VECS  32
+#define SCRIPT_NAME      32
+#define SCRIPT_PATH      256
+
+typedef struct {
+   char     name[SCRIPT_NAME];
+   double*  local;
+} Script_vector;
+
+char* Read_script(char path[], int my_rank, MPI_Comm comm);
+void Run_script(char text[], int local_n, int n, int my_rank,
+      MPI_Comm comm);
+double* Find_vector(Script_vector vecs[], int nvecs, char name[],
+      int line_no, MPI_Comm comm);
+double* Target_vector(Script_vector vecs[], int* nvecs_p, char name[],
+      int local_n, int line_no, MPI_Comm comm);
+void Load_vector(char path[], double local_v[], int local_n, int n,
+      int my_rank, int line_no, MPI_Comm comm);
+void Store_vector(char path[], double local_v[], int local_n, int n,
+      int my_rank, int line_no, MPI_Comm comm);
+void Script_error(int line_no, char message[], MPI_Comm comm);
+
+int main(int argc, char* argv[]) {
+    int n, local_n;
+    int comm_sz, my_rank;
+    char* text;
+    MPI_Comm comm;
+
+    // Initialize MPI
+    MPI_Init(&argc, &argv);
+    comm = MPI_COMM_WORLD;
+    MPI_Comm_size(comm, &comm_sz);
+    MPI_Comm_rank(comm, &my_rank);
+
+    if (argc != 3) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Usage: %s <script file> <order of the vectors>\n", argv[0]);
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    n = atoi(argv[2]);
+    if (n <= 0 || n % comm_sz != 0) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Order of the vectors should be a positive integer and evenly divisible by the number of processes\n");
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    local_n = n / comm_sz;
+
+    text = Read_script(argv[1], my_rank, comm);
+    Run_script(text, local_n, n, my_rank, comm);
+    free(text);
+
+    MPI_Finalize();
+    return 0;
+}  /* main */
+
+/*---------------------------------------------------------------------
+ * Function:  Read_script
+ * Purpose:   Read the script on process 0 and broadcast it
+ * In args:   path:     file name of the script
+ *            my_rank:  calling process' rank in comm
+ *            comm:     communicator containing the processes
+ * Ret val:   The text of the script, NUL-terminated, on every process
+ *
+ * Errors:    If the script can't be read, the program terminates
+ */
+char* Read_script(
+      char      path[]   /* in */,
+      int       my_rank  /* in */,
+      MPI_Comm  comm     /* in */) {
+   FILE* fp;
+   long len = -1;
+   char* text = NULL;
+
+   if (my_rank == 0) {
+      fp = fopen(path, "r");
+      if (fp != NULL && fseek(fp, 0, SEEK_END) == 0) {
+         len = ftell(fp);
+         text = len >= 0 ? malloc(len + 1) : NULL;
+         rewind(fp);
+         if (text == NULL || fread(text, 1, len, fp) != (size_t) len)
+            len = -1;
+      }
+      if (fp != NULL) fclose(fp);
+   }
+   MPI_Bcast(&len, 1, MPI_LONG, 0, comm);
+   Check_for_error(len >= 0, "Read_script", "Can't read the script", comm);
+
+   if (my_rank != 0) text = malloc(len + 1);
+   Check_for_error(text != NULL, "Read_script", "Can't allocate the script",
+         comm);
+   MPI_Bcast(text, len, MPI_CHAR, 0, comm);
+   text[len] = '\0';
+   return text;
+}  /* Read_script */
+
+/*---------------------------------------------------------------------
+ * Function:  Run_script
+ * Purpose:   Run the statements of a script in order
+ * In args:   local_n, n:  local and global order of the vectors
+ *            my_rank:     calling process' rank in comm
+ *            comm:        communicator containing the vectors
+ * In/out:    text:        the script (split into lines in place)
+ *
+ * Errors:    A malformed statement terminates the program
+ */
+void Run_script(
+      char      text[]   /* in/out */,
+      int       local_n  /* in     */,
+      int       n        /* in     */,
+      int       my_rank  /* in     */,
+      MPI_Comm  comm     /* in     */) {
+   Script_vector vecs[SCRIPT_MAX_VECS];
+   int nvecs = 0, line_no = 0, step = 0, nargs, v;
+   char op[16], a1[SCRIPT_PATH], a2[SCRIPT_PATH], a3[SCRIPT_PATH], extra[2];
+   char *line, *next, *hash;
+   double *x, *y, *z, local_dot, dot = 0.0, scalar;
+   double start, local_time, time, total = 0.0;
+
+   for (line = text; line != NULL; line = next) {
+      line_no++;
+      next = strchr(line, '\n');
+      if (next != NULL) *next++ = '\0';
+      hash = strchr(line, '#');
+      if (hash != NULL) *hash = '\0';
+
+      nargs = sscanf(line, "%15s %255s %255s %255s %1s", op, a1, a2, a3,
+            extra);
+      if (nargs <= 0) continue;
+
+      MPI_Barrier(comm);
+      start = MPI_Wtime();
+      if (strcmp(op, "gen") == 0 && nargs == 3) {
+         z = Target_vector(vecs, &nvecs, a1, local_n, line_no, comm);
+         Generate_vector(z, local_n, my_rank, atoi(a2));
+      } else if (strcmp(op, "load") == 0 && nargs == 3) {
+         z = Target_vector(vecs, &nvecs, a1, local_n, line_no, comm);
+         Load_vector(a2, z, local_n, n, my_rank, line_no, comm);
+      } else if (strcmp(op, "add") == 0 && nargs == 4) {
+         x = Find_vector(vecs, nvecs, a2, line_no, comm);
+         y = Find_vector(vecs, nvecs, a3, line_no, comm);
+         z = Target_vector(vecs, &nvecs, a1, local_n, line_no, comm);
+         Parallel_vector_sum(x, y, z, local_n);
+      } else if (strcmp(op, "scale") == 0 && nargs == 3) {
+         z = Find_vector(vecs, nvecs, a1, line_no, comm);
+         scalar = atof(a2);
+         Parallel_scalar_multiplication(z, local_n, scalar);
+      } else if (strcmp(op, "dot") == 0 && nargs == 3) {
+         x = Find_vector(vecs, nvecs, a1, line_no, comm);
+         y = Find_vector(vecs, nvecs, a2, line_no, comm);
+         local_dot = Parallel_dot_product(x, y, local_n);
+         MPI_Reduce(&local_dot, &dot, 1, MPI_DOUBLE, MPI_SUM, 0, comm);
+      } else if (strcmp(op, "store") == 0 && nargs == 3) {
+         z = Find_vector(vecs, nvecs, a1, line_no, comm);
+         Store_vector(a2, z, local_n, n, my_rank, line_no, comm);
+      } else {
+         Script_error(line_no, "unknown statement or wrong number of arguments",
+               comm);
+      }
+      local_time = MPI_Wtime() - start;
+      MPI_Reduce(&local_time, &time, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+      total += time;
+      step++;
+
+      if (my_rank == 0) {
+         printf("Step %3d (line %3d): %-32s %f seconds", step, line_no,
+               line + strspn(line, " \t"), time);
+         if (strcmp(op, "dot") == 0) printf("  => %f", dot);
+         printf("\n");
+      }
+   }
+
+   if (my_rank == 0)
+      printf("%d steps on %d vectors took %f seconds\n", step, nvecs, total);
+
+   for (v = 0; v < nvecs; v++)
+      free(vecs[v].local);
+}  /* Run_script */
+
+/*---------------------------------------------------------------------
+ * Function:  Find_vector
+ * Purpose:   Look up an existing vector by name
+ * In args:   vecs, nvecs:  the vectors of the script
+ *            name:         the name
+ *            line_no:      line of the statement, for errors
+ *            comm:         communicator containing the vectors
+ * Ret val:   The local block of the vector
+ *
+ * Errors:    If there is no such vector, the program terminates
+ */
+double* Find_vector(
+      Script_vector  vecs[]   /* in */,
+      int            nvecs    /* in */,
+      char           name[]   /* in */,
+      int            line_no  /* in */,
+      MPI_Comm       comm     /* in */) {
+   int v;
+
+   for (v = 0; v < nvecs; v++)
+      if (strcmp(vecs[v].name, name) == 0) return vecs[v].local;
+   Script_error(line_no, "undefined vector", comm);
+   return NULL;
+}  /* Find_vector */
+
+/*---------------------------------------------------------------------
+ * Function:  Target_vector
+ * Purpose:   Look up the destination of a statement, creating it if it
+ *            doesn't exist yet
+ * In args:   name:      the name
+ *            local_n:   size of the local blocks
+ *            line_no:   line of the statement, for errors
+ *            comm:      communicator containing the vectors
+ * In/out:    vecs, nvecs_p:  the vectors of the script
+ * Ret val:   The local block of the vector
+ *
+ * Errors:    Too many vectors or a name that is too long terminate the
+ *            program
+ */
+double* Target_vector(
+      Script_vector  vecs[]    /* in/out */,
+      int*           nvecs_p   /* in/out */,
+      char           name[]    /* in     */,
+      int            local_n   /* in     */,
+      int            line_no   /* in     */,
+      MPI_Comm       comm      /* in     */) {
+   int v;
+
+   for (v = 0; v < *nvecs_p; v++)
+      if (strcmp(vecs[v].name, name) == 0) return vecs[v].local;
+   if (*nvecs_p == SCRIPT_MAX_VECS)
+      Script_error(line_no, "too many vectors", comm);
+   if (strlen(name) >= SCRIPT_NAME)
+      Script_error(line_no, "vector name too long", comm);
+
+   v = (*nvecs_p)++;
+   strcpy(vecs[v].name, name);
+   Allocate_vectors(&vecs[v].local, NULL, NULL, local_n, comm);
+   return vecs[v].local;
+}  /* Target_vector */
+
+/*---------------------------------------------------------------------
+ * Function:  Load_vector
+ * Purpose:   Read the first n doubles of a file into a vector
+ * In args:   path:        file name
+ *            local_n, n:  local and global order of the vector
+ *            my_rank:     calling process' rank in comm
+ *            line_no:     line of the statement, for errors
+ *            comm:        communicator containing the vector
+ * Out args:  local_v:     local block of the vector
+ *
+ * Errors:    A missing or short file terminates the program
+ */
+void Load_vector(
+      char      path[]     /* in  */,
+      double    local_v[]  /* out */,
+      int       local_n    /* in  */,
+      int       n          /* in  */,
+      int       my_rank    /* in  */,
+      int       line_no    /* in  */,
+      MPI_Comm  comm       /* in  */) {
+   MPI_File fh;
+   MPI_Offset size = 0;
+   int ok;
+
+   ok = MPI_File_open(comm, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh)
+         == MPI_SUCCESS;
+   if (!ok) Script_error(line_no, "can't open the file", comm);
+   MPI_File_get_size(fh, &size);
+   ok = size >= (MPI_Offset) n*(MPI_Offset) sizeof(double) &&
+        MPI_File_read_at_all(fh,
+              (MPI_Offset) my_rank*local_n*(MPI_Offset) sizeof(double),
+              local_v, local_n, MPI_DOUBLE, MPI_STATUS_IGNORE) == MPI_SUCCESS;
+   MPI_File_close(&fh);
+   Check_for_error(ok, "Load_vector", "File too short or unreadable", comm);
+}  /* Load_vector */
+
+/*---------------------------------------------------------------------
+ * Function:  Store_vector
+ * Purpose:   Write a vector to a file of exactly n doubles
+ * In args:   path:        file name
+ *            local_v:     local block of the vector
+ *            local_n, n:  local and global order of the vector
+ *            my_rank:     calling process' rank in comm
+ *            line_no:     line of the statement, for errors
+ *            comm:        communicator containing the vector
+ *
+ * Errors:    If the file can't be written, the program terminates
+ */
+void Store_vector(
+      char      path[]     /* in */,
+      double    local_v[]  /* in */,
+      int       local_n    /* in */,
+      int       n          /* in */,
+      int       my_rank    /* in */,
+      int       line_no    /* in */,
+      MPI_Comm  comm       /* in */) {
+   MPI_File fh;
+   int ok;
+
+   ok = MPI_File_open(comm, path, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+         MPI_INFO_NULL, &fh) == MPI_SUCCESS;
+   if (!ok) Script_error(line_no, "can't create the file", comm);
+   ok = MPI_File_set_size(fh, (MPI_Offset) n*(MPI_Offset) sizeof(double))
+              == MPI_SUCCESS &&
+        MPI_File_write_at_all(fh,
+              (MPI_Offset) my_rank*local_n*(MPI_Offset) sizeof(double),
+              local_v, local_n, MPI_DOUBLE, MPI_STATUS_IGNORE) == MPI_SUCCESS;
+   MPI_File_close(&fh);
+   Check_for_error(ok, "Store_vector", "Can't write the file", comm);
+}  /* Store_vector */
+
+/*---------------------------------------------------------------------
+ * Function:  Script_error
+ * Purpose:   Report an error in a statement and terminate
+ * In args:   line_no:  line of the statement
+ *            message:  what is wrong
+ *            comm:     communicator containing the processes
+ *
+ * Note:
+ *    Every process finds the same error, so all of them call this.
+ */
+void Script_error(
+      int       line_no    /* in */,
+      char      message[]  /* in */,
+      MPI_Comm  comm       /* in */) {
+   char text[128];
+
+   snprintf(text, sizeof(text), "line %d: %s", line_no, message);
+   Check_for_error(0, "Run_script", text, comm);
+}  /* Script_error */
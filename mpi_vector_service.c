@@ -0,0 +1,286 @@
+/* File:     mpi_vector_service.c
+ *
+ * Purpose:  Resident vector service: one MPI job keeps its processes
+ *           and a pool of distributed vectors alive and runs the
+ *           operations requested by clients (vector_client.c), so a
+ *           request costs no mpiexec, MPI_Init or allocation.
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_vector_service \
+ *              mpi_vector_service.c mpi_vector_utils.c vector_ops.c -lm
+ * Run:      mpiexec -n <comm_sz> ./mpi_vector_service [<socket path>]
+ *
+ * Input:    Requests (see mpi_service.h) on a Unix socket, by default
+ *           SVC_SOCKET
+ * Output:   A reply per request; on shutdown, the number of requests
+ *           served and their mean service time
+ *
+ * Notes:
+ * 1.  Process 0 listens on the socket and multiplexes up to
+ *     SVC_MAX_CLIENTS connections with poll.  Each request it reads is
+ *     broadcast to the other processes, run by all of them, and
+ *     answered; requests from concurrent clients are served one at a
+ *     time, in the order poll reports them.  A request may arrive in
+ *     pieces: process 0 buffers what each client has sent so far and
+ *     never waits on one client while others are ready.  While
+ *     SVC_MAX_CLIENTS are connected, further connections wait in the
+ *     listen backlog.
+ * 2.  Invalid requests are rejected by process 0 without involving
+ *     the others.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+#include "mpi_service.h"
+
+typedef struct {
+   double    *local_x, *local_y, *local_z;
+   int       local_n, capacity;
+} Vector_pool;
+
+typedef struct {
+   Svc_request   req;    /* the request being read         */
+   size_t        got;    /* bytes of it received so far    */
+} Client;
+
+int Open_socket(char path[]);
+void Serve(int listen_fd, Vector_pool* pool, int comm_sz, MPI_Comm comm);
+int Valid_request(Svc_request* req, int comm_sz);
+double Run_request(Svc_request* req, Vector_pool* pool, int my_rank,
+      int comm_sz, MPI_Comm comm);
+
+int main(int argc, char* argv[]) {
+    int comm_sz, my_rank, listen_fd = -1;
+    char* path = SVC_SOCKET;
+    MPI_Comm comm;
+    Vector_pool pool = {NULL, NULL, NULL, 0, 0};
+    Svc_request req;
+
+    // Initialize MPI
+    MPI_Init(&argc, &argv);
+    comm = MPI_COMM_WORLD;
+    MPI_Comm_size(comm, &comm_sz);
+    MPI_Comm_rank(comm, &my_rank);
+
+    if (argc > 2) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Usage: %s [<socket path>]\n", argv[0]);
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+    if (argc == 2) path = argv[1];
+
+    if (my_rank == 0) listen_fd = Open_socket(path);
+    Check_for_error(my_rank != 0 || listen_fd >= 0, "main",
+          "Can't listen on the socket", comm);
+
+    if (my_rank == 0) {
+        printf("Serving on %s with %d processes\n", path, comm_sz);
+        fflush(stdout);
+        Serve(listen_fd, &pool, comm_sz, comm);
+        close(listen_fd);
+        unlink(path);
+    } else {
+        do {
+            MPI_Bcast(&req, sizeof(req), MPI_BYTE, 0, comm);
+            Run_request(&req, &pool, my_rank, comm_sz, comm);
+        } while (req.op != SVC_SHUTDOWN);
+    }
+
+    free(pool.local_x);
+    free(pool.local_y);
+    free(pool.local_z);
+
+    MPI_Finalize();
+    return 0;
+}  /* main */
+
+/*---------------------------------------------------------------------
+ * Function:  Open_socket
+ * Purpose:   Create a listening Unix socket at path, replacing a stale
+ *            one
+ * In args:   path:  file name of the socket
+ * Ret val:   The socket, or -1 on failure
+ */
+int Open_socket(char path[] /* in */) {
+   struct sockaddr_un addr;
+   int fd;
+
+   if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+   fd = socket(AF_UNIX, SOCK_STREAM, 0);
+   if (fd < 0) return -1;
+   memset(&addr, 0, sizeof(addr));
+   addr.sun_family = AF_UNIX;
+   strcpy(addr.sun_path, path);
+   unlink(path);
+   if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0
+         || listen(fd, SVC_MAX_CLIENTS) != 0) {
+      close(fd);
+      return -1;
+   }
+   return fd;
+}  /* Open_socket */
+
+/*---------------------------------------------------------------------
+ * Function:  Serve
+ * Purpose:   Accept clients and run their requests until one asks for
+ *            shutdown (process 0 only)
+ * In args:   listen_fd:  the listening socket
+ *            comm_sz:    number of processes in comm
+ *            comm:       communicator of the service
+ * In/out:    pool:       process 0's blocks of the vectors
+ */
+void Serve(
+      int           listen_fd  /* in     */,
+      Vector_pool*  pool       /* in/out */,
+      int           comm_sz    /* in     */,
+      MPI_Comm      comm       /* in     */) {
+   struct pollfd fds[SVC_MAX_CLIENTS + 1];
+   Client clients[SVC_MAX_CLIENTS + 1];
+   int nfds = 1, i, fd, done = 0;
+   long long served = 0;
+   double start, busy = 0.0;
+   Svc_request req;
+   Svc_reply reply;
+   ssize_t got;
+
+   fds[0].fd = listen_fd;
+   while (!done) {
+      // Leave new connections in the backlog while every slot is taken
+      fds[0].events = nfds <= SVC_MAX_CLIENTS ? POLLIN : 0;
+      if (poll(fds, nfds, -1) < 0) continue;
+
+      for (i = nfds - 1; i >= 1 && !done; i--) {
+         if (fds[i].revents == 0) continue;
+         got = recv(fds[i].fd, (char*) &clients[i].req + clients[i].got,
+               sizeof(req) - clients[i].got, MSG_DONTWAIT);
+         if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK
+               || errno == EINTR))
+            continue;
+         if (got <= 0) {
+            // Client gone: drop it
+            close(fds[i].fd);
+            fds[i] = fds[--nfds];
+            clients[i] = clients[nfds];
+            continue;
+         }
+         clients[i].got += got;
+         if (clients[i].got < sizeof(req)) continue;
+         req = clients[i].req;
+         clients[i].got = 0;
+
+         start = MPI_Wtime();
+         if (Valid_request(&req, comm_sz)) {
+            MPI_Bcast(&req, sizeof(req), MPI_BYTE, 0, comm);
+            reply.result = Run_request(&req, pool, 0, comm_sz, comm);
+            reply.status = 0;
+            done = req.op == SVC_SHUTDOWN;
+         } else {
+            reply.result = 0.0;
+            reply.status = -1;
+         }
+         reply.service_time = MPI_Wtime() - start;
+         busy += reply.service_time;
+         served++;
+         send(fds[i].fd, &reply, sizeof(reply), MSG_NOSIGNAL);
+      }
+
+      if ((fds[0].revents & POLLIN) && nfds <= SVC_MAX_CLIENTS) {
+         fd = accept(listen_fd, NULL, NULL);
+         if (fd >= 0) {
+            fds[nfds].fd = fd;
+            fds[nfds].events = POLLIN;
+            fds[nfds].revents = 0;
+            clients[nfds].got = 0;
+            nfds++;
+         }
+      }
+   }
+
+   for (i = 1; i < nfds; i++)
+      close(fds[i].fd);
+   printf("Served %lld requests, mean service time %e seconds\n", served,
+         served > 0 ? busy/served : 0.0);
+}  /* Serve */
+
+/*---------------------------------------------------------------------
+ * Function:  Valid_request
+ * Purpose:   Check a request before it is broadcast
+ * In args:   req:      the request
+ *            comm_sz:  number of processes
+ * Ret val:   1 if the request can be run, 0 otherwise
+ */
+int Valid_request(
+      Svc_request*  req      /* in */,
+      int           comm_sz  /* in */) {
+   if (req->op < SVC_PING || req->op > SVC_SHUTDOWN) return 0;
+   if (req->op == SVC_GEN)
+      return req->n > 0 && req->n % comm_sz == 0
+            && req->n/comm_sz <= 0x7fffffff;
+   return 1;
+}  /* Valid_request */
+
+/*---------------------------------------------------------------------
+ * Function:  Run_request
+ * Purpose:   Run a request on the pool (all processes)
+ * In args:   req:      the request
+ *            my_rank:  calling process' rank in comm
+ *            comm_sz:  number of processes in comm
+ *            comm:     communicator of the service
+ * In/out:    pool:     the calling process' blocks of the vectors
+ * Ret val:   The result of the operation (significant on process 0)
+ *
+ * Note:
+ *    SVC_GEN reallocates the blocks only if they must grow.
+ */
+double Run_request(
+      Svc_request*  req      /* in     */,
+      Vector_pool*  pool     /* in/out */,
+      int           my_rank  /* in     */,
+      int           comm_sz  /* in     */,
+      MPI_Comm      comm     /* in     */) {
+   double local_result, result = 0.0;
+   int local_n;
+
+   switch (req->op) {
+      case SVC_GEN:
+         local_n = req->n/comm_sz;
+         if (local_n > pool->capacity) {
+            free(pool->local_x);
+            free(pool->local_y);
+            free(pool->local_z);
+            Allocate_vectors(&pool->local_x, &pool->local_y, &pool->local_z,
+                  local_n, comm);
+            pool->capacity = local_n;
+         }
+         pool->local_n = local_n;
+         Generate_vector(pool->local_x, local_n, my_rank, req->seed);
+         Generate_vector(pool->local_y, local_n, my_rank, req->seed + 1);
+         result = req->n;
+         break;
+      case SVC_ADD:
+         Parallel_vector_sum(pool->local_x, pool->local_y, pool->local_z,
+               pool->local_n);
+         local_result = Vector_total(pool->local_z, pool->local_n);
+         MPI_Reduce(&local_result, &result, 1, MPI_DOUBLE, MPI_SUM, 0, comm);
+         break;
+      case SVC_DOT:
+         local_result = Parallel_dot_product(pool->local_x, pool->local_y,
+               pool->local_n);
+         MPI_Reduce(&local_result, &result, 1, MPI_DOUBLE, MPI_SUM, 0, comm);
+         break;
+      case SVC_SCALE:
+         Parallel_scalar_multiplication(pool->local_x, pool->local_n,
+               req->scalar);
+         break;
+   }
+   return result;
+}  /* Run_request */
@@ -0,0 +1,180 @@
+/* File:     mpi_vector_stats.c
+ *
+ * Purpose:  Profile a block-distributed vector (min, max, argmin,
+ *           argmax, mean, variance and histogram) with the fused
+ *           single-pass, single-collective Parallel_stats, and compare
+ *           it with computing each statistic separately.
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_vector_stats \
+ *              mpi_vector_stats.c mpi_stats.c mpi_vector_utils.c vector_ops.c -lm
+ * Run:      mpiexec -n <comm_sz> ./mpi_vector_stats <order of the vector> <bins>
+ *
+ * Input:    The order of the vector, n, and the number of histogram bins
+ * Output:   The profile, the total difference between the two ways
+ *           of computing it and the time each took
+ *
+ * Notes:
+ * 1.  The order of the vector, n, should be evenly divisible by comm_sz
+ * 2.  The values are random in [0, 1], so the histogram covers [0, 1).
+ * 3.  The separate path makes four passes over the local block and
+ *     five collectives.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+#include "mpi_stats.h"
+
+void Separate_stats(Vec_stats* s, long long hist[], const double local_x[],
+      int local_n, int my_rank, MPI_Comm comm);
+
+int main(int argc, char* argv[]) {
+    int n, local_n, nbins, b;
+    int comm_sz, my_rank;
+    double *local_x;
+    Vec_stats *fused, *separate;
+    long long* local_hist;
+    MPI_Comm comm;
+    double start, fused_time, separate_time, diff;
+
+    // Initialize MPI
+    MPI_Init(&argc, &argv);
+    comm = MPI_COMM_WORLD;
+    MPI_Comm_size(comm, &comm_sz);
+    MPI_Comm_rank(comm, &my_rank);
+
+    if (argc != 3) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Usage: %s <order of the vector> <bins>\n", argv[0]);
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    n = atoi(argv[1]);
+    nbins = atoi(argv[2]);
+    if (n <= 0 || n % comm_sz != 0 || nbins <= 0) {
+        if (my_rank == 0) {
+            fprintf(stderr, "Order of the vector should be a positive integer and evenly divisible by the number of processes, and bins positive\n");
+        }
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    local_n = n / comm_sz;
+
+    Allocate_vectors(&local_x, NULL, NULL, local_n, comm);
+    fused = Stats_alloc(nbins, 0.0, 1.0);
+    separate = Stats_alloc(nbins, 0.0, 1.0);
+    local_hist = malloc(nbins*sizeof(long long));
+    Check_for_error(fused != NULL && separate != NULL && local_hist != NULL,
+          "main", "Can't allocate profiles", comm);
+
+    Generate_vector(local_x, local_n, my_rank, 1);
+    Print_vector(local_x, local_n, n, "=> The vector is", my_rank, comm);
+
+    MPI_Barrier(comm);
+    start = MPI_Wtime();
+    Parallel_stats(fused, local_x, local_n, comm);
+    fused_time = MPI_Wtime() - start;
+
+    MPI_Barrier(comm);
+    start = MPI_Wtime();
+    Separate_stats(separate, local_hist, local_x, local_n, my_rank, comm);
+    separate_time = MPI_Wtime() - start;
+
+    if (my_rank == 0) {
+        diff = fabs(fused->mean - separate->mean) +
+              fabs(fused->m2 - separate->m2)/fused->count;
+        for (b = 0; b < nbins; b++)
+            diff += llabs(fused->hist[b] - separate->hist[b]);
+        if (fused->argmin != separate->argmin) diff += 1.0;
+        if (fused->argmax != separate->argmax) diff += 1.0;
+
+        printf("min      = %f at %lld\n", fused->min, fused->argmin);
+        printf("max      = %f at %lld\n", fused->max, fused->argmax);
+        printf("mean     = %f\n", fused->mean);
+        printf("variance = %f (sample %f)\n", fused->m2/fused->count,
+              fused->count > 1 ? fused->m2/(fused->count - 1) : 0.0);
+        printf("histogram over [%g, %g), %lld below, %lld above:\n",
+              fused->lo, fused->hi, fused->below, fused->above);
+        for (b = 0; b < nbins; b++)
+            printf("\t[%f, %f)  %lld\n", fused->lo + b*(fused->hi - fused->lo)/nbins,
+                  fused->lo + (b + 1)*(fused->hi - fused->lo)/nbins, fused->hist[b]);
+        printf("Difference between fused and separate profiles: %e\n", diff);
+        printf("Fused profile (1 pass, 1 collective) took %f seconds\n", fused_time);
+        printf("Separate profile (4 passes, 5 collectives) took %f seconds\n", separate_time);
+    }
+
+    free(local_x);
+    free(local_hist);
+    free(fused);
+    free(separate);
+
+    MPI_Finalize();
+    return 0;
+}  /* main */
+
+/*---------------------------------------------------------------------
+ * Function:  Separate_stats
+ * Purpose:   Reference profile: one pass and one collective per
+ *            statistic (extremes, mean, variance, histogram)
+ * In args:   local_x:  local block of the vector
+ *            local_n:  size of the local block
+ *            my_rank:  calling process' rank
+ *            comm:     communicator containing the vector
+ * Out args:  s:        the profile (on every process)
+ *            hist:     scratch storage for nbins local counts
+ */
+void Separate_stats(
+      Vec_stats*    s          /* out */,
+      long long     hist[]     /* out */,
+      const double  local_x[]  /* in  */,
+      int           local_n    /* in  */,
+      int           my_rank    /* in  */,
+      MPI_Comm      comm       /* in  */) {
+   struct { double val; int idx; } in[2], out[2];
+   double local_sum, d;
+   long long b;
+   int i;
+
+   in[0].val = in[1].val = local_x[0];
+   in[0].idx = in[1].idx = 0;
+   for (i = 1; i < local_n; i++) {
+      if (local_x[i] < in[0].val) { in[0].val = local_x[i]; in[0].idx = i; }
+      if (local_x[i] > in[1].val) { in[1].val = local_x[i]; in[1].idx = i; }
+   }
+   in[0].idx += my_rank*local_n;
+   in[1].idx += my_rank*local_n;
+   MPI_Allreduce(&in[0], &out[0], 1, MPI_DOUBLE_INT, MPI_MINLOC, comm);
+   MPI_Allreduce(&in[1], &out[1], 1, MPI_DOUBLE_INT, MPI_MAXLOC, comm);
+   s->min = out[0].val;
+   s->argmin = out[0].idx;
+   s->max = out[1].val;
+   s->argmax = out[1].idx;
+
+   local_sum = 0.0;
+   for (i = 0; i < local_n; i++)
+      local_sum += local_x[i];
+   MPI_Allreduce(&local_sum, &s->mean, 1, MPI_DOUBLE, MPI_SUM, comm);
+   MPI_Comm_size(comm, &i);
+   s->count = (long long)i*local_n;
+   s->mean /= s->count;
+
+   local_sum = 0.0;
+   for (i = 0; i < local_n; i++) {
+      d = local_x[i] - s->mean;
+      local_sum += d*d;
+   }
+   MPI_Allreduce(&local_sum, &s->m2, 1, MPI_DOUBLE, MPI_SUM, comm);
+
+   for (b = 0; b < s->nbins; b++)
+      hist[b] = 0;
+   for (i = 0; i < local_n; i++) {
+      b = (long long)((local_x[i] - s->lo)*(s->nbins/(s->hi - s->lo)));
+      if (local_x[i] >= s->lo && local_x[i] < s->hi)
+         hist[b < s->nbins ? b : s->nbins - 1]++;
+   }
+   MPI_Allreduce(hist, s->hist, s->nbins, MPI_LONG_LONG, MPI_SUM, comm);
+}  /* Separate_stats */
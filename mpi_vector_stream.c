@@ -0,0 +1,98 @@
+/* File:     mpi_vector_stream.c
+ *
+ * Purpose:  Out-of-core vector operations on file-backed vectors:
+ *           generate a vector file, add two vector files, or take the
+ *           dot product of two vector files, with constant memory per
+ *           process.
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_vector_stream \
+ *              mpi_vector_stream.c mpi_stream.c mpi_vector_utils.c vector_ops.c -lm
+ * Run:      mpiexec -n <comm_sz> ./mpi_vector_stream gen <file> <order> <chunk>
+ *           mpiexec -n <comm_sz> ./mpi_vector_stream add <x file> <y file> <z file> <chunk>
+ *           mpiexec -n <comm_sz> ./mpi_vector_stream dot <x file> <y file> <chunk>
+ *
+ * Input:    The files and the number of elements per buffer, chunk
+ * Output:   The dot product (dot), the time taken and the I/O
+ *           throughput in GB/s (bytes read plus written)
+ *
+ * Notes:
+ * 1.  Each process holds 2 buffers of chunk doubles per file, no
+ *     matter how large the vectors are.
+ * 2.  Files are raw native doubles (see mpi_stream.h).
+ * 3.  gen seeds the generator with the time and a hash of the file
+ *     name, so x and y generated within the same second differ.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include "mpi_stream.h"
+
+void Usage(char prog_name[], int my_rank);
+int Path_seed(char path[]);
+
+int main(int argc, char* argv[]) {
+    int comm_sz, my_rank, chunk;
+    MPI_Comm comm;
+    Stream_report report;
+    double dot = 0.0;
+
+    // Initialize MPI
+    MPI_Init(&argc, &argv);
+    comm = MPI_COMM_WORLD;
+    MPI_Comm_size(comm, &comm_sz);
+    MPI_Comm_rank(comm, &my_rank);
+
+    if (argc < 2) Usage(argv[0], my_rank);
+    chunk = atoi(argv[argc - 1]);
+    if (chunk <= 0) Usage(argv[0], my_rank);
+
+    if (strcmp(argv[1], "gen") == 0 && argc == 5) {
+        if (atoll(argv[3]) <= 0) Usage(argv[0], my_rank);
+        Stream_generate(argv[2], atoll(argv[3]), chunk, Path_seed(argv[2]),
+              &report, comm);
+    } else if (strcmp(argv[1], "add") == 0 && argc == 6) {
+        Stream_vector_sum(argv[2], argv[3], argv[4], chunk, &report, comm);
+    } else if (strcmp(argv[1], "dot") == 0 && argc == 5) {
+        dot = Stream_dot_product(argv[2], argv[3], chunk, &report, comm);
+    } else {
+        Usage(argv[0], my_rank);
+    }
+
+    if (my_rank == 0) {
+        if (strcmp(argv[1], "dot") == 0)
+            printf("The dot product is %f\n", dot);
+        printf("Streaming %s of %lld elements took %f seconds (%.2f GB/s)\n",
+              argv[1], (long long)report.n, report.time,
+              report.bytes/report.time/1.0e9);
+    }
+
+    MPI_Finalize();
+    return 0;
+}  /* main */
+
+/*---------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   Print the command lines and terminate
+ */
+void Usage(char prog_name[], int my_rank) {
+    if (my_rank == 0) {
+        fprintf(stderr, "Usage: %s gen <file> <order> <chunk>\n", prog_name);
+        fprintf(stderr, "       %s add <x file> <y file> <z file> <chunk>\n", prog_name);
+        fprintf(stderr, "       %s dot <x file> <y file> <chunk>\n", prog_name);
+    }
+    MPI_Finalize();
+    exit(-1);
+}  /* Usage */
+
+/*---------------------------------------------------------------------
+ * Function:  Path_seed
+ * Purpose:   Seed for generating a file: the FNV-1a hash of its path
+ */
+int Path_seed(char path[]) {
+    unsigned int h = 2166136261u;
+
+    for (; *path != '\0'; path++)
+        h = (h ^ (unsigned char) *path)*16777619u;
+    return (int) h;
+}  /* Path_seed */
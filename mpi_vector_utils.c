@@ -0,0 +1,215 @@
+/* File:     mpi_vector_utils.c
+ *
+ * Purpose:  Helpers shared by mpi_vector_add.c and
+ *           mpi_vector_operations.c for vectors with a block
+ *           distribution.
+ *
+ * Notes:
+ * 1.  The order of the vectors, n, should be evenly divisible
+ *     by comm_sz
+ * 2.  When an error is detected, a message is printed and the
+ *     processes quit.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include "mpi_vector_utils.h"
+
+/*-------------------------------------------------------------------
+ * Function:  Check_for_error
+ * Purpose:   Check whether any process has found an error.  If so,
+ *            print message and terminate all processes.  Otherwise,
+ *            continue execution.
+ * In args:   local_ok:  1 if calling process has found an error, 0
+ *               otherwise
+ *            fname:     name of function calling Check_for_error
+ *            message:   message to print if there's an error
+ *            comm:      communicator containing processes calling
+ *                       Check_for_error:  should be MPI_COMM_WORLD.
+ *
+ * Note:
+ *    The communicator containing the processes calling Check_for_error
+ *    should be MPI_COMM_WORLD.
+ */
+void Check_for_error(
+      int       local_ok   /* in */,
+      char      fname[]    /* in */,
+      char      message[]  /* in */,
+      MPI_Comm  comm       /* in */) {
+   int ok;
+
+   MPI_Allreduce(&local_ok, &ok, 1, MPI_INT, MPI_MIN, comm);
+   if (ok == 0) {
+      int my_rank;
+      MPI_Comm_rank(comm, &my_rank);
+      if (my_rank == 0) {
+         fprintf(stderr, "Proc %d > In %s, %s\n", my_rank, fname,
+               message);
+         fflush(stderr);
+      }
+      MPI_Finalize();
+      exit(-1);
+   }
+}  /* Check_for_error */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Read_n
+ * Purpose:   Get the order of the vectors from stdin on proc 0 and
+ *            broadcast to other processes.
+ * In args:   my_rank:    process rank in communicator
+ *            comm_sz:    number of processes in communicator
+ *            comm:       communicator containing all the processes
+ *                        calling Read_n
+ * Out args:  n_p:        global value of n
+ *            local_n_p:  local value of n = n/comm_sz
+ *
+ * Errors:    n should be positive and evenly divisible by comm_sz
+ */
+void Read_n(
+      int*      n_p        /* out */,
+      int*      local_n_p  /* out */,
+      int       my_rank    /* in  */,
+      int       comm_sz    /* in  */,
+      MPI_Comm  comm       /* in  */) {
+   int local_ok = 1;
+   char *fname = "Read_n";
+
+   if (my_rank == 0) {
+      printf("What's the order of the vectors?\n");
+      scanf("%d", n_p);
+   }
+   MPI_Bcast(n_p, 1, MPI_INT, 0, comm);
+   if (*n_p <= 0 || *n_p % comm_sz != 0) local_ok = 0;
+   Check_for_error(local_ok, fname,
+         "n should be > 0 and evenly divisible by comm_sz", comm);
+   *local_n_p = *n_p/comm_sz;
+}  /* Read_n */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Allocate_vectors
+ * Purpose:   Allocate aligned storage for x, y, and z
+ * In args:   local_n:  the size of the local vectors
+ *            comm:     the communicator containing the calling processes
+ * Out args:  local_x_pp, local_y_pp, local_z_pp:  pointers to memory
+ *               blocks to be allocated for local vectors.  Any of
+ *               them may be NULL if that vector isn't needed.
+ *
+ * Errors:    One or more of the allocations fails
+ */
+void Allocate_vectors(
+      double**   local_x_pp  /* out */,
+      double**   local_y_pp  /* out */,
+      double**   local_z_pp  /* out */,
+      int        local_n     /* in  */,
+      MPI_Comm   comm        /* in  */) {
+   int local_ok = 1;
+   char* fname = "Allocate_vectors";
+   double** pps[3] = {local_x_pp, local_y_pp, local_z_pp};
+   int i;
+
+   for (i = 0; i < 3; i++) {
+      if (pps[i] == NULL) continue;
+      *pps[i] = Vec_alloc(local_n, sizeof(double));
+      if (*pps[i] == NULL) local_ok = 0;
+   }
+   Check_for_error(local_ok, fname, "Can't allocate local vector(s)",
+         comm);
+}  /* Allocate_vectors */
+
+
+/*-------------------------------------------------------------------
+ * Function:   Read_vector
+ * Purpose:    Fill a vector on process 0 and distribute among the
+ *             processes using a block distribution.
+ * In args:    local_n:  size of local vectors
+ *             n:        size of global vector
+ *             vec_name: name of vector being read (e.g., "x")
+ *             my_rank:  calling process' rank in comm
+ *             comm:     communicator containing calling processes
+ * Out arg:    local_a:  local vector read
+ *
+ * Errors:     if the malloc on process 0 for temporary storage
+ *             fails the program terminates
+ *
+ * Note:
+ *    This function assumes a block distribution and the order
+ *   of the vector evenly divisible by comm_sz.
+ */
+void Read_vector(
+      double    local_a[]   /* out */,
+      int       local_n     /* in  */,
+      int       n           /* in  */,
+      char      vec_name[]  /* in  */,
+      int       my_rank     /* in  */,
+      MPI_Comm  comm        /* in  */) {
+
+   double* a = NULL;
+   int i;
+   int local_ok = 1;
+   char* fname = "Read_vector";
+
+   if (my_rank == 0) {
+      a = malloc(n*sizeof(double));
+      if (a == NULL) local_ok = 0;
+      Check_for_error(local_ok, fname, "Can't allocate temporary vector",
+            comm);
+      //printf("Enter the vector %s\n", vec_name);
+      //fill vec with indez
+      for (i = 0; i < n; i++)
+         a[i] = i;
+      MPI_Scatter(a, local_n, MPI_DOUBLE, local_a, local_n, MPI_DOUBLE, 0,
+         comm);
+      free(a);
+   } else {
+      Check_for_error(local_ok, fname, "Can't allocate temporary vector",
+            comm);
+      MPI_Scatter(a, local_n, MPI_DOUBLE, local_a, local_n, MPI_DOUBLE, 0,
+         comm);
+   }
+}  /* Read_vector */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Print_vector
+ * Purpose:   Print a vector that has a block distribution to stdout
+ * In args:   local_b:  local storage for vector to be printed
+ *            local_n:  order of local vectors
+ *            n:        order of global vector (local_n*comm_sz)
+ *            title:    title to precede print out
+ *            comm:     communicator containing processes calling
+ *                      Print_vector
+ *
+ * Error:     if process 0 can't allocate temporary storage for
+ *            the full vector, the program terminates.
+ *
+ * Note:
+ *    Assumes order of vector is evenly divisible by the number of
+ *    processes
+ */
+void Print_vector(
+      double    local_b[]  /* in */,
+      int       local_n    /* in */,
+      int       n          /* in */,
+      char      title[]    /* in */,
+      int       my_rank    /* in */,
+      MPI_Comm  comm       /* in */) {
+
+    double* b = NULL;
+    if (my_rank == 0) {
+        b = malloc(n * sizeof(double));
+        if (b == NULL) {
+            fprintf(stderr, "Can't allocate temporary vector for printing\n");
+            MPI_Finalize();
+            exit(-1);
+        }
+    }
+
+    MPI_Gather(local_b, local_n, MPI_DOUBLE, b, local_n, MPI_DOUBLE, 0, comm);
+
+    if (my_rank == 0) {
+        Print_vector_summary(b, n, title);
+        free(b);
+    }
+} /* Print_vector */
@@ -0,0 +1,37 @@
+/* File:     mpi_vector_utils.h
+ *
+ * Purpose:  Helpers shared by the MPI programs for vectors with a
+ *           block distribution: error checking, allocation, input
+ *           and output of distributed vectors.
+ *
+ * Compile:  Link mpi_vector_utils.c and vector_ops.c into the program.
+ *
+ * Note:
+ *    The Parallel_* names apply the kernels of vector_ops.h to the
+ *    local block of each process.
+ */
+#ifndef MPI_VECTOR_UTILS_H
+#define MPI_VECTOR_UTILS_H
+
+#include <mpi.h>
+#include "vector_ops.h"
+
+#define Parallel_vector_sum(local_x, local_y, local_z, local_n) \
+      Vector_sum(local_x, local_y, local_z, local_n)
+#define Parallel_dot_product(local_x, local_y, local_n) \
+      Dot_product(local_x, local_y, local_n)
+#define Parallel_scalar_multiplication(local_a, local_n, scalar) \
+      Scalar_multiplication(local_a, local_n, scalar)
+
+void Check_for_error(int local_ok, char fname[], char message[],
+      MPI_Comm comm);
+void Read_n(int* n_p, int* local_n_p, int my_rank, int comm_sz,
+      MPI_Comm comm);
+void Allocate_vectors(double** local_x_pp, double** local_y_pp,
+      double** local_z_pp, int local_n, MPI_Comm comm);
+void Read_vector(double local_a[], int local_n, int n, char vec_name[],
+      int my_rank, MPI_Comm comm);
+void Print_vector(double local_b[], int local_n, int n, char title[],
+      int my_rank, MPI_Comm comm);
+
+#endif /* MPI_VECTOR_UTILS_H */
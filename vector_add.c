@@ -2,34 +2,57 @@
  *
  * Purpose:  Implement vector addition
  *
- * Compile:  gcc -g -Wall -o vector_add vector_add.c
- * Run:      ./vector_add
+ * Compile:  gcc -g -Wall -O3 -march=native -o vector_add vector_add.c vector_ops.c -lm
+ * Run:      ./vector_add <order of the vectors>
+ *           ./vector_add -f <x file> <y file> [<z file>] [-p]
  *
- * Input:    The order of the vectors, n, and the vectors x and y
- * Output:   The sum vector z = x+y
+ * Input:    The order of the vectors, n (x and y are random), or
+ *           files holding x and y as raw native doubles (the format
+ *           used by mpi_vector_stream)
+ * Output:   The sum vector z = x+y, written to <z file> if given
  *
- * Note:
- *    If the program detects an error (order of vector <= 0 or malloc
- * failure), it prints a message and terminates
+ * Notes:
+ *    If the program detects an error (order of vector <= 0, malloc
+ * failure or a bad file), it prints a message and terminates
+ *    The kernels are shared with the MPI programs (vector_ops.c)
+ *    With -f the files are memory-mapped and the sum is computed
+ * straight over the mapped pages, with no copy.  The mappings are
+ * advised as sequential; -p also prefaults them (MAP_POPULATE, where
+ * available) so that the load time is paid before the addition
+ * instead of as page faults during it.  Load, addition and store
+ * times are reported separately.
  *
  * IPP:      Section 3.4.6 (p. 109)
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "vector_ops.h"
 
 void Read_n(int* n_p);
 void Allocate_vectors(double** x_pp, double** y_pp, double** z_pp, int n);
 void Read_vector(double a[], int n, char vec_name[]);
-void Print_vector(double b[], int n, char title[]);
-void Vector_sum(double x[], double y[], double z[], int n);
-void Generate_vector(double a[], int n, int i_seed);
+int Mapped_vector_sum(int argc, char* argv[]);
+double* Map_input(char path[], int* n_p, struct stat* st_p, int populate);
+double* Map_output(char path[], int n, const struct stat inputs[],
+      int populate);
+double Wall_time(void);
 
 /*---------------------------------------------------------------------*/
 int main(int argc, char* argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "-f") == 0)
+        return Mapped_vector_sum(argc, argv);
+
     // Check if the user provided the vector size as an argument
     if (argc != 2) {
         fprintf(stderr, "Usage: %s <order of the vectors>\n", argv[0]);
+        fprintf(stderr, "       %s -f <x file> <y file> [<z file>] [-p]\n", argv[0]);
         exit(-1);
     }
 
@@ -46,8 +69,8 @@ int main(int argc, char* argv[]) {
 
    Allocate_vectors(&x, &y, &z, n);
 
-   Generate_vector(x, n, 1);
-   Generate_vector(y, n, 2);
+   Generate_vector(x, n, 0, 1);
+   Generate_vector(y, n, 0, 2);
 
    start = clock();
    Vector_sum(x, y, z, n);
@@ -56,9 +79,9 @@ int main(int argc, char* argv[]) {
    // Calculate the time taken
    cpu_time_used = ((double) (end - start)) / CLOCKS_PER_SEC;
 
-   Print_vector(x, n, "=> The first vector is");
-   Print_vector(y, n, "=> The second vector is");
-   Print_vector(z, n, "=> The sum is");
+   Print_vector_summary(x, n, "=> The first vector is");
+   Print_vector_summary(y, n, "=> The second vector is");
+   Print_vector_summary(z, n, "=> The sum is");
 
    // Print the time taken for vector addition
    printf("Vector addition took %f seconds\n", cpu_time_used);
@@ -88,7 +111,7 @@ void Read_n(int* n_p /* out */) {
 
 /*---------------------------------------------------------------------
  * Function:  Allocate_vectors
- * Purpose:   Allocate storage for the vectors
+ * Purpose:   Allocate aligned storage for the vectors
  * In arg:    n:  the order of the vectors
  * Out args:  x_pp, y_pp, z_pp:  pointers to storage for the vectors
  *
@@ -99,9 +122,9 @@ void Allocate_vectors(
       double**  y_pp  /* out */,
       double**  z_pp  /* out */,
       int       n     /* in  */) {
-   *x_pp = malloc(n*sizeof(double));
-   *y_pp = malloc(n*sizeof(double));
-   *z_pp = malloc(n*sizeof(double));
+   *x_pp = Vec_alloc(n, sizeof(double));
+   *y_pp = Vec_alloc(n, sizeof(double));
+   *z_pp = Vec_alloc(n, sizeof(double));
    if (*x_pp == NULL || *y_pp == NULL || *z_pp == NULL) {
       fprintf(stderr, "Can't allocate vectors\n");
       exit(-1);
@@ -126,61 +149,194 @@ void Read_vector(
 }  /* Read_vector */
 
 /*---------------------------------------------------------------------
- * Function:  Print_vector
- * Purpose:   Print the contents of a vector (10 first and 10 last elements)
- * In args:   b:  the vector to be printed
- *            n:  the order of the vector
- *            title:  title for print out
+ * Function:  Mapped_vector_sum
+ * Purpose:   Add two vectors stored in files, computing over the
+ *            mapped pages
+ * In args:   argc, argv:  the command line (-f <x file> <y file>
+ *                         [<z file>] [-p])
+ * Ret val:   0 (errors terminate the program)
  */
-void Print_vector(
-      double  b[]     /* in */,
-      int     n       /* in */,
-      char    title[] /* in */) {
-    int i;
-    printf("%s\n", title);
-    printf("\t");
-    int elements_to_print = (n < 20) ? n : 10;
-    for (i = 0; i < elements_to_print; i++)
-        printf("%f ", b[i]);
-    printf("\t");
-    if (n >= 20) {
-        printf("\n\t...\n");
-        printf("\t");
-        for (i = n - 10; i < n; i++)
-            printf("%f ", b[i]);
-    }
-    printf("\n");
-}  /* Print_vector */
+int Mapped_vector_sum(int argc, char* argv[]) {
+   int populate = 0, nx, ny;
+   char* z_path = NULL;
+   double *x, *y, *z;
+   double t0, load_time, store_time = 0.0;
+   clock_t start, end;
+   struct stat inputs[2];
+
+   if (argc >= 5 && strcmp(argv[argc - 1], "-p") == 0) {
+      populate = 1;
+      argc--;
+   }
+   if (argc == 5) {
+      z_path = argv[4];
+   } else if (argc != 4) {
+      fprintf(stderr, "Usage: %s -f <x file> <y file> [<z file>] [-p]\n", argv[0]);
+      exit(-1);
+   }
+
+   t0 = Wall_time();
+   x = Map_input(argv[2], &nx, &inputs[0], populate);
+   y = Map_input(argv[3], &ny, &inputs[1], populate);
+   if (nx != ny) {
+      fprintf(stderr, "%s and %s hold different numbers of doubles\n",
+            argv[2], argv[3]);
+      exit(-1);
+   }
+   if (z_path != NULL) {
+      z = Map_output(z_path, nx, inputs, populate);
+   } else {
+      z = Vec_alloc(nx, sizeof(double));
+      if (z == NULL) {
+         fprintf(stderr, "Can't allocate vectors\n");
+         exit(-1);
+      }
+   }
+   load_time = Wall_time() - t0;
+
+   start = clock();
+   Vector_sum(x, y, z, nx);
+   end = clock();
+
+   Print_vector_summary(x, nx, "=> The first vector is");
+   Print_vector_summary(y, nx, "=> The second vector is");
+   Print_vector_summary(z, nx, "=> The sum is");
+
+   if (z_path != NULL) {
+      t0 = Wall_time();
+      msync(z, (size_t)nx*sizeof(double), MS_SYNC);
+      munmap(z, (size_t)nx*sizeof(double));
+      store_time = Wall_time() - t0;
+   } else {
+      free(z);
+   }
+   munmap(x, (size_t)nx*sizeof(double));
+   munmap(y, (size_t)nx*sizeof(double));
+
+   printf("Mapping the vectors took %f seconds%s\n", load_time,
+         populate ? " (prefaulted)" : "");
+   printf("Vector addition took %f seconds\n",
+         ((double) (end - start)) / CLOCKS_PER_SEC);
+   if (z_path != NULL)
+      printf("Writing the sum took %f seconds\n", store_time);
+
+   return 0;
+}  /* Mapped_vector_sum */
 
 /*---------------------------------------------------------------------
- * Function:  Vector_sum
- * Purpose:   Add two vectors
- * In args:   x:  the first vector to be added
- *            y:  the second vector to be added
- *            n:  the order of the vectors
- * Out arg:   z:  the sum vector
+ * Function:  Map_input
+ * Purpose:   Map a file of doubles read-only
+ * In args:   path:      the file
+ *            populate:  1 to prefault the pages now
+ * Out args:  n_p:       number of doubles in the file
+ *            st_p:      the file's status, to recognize it as an output
+ * Ret val:   The mapped vector
+ *
+ * Errors:    If the file can't be opened or mapped, holds no doubles,
+ *            too many for an int order or a partial double, the
+ *            program terminates
  */
-void Vector_sum(
-      double  x[]  /* in  */,
-      double  y[]  /* in  */,
-      double  z[]  /* out */,
-      int     n    /* in  */) {
-   int i;
+double* Map_input(
+      char          path[]    /* in  */,
+      int*          n_p       /* out */,
+      struct stat*  st_p      /* out */,
+      int           populate  /* in  */) {
+   int fd, flags = MAP_PRIVATE;
+   double* a;
 
-   for (i = 0; i < n; i++)
-      z[i] = x[i] + y[i];
-}  /* Vector_sum */
+   fd = open(path, O_RDONLY);
+   if (fd < 0 || fstat(fd, st_p) != 0) {
+      fprintf(stderr, "Can't open %s\n", path);
+      exit(-1);
+   }
+   if (st_p->st_size < (off_t)sizeof(double) ||
+       st_p->st_size/sizeof(double) > INT_MAX) {
+      fprintf(stderr, "%s should hold between 1 and %d doubles\n", path,
+            INT_MAX);
+      exit(-1);
+   }
+   if (st_p->st_size % sizeof(double) != 0) {
+      fprintf(stderr, "%s ends in a partial double\n", path);
+      exit(-1);
+   }
+   *n_p = st_p->st_size/sizeof(double);
 
+#ifdef MAP_POPULATE
+   if (populate) flags |= MAP_POPULATE;
+#endif
+   a = mmap(NULL, (size_t)*n_p*sizeof(double), PROT_READ, flags, fd, 0);
+   close(fd);
+   if (a == MAP_FAILED) {
+      fprintf(stderr, "Can't map %s\n", path);
+      exit(-1);
+   }
+   madvise(a, (size_t)*n_p*sizeof(double), MADV_SEQUENTIAL);
+   return a;
+}  /* Map_input */
 
 /*---------------------------------------------------------------------
- * Function:  Generate_vector
- * Purpose:   Generate a vector with random numbers
- * In args:   n:  the order of the vector
- * Out arg:   a:  the vector to be generated
+ * Function:  Map_output
+ * Purpose:   Create (or resize) a file for n doubles and map it for
+ *            writing
+ * In args:   path:      the file
+ *            n:         number of doubles
+ *            inputs:    status of the two input files
+ *            populate:  1 to prefault the pages now
+ * Ret val:   The mapped vector; release with msync and munmap
+ *
+ * Errors:    If the file is one of the inputs, or can't be created,
+ *            sized or mapped, the program terminates
+ *
+ * Note:
+ *    The file is opened without O_TRUNC and only resized once it is
+ *    known not to be an input: truncating a mapped input would make
+ *    reading it raise SIGBUS.
  */
-void Generate_vector(double a[], int n, int i_seed) {
-   srand(time(NULL) + i_seed); // Seed for the random number generator
-   for (int i = 0; i < n; i++) {
-      a[i] = (double)rand() / RAND_MAX; // Generate a random number between 0 and 1
+double* Map_output(
+      char               path[]    /* in */,
+      int                n         /* in */,
+      const struct stat  inputs[]  /* in */,
+      int                populate  /* in */) {
+   struct stat st;
+   int fd, i, flags = MAP_SHARED;
+   double* a;
+
+   fd = open(path, O_RDWR | O_CREAT, 0644);
+   if (fd < 0 || fstat(fd, &st) != 0) {
+      fprintf(stderr, "Can't create %s\n", path);
+      exit(-1);
+   }
+   for (i = 0; i < 2; i++)
+      if (st.st_dev == inputs[i].st_dev && st.st_ino == inputs[i].st_ino) {
+         fprintf(stderr, "%s is also an input\n", path);
+         exit(-1);
+      }
+   if (ftruncate(fd, (off_t)n*sizeof(double)) != 0) {
+      fprintf(stderr, "Can't create %s\n", path);
+      exit(-1);
    }
-}
+
+#ifdef MAP_POPULATE
+   if (populate) flags |= MAP_POPULATE;
+#endif
+   a = mmap(NULL, (size_t)n*sizeof(double), PROT_READ | PROT_WRITE, flags,
+         fd, 0);
+   close(fd);
+   if (a == MAP_FAILED) {
+      fprintf(stderr, "Can't map %s\n", path);
+      exit(-1);
+   }
+   madvise(a, (size_t)n*sizeof(double), MADV_SEQUENTIAL);
+   return a;
+}  /* Map_output */
+
+/*---------------------------------------------------------------------
+ * Function:  Wall_time
+ * Purpose:   Elapsed (not CPU) time in seconds, for timing I/O
+ */
+double Wall_time(void) {
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec*1.0e-9;
+}  /* Wall_time */
@@ -0,0 +1,262 @@
+/* File:     vector_client.c
+ *
+ * Purpose:  Client of the resident vector service (mpi_vector_service.c):
+ *           send single requests, or load the service with concurrent
+ *           clients and report latency and throughput.
+ *
+ * Compile:  gcc -g -Wall -O3 -march=native -o vector_client vector_client.c
+ * Run:      ./vector_client <socket path> gen <order of the vectors> <seed>
+ *           ./vector_client <socket path> add|dot|ping
+ *           ./vector_client <socket path> scale <scalar>
+ *           ./vector_client <socket path> shutdown
+ *           ./vector_client <socket path> bench <clients> <requests> add|dot|ping|scale
+ *
+ * Input:    The command line
+ * Output:   The result of a single request, or for bench the request
+ *           latency (mean, median, 99th percentile, max) seen by the
+ *           clients, the mean service time inside the service and the
+ *           throughput in requests per second
+ *
+ * Notes:
+ * 1.  bench forks <clients> processes, each with its own connection,
+ *     sending <requests> requests back to back.  scale uses the scalar
+ *     1.0 so the vectors are left unchanged.
+ * 2.  The service runs one request at a time, so with many clients the
+ *     latency includes the wait for the requests ahead.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "mpi_service.h"
+
+void Usage(char prog_name[]);
+int Connect(char path[]);
+int Request(int fd, Svc_request* req, Svc_reply* reply);
+int Parse_op(char name[]);
+double Now(void);
+int Compare_doubles(const void* a, const void* b);
+void Bench(char path[], int clients, int requests, int op);
+
+int main(int argc, char* argv[]) {
+    Svc_request req = {SVC_PING, 0, 0, 0.0};
+    Svc_reply reply;
+    int fd;
+
+    if (argc < 3) Usage(argv[0]);
+
+    if (strcmp(argv[2], "bench") == 0) {
+        if (argc != 6 || atoi(argv[3]) <= 0 || atoi(argv[4]) <= 0
+              || Parse_op(argv[5]) < 0 || Parse_op(argv[5]) == SVC_GEN)
+            Usage(argv[0]);
+        Bench(argv[1], atoi(argv[3]), atoi(argv[4]), Parse_op(argv[5]));
+        return 0;
+    }
+
+    if (strcmp(argv[2], "shutdown") == 0 && argc == 3) {
+        req.op = SVC_SHUTDOWN;
+    } else if (strcmp(argv[2], "gen") == 0 && argc == 5) {
+        req.op = SVC_GEN;
+        req.n = atoll(argv[3]);
+        req.seed = atoi(argv[4]);
+    } else if (strcmp(argv[2], "scale") == 0 && argc == 4) {
+        req.op = SVC_SCALE;
+        req.scalar = atof(argv[3]);
+    } else if (argc == 3 && Parse_op(argv[2]) >= 0
+          && Parse_op(argv[2]) != SVC_SCALE) {
+        req.op = Parse_op(argv[2]);
+    } else {
+        Usage(argv[0]);
+    }
+
+    fd = Connect(argv[1]);
+    if (fd < 0) {
+        fprintf(stderr, "Can't connect to %s\n", argv[1]);
+        exit(-1);
+    }
+    if (Request(fd, &req, &reply) != 0 || reply.status != 0) {
+        fprintf(stderr, "Request failed\n");
+        exit(-1);
+    }
+    printf("Result %.15g (service time %e seconds)\n", reply.result,
+          reply.service_time);
+    close(fd);
+    return 0;
+}  /* main */
+
+/*---------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   Print the command lines and terminate
+ */
+void Usage(char prog_name[]) {
+    fprintf(stderr, "Usage: %s <socket path> gen <order of the vectors> <seed>\n", prog_name);
+    fprintf(stderr, "       %s <socket path> add|dot|ping\n", prog_name);
+    fprintf(stderr, "       %s <socket path> scale <scalar>\n", prog_name);
+    fprintf(stderr, "       %s <socket path> shutdown\n", prog_name);
+    fprintf(stderr, "       %s <socket path> bench <clients> <requests> add|dot|ping|scale\n", prog_name);
+    exit(-1);
+}  /* Usage */
+
+/*---------------------------------------------------------------------
+ * Function:  Connect
+ * Purpose:   Connect to the service
+ * In args:   path:  file name of the service's socket
+ * Ret val:   The connected socket, or -1 on failure
+ */
+int Connect(char path[] /* in */) {
+   struct sockaddr_un addr;
+   int fd;
+
+   if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+   fd = socket(AF_UNIX, SOCK_STREAM, 0);
+   if (fd < 0) return -1;
+   memset(&addr, 0, sizeof(addr));
+   addr.sun_family = AF_UNIX;
+   strcpy(addr.sun_path, path);
+   if (connect(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0) {
+      close(fd);
+      return -1;
+   }
+   return fd;
+}  /* Connect */
+
+/*---------------------------------------------------------------------
+ * Function:  Request
+ * Purpose:   Send a request and wait for its reply
+ * In args:   fd:     connected socket
+ *            req:    the request
+ * Out args:  reply:  the reply
+ * Ret val:   0 on success, -1 if the connection failed
+ */
+int Request(
+      int           fd     /* in  */,
+      Svc_request*  req    /* in  */,
+      Svc_reply*    reply  /* out */) {
+   if (send(fd, req, sizeof(*req), MSG_NOSIGNAL) != sizeof(*req))
+      return -1;
+   if (recv(fd, reply, sizeof(*reply), MSG_WAITALL) != sizeof(*reply))
+      return -1;
+   return 0;
+}  /* Request */
+
+/*---------------------------------------------------------------------
+ * Function:  Parse_op
+ * Purpose:   Map an operation name of the command line to its code
+ * Ret val:   The operation, or -1 if the name is unknown
+ */
+int Parse_op(char name[] /* in */) {
+   if (strcmp(name, "ping") == 0) return SVC_PING;
+   if (strcmp(name, "gen") == 0) return SVC_GEN;
+   if (strcmp(name, "add") == 0) return SVC_ADD;
+   if (strcmp(name, "dot") == 0) return SVC_DOT;
+   if (strcmp(name, "scale") == 0) return SVC_SCALE;
+   return -1;
+}  /* Parse_op */
+
+/*---------------------------------------------------------------------
+ * Function:  Now
+ * Purpose:   Wall-clock time in seconds
+ */
+double Now(void) {
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec*1.0e-9;
+}  /* Now */
+
+/*---------------------------------------------------------------------
+ * Function:  Compare_doubles
+ * Purpose:   qsort comparison of doubles in increasing order
+ */
+int Compare_doubles(const void* a, const void* b) {
+   double x = *(const double*) a, y = *(const double*) b;
+
+   return (x > y) - (x < y);
+}  /* Compare_doubles */
+
+/*---------------------------------------------------------------------
+ * Function:  Bench
+ * Purpose:   Run concurrent clients against the service and print the
+ *            latency and throughput they observed
+ * In args:   path:      file name of the service's socket
+ *            clients:   number of concurrent clients
+ *            requests:  requests sent by each client
+ *            op:        the operation requested
+ *
+ * Note:
+ *    Each client writes the latency and service time of every request
+ *    to a pipe shared with the parent, which collects them.
+ */
+void Bench(
+      char  path[]    /* in */,
+      int   clients   /* in */,
+      int   requests  /* in */,
+      int   op        /* in */) {
+   Svc_request req = {op, 0, 0, 1.0};
+   Svc_reply reply;
+   int pipe_fd[2], c, r, fd, ok, total = clients*requests;
+   double *latency, start, elapsed, sum_lat = 0.0, sum_svc = 0.0;
+   double sample[2];
+
+   latency = malloc(total*sizeof(double));
+   if (latency == NULL || pipe(pipe_fd) != 0) {
+      fprintf(stderr, "Can't set up the clients\n");
+      exit(-1);
+   }
+
+   start = Now();
+   for (c = 0; c < clients; c++) {
+      if (fork() == 0) {
+         close(pipe_fd[0]);
+         fd = Connect(path);
+         for (r = 0; r < requests; r++) {
+            sample[0] = Now();
+            ok = fd >= 0 && Request(fd, &req, &reply) == 0
+                  && reply.status == 0;
+            sample[0] = ok ? Now() - sample[0] : -1.0;
+            sample[1] = ok ? reply.service_time : 0.0;
+            if (write(pipe_fd[1], sample, sizeof(sample)) != sizeof(sample))
+               break;
+         }
+         if (fd >= 0) close(fd);
+         _exit(0);
+      }
+   }
+   close(pipe_fd[1]);
+
+   ok = 1;
+   for (r = 0; r < total; r++) {
+      if (read(pipe_fd[0], sample, sizeof(sample)) != sizeof(sample)
+            || sample[0] < 0.0) {
+         ok = 0;
+         break;
+      }
+      latency[r] = sample[0];
+      sum_lat += sample[0];
+      sum_svc += sample[1];
+   }
+   while (wait(NULL) > 0)
+      ;
+   elapsed = Now() - start;
+   close(pipe_fd[0]);
+   if (!ok) {
+      fprintf(stderr, "A request failed\n");
+      exit(-1);
+   }
+
+   qsort(latency, total, sizeof(double), Compare_doubles);
+   printf("%d clients x %d requests: %.0f requests/s\n", clients, requests,
+         total/elapsed);
+   printf("Latency (s): mean %e  median %e  p99 %e  max %e\n",
+         sum_lat/total, latency[total/2], latency[(int) (0.99*(total - 1))],
+         latency[total - 1]);
+   printf("Mean service time %e s, so %e s per request in transit and queueing\n",
+         sum_svc/total, (sum_lat - sum_svc)/total);
+
+   free(latency);
+}  /* Bench */
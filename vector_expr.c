@@ -0,0 +1,310 @@
+/* File:     vector_expr.c
+ *
+ * Purpose:  Build and evaluate the lazy elementwise expressions
+ *           declared in vector_expr.h.
+ *
+ * Note:
+ *    Evaluation is a tiled interpreter: the dispatch on the operation
+ *    happens once per tile of VEXPR_TILE elements, and the loop inside
+ *    each case is a plain vectorizable loop over the tile.
+ */
+#include <math.h>
+#include <string.h>
+#include "vector_ops.h"
+#include "vector_expr.h"
+
+#define LEAF_VECTOR  0
+#define LEAF_CONST   1
+#define OPERATION    2
+
+#define VEXPR_ACC    8   /* independent partial sums in reductions */
+
+static int Arity(Vexpr_op op);
+static double Apply_scalar(Vexpr_op op, double a, double b);
+static void Apply_unary(Vexpr_op op, const double a[], double out[],
+      int len);
+static void Apply_binary(Vexpr_op op, const double a[], double sa,
+      const double b[], double sb, double out[], int len);
+
+/*---------------------------------------------------------------------
+ * Function:  Vexpr_init
+ * Purpose:   Start an empty expression
+ * Out arg:   e:  the expression
+ */
+void Vexpr_init(Vexpr* e /* out */) {
+   e->len = 0;
+   e->depth = 0;
+   e->ok = 1;
+}  /* Vexpr_init */
+
+/*---------------------------------------------------------------------
+ * Function:  Push
+ * Purpose:   Append one instruction, flagging overflow of the code
+ *            or of the operand stack
+ * In/out:    e:      the expression
+ * In args:   instr:  the instruction
+ *            delta:  change in stack depth caused by instr
+ */
+static void Push(
+      Vexpr*       e      /* in/out */,
+      Vexpr_instr  instr  /* in     */,
+      int          delta  /* in     */) {
+   if (!e->ok) return;
+   if (e->len == VEXPR_MAX_CODE || e->depth + delta > VEXPR_MAX_DEPTH ||
+       e->depth + delta < 1) {
+      e->ok = 0;
+      return;
+   }
+   e->code[e->len++] = instr;
+   e->depth += delta;
+}  /* Push */
+
+/*---------------------------------------------------------------------
+ * Function:  Vexpr_push_vector
+ * Purpose:   Push a vector operand.  Only the pointer is recorded; the
+ *            vector is read when the expression is evaluated.
+ * In/out:    e:  the expression
+ * In arg:    a:  the vector (local block)
+ */
+void Vexpr_push_vector(
+      Vexpr*        e    /* in/out */,
+      const double  a[]  /* in     */) {
+   Vexpr_instr instr = {LEAF_VECTOR, VEXPR_ADD, a, 0.0};
+   Push(e, instr, 1);
+}  /* Vexpr_push_vector */
+
+/*---------------------------------------------------------------------
+ * Function:  Vexpr_push_const
+ * Purpose:   Push a scalar operand
+ * In/out:    e:      the expression
+ * In arg:    value:  the scalar
+ */
+void Vexpr_push_const(
+      Vexpr*  e      /* in/out */,
+      double  value  /* in     */) {
+   Vexpr_instr instr = {LEAF_CONST, VEXPR_ADD, NULL, value};
+   Push(e, instr, 1);
+}  /* Vexpr_push_const */
+
+/*---------------------------------------------------------------------
+ * Function:  Vexpr_apply
+ * Purpose:   Replace the top operand(s) of the stack with op applied
+ *            to them.  For binary operations the earlier operand is
+ *            the left one.
+ * In/out:    e:   the expression
+ * In arg:    op:  the operation
+ */
+void Vexpr_apply(
+      Vexpr*    e   /* in/out */,
+      Vexpr_op  op  /* in     */) {
+   Vexpr_instr instr = {OPERATION, op, NULL, 0.0};
+   if (e->depth < Arity(op)) e->ok = 0;
+   Push(e, instr, 1 - Arity(op));
+}  /* Vexpr_apply */
+
+/*---------------------------------------------------------------------
+ * Function:  Vexpr_is_valid
+ * Purpose:   Check that an expression was built correctly and leaves
+ *            exactly one value
+ * In arg:    e:  the expression
+ * Ret val:   1 if e can be evaluated, 0 otherwise
+ */
+int Vexpr_is_valid(const Vexpr* e /* in */) {
+   return e->ok && e->depth == 1;
+}  /* Vexpr_is_valid */
+
+/*---------------------------------------------------------------------
+ * Function:  Vexpr_eval
+ * Purpose:   Evaluate an expression over n elements in one pass,
+ *            storing the result and/or reducing it
+ * In args:   e:    the expression (should satisfy Vexpr_is_valid)
+ *            n:    the number of elements
+ *            red:  reduction to fuse into the pass
+ *            w:    second vector for VEXPR_RED_DOT (else unused)
+ * Out arg:   z:    the result, or NULL if only the reduction is wanted.
+ *                  z may be one of the operands of e.
+ * Ret val:   The local value of the reduction (0 for VEXPR_RED_NONE,
+ *            NAN if e is invalid)
+ */
+double Vexpr_eval(
+      const Vexpr*     e    /* in  */,
+      double           z[]  /* out */,
+      int              n    /* in  */,
+      Vexpr_reduction  red  /* in  */,
+      const double     w[]  /* in  */) {
+   _Alignas(VEC_ALIGN) double buf[VEXPR_MAX_DEPTH][VEXPR_TILE];
+   const double* p[VEXPR_MAX_DEPTH];   /* NULL: slot holds a scalar */
+   double s[VEXPR_MAX_DEPTH];
+   double acc[VEXPR_ACC] = {0};
+   double result = 0.0;
+   int start, len, k, sp, i, j;
+
+   if (!Vexpr_is_valid(e)) return NAN;
+
+   for (start = 0; start < n; start += VEXPR_TILE) {
+      len = (n - start < VEXPR_TILE) ? n - start : VEXPR_TILE;
+      sp = 0;
+      for (k = 0; k < e->len; k++) {
+         const Vexpr_instr* instr = &e->code[k];
+         double* out;
+         int a;
+
+         if (instr->kind == LEAF_VECTOR) {
+            p[sp] = instr->vec + start;
+            sp++;
+            continue;
+         } else if (instr->kind == LEAF_CONST) {
+            p[sp] = NULL;
+            s[sp] = instr->value;
+            sp++;
+            continue;
+         }
+
+         if (Arity(instr->op) == 2) sp--;
+         a = sp - 1;
+         /* The last operation writes straight into z */
+         out = (k == e->len - 1 && z != NULL) ? z + start : buf[a];
+         if (Arity(instr->op) == 1) {
+            if (p[a] == NULL) {
+               s[a] = Apply_scalar(instr->op, s[a], 0.0);
+            } else {
+               Apply_unary(instr->op, p[a], out, len);
+               p[a] = out;
+            }
+         } else {
+            if (p[a] == NULL && p[sp] == NULL) {
+               s[a] = Apply_scalar(instr->op, s[a], s[sp]);
+            } else {
+               Apply_binary(instr->op, p[a], s[a], p[sp], s[sp], out, len);
+               p[a] = out;
+            }
+         }
+      }
+
+      /* The expression was a leaf or folded to a scalar */
+      if (p[0] == NULL) {
+         for (i = 0; i < len; i++)
+            buf[0][i] = s[0];
+         p[0] = buf[0];
+      }
+      if (z != NULL && p[0] != z + start)
+         memmove(z + start, p[0], len*sizeof(double));
+
+      switch (red) {
+         case VEXPR_RED_SUM:
+            for (i = 0; i + VEXPR_ACC <= len; i += VEXPR_ACC)
+               for (j = 0; j < VEXPR_ACC; j++)
+                  acc[j] += p[0][i+j];
+            for (; i < len; i++)
+               acc[0] += p[0][i];
+            break;
+         case VEXPR_RED_DOT:
+            for (i = 0; i + VEXPR_ACC <= len; i += VEXPR_ACC)
+               for (j = 0; j < VEXPR_ACC; j++)
+                  acc[j] += p[0][i+j]*w[start+i+j];
+            for (; i < len; i++)
+               acc[0] += p[0][i]*w[start+i];
+            break;
+         case VEXPR_RED_SUMSQ:
+            for (i = 0; i + VEXPR_ACC <= len; i += VEXPR_ACC)
+               for (j = 0; j < VEXPR_ACC; j++)
+                  acc[j] += p[0][i+j]*p[0][i+j];
+            for (; i < len; i++)
+               acc[0] += p[0][i]*p[0][i];
+            break;
+         default:
+            break;
+      }
+   }
+
+   for (j = 0; j < VEXPR_ACC; j++)
+      result += acc[j];
+   return result;
+}  /* Vexpr_eval */
+
+/*---------------------------------------------------------------------
+ * Function:  Arity
+ * Purpose:   Number of operands taken by op
+ */
+static int Arity(Vexpr_op op) {
+   return (op == VEXPR_NEG || op == VEXPR_ABS || op == VEXPR_SQRT) ? 1 : 2;
+}  /* Arity */
+
+/*---------------------------------------------------------------------
+ * Function:  Apply_scalar
+ * Purpose:   Fold op over scalar operands (b is ignored if op is unary)
+ */
+static double Apply_scalar(Vexpr_op op, double a, double b) {
+   switch (op) {
+      case VEXPR_ADD:  return a + b;
+      case VEXPR_SUB:  return a - b;
+      case VEXPR_MUL:  return a * b;
+      case VEXPR_DIV:  return a / b;
+      case VEXPR_MIN:  return a < b ? a : b;
+      case VEXPR_MAX:  return a > b ? a : b;
+      case VEXPR_NEG:  return -a;
+      case VEXPR_ABS:  return fabs(a);
+      case VEXPR_SQRT: return sqrt(a);
+   }
+   return NAN;
+}  /* Apply_scalar */
+
+#define VEXPR_LOOP(expr) do { \
+      VEC_IVDEP \
+      for (i = 0; i < len; i++) out[i] = (expr); \
+   } while (0)
+
+/*---------------------------------------------------------------------
+ * Function:  Apply_unary
+ * Purpose:   out = op(a) over one tile (out may be a)
+ */
+static void Apply_unary(
+      Vexpr_op      op     /* in  */,
+      const double  a[]    /* in  */,
+      double        out[]  /* out */,
+      int           len    /* in  */) {
+   int i;
+
+   switch (op) {
+      case VEXPR_NEG:  VEXPR_LOOP(-a[i]); break;
+      case VEXPR_ABS:  VEXPR_LOOP(fabs(a[i])); break;
+      case VEXPR_SQRT: VEXPR_LOOP(sqrt(a[i])); break;
+      default: break;
+   }
+}  /* Apply_unary */
+
+#define VEXPR_BINARY(A, B) do { \
+      switch (op) { \
+         case VEXPR_ADD: VEXPR_LOOP((A) + (B)); break; \
+         case VEXPR_SUB: VEXPR_LOOP((A) - (B)); break; \
+         case VEXPR_MUL: VEXPR_LOOP((A) * (B)); break; \
+         case VEXPR_DIV: VEXPR_LOOP((A) / (B)); break; \
+         case VEXPR_MIN: VEXPR_LOOP((A) < (B) ? (A) : (B)); break; \
+         case VEXPR_MAX: VEXPR_LOOP((A) > (B) ? (A) : (B)); break; \
+         default: break; \
+      } \
+   } while (0)
+
+/*---------------------------------------------------------------------
+ * Function:  Apply_binary
+ * Purpose:   out = a op b over one tile.  A NULL operand stands for
+ *            its scalar (sa or sb); at most one of them is NULL.
+ *            out may be a or b.
+ */
+static void Apply_binary(
+      Vexpr_op      op     /* in  */,
+      const double  a[]    /* in  */,
+      double        sa     /* in  */,
+      const double  b[]    /* in  */,
+      double        sb     /* in  */,
+      double        out[]  /* out */,
+      int           len    /* in  */) {
+   int i;
+
+   if (a != NULL && b != NULL)
+      VEXPR_BINARY(a[i], b[i]);
+   else if (a != NULL)
+      VEXPR_BINARY(a[i], sb);
+   else
+      VEXPR_BINARY(sa, b[i]);
+}  /* Apply_binary */
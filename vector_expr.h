@@ -0,0 +1,87 @@
+/* File:     vector_expr.h
+ *
+ * Purpose:  Lazy elementwise expressions over (local blocks of)
+ *           vectors.  An expression such as z = a*x + b*y + c is
+ *           recorded first and evaluated later in a single pass over
+ *           memory, with no full-length temporaries.  A reduction of
+ *           the result (sum, dot with another vector, sum of squares)
+ *           can be fused into the same pass.
+ *
+ * Compile:  Link vector_expr.c and vector_ops.c into the program.
+ *
+ * Example:  z = 2*x + 3*y + 1 and its squared norm
+ *
+ *              Vexpr e;
+ *              Vexpr_init(&e);
+ *              Vexpr_push_const(&e, 2.0);
+ *              Vexpr_push_vector(&e, x);
+ *              Vexpr_apply(&e, VEXPR_MUL);
+ *              Vexpr_push_const(&e, 3.0);
+ *              Vexpr_push_vector(&e, y);
+ *              Vexpr_apply(&e, VEXPR_MUL);
+ *              Vexpr_apply(&e, VEXPR_ADD);
+ *              Vexpr_push_const(&e, 1.0);
+ *              Vexpr_apply(&e, VEXPR_ADD);
+ *              sumsq = Vexpr_eval(&e, z, n, VEXPR_RED_SUMSQ, NULL);
+ *
+ * Notes:
+ * 1.  Expressions are built in postfix order on a small operand stack.
+ *     Building never allocates; an expression that is too long or
+ *     malformed is flagged and Vexpr_eval reports it.
+ * 2.  Evaluation walks the vectors in tiles of VEXPR_TILE elements.
+ *     Intermediate results live in per-stack-slot tile buffers that
+ *     stay in L1 cache, and each operation is a vectorizable loop over
+ *     one tile.  Constant operands are never expanded to vectors.
+ * 3.  For distributed vectors, evaluate on the local block and
+ *     combine the returned partial reduction with one MPI_Allreduce
+ *     (or MPI_Reduce).
+ */
+#ifndef VECTOR_EXPR_H
+#define VECTOR_EXPR_H
+
+#define VEXPR_MAX_CODE   64
+#define VEXPR_MAX_DEPTH  8
+#define VEXPR_TILE       256
+
+typedef enum {
+   VEXPR_ADD,     /* binary: a + b      */
+   VEXPR_SUB,     /* binary: a - b      */
+   VEXPR_MUL,     /* binary: a * b      */
+   VEXPR_DIV,     /* binary: a / b      */
+   VEXPR_MIN,     /* binary: min(a, b)  */
+   VEXPR_MAX,     /* binary: max(a, b)  */
+   VEXPR_NEG,     /* unary:  -a         */
+   VEXPR_ABS,     /* unary:  |a|        */
+   VEXPR_SQRT     /* unary:  sqrt(a)    */
+} Vexpr_op;
+
+typedef enum {
+   VEXPR_RED_NONE,   /* no reduction, returns 0       */
+   VEXPR_RED_SUM,    /* sum of z[i]                   */
+   VEXPR_RED_DOT,    /* sum of z[i]*w[i]              */
+   VEXPR_RED_SUMSQ   /* sum of z[i]*z[i]              */
+} Vexpr_reduction;
+
+typedef struct {
+   int            kind;    /* leaf vector, leaf constant or operation */
+   Vexpr_op       op;
+   const double*  vec;
+   double         value;
+} Vexpr_instr;
+
+typedef struct {
+   Vexpr_instr  code[VEXPR_MAX_CODE];
+   int          len;
+   int          depth;     /* operands on the stack after code[len-1] */
+   int          ok;        /* 0 once a build error has been seen      */
+} Vexpr;
+
+void Vexpr_init(Vexpr* e);
+void Vexpr_push_vector(Vexpr* e, const double a[]);
+void Vexpr_push_const(Vexpr* e, double value);
+void Vexpr_apply(Vexpr* e, Vexpr_op op);
+int Vexpr_is_valid(const Vexpr* e);
+double Vexpr_eval(const Vexpr* e, double z[], int n,
+      Vexpr_reduction red, const double w[]);
+
+#endif /* VECTOR_EXPR_H */
@@ -0,0 +1,568 @@
+/* File:     vector_math.c
+ *
+ * Purpose:  Vectorizable elementwise math functions with accuracy tiers
+ *           (see vector_math.h).
+ *
+ * Note:
+ *    Each function is a scalar "core" written without branches (the
+ *    special cases are selects at the end), inlined into a plain loop
+ *    over a chunk of VMATH_CHUNK elements.  The dispatch on the tier
+ *    happens once per chunk, so the degree of the polynomial is a
+ *    constant in every loop and the compiler unrolls it.
+ */
+#include <math.h>
+#include <float.h>
+#include <string.h>
+#include <stdint.h>
+#include "vector_ops.h"
+#include "vector_math.h"
+
+#ifdef _OPENMP
+#define VMATH_PARALLEL_FOR \
+   _Pragma("omp parallel for schedule(static) if(n > VMATH_CHUNK)")
+#else
+#define VMATH_PARALLEL_FOR
+#endif
+
+#define VMATH_LOOP(expr) do { \
+      VEC_IVDEP \
+      for (i = 0; i < len; i++) out[i] = (expr); \
+   } while (0)
+
+/* exp: x = k*ln2 + r, |r| <= ln2/2; ln2 = LN2_HI + LN2_LO and k*LN2_HI
+   is exact for |k| < 2^21                                            */
+#define LOG2E      1.44269504088896338700e+00
+#define LN2_HI     6.93147180369123816490e-01
+#define LN2_LO     1.90821492927058770002e-10
+#define EXP_SHIFT  0x1.8p52    /* adding it rounds to an integer      */
+#define EXP_HI     709.79      /* exp overflows above log(DBL_MAX)    */
+#define EXP_LO     -745.2      /* and rounds to 0 below this          */
+#define SQRT_HALF  0x1.6a09e667f3bcdp-1
+#define RSQRT_MAGIC  0x5fe6eb50c7b537a9ULL
+
+/* Degrees of the polynomials of each tier */
+static const int exp_deg[VMATH_NUM_TIERS] = {6, 10, 13};
+static const int log_deg[VMATH_NUM_TIERS] = {3, 6, 7};
+static const int rsqrt_steps[VMATH_NUM_TIERS] = {2, 3, 3};
+
+/* e^r - 1 = r*(1 + r/2 + r^2/6 + ...): Taylor coefficients 1/(j+1)! */
+static const double exp_coef[13] = {
+   1.0, 1.0/2, 1.0/6, 1.0/24, 1.0/120, 1.0/720, 1.0/5040, 1.0/40320,
+   1.0/362880, 1.0/3628800, 1.0/39916800, 1.0/479001600,
+   1.0/6227020800.0
+};
+
+/* log(1+f) = 2s + s*R(s^2), s = f/(2+f): Taylor coefficients 2/(2j+3)
+   of R for the lower tiers and the minimax ones of fdlibm for the
+   accurate tier                                                      */
+static const double log_taylor[7] = {
+   2.0/3, 2.0/5, 2.0/7, 2.0/9, 2.0/11, 2.0/13, 2.0/15
+};
+static const double log_minimax[7] = {
+   6.666666666666735130e-01, 3.999999999940941908e-01,
+   2.857142874366239149e-01, 2.222219843214978396e-01,
+   1.818357216161805012e-01, 1.531383769920937332e-01,
+   1.479819860511658591e-01
+};
+
+static void Exp_chunk(const double x[], double out[], int len,
+      Vmath_tier tier);
+static void Log_chunk(const double x[], double out[], int len,
+      Vmath_tier tier);
+static void Sqrt_chunk(const double x[], double out[], int len,
+      Vmath_tier tier);
+static void Tanh_chunk(const double x[], double out[], int len,
+      Vmath_tier tier);
+static void Sigmoid_chunk(const double x[], double out[], int len,
+      Vmath_tier tier);
+static void Pow_chunk(const double x[], const double y[], double out[],
+      int len, Vmath_tier tier);
+
+/*---------------------------------------------------------------------
+ * Function:  As_bits, As_double
+ * Purpose:   Reinterpret a double as a 64-bit integer and back
+ */
+static inline uint64_t As_bits(double x) {
+   uint64_t u;
+
+   memcpy(&u, &x, sizeof(u));
+   return u;
+}  /* As_bits */
+
+static inline double As_double(uint64_t u) {
+   double x;
+
+   memcpy(&x, &u, sizeof(x));
+   return x;
+}  /* As_double */
+
+/*---------------------------------------------------------------------
+ * Function:  Horner
+ * Purpose:   c[0] + c[1]*r + ... + c[deg-1]*r^(deg-1)
+ */
+static inline double Horner(double r, const double c[], int deg) {
+   double p = c[deg-1];
+   int j;
+
+   for (j = deg - 2; j >= 0; j--)
+      p = p*r + c[j];
+   return p;
+}  /* Horner */
+
+/*---------------------------------------------------------------------
+ * Function:  Exp_core
+ * Purpose:   exp(x + lo), with |lo| much smaller than ulp(x)
+ * In args:   x, lo:  the argument as an unevaluated sum
+ *            deg:    degree of the polynomial for e^r - 1
+ * Ret val:   the result; inf above EXP_HI, 0 below EXP_LO
+ *
+ * Note:
+ *    2^k is applied as 2^(k/2)*2^(k - k/2), so results that are
+ *    subnormal or near overflow don't need a special case.
+ */
+static inline double Exp_core(double x, double lo, int deg) {
+   double xc, z, kd, r, q, s1, s2;
+   int64_t k, k1;
+
+   xc = x > EXP_HI ? EXP_HI : x;
+   xc = xc < EXP_LO ? EXP_LO : xc;
+   z = xc*LOG2E + EXP_SHIFT;
+   kd = z - EXP_SHIFT;
+   k = (int64_t) (As_bits(z) - As_bits(EXP_SHIFT));
+   r = (xc - kd*LN2_HI) - kd*LN2_LO + lo;
+   q = r*Horner(r, exp_coef, deg);
+   k1 = k >> 1;
+   s1 = As_double((uint64_t) (k1 + 1023) << 52);
+   s2 = As_double((uint64_t) (k - k1 + 1023) << 52);
+   return (1.0 + q)*s1*s2;
+}  /* Exp_core */
+
+/*---------------------------------------------------------------------
+ * Function:  Expm1_core
+ * Purpose:   exp(x) - 1 for x >= 0 (or NaN), without cancellation for
+ *            small x
+ * In args:   x:    the argument
+ *            deg:  degree of the polynomial for e^r - 1
+ * Ret val:   the result; arguments above 40 are treated as 40
+ */
+static inline double Expm1_core(double x, int deg) {
+   double xc, z, kd, r, q, s;
+   int64_t k;
+
+   xc = x > 40.0 ? 40.0 : x;
+   z = xc*LOG2E + EXP_SHIFT;
+   kd = z - EXP_SHIFT;
+   k = (int64_t) (As_bits(z) - As_bits(EXP_SHIFT));
+   r = (xc - kd*LN2_HI) - kd*LN2_LO;
+   q = r*Horner(r, exp_coef, deg);
+   s = As_double((uint64_t) (k + 1023) << 52);
+   return s*q + (s - 1.0);
+}  /* Expm1_core */
+
+/*---------------------------------------------------------------------
+ * Function:  Log_core
+ * Purpose:   log(x) for positive finite x, as an unevaluated sum hi + lo
+ * In args:   x:     the argument
+ *            c:     coefficients of R
+ *            deg:   their number
+ * Out args:  lo_p:  the low part, |lo| <= ulp(hi)/2
+ * Ret val:   the high part
+ *
+ * Note:
+ *    x = 2^e*(1+f) with sqrt(1/2) <= 1+f < sqrt(2), and
+ *    log(1+f) = f - f^2/2 + s*(f^2/2 + R).  The first two terms are
+ *    summed exactly, and so is e*LN2_HI + the result, so pow can use
+ *    the extra bits.
+ */
+static inline double Log_core(double x, const double c[], int deg,
+      double* lo_p) {
+   double xs, m, f, s, z, R, hfsq, hfsq_lo, a, a_lo, t, ed, b, hi, bb,
+          lo, sum;
+   int64_t e;
+   uint64_t u;
+   int sub;
+
+   sub = x < DBL_MIN;
+   xs = sub ? x*0x1p52 : x;
+   u = As_bits(xs);
+   e = (int64_t) (u - As_bits(SQRT_HALF)) >> 52;
+   m = As_double(u - ((uint64_t) e << 52));
+   e -= sub ? 52 : 0;
+
+   f = m - 1.0;
+   s = f/(2.0 + f);
+   z = s*s;
+   R = z*Horner(z, c, deg);
+   hfsq = 0.5*f*f;
+   hfsq_lo = fma(0.5*f, f, -hfsq);
+   a = f - hfsq;
+   a_lo = (f - a) - hfsq;
+   t = s*(hfsq + R) - hfsq_lo + a_lo;
+
+   ed = (double) e;
+   b = ed*LN2_HI;
+   hi = b + a;
+   bb = hi - b;
+   lo = (b - (hi - bb)) + (a - bb) + (t + ed*LN2_LO);
+   sum = hi + lo;
+   *lo_p = lo - (sum - hi);
+   return sum;
+}  /* Log_core */
+
+/*---------------------------------------------------------------------
+ * Function:  Log_special
+ * Purpose:   Replace the result of Log_core for x <= 0, inf and NaN
+ */
+static inline double Log_special(double x, double r) {
+   r = x == 0.0 ? -INFINITY : r;
+   r = x < 0.0 ? NAN : r;
+   r = x == INFINITY ? x : r;
+   return x != x ? x : r;
+}  /* Log_special */
+
+/*---------------------------------------------------------------------
+ * Function:  Sqrt_core
+ * Purpose:   sqrt(x) from an estimate of 1/sqrt(x) refined by Newton's
+ *            method
+ * In args:   x:      the argument
+ *            steps:  Newton steps for 1/sqrt(x): each one squares the
+ *                    relative error, from about 3e-2 for the estimate
+ * Ret val:   the result: relative error about 1e-11 after 2 steps,
+ *            within an ulp after 3
+ *
+ * Note:
+ *    The estimate halves the exponent with an integer shift, and one
+ *    Newton step for sqrt(x) with the residual x - s*s ends.  The
+ *    hardware sqrt would be correctly rounded, but libm's sqrt may set
+ *    errno, which keeps the loop from vectorizing.  Subnormals are
+ *    scaled by 2^104 first.
+ */
+static inline double Sqrt_core(double x, int steps) {
+   double xs, h, y, s;
+   int sub, j;
+
+   sub = x < DBL_MIN;
+   xs = sub ? x*0x1p104 : x;
+   y = As_double(RSQRT_MAGIC - (As_bits(xs) >> 1));
+   h = 0.5*xs;
+   for (j = 0; j < steps; j++)
+      y = y*(1.5 - h*y*y);
+   s = xs*y;
+   s = s + 0.5*y*fma(-s, s, xs);
+   s = sub ? s*0x1p-52 : s;
+   s = x < 0.0 ? NAN : s;
+   return x == INFINITY ? x : s;
+}  /* Sqrt_core */
+
+/*---------------------------------------------------------------------
+ * Function:  Tanh_core
+ * Purpose:   tanh(x) = sign(x)*t/(t + 2), t = exp(2|x|) - 1
+ */
+static inline double Tanh_core(double x, int deg) {
+   double t = Expm1_core(2.0*fabs(x), deg);
+
+   return copysign(t/(t + 2.0), x);
+}  /* Tanh_core */
+
+/*---------------------------------------------------------------------
+ * Function:  Pow_core
+ * Purpose:   x^y = exp(y*log(x)) for positive finite x and finite y
+ *
+ * Note:
+ *    log(x) and the product with y are carried as hi + lo, since an
+ *    absolute error in y*log(x) is a relative error in the result.
+ */
+static inline double Pow_core(double x, double y, const double c[],
+      int log_d, int exp_d) {
+   double lh, ll, ph, pl;
+
+   lh = Log_core(x, c, log_d, &ll);
+   ph = y*lh;
+   pl = fma(y, lh, -ph) + y*ll;
+   pl = fabs(ph) < 1000.0 ? pl : 0.0;
+   return Exp_core(ph, pl, exp_d);
+}  /* Pow_core */
+
+/*---------------------------------------------------------------------
+ * Function:  Vmath_exp
+ * Purpose:   y[i] = exp(x[i])
+ * In args:   x:     the arguments
+ *            n:     their number
+ *            tier:  accuracy wanted
+ * Out args:  y:     the results (may be x)
+ */
+void Vmath_exp(
+      const double  x[]   /* in  */,
+      double        y[]   /* out */,
+      int           n     /* in  */,
+      Vmath_tier    tier  /* in  */) {
+   int c;
+
+   VMATH_PARALLEL_FOR
+   for (c = 0; c < n; c += VMATH_CHUNK)
+      Exp_chunk(x + c, y + c, n - c < VMATH_CHUNK ? n - c : VMATH_CHUNK,
+            tier);
+}  /* Vmath_exp */
+
+/*---------------------------------------------------------------------
+ * Function:  Vmath_log
+ * Purpose:   y[i] = log(x[i])
+ * In args:   x:     the arguments
+ *            n:     their number
+ *            tier:  accuracy wanted
+ * Out args:  y:     the results (may be x)
+ */
+void Vmath_log(
+      const double  x[]   /* in  */,
+      double        y[]   /* out */,
+      int           n     /* in  */,
+      Vmath_tier    tier  /* in  */) {
+   int c;
+
+   VMATH_PARALLEL_FOR
+   for (c = 0; c < n; c += VMATH_CHUNK)
+      Log_chunk(x + c, y + c, n - c < VMATH_CHUNK ? n - c : VMATH_CHUNK,
+            tier);
+}  /* Vmath_log */
+
+/*---------------------------------------------------------------------
+ * Function:  Vmath_sqrt
+ * Purpose:   y[i] = sqrt(x[i])
+ * In args:   x:     the arguments
+ *            n:     their number
+ *            tier:  accuracy wanted
+ * Out args:  y:     the results (may be x)
+ *
+ * Note:
+ *    The MEDIUM tier is already within an ulp, so ACCURATE is the same.
+ */
+void Vmath_sqrt(
+      const double  x[]   /* in  */,
+      double        y[]   /* out */,
+      int           n     /* in  */,
+      Vmath_tier    tier  /* in  */) {
+   int c;
+
+   VMATH_PARALLEL_FOR
+   for (c = 0; c < n; c += VMATH_CHUNK)
+      Sqrt_chunk(x + c, y + c, n - c < VMATH_CHUNK ? n - c : VMATH_CHUNK,
+            tier);
+}  /* Vmath_sqrt */
+
+/*---------------------------------------------------------------------
+ * Function:  Vmath_tanh
+ * Purpose:   y[i] = tanh(x[i])
+ * In args:   x:     the arguments
+ *            n:     their number
+ *            tier:  accuracy wanted
+ * Out args:  y:     the results (may be x)
+ */
+void Vmath_tanh(
+      const double  x[]   /* in  */,
+      double        y[]   /* out */,
+      int           n     /* in  */,
+      Vmath_tier    tier  /* in  */) {
+   int c;
+
+   VMATH_PARALLEL_FOR
+   for (c = 0; c < n; c += VMATH_CHUNK)
+      Tanh_chunk(x + c, y + c, n - c < VMATH_CHUNK ? n - c : VMATH_CHUNK,
+            tier);
+}  /* Vmath_tanh */
+
+/*---------------------------------------------------------------------
+ * Function:  Vmath_sigmoid
+ * Purpose:   y[i] = 1/(1 + exp(-x[i]))
+ * In args:   x:     the arguments
+ *            n:     their number
+ *            tier:  accuracy wanted
+ * Out args:  y:     the results (may be x)
+ */
+void Vmath_sigmoid(
+      const double  x[]   /* in  */,
+      double        y[]   /* out */,
+      int           n     /* in  */,
+      Vmath_tier    tier  /* in  */) {
+   int c;
+
+   VMATH_PARALLEL_FOR
+   for (c = 0; c < n; c += VMATH_CHUNK)
+      Sigmoid_chunk(x + c, y + c,
+            n - c < VMATH_CHUNK ? n - c : VMATH_CHUNK, tier);
+}  /* Vmath_sigmoid */
+
+/*---------------------------------------------------------------------
+ * Function:  Vmath_pow
+ * Purpose:   z[i] = pow(x[i], y[i])
+ * In args:   x:     the bases
+ *            y:     the exponents
+ *            n:     their number
+ *            tier:  accuracy wanted
+ * Out args:  z:     the results (may be x or y)
+ */
+void Vmath_pow(
+      const double  x[]   /* in  */,
+      const double  y[]   /* in  */,
+      double        z[]   /* out */,
+      int           n     /* in  */,
+      Vmath_tier    tier  /* in  */) {
+   int c;
+
+   VMATH_PARALLEL_FOR
+   for (c = 0; c < n; c += VMATH_CHUNK)
+      Pow_chunk(x + c, y + c, z + c,
+            n - c < VMATH_CHUNK ? n - c : VMATH_CHUNK, tier);
+}  /* Vmath_pow */
+
+/*---------------------------------------------------------------------
+ * Function:  Exp_chunk
+ * Purpose:   out = exp(x) over one chunk
+ */
+static void Exp_chunk(const double x[], double out[], int len,
+      Vmath_tier tier) {
+   int i;
+
+   switch (tier) {
+      case VMATH_FAST:
+         VMATH_LOOP(Exp_core(x[i], 0.0, exp_deg[VMATH_FAST]));
+         break;
+      case VMATH_MEDIUM:
+         VMATH_LOOP(Exp_core(x[i], 0.0, exp_deg[VMATH_MEDIUM]));
+         break;
+      default:
+         VMATH_LOOP(Exp_core(x[i], 0.0, exp_deg[VMATH_ACCURATE]));
+         break;
+   }
+}  /* Exp_chunk */
+
+/*---------------------------------------------------------------------
+ * Function:  Log_chunk
+ * Purpose:   out = log(x) over one chunk
+ *
+ * Note:
+ *    The special cases are patched in a second loop: with the selects
+ *    in the same loop, the compiler moves the polynomial under a branch
+ *    and stops vectorizing.  The first loop writes to a buffer so that
+ *    the second one can still read x when out is x.
+ */
+static void Log_chunk(const double x[], double out[], int len,
+      Vmath_tier tier) {
+   double buf[VMATH_CHUNK], lo;
+   int i;
+
+   switch (tier) {
+      case VMATH_FAST:
+         VEC_IVDEP
+         for (i = 0; i < len; i++)
+            buf[i] = Log_core(x[i], log_taylor, log_deg[VMATH_FAST], &lo);
+         break;
+      case VMATH_MEDIUM:
+         VEC_IVDEP
+         for (i = 0; i < len; i++)
+            buf[i] = Log_core(x[i], log_taylor, log_deg[VMATH_MEDIUM], &lo);
+         break;
+      default:
+         VEC_IVDEP
+         for (i = 0; i < len; i++)
+            buf[i] = Log_core(x[i], log_minimax, log_deg[VMATH_ACCURATE],
+                  &lo);
+         break;
+   }
+   VMATH_LOOP(Log_special(x[i], buf[i]));
+}  /* Log_chunk */
+
+/*---------------------------------------------------------------------
+ * Function:  Sqrt_chunk
+ * Purpose:   out = sqrt(x) over one chunk
+ */
+static void Sqrt_chunk(const double x[], double out[], int len,
+      Vmath_tier tier) {
+   int i;
+
+   if (tier == VMATH_FAST)
+      VMATH_LOOP(Sqrt_core(x[i], rsqrt_steps[VMATH_FAST]));
+   else
+      VMATH_LOOP(Sqrt_core(x[i], rsqrt_steps[VMATH_ACCURATE]));
+}  /* Sqrt_chunk */
+
+/*---------------------------------------------------------------------
+ * Function:  Tanh_chunk
+ * Purpose:   out = tanh(x) over one chunk
+ */
+static void Tanh_chunk(const double x[], double out[], int len,
+      Vmath_tier tier) {
+   int i;
+
+   switch (tier) {
+      case VMATH_FAST:
+         VMATH_LOOP(Tanh_core(x[i], exp_deg[VMATH_FAST]));
+         break;
+      case VMATH_MEDIUM:
+         VMATH_LOOP(Tanh_core(x[i], exp_deg[VMATH_MEDIUM]));
+         break;
+      default:
+         VMATH_LOOP(Tanh_core(x[i], exp_deg[VMATH_ACCURATE]));
+         break;
+   }
+}  /* Tanh_chunk */
+
+/*---------------------------------------------------------------------
+ * Function:  Sigmoid_chunk
+ * Purpose:   out = 1/(1 + exp(-x)) over one chunk
+ */
+static void Sigmoid_chunk(const double x[], double out[], int len,
+      Vmath_tier tier) {
+   int i;
+
+   switch (tier) {
+      case VMATH_FAST:
+         VMATH_LOOP(1.0/(1.0 + Exp_core(-x[i], 0.0, exp_deg[VMATH_FAST])));
+         break;
+      case VMATH_MEDIUM:
+         VMATH_LOOP(1.0/(1.0 + Exp_core(-x[i], 0.0, exp_deg[VMATH_MEDIUM])));
+         break;
+      default:
+         VMATH_LOOP(1.0/(1.0
+               + Exp_core(-x[i], 0.0, exp_deg[VMATH_ACCURATE])));
+         break;
+   }
+}  /* Sigmoid_chunk */
+
+/*---------------------------------------------------------------------
+ * Function:  Pow_chunk
+ * Purpose:   out = pow(x, y) over one chunk
+ *
+ * Note:
+ *    The results go to a buffer first, so that the few special cases
+ *    can still read x and y when out is one of them.
+ */
+static void Pow_chunk(const double x[], const double y[], double out[],
+      int len, Vmath_tier tier) {
+   double buf[VMATH_CHUNK], *z = buf;
+   int i;
+
+   switch (tier) {
+      case VMATH_FAST:
+         VEC_IVDEP
+         for (i = 0; i < len; i++)
+            z[i] = Pow_core(x[i], y[i], log_taylor, log_deg[VMATH_FAST],
+                  exp_deg[VMATH_FAST]);
+         break;
+      case VMATH_MEDIUM:
+         VEC_IVDEP
+         for (i = 0; i < len; i++)
+            z[i] = Pow_core(x[i], y[i], log_taylor, log_deg[VMATH_MEDIUM],
+                  exp_deg[VMATH_MEDIUM]);
+         break;
+      default:
+         VEC_IVDEP
+         for (i = 0; i < len; i++)
+            z[i] = Pow_core(x[i], y[i], log_minimax,
+                  log_deg[VMATH_ACCURATE], exp_deg[VMATH_ACCURATE]);
+         break;
+   }
+   for (i = 0; i < len; i++)
+      if (!(x[i] > 0.0 && x[i] < INFINITY && fabs(y[i]) < INFINITY))
+         z[i] = pow(x[i], y[i]);
+   memcpy(out, z, len*sizeof(double));
+}  /* Pow_chunk */
@@ -0,0 +1,54 @@
+/* File:     vector_math.h
+ *
+ * Purpose:  Elementwise exp, log, sqrt, tanh, sigmoid and pow over
+ *           (local blocks of) vectors of doubles, with a choice of
+ *           accuracy tiers.  The MPI programs apply them to their local
+ *           blocks; no communication is needed.
+ *
+ * Compile:  Link vector_math.c into the program (and -lm).  Add
+ *           -fopenmp to split long vectors between OpenMP threads.
+ *
+ * Notes:
+ * 1.  Calling libm once per element is compute bound: the calls are
+ *     not inlined, so the loops don't vectorize.  Here every function
+ *     is a range reduction and a polynomial written with selects
+ *     instead of branches, and the loops over the elements vectorize
+ *     for the ISA chosen with -march.
+ * 2.  The tiers trade polynomial degree for accuracy (max relative
+ *     error over the whole domain, as measured by mpi_vector_math.c):
+ *        VMATH_FAST      about 1e-7 (single precision)
+ *        VMATH_MEDIUM    about 1e-12
+ *        VMATH_ACCURATE  a few ulps
+ *     sqrt is Newton's method from a bit-level estimate: FAST is within
+ *     about 1e-11 and the other tiers within an ulp.  The error of pow
+ *     grows with |y*log(x)| in every tier; ACCURATE reaches some tens of
+ *     ulps near overflow.
+ * 3.  Special values (0, negative arguments of log and sqrt, infinities,
+ *     NaNs, subnormals) give the results of C99 Annex F, except that
+ *     errno is never set.  pow hands x <= 0 and infinite or NaN
+ *     arguments to libm.
+ * 4.  With OpenMP, vectors longer than VMATH_CHUNK elements are split
+ *     into chunks of VMATH_CHUNK shared statically between the threads.
+ * 5.  The output may be the same array as an input.
+ */
+#ifndef VECTOR_MATH_H
+#define VECTOR_MATH_H
+
+#define VMATH_CHUNK  4096
+
+typedef enum {
+   VMATH_FAST,
+   VMATH_MEDIUM,
+   VMATH_ACCURATE,
+   VMATH_NUM_TIERS
+} Vmath_tier;
+
+void Vmath_exp(const double x[], double y[], int n, Vmath_tier tier);
+void Vmath_log(const double x[], double y[], int n, Vmath_tier tier);
+void Vmath_sqrt(const double x[], double y[], int n, Vmath_tier tier);
+void Vmath_tanh(const double x[], double y[], int n, Vmath_tier tier);
+void Vmath_sigmoid(const double x[], double y[], int n, Vmath_tier tier);
+void Vmath_pow(const double x[], const double y[], double z[], int n,
+      Vmath_tier tier);
+
+#endif /* VECTOR_MATH_H */
@@ -0,0 +1,96 @@
+/* File:     vector_ops.c
+ *
+ * Purpose:  Instantiate the kernels declared in vector_ops.h for
+ *           double and float elements, plus the type-independent
+ *           helpers (aligned allocation and printing).
+ *
+ * Compile:  Linked into vector_add, mpi_vector_add and
+ *           mpi_vector_operations (see their headers).
+ */
+#define _POSIX_C_SOURCE 200809L  /* rand_r, posix_memalign */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <float.h>
+#include "vector_ops.h"
+
+#define VEC_CAT_(a, b)  a ## _ ## b
+#define VEC_CAT(a, b)   VEC_CAT_(a, b)
+
+#define VEC_T           double
+#define VEC_S           d
+#define VEC_SQRT        sqrt
+#define VEC_EPS         DBL_EPSILON
+#define VEC_MIN_NORMAL  DBL_MIN
+#define VEC_MAX_VAL     DBL_MAX
+#include "vector_ops_impl.h"
+#undef VEC_T
+#undef VEC_S
+#undef VEC_SQRT
+#undef VEC_EPS
+#undef VEC_MIN_NORMAL
+#undef VEC_MAX_VAL
+
+#define VEC_T           float
+#define VEC_S           f
+#define VEC_SQRT        sqrtf
+#define VEC_EPS         FLT_EPSILON
+#define VEC_MIN_NORMAL  FLT_MIN
+#define VEC_MAX_VAL     FLT_MAX
+#include "vector_ops_impl.h"
+#undef VEC_T
+#undef VEC_S
+#undef VEC_SQRT
+#undef VEC_EPS
+#undef VEC_MIN_NORMAL
+#undef VEC_MAX_VAL
+
+/*---------------------------------------------------------------------
+ * Function:  Vec_alloc
+ * Purpose:   Allocate storage for count elements aligned to VEC_ALIGN
+ * In args:   count:      number of elements
+ *            elem_size:  size of one element in bytes
+ * Ret val:   Pointer to the storage (release with free), or NULL if
+ *            the allocation fails
+ */
+void* Vec_alloc(
+      size_t  count      /* in */,
+      size_t  elem_size  /* in */) {
+   void* p;
+   size_t bytes = count*elem_size;
+
+   /* Round up so the last SIMD load of a block stays in the allocation */
+   bytes = (bytes + VEC_ALIGN - 1)/VEC_ALIGN*VEC_ALIGN;
+   if (bytes == 0) bytes = VEC_ALIGN;
+   if (posix_memalign(&p, VEC_ALIGN, bytes) != 0) return NULL;
+   return p;
+}  /* Vec_alloc */
+
+/*---------------------------------------------------------------------
+ * Function:  Print_vector_summary
+ * Purpose:   Print the contents of a vector (10 first and 10 last elements)
+ * In args:   b:      the vector to be printed
+ *            n:      the order of the vector
+ *            title:  title for print out
+ */
+void Print_vector_summary(
+      double  b[]     /* in */,
+      int     n       /* in */,
+      char    title[] /* in */) {
+    int i;
+    printf("%s\n", title);
+    printf("\t");
+    int elements_to_print = (n < 20) ? n : 10;
+    for (i = 0; i < elements_to_print; i++)
+        printf("%f ", b[i]);
+    printf("\t");
+    if (n >= 20) {
+        printf("\n\t...\n");
+        printf("\t");
+        for (i = n - 10; i < n; i++)
+            printf("%f ", b[i]);
+    }
+    printf("\n");
+}  /* Print_vector_summary */
@@ -0,0 +1,148 @@
+/* File:     vector_ops.h
+ *
+ * Purpose:  Serial vector kernels shared by vector_add.c,
+ *           mpi_vector_add.c and mpi_vector_operations.c.  The MPI
+ *           programs apply them to their local blocks.
+ *
+ * Compile:  Link vector_ops.c into the program, e.g.
+ *           gcc -g -Wall -O3 -march=native -o vector_add vector_add.c vector_ops.c
+ *
+ * Notes:
+ * 1.  Every kernel is specialized at compile time for double (_d)
+ *     and float (_f) elements from the template in vector_ops_impl.h.
+ *     The unsuffixed names are C11 _Generic macros that pick the
+ *     right version from the type of the output (or first) vector.
+ * 2.  The target ISA is chosen with -march: VEC_ALIGN follows the
+ *     widest SIMD register the compiler may use.
+ * 3.  Each kernel has a fast path for operands aligned to VEC_ALIGN
+ *     (all storage from Vec_alloc is) and a generic path otherwise.
+ */
+#ifndef VECTOR_OPS_H
+#define VECTOR_OPS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Alignment in bytes of the widest SIMD register for this ISA */
+#if defined(__AVX512F__)
+#define VEC_ALIGN 64
+#elif defined(__AVX__)
+#define VEC_ALIGN 32
+#else
+#define VEC_ALIGN 16
+#endif
+
+#define VEC_IS_ALIGNED(p) (((uintptr_t)(p)) % VEC_ALIGN == 0)
+
+/* Loop annotation: iterations are independent, vectorize the loop */
+#if defined(__clang__)
+#define VEC_IVDEP _Pragma("clang loop vectorize(enable)")
+#elif defined(__GNUC__)
+#define VEC_IVDEP _Pragma("GCC ivdep")
+#else
+#define VEC_IVDEP
+#endif
+
+#if defined(__GNUC__)
+#define VEC_ASSUME_ALIGNED(p) __builtin_assume_aligned((p), VEC_ALIGN)
+#else
+#define VEC_ASSUME_ALIGNED(p) (p)
+#endif
+
+/* Elements per cache-resident tile in the multi-step kernels */
+#define VEC_TILE 256
+
+void* Vec_alloc(size_t count, size_t elem_size);
+void Print_vector_summary(double b[], int n, char title[]);
+
+void Vector_sum_d(const double x[], const double y[], double z[], int n);
+void Vector_sum_f(const float x[], const float y[], float z[], int n);
+double Dot_product_d(const double x[], const double y[], int n);
+float Dot_product_f(const float x[], const float y[], int n);
+void Scalar_multiplication_d(double a[], int n, double scalar);
+void Scalar_multiplication_f(float a[], int n, float scalar);
+void Generate_vector_d(double a[], int n, int my_rank, int i_seed);
+void Generate_vector_f(float a[], int n, int my_rank, int i_seed);
+void Axpy_d(const double x[], double y[], int n, double alpha);
+void Axpy_f(const float x[], float y[], int n, float alpha);
+void Axpby_d(const double x[], double y[], int n, double alpha, double beta);
+void Axpby_f(const float x[], float y[], int n, float alpha, float beta);
+void Copy_vector_d(const double x[], double y[], int n);
+void Copy_vector_f(const float x[], float y[], int n);
+void Swap_vectors_d(double x[], double y[], int n);
+void Swap_vectors_f(float x[], float y[], int n);
+double Asum_d(const double x[], int n);
+float Asum_f(const float x[], int n);
+void Sumsq_merge_d(double* scale_p, double* ssq_p, double scale, double ssq);
+void Sumsq_merge_f(float* scale_p, float* ssq_p, float scale, float ssq);
+void Scaled_sumsq_d(const double x[], int n, double* scale_p, double* ssq_p);
+void Scaled_sumsq_f(const float x[], int n, float* scale_p, float* ssq_p);
+double Nrm2_d(const double x[], int n);
+float Nrm2_f(const float x[], int n);
+int Iamax_d(const double x[], int n);
+int Iamax_f(const float x[], int n);
+int Iamin_d(const double x[], int n);
+int Iamin_f(const float x[], int n);
+double Prefix_sum_d(const double x[], double z[], int n, double carry,
+      int inclusive);
+float Prefix_sum_f(const float x[], float z[], int n, float carry,
+      int inclusive);
+double Vector_total_d(const double x[], int n);
+float Vector_total_f(const float x[], int n);
+void Add_scalar_d(double a[], int n, double value);
+void Add_scalar_f(float a[], int n, float value);
+
+#define Vector_sum(x, y, z, n) _Generic((z), \
+      double*: Vector_sum_d, \
+      float*:  Vector_sum_f)(x, y, z, n)
+#define Dot_product(x, y, n) _Generic((x), \
+      double*: Dot_product_d, const double*: Dot_product_d, \
+      float*:  Dot_product_f, const float*:  Dot_product_f)(x, y, n)
+#define Scalar_multiplication(a, n, scalar) _Generic((a), \
+      double*: Scalar_multiplication_d, \
+      float*:  Scalar_multiplication_f)(a, n, scalar)
+#define Generate_vector(a, n, my_rank, i_seed) _Generic((a), \
+      double*: Generate_vector_d, \
+      float*:  Generate_vector_f)(a, n, my_rank, i_seed)
+
+#define Axpy(x, y, n, alpha) _Generic((y), \
+      double*: Axpy_d, \
+      float*:  Axpy_f)(x, y, n, alpha)
+#define Axpby(x, y, n, alpha, beta) _Generic((y), \
+      double*: Axpby_d, \
+      float*:  Axpby_f)(x, y, n, alpha, beta)
+#define Copy_vector(x, y, n) _Generic((y), \
+      double*: Copy_vector_d, \
+      float*:  Copy_vector_f)(x, y, n)
+#define Swap_vectors(x, y, n) _Generic((x), \
+      double*: Swap_vectors_d, \
+      float*:  Swap_vectors_f)(x, y, n)
+#define Asum(x, n) _Generic((x), \
+      double*: Asum_d, const double*: Asum_d, \
+      float*:  Asum_f, const float*:  Asum_f)(x, n)
+#define Sumsq_merge(scale_p, ssq_p, scale, ssq) _Generic((scale_p), \
+      double*: Sumsq_merge_d, \
+      float*:  Sumsq_merge_f)(scale_p, ssq_p, scale, ssq)
+#define Scaled_sumsq(x, n, scale_p, ssq_p) _Generic((scale_p), \
+      double*: Scaled_sumsq_d, \
+      float*:  Scaled_sumsq_f)(x, n, scale_p, ssq_p)
+#define Nrm2(x, n) _Generic((x), \
+      double*: Nrm2_d, const double*: Nrm2_d, \
+      float*:  Nrm2_f, const float*:  Nrm2_f)(x, n)
+#define Iamax(x, n) _Generic((x), \
+      double*: Iamax_d, const double*: Iamax_d, \
+      float*:  Iamax_f, const float*:  Iamax_f)(x, n)
+#define Iamin(x, n) _Generic((x), \
+      double*: Iamin_d, const double*: Iamin_d, \
+      float*:  Iamin_f, const float*:  Iamin_f)(x, n)
+#define Prefix_sum(x, z, n, carry, inclusive) _Generic((z), \
+      double*: Prefix_sum_d, \
+      float*:  Prefix_sum_f)(x, z, n, carry, inclusive)
+#define Vector_total(x, n) _Generic((x), \
+      double*: Vector_total_d, const double*: Vector_total_d, \
+      float*:  Vector_total_f, const float*:  Vector_total_f)(x, n)
+#define Add_scalar(a, n, value) _Generic((a), \
+      double*: Add_scalar_d, \
+      float*:  Add_scalar_f)(a, n, value)
+
+#endif /* VECTOR_OPS_H */
@@ -0,0 +1,566 @@
+/* File:     vector_ops_impl.h
+ *
+ * Purpose:  Element-type template for the kernels in vector_ops.h.
+ *           vector_ops.c includes this file once per element type
+ *           after defining
+ *              VEC_T:  the element type (e.g., double)
+ *              VEC_S:  the suffix used in the function names (e.g., d)
+ *              VEC_SQRT, VEC_EPS, VEC_MIN_NORMAL, VEC_MAX_VAL:
+ *                      sqrt and the <float.h> limits for VEC_T
+ *
+ * Notes:
+ * 1.  No include guard: this file is meant to be included repeatedly.
+ * 2.  Loops carry VEC_IVDEP so the compiler vectorizes them even when
+ *     an output aliases an input at the same index (e.g., x = x + y).
+ * 3.  Reductions keep VEC_ACC independent partial sums so that they
+ *     vectorize without -ffast-math and give the same result on every
+ *     run for a given n.
+ */
+
+#define VEC_FN(name)  VEC_CAT(name, VEC_S)
+#define VEC_ACC       (2*VEC_ALIGN/(int)sizeof(VEC_T))
+#define VEC_ABS(a)    ((a) < 0 ? -(a) : (a))
+
+/*---------------------------------------------------------------------
+ * Function:  Vector_sum
+ * Purpose:   Add two vectors
+ * In args:   x:  the first vector to be added
+ *            y:  the second vector to be added
+ *            n:  the order of the vectors
+ * Out arg:   z:  the sum vector (may be x or y)
+ */
+void VEC_FN(Vector_sum)(
+      const VEC_T  x[]  /* in  */,
+      const VEC_T  y[]  /* in  */,
+      VEC_T        z[]  /* out */,
+      int          n    /* in  */) {
+   int i;
+
+   if (VEC_IS_ALIGNED(x) && VEC_IS_ALIGNED(y) && VEC_IS_ALIGNED(z)) {
+      const VEC_T* ax = VEC_ASSUME_ALIGNED(x);
+      const VEC_T* ay = VEC_ASSUME_ALIGNED(y);
+      VEC_T* az = VEC_ASSUME_ALIGNED(z);
+      VEC_IVDEP
+      for (i = 0; i < n; i++)
+         az[i] = ax[i] + ay[i];
+   } else {
+      VEC_IVDEP
+      for (i = 0; i < n; i++)
+         z[i] = x[i] + y[i];
+   }
+}  /* Vector_sum */
+
+/*---------------------------------------------------------------------
+ * Function:  Dot_product
+ * Purpose:   Compute the dot product of two vectors
+ * In args:   x, y:  the vectors
+ *            n:     the order of the vectors
+ * Ret val:   sum of x[i]*y[i]
+ */
+VEC_T VEC_FN(Dot_product)(
+      const VEC_T  x[]  /* in */,
+      const VEC_T  y[]  /* in */,
+      int          n    /* in */) {
+   VEC_T acc[VEC_ACC] = {0};
+   VEC_T dot = 0;
+   int i, j;
+
+   if (VEC_IS_ALIGNED(x) && VEC_IS_ALIGNED(y)) {
+      const VEC_T* ax = VEC_ASSUME_ALIGNED(x);
+      const VEC_T* ay = VEC_ASSUME_ALIGNED(y);
+      for (i = 0; i + VEC_ACC <= n; i += VEC_ACC)
+         for (j = 0; j < VEC_ACC; j++)
+            acc[j] += ax[i+j]*ay[i+j];
+   } else {
+      for (i = 0; i + VEC_ACC <= n; i += VEC_ACC)
+         for (j = 0; j < VEC_ACC; j++)
+            acc[j] += x[i+j]*y[i+j];
+   }
+   for (; i < n; i++)
+      acc[0] += x[i]*y[i];
+   for (j = 0; j < VEC_ACC; j++)
+      dot += acc[j];
+   return dot;
+}  /* Dot_product */
+
+/*---------------------------------------------------------------------
+ * Function:  Scalar_multiplication
+ * Purpose:   Multiply each element of a vector by a scalar
+ * In args:   n:       the order of the vector
+ *            scalar:  the factor
+ * In/out:    a:       the vector to be scaled
+ */
+void VEC_FN(Scalar_multiplication)(
+      VEC_T  a[]     /* in/out */,
+      int    n       /* in     */,
+      VEC_T  scalar  /* in     */) {
+   int i;
+
+   if (VEC_IS_ALIGNED(a)) {
+      VEC_T* aa = VEC_ASSUME_ALIGNED(a);
+      VEC_IVDEP
+      for (i = 0; i < n; i++)
+         aa[i] *= scalar;
+   } else {
+      VEC_IVDEP
+      for (i = 0; i < n; i++)
+         a[i] *= scalar;
+   }
+}  /* Scalar_multiplication */
+
+/*---------------------------------------------------------------------
+ * Function:  Generate_vector
+ * Purpose:   Generate a vector with random numbers in [0, 1]
+ * In args:   n:        the order of the vector
+ *            my_rank:  rank of the calling process (0 if serial)
+ *            i_seed:   distinguishes vectors generated by one process
+ * Out arg:   a:        the vector to be generated
+ */
+void VEC_FN(Generate_vector)(
+      VEC_T  a[]      /* out */,
+      int    n        /* in  */,
+      int    my_rank  /* in  */,
+      int    i_seed   /* in  */) {
+   unsigned int seed = (unsigned int)time(NULL) + my_rank + i_seed;
+   int i;
+
+   for (i = 0; i < n; i++)
+      a[i] = (VEC_T)((double)rand_r(&seed) / RAND_MAX);
+}  /* Generate_vector */
+
+/*---------------------------------------------------------------------
+ * Function:  Axpy
+ * Purpose:   y = alpha*x + y
+ * In args:   x:      the vector to be scaled and added
+ *            n:      the order of the vectors
+ *            alpha:  the factor
+ * In/out:    y:      the vector to be updated
+ */
+void VEC_FN(Axpy)(
+      const VEC_T  x[]    /* in     */,
+      VEC_T        y[]    /* in/out */,
+      int          n      /* in     */,
+      VEC_T        alpha  /* in     */) {
+   int i;
+
+   if (VEC_IS_ALIGNED(x) && VEC_IS_ALIGNED(y)) {
+      const VEC_T* ax = VEC_ASSUME_ALIGNED(x);
+      VEC_T* ay = VEC_ASSUME_ALIGNED(y);
+      VEC_IVDEP
+      for (i = 0; i < n; i++)
+         ay[i] += alpha*ax[i];
+   } else {
+      VEC_IVDEP
+      for (i = 0; i < n; i++)
+         y[i] += alpha*x[i];
+   }
+}  /* Axpy */
+
+/*---------------------------------------------------------------------
+ * Function:  Axpby
+ * Purpose:   y = alpha*x + beta*y
+ * In args:   x:      the vector to be scaled and added
+ *            n:      the order of the vectors
+ *            alpha:  the factor for x
+ *            beta:   the factor for y
+ * In/out:    y:      the vector to be updated
+ */
+void VEC_FN(Axpby)(
+      const VEC_T  x[]    /* in     */,
+      VEC_T        y[]    /* in/out */,
+      int          n      /* in     */,
+      VEC_T        alpha  /* in     */,
+      VEC_T        beta   /* in     */) {
+   int i;
+
+   if (VEC_IS_ALIGNED(x) && VEC_IS_ALIGNED(y)) {
+      const VEC_T* ax = VEC_ASSUME_ALIGNED(x);
+      VEC_T* ay = VEC_ASSUME_ALIGNED(y);
+      VEC_IVDEP
+      for (i = 0; i < n; i++)
+         ay[i] = alpha*ax[i] + beta*ay[i];
+   } else {
+      VEC_IVDEP
+      for (i = 0; i < n; i++)
+         y[i] = alpha*x[i] + beta*y[i];
+   }
+}  /* Axpby */
+
+/*---------------------------------------------------------------------
+ * Function:  Copy_vector
+ * Purpose:   y = x
+ * In args:   x:  the source vector
+ *            n:  the order of the vectors
+ * Out arg:   y:  the destination (must not overlap x)
+ */
+void VEC_FN(Copy_vector)(
+      const VEC_T  x[]  /* in  */,
+      VEC_T        y[]  /* out */,
+      int          n    /* in  */) {
+   if (n > 0) memcpy(y, x, (size_t)n*sizeof(VEC_T));
+}  /* Copy_vector */
+
+/*---------------------------------------------------------------------
+ * Function:  Swap_vectors
+ * Purpose:   Exchange the contents of x and y
+ * In arg:    n:     the order of the vectors
+ * In/out:    x, y:  the vectors
+ */
+void VEC_FN(Swap_vectors)(
+      VEC_T  x[]  /* in/out */,
+      VEC_T  y[]  /* in/out */,
+      int    n    /* in     */) {
+   VEC_T t;
+   int i;
+
+   VEC_IVDEP
+   for (i = 0; i < n; i++) {
+      t = x[i];
+      x[i] = y[i];
+      y[i] = t;
+   }
+}  /* Swap_vectors */
+
+/*---------------------------------------------------------------------
+ * Function:  Asum
+ * Purpose:   Sum of the absolute values of the elements of x
+ * In args:   x:  the vector
+ *            n:  the order of the vector
+ */
+VEC_T VEC_FN(Asum)(
+      const VEC_T  x[]  /* in */,
+      int          n    /* in */) {
+   VEC_T acc[VEC_ACC] = {0};
+   VEC_T sum = 0;
+   int i, j;
+
+   for (i = 0; i + VEC_ACC <= n; i += VEC_ACC)
+      for (j = 0; j < VEC_ACC; j++)
+         acc[j] += VEC_ABS(x[i+j]);
+   for (; i < n; i++)
+      acc[0] += VEC_ABS(x[i]);
+   for (j = 0; j < VEC_ACC; j++)
+      sum += acc[j];
+   return sum;
+}  /* Asum */
+
+/*---------------------------------------------------------------------
+ * Function:  Sumsq_merge
+ * Purpose:   Combine two scaled sums of squares, each standing for
+ *            scale^2*ssq, without overflow or underflow
+ * In/out:    scale_p, ssq_p:  the first pair, replaced by the result
+ * In args:   scale, ssq:      the second pair
+ *
+ * Note:
+ *    Tiles in the safe range come in unscaled (scale 1) with ssq up to
+ *    VEC_MAX_VAL/2, so ssq can't be allowed to pile up: once it passes
+ *    VEC_MAX_VAL/(2*VEC_TILE) it is folded into scale, leaving ssq = 1.
+ */
+void VEC_FN(Sumsq_merge)(
+      VEC_T*  scale_p  /* in/out */,
+      VEC_T*  ssq_p    /* in/out */,
+      VEC_T   scale    /* in     */,
+      VEC_T   ssq      /* in     */) {
+   VEC_T r;
+
+   if (scale == 0 || ssq == 0) return;
+   if (*scale_p >= scale) {
+      r = scale / *scale_p;
+      *ssq_p += ssq*r*r;
+   } else {
+      r = *scale_p / scale;
+      *ssq_p = ssq + *ssq_p*r*r;
+      *scale_p = scale;
+   }
+   if (*ssq_p > VEC_MAX_VAL/(2*VEC_TILE)) {
+      *scale_p *= VEC_SQRT(*ssq_p);
+      *ssq_p = 1;
+   }
+}  /* Sumsq_merge */
+
+/*---------------------------------------------------------------------
+ * Function:  Scaled_sumsq
+ * Purpose:   Compute scale and ssq with scale^2*ssq = sum of x[i]^2,
+ *            so that the 2-norm scale*sqrt(ssq) can't overflow or
+ *            underflow
+ * In args:   x:  the vector
+ *            n:  the order of the vector
+ * Out args:  scale_p, ssq_p:  the scaled sum of squares
+ *
+ * Note:
+ *    One pass over memory.  Each tile of VEC_TILE elements is summed
+ *    unscaled; only a tile whose largest element is outside the safe
+ *    range is summed again (from cache) after scaling by that element.
+ */
+void VEC_FN(Scaled_sumsq)(
+      const VEC_T  x[]      /* in  */,
+      int          n        /* in  */,
+      VEC_T*       scale_p  /* out */,
+      VEC_T*       ssq_p    /* out */) {
+   const VEC_T tsml = VEC_SQRT(VEC_MIN_NORMAL/VEC_EPS);
+   const VEC_T tbig = VEC_SQRT(VEC_MAX_VAL/(2*VEC_TILE));
+   VEC_T acc[VEC_ACC], amax[VEC_ACC];
+   VEC_T tile_max, tile_ssq, inv, a;
+   int start, len, i, j;
+
+   *scale_p = 0;
+   *ssq_p = 1;
+   for (start = 0; start < n; start += VEC_TILE) {
+      const VEC_T* t = x + start;
+      len = (n - start < VEC_TILE) ? n - start : VEC_TILE;
+      for (j = 0; j < VEC_ACC; j++)
+         acc[j] = amax[j] = 0;
+      for (i = 0; i + VEC_ACC <= len; i += VEC_ACC)
+         for (j = 0; j < VEC_ACC; j++) {
+            a = VEC_ABS(t[i+j]);
+            amax[j] = (a > amax[j]) ? a : amax[j];
+            acc[j] += t[i+j]*t[i+j];
+         }
+      for (; i < len; i++) {
+         a = VEC_ABS(t[i]);
+         amax[0] = (a > amax[0]) ? a : amax[0];
+         acc[0] += t[i]*t[i];
+      }
+      tile_max = tile_ssq = 0;
+      for (j = 0; j < VEC_ACC; j++) {
+         tile_max = (amax[j] > tile_max) ? amax[j] : tile_max;
+         tile_ssq += acc[j];
+      }
+      if (tile_max == 0) continue;
+
+      if (tile_max >= tsml && tile_max <= tbig) {
+         VEC_FN(Sumsq_merge)(scale_p, ssq_p, 1, tile_ssq);
+      } else {
+         inv = 1/tile_max;
+         tile_ssq = 0;
+         for (i = 0; i < len; i++)
+            tile_ssq += (t[i]*inv)*(t[i]*inv);
+         VEC_FN(Sumsq_merge)(scale_p, ssq_p, tile_max, tile_ssq);
+      }
+   }
+   if (*scale_p == 0) *ssq_p = 0;
+}  /* Scaled_sumsq */
+
+/*---------------------------------------------------------------------
+ * Function:  Nrm2
+ * Purpose:   Overflow-safe 2-norm of x
+ * In args:   x:  the vector
+ *            n:  the order of the vector
+ */
+VEC_T VEC_FN(Nrm2)(
+      const VEC_T  x[]  /* in */,
+      int          n    /* in */) {
+   VEC_T scale, ssq;
+
+   VEC_FN(Scaled_sumsq)(x, n, &scale, &ssq);
+   return scale*VEC_SQRT(ssq);
+}  /* Nrm2 */
+
+/*---------------------------------------------------------------------
+ * Function:  Iamax
+ * Purpose:   Index of the first element of x with the largest
+ *            absolute value (0-based)
+ * In args:   x:  the vector
+ *            n:  the order of the vector
+ * Ret val:   The index, or -1 if n <= 0 or every element is NaN
+ *
+ * Note:
+ *    NaNs never compare larger, so they are skipped.
+ *    The largest value of each tile is found with a vectorized
+ *    reduction; the tile (still in cache) is rescanned for its
+ *    position only when it beats the best value so far.
+ */
+int VEC_FN(Iamax)(
+      const VEC_T  x[]  /* in */,
+      int          n    /* in */) {
+   VEC_T m[VEC_ACC], best = -1, tile_best, a;
+   int start, len, i, j, best_i = -1;
+
+   for (start = 0; start < n; start += VEC_TILE) {
+      const VEC_T* t = x + start;
+      len = (n - start < VEC_TILE) ? n - start : VEC_TILE;
+      for (j = 0; j < VEC_ACC; j++)
+         m[j] = -1;
+      for (i = 0; i + VEC_ACC <= len; i += VEC_ACC)
+         for (j = 0; j < VEC_ACC; j++) {
+            a = VEC_ABS(t[i+j]);
+            m[j] = (a > m[j]) ? a : m[j];
+         }
+      for (; i < len; i++) {
+         a = VEC_ABS(t[i]);
+         m[0] = (a > m[0]) ? a : m[0];
+      }
+      tile_best = m[0];
+      for (j = 1; j < VEC_ACC; j++)
+         tile_best = (m[j] > tile_best) ? m[j] : tile_best;
+      if (tile_best > best) {
+         for (i = 0; VEC_ABS(t[i]) != tile_best; i++) ;
+         best = tile_best;
+         best_i = start + i;
+      }
+   }
+   return best_i;
+}  /* Iamax */
+
+/*---------------------------------------------------------------------
+ * Function:  Iamin
+ * Purpose:   Index of the first element of x with the smallest
+ *            absolute value (0-based)
+ * In args:   x:  the vector
+ *            n:  the order of the vector
+ * Ret val:   The index, or -1 if n <= 0 or every element is NaN
+ *
+ * Note:
+ *    As in Iamax, NaNs never compare smaller, so they are skipped.
+ */
+int VEC_FN(Iamin)(
+      const VEC_T  x[]  /* in */,
+      int          n    /* in */) {
+   VEC_T m[VEC_ACC], best = (VEC_T) INFINITY, tile_best, a;
+   int start, len, i, j, best_i = -1;
+
+   for (start = 0; start < n; start += VEC_TILE) {
+      const VEC_T* t = x + start;
+      len = (n - start < VEC_TILE) ? n - start : VEC_TILE;
+      for (j = 0; j < VEC_ACC; j++)
+         m[j] = (VEC_T) INFINITY;
+      for (i = 0; i + VEC_ACC <= len; i += VEC_ACC)
+         for (j = 0; j < VEC_ACC; j++) {
+            a = VEC_ABS(t[i+j]);
+            m[j] = (a < m[j]) ? a : m[j];
+         }
+      for (; i < len; i++) {
+         a = VEC_ABS(t[i]);
+         m[0] = (a < m[0]) ? a : m[0];
+      }
+      tile_best = m[0];
+      for (j = 1; j < VEC_ACC; j++)
+         tile_best = (m[j] < tile_best) ? m[j] : tile_best;
+      if (best_i < 0 || tile_best < best) {
+         /* No match if the tile is all NaN (tile_best stays inf) */
+         for (i = 0; i < len && VEC_ABS(t[i]) != tile_best; i++) ;
+         if (i < len) {
+            best = tile_best;
+            best_i = start + i;
+         }
+      }
+   }
+   return best_i;
+}  /* Iamin */
+
+/*---------------------------------------------------------------------
+ * Function:  Prefix_sum
+ * Purpose:   Inclusive (z[i] = carry + x[0] + ... + x[i]) or exclusive
+ *            (z[i] = carry + x[0] + ... + x[i-1]) prefix sum
+ * In args:   x:          the vector
+ *            n:          the order of the vectors
+ *            carry:      value added to every prefix (sum of anything
+ *                        preceding x)
+ *            inclusive:  1 for an inclusive scan, 0 for exclusive
+ * Out arg:   z:          the prefix sums (may be x)
+ * Ret val:   carry + the sum of all elements of x
+ *
+ * Note:
+ *    A plain scan is one long chain of dependent additions.  Each tile
+ *    is split into VEC_ACC segments: their sums are computed first,
+ *    then the segments are scanned as VEC_ACC independent chains that
+ *    the processor (or the vectorizer) runs side by side.  The tile is
+ *    still in cache for the second step.
+ */
+VEC_T VEC_FN(Prefix_sum)(
+      const VEC_T  x[]        /* in  */,
+      VEC_T        z[]        /* out */,
+      int          n          /* in  */,
+      VEC_T        carry      /* in  */,
+      int          inclusive  /* in  */) {
+   VEC_T run[VEC_ACC], t;
+   int start, len, seg, i, j;
+
+   for (start = 0; start < n; start += VEC_TILE) {
+      len = (n - start < VEC_TILE) ? n - start : VEC_TILE;
+      seg = len / VEC_ACC;
+
+      /* Segment sums, then their exclusive scan seeded by carry */
+      for (j = 0; j < VEC_ACC; j++) {
+         run[j] = 0;
+         for (i = 0; i < seg; i++)
+            run[j] += x[start + j*seg + i];
+      }
+      for (j = 0; j < VEC_ACC; j++) {
+         t = run[j];
+         run[j] = carry;
+         carry += t;
+      }
+
+      /* Independent chains, one per segment */
+      for (i = 0; i < seg; i++)
+         for (j = 0; j < VEC_ACC; j++) {
+            t = x[start + j*seg + i];
+            if (inclusive) {
+               run[j] += t;
+               z[start + j*seg + i] = run[j];
+            } else {
+               z[start + j*seg + i] = run[j];
+               run[j] += t;
+            }
+         }
+
+      /* Leftover elements of a short tile */
+      for (i = VEC_ACC*seg; i < len; i++) {
+         t = x[start + i];
+         if (inclusive) {
+            carry += t;
+            z[start + i] = carry;
+         } else {
+            z[start + i] = carry;
+            carry += t;
+         }
+      }
+   }
+   return carry;
+}  /* Prefix_sum */
+
+/*---------------------------------------------------------------------
+ * Function:  Vector_total
+ * Purpose:   Sum of the elements of x
+ * In args:   x:  the vector
+ *            n:  the order of the vector
+ */
+VEC_T VEC_FN(Vector_total)(
+      const VEC_T  x[]  /* in */,
+      int          n    /* in */) {
+   VEC_T acc[VEC_ACC] = {0};
+   VEC_T sum = 0;
+   int i, j;
+
+   for (i = 0; i + VEC_ACC <= n; i += VEC_ACC)
+      for (j = 0; j < VEC_ACC; j++)
+         acc[j] += x[i+j];
+   for (; i < n; i++)
+      acc[0] += x[i];
+   for (j = 0; j < VEC_ACC; j++)
+      sum += acc[j];
+   return sum;
+}  /* Vector_total */
+
+/*---------------------------------------------------------------------
+ * Function:  Add_scalar
+ * Purpose:   a[i] += value for every element
+ * In args:   n:      the order of the vector
+ *            value:  the value to add
+ * In/out:    a:      the vector
+ */
+void VEC_FN(Add_scalar)(
+      VEC_T  a[]    /* in/out */,
+      int    n      /* in     */,
+      VEC_T  value  /* in     */) {
+   int i;
+
+   VEC_IVDEP
+   for (i = 0; i < n; i++)
+      a[i] += value;
+}  /* Add_scalar */
+
+#undef VEC_ABS
+#undef VEC_ACC
+#undef VEC_FN